@@ -0,0 +1,99 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <math.h>
+#include <string>
+#include "common.h"
+
+namespace baikaldb {
+// 简单的bloom filter，序列化为字符串后可以随表达式下发到store
+// 格式：第1字节为hash次数，之后为bit数组
+// 使用64位hash拆成两个32位做double hashing
+class BloomFilter {
+public:
+    BloomFilter() {}
+
+    static uint64_t hash(const std::string& key) {
+        uint64_t out[2];
+        butil::MurmurHash3_x64_128(key.data(), key.size(), 0x1234, out);
+        return out[0];
+    }
+
+    // 按预期元素个数与误判率计算bit数与hash次数，max_bytes限制序列化后的大小
+    void init(int64_t expected_num, double fpp, int64_t max_bytes) {
+        if (expected_num < 1) {
+            expected_num = 1;
+        }
+        if (fpp <= 0 || fpp >= 1) {
+            fpp = 0.01;
+        }
+        int64_t num_bits = (int64_t)(-expected_num * log(fpp) / (M_LN2 * M_LN2));
+        if (max_bytes > 0) {
+            num_bits = std::min(num_bits, max_bytes * 8);
+        }
+        num_bits = std::max<int64_t>(num_bits, 64);
+        int hash_num = (int)round((double)num_bits / expected_num * M_LN2);
+        hash_num = std::min(std::max(hash_num, 1), 16);
+        _data.assign(1 + (num_bits + 7) / 8, '\0');
+        _data[0] = (char)hash_num;
+    }
+
+    bool init_from_string(const std::string& data) {
+        if (data.size() < 2 || data[0] <= 0) {
+            return false;
+        }
+        _data = data;
+        return true;
+    }
+
+    bool empty() const {
+        return _data.size() < 2;
+    }
+
+    void add_hash(uint64_t hash) {
+        uint64_t num_bits = (_data.size() - 1) * 8;
+        uint32_t h1 = hash;
+        uint32_t h2 = hash >> 32;
+        uint8_t* bits = (uint8_t*)&_data[1];
+        for (int i = 0; i < _data[0]; i++) {
+            uint64_t pos = (h1 + (uint64_t)i * h2) % num_bits;
+            bits[pos >> 3] |= (1 << (pos & 7));
+        }
+    }
+
+    bool may_contain_hash(uint64_t hash) const {
+        uint64_t num_bits = (_data.size() - 1) * 8;
+        uint32_t h1 = hash;
+        uint32_t h2 = hash >> 32;
+        const uint8_t* bits = (const uint8_t*)&_data[1];
+        for (int i = 0; i < _data[0]; i++) {
+            uint64_t pos = (h1 + (uint64_t)i * h2) % num_bits;
+            if ((bits[pos >> 3] & (1 << (pos & 7))) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const std::string& data() const {
+        return _data;
+    }
+
+private:
+    std::string _data;
+};
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,90 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <bthread/bthread.h>
+#include <bthread/mutex.h>
+#include <bthread/condition_variable.h>
+
+namespace baikaldb {
+// 并发请求合并为一批处理
+// 第一个排队的调用者成为本轮leader，等待window_us后取出队列中最多max_size个请求，
+// 调用commit处理整批，commit负责把结果写回各请求；其余调用者等待本轮完成后返回
+// 只合并leader开始处理前排队的请求，处理期间到达的请求进入下一轮
+template <typename Request>
+class GroupCommitter {
+public:
+    typedef std::function<void(std::vector<Request*>&)> CommitFunc;
+    explicit GroupCommitter(const CommitFunc& commit) : _commit(commit) {}
+
+    // 返回时request所在的批已经处理完成
+    void submit(Request* request, int64_t window_us, size_t max_size) {
+        Waiter w;
+        w.request = request;
+        std::vector<Waiter*> group;
+        {
+            std::unique_lock<bthread::Mutex> lck(_mutex);
+            _queue.emplace_back(&w);
+            while (!w.done && (_committing || _queue.front() != &w)) {
+                _cv.wait(lck);
+            }
+            if (w.done) {
+                return;
+            }
+            _committing = true;
+        }
+        if (window_us > 0) {
+            bthread_usleep(window_us);
+        }
+        std::vector<Request*> requests;
+        {
+            std::unique_lock<bthread::Mutex> lck(_mutex);
+            max_size = std::max<size_t>(max_size, 1);
+            while (!_queue.empty() && group.size() < max_size) {
+                group.emplace_back(_queue.front());
+                requests.emplace_back(_queue.front()->request);
+                _queue.pop_front();
+            }
+        }
+        _commit(requests);
+        {
+            std::unique_lock<bthread::Mutex> lck(_mutex);
+            for (auto waiter : group) {
+                waiter->done = true;
+            }
+            _committing = false;
+            _cv.notify_all();
+        }
+    }
+
+private:
+    struct Waiter {
+        Request* request = nullptr;
+        bool done = false;
+    };
+    CommitFunc _commit;
+    bthread::Mutex _mutex;
+    bthread::ConditionVariable _cv;
+    std::deque<Waiter*> _queue;
+    bool _committing = false;
+};
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -158,6 +158,8 @@ public:
             const FieldDescriptor* field, 
             const FieldInfo& field_info,
             int& pos) const;
+    // 解码为ExprValue，供列存直接解码使用，不经过protobuf反射
+    int decode_field(const FieldInfo& field_info, int& pos, ExprValue* value) const;
 
     int skip_field(const FieldInfo& field_info, int& pos) const;
 private:
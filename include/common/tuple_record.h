@@ -21,6 +21,7 @@
 #include "rocksdb/slice.h"
 
 namespace baikaldb {
+class ColumnBatch;
 class TupleRecord {
 public:
     TupleRecord(rocksdb::Slice slice) {
@@ -85,6 +86,10 @@ public:
     }
     int decode_fields(const std::map<int32_t, FieldInfo*>& fields, const std::vector<int32_t>* field_slot,
             SmartRecord* record, int32_t tuple_id, std::unique_ptr<MemRow>* mem_row);
+    // 直接解码到ColumnBatch的tuple_id列中，不经过MemRow和protobuf反射
+    // 调用方负责finish_row/rollback_row
+    int decode_fields(const std::map<int32_t, FieldInfo*>& fields, const std::vector<int32_t>& field_slot,
+            int32_t tuple_id, ColumnBatch* batch);
 
     int verification_fields(int32_t max_field_id);
 private:
@@ -0,0 +1,57 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Brief:  采样region读写访问的主键，按访问分布计算热点region的分裂点
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "rocksdb/slice.h"
+#include "common.h"
+
+namespace baikaldb {
+DECLARE_int32(load_split_sample_rate);
+DECLARE_int32(load_split_max_samples);
+DECLARE_int32(load_split_min_samples);
+DECLARE_int32(load_split_min_balance_percent);
+
+class KeySampler {
+public:
+    // 只有读写qps超过阈值的region才开启，常规region只多一次原子读
+    void set_enabled(bool enabled) {
+        _enabled.store(enabled, std::memory_order_relaxed);
+    }
+    bool enabled() const {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+    // key为rocksdb中的完整key：region_id + index_id + 主键
+    void sample(const rocksdb::Slice& key);
+    // 选择使左右两边采样访问量最接近的主键作为分裂点
+    // 采样不足或者访问集中在少数key上(如计数器单行)无法均分时返回-1
+    int get_split_key(const std::string& start_key, const std::string& end_key, std::string* split_key);
+    size_t sample_count();
+    void clear();
+
+private:
+    std::atomic<bool> _enabled{false};
+    std::mutex _mutex;
+    // 蓄水池采样，保存去掉前缀的主键
+    std::vector<std::string> _keys;
+    int64_t _seen_count = 0;
+};
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -27,6 +27,7 @@ namespace baikaldb {
 class Transaction;
 class TableIterator;
 class IndexIterator;
+class ColumnBatch;
 typedef std::shared_ptr<Transaction> SmartTransaction;
 typedef std::bitset<ROW_BATCH_CAPACITY> FiltBitSet;
 
@@ -212,13 +213,19 @@ public:
     int get_next(int32_t tuple_id, std::unique_ptr<MemRow>& mem_row) {
         return get_next_internal(nullptr, tuple_id, &mem_row);
     }
+    // 直接解码到列存batch，成功时batch增加一行，失败时不改变batch
+    int get_next(int32_t tuple_id, ColumnBatch* batch) {
+        return get_next_internal(nullptr, tuple_id, nullptr, batch);
+    }
 
     void set_mode(KVMode mode) {
         _mode = mode;
     }
     int get_column(int32_t tuple_id, const FieldInfo& field, const FiltBitSet* filter, RowBatch* batch);
 private:
-    int get_next_internal(SmartRecord* record, int32_t tuple_id, std::unique_ptr<MemRow>* mem_row);
+    int get_next_internal(SmartRecord* record, int32_t tuple_id, std::unique_ptr<MemRow>* mem_row,
+            ColumnBatch* batch = nullptr);
+    int decode_key(int32_t tuple_id, const TableKey& key, int& pos, ColumnBatch* batch);
     KVMode  _mode;
 };
 
@@ -27,6 +27,7 @@
 #include "trace_state.h"
 #include "my_rocksdb.h"
 #include "tuple_record.h"
+#include "key_sampler.h"
 
 namespace baikaldb {
 DECLARE_bool(disable_wal);
@@ -57,6 +58,8 @@ class TransactionPool;
 // 不同region资源隔离，不需要每次从SchemaFactory加锁获取
 struct RegionResource {
     pb::RegionInfo region_info;
+    // region info更新时随resource拷贝，属于同一个region
+    std::shared_ptr<KeySampler> key_sampler;
 };
 class Transaction {
 public:
@@ -418,6 +421,13 @@ public:
            }
        }
     }
+    // 热点region采样访问的主键，用于按负载分裂；分裂时写入新region的key不采样
+    void sample_access_key(int64_t region, const rocksdb::Slice& key) {
+        if (_resource != nullptr && _resource->key_sampler != nullptr
+                && region == _resource->region_info.region_id()) {
+            _resource->key_sampler->sample(key);
+        }
+    }
     bool is_cstore() {
         if (_table_info.get() == nullptr) {
             // _is_global_index
@@ -26,6 +26,7 @@
 #include "exec_node.h"
 #include "agg_fn_call.h"
 #include "mut_table_key.h"
+#include "spill_file.h"
 
 namespace baikaldb {
 class AggNode : public ExecNode {
@@ -49,6 +50,8 @@ public:
     virtual void transfer_pb(int64_t region_id, pb::PlanNode* pb_node);
     void encode_agg_key(MemRow* row, MutTableKey& key);
     void process_row_batch(RuntimeState* state, RowBatch& batch, int64_t& used_size, int64_t& release_size);
+    // 子节点原生产出ColumnBatch时使用
+    int process_columnar_child(RuntimeState* state, ExecNode* child, int64_t& scan_time, int64_t& agg_time);
     std::vector<ExprNode*>* mutable_group_exprs() {
         return &_group_exprs;
     }
@@ -68,6 +71,25 @@ public:
     std::vector<AggFnCall*>* mutable_agg_fn_calls() {
         return &_agg_fn_calls;
     }
+
+    static bvar::Adder<int64_t> agg_spill_bytes;
+    static bvar::Adder<int64_t> agg_spill_rows;
+private:
+    struct SpillPartition {
+        std::unique_ptr<SpillFile> file;
+        int level = 0;
+    };
+    // 有分组且聚合状态都在行内时才能落盘
+    bool can_spill();
+    int check_spill(RuntimeState* state);
+    // 按分组key的hash把_hash_map写入_writing_partitions，并清空_hash_map
+    int spill_hash_map(RuntimeState* state);
+    // 当前层级的分区写完，转为待处理分区
+    int finish_spill_partitions(int level);
+    // 取一个待处理分区merge到_hash_map，内存仍不足时继续按下一层级分区
+    int load_partition(RuntimeState* state);
+    void clear_hash_map();
+
 private:
     //需要推导_agg_tuple_id内部slot的类型
     std::vector<ExprNode*> _group_exprs;
@@ -81,6 +103,15 @@ private:
     //用于分组和get_next的定位,用map可与mysql保持一致
     butil::FlatMap<std::string, MemRow*> _hash_map;
     butil::FlatMap<std::string, MemRow*>::iterator _iter;
+    // grace hash agg落盘相关
+    bool _can_spill = false;
+    // _hash_map中数据再次落盘时使用的分区层级
+    int _spill_level = 0;
+    int64_t _hash_map_bytes = 0;
+    // _hash_map中由子节点产出的行，子节点已计入内存
+    int64_t _input_row_bytes = 0;
+    std::vector<std::unique_ptr<SpillFile>> _writing_partitions;
+    std::vector<SpillPartition> _pending_partitions;
 };
 }
 /* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -62,6 +62,9 @@ public:
     size_t uniq_index_number() const {
         return _uniq_index_number;
     }
+    void reset_fetcher_store() {
+        _fetcher_store.clear();
+    }
 protected:
     FetcherStore _fetcher_store;
     pb::OpType  _op_type;
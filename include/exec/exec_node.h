@@ -18,6 +18,7 @@
 #include "table_record.h"
 #include "expr_node.h"
 #include "row_batch.h"
+#include "column_batch.h"
 #include "proto/plan.pb.h"
 #include "proto/meta.interface.pb.h"
 #include "mem_row_descriptor.h"
@@ -79,6 +80,16 @@ public:
         *eos = true;
         return 0;
     }
+    // 列存执行模式(FLAGS_enable_columnar_execution)
+    // 能原生产出ColumnBatch的节点返回true，父节点据此决定是否走列存接口
+    virtual bool can_produce_columnar() {
+        return false;
+    }
+    // 默认实现为适配器：调用行存get_next后转成ColumnBatch，保证未改造的节点也能工作
+    virtual int get_next_columnar(RuntimeState* state, ColumnBatch* batch, bool* eos);
+    // 逐个conjunct批量计算并收缩batch的选择向量，后面的conjunct只计算剩余行
+    // row用于不支持批量计算的表达式逐行回退，每次调用时重置
+    static int filter_column_batch(std::vector<ExprNode*>& conjuncts, ColumnBatch* batch, MemRow* row);
     virtual void close(RuntimeState* state) {
         _num_rows_returned = 0;
         _return_empty = false;
@@ -20,11 +20,15 @@
 #endif
 #include <bthread/condition_variable.h>
 #include <bthread/mutex.h>
+#include <deque>
+#include <set>
 #include "table_record.h"
 #include "schema_factory.h"
 #include "runtime_state.h"
 #include "exec_node.h"
 #include "network_socket.h"
+#include "backup_stream.h"
+#include "lru_cache.h"
 #include "proto/store.interface.pb.h"
 namespace baikaldb {
 enum ErrorType {
@@ -48,6 +52,186 @@ class FetcherStore;
             _addr.c_str(), _backup.c_str(), ##args);                                                               \
     } while (0);
 
+// streaming select中单个region的行队列，执行器在region完成前边收边消费
+// 队列满时接收端阻塞在on_received_messages中，brpc不再确认消费，store的StreamWrite随之阻塞，
+// 因此store的扫描速度由执行器的消费速度决定
+// 同一region的重试和分裂后的子region共用一个队列，所有任务结束后队列才结束
+class StreamRowQueue {
+public:
+    explicit StreamRowQueue(size_t max_batches) : _max_batches(max_batches) {}
+
+    // 接收端：队列满时等待消费，取消后返回-1；owner为产生该batch的任务，重试时据此丢弃
+    int push(const void* owner, const std::shared_ptr<RowBatch>& batch) {
+        std::unique_lock<bthread::Mutex> lck(_mutex);
+        while (!_cancelled && _batches.size() >= _max_batches) {
+            _cond.wait(lck);
+        }
+        if (_cancelled) {
+            return -1;
+        }
+        _batches.emplace_back(owner, batch);
+        _cond.notify_all();
+        return 0;
+    }
+    // 消费端：0取到batch或*eos表示region的行已全部取完，1超时
+    int pop(std::shared_ptr<RowBatch>* batch, bool* eos, int64_t timeout_us) {
+        std::unique_lock<bthread::Mutex> lck(_mutex);
+        *eos = false;
+        if (_batches.empty() && !is_eos()) {
+            _cond.wait_for(lck, timeout_us);
+        }
+        if (!_batches.empty()) {
+            _consumed_owners.insert(_batches.front().first);
+            *batch = _batches.front().second;
+            _batches.pop_front();
+            _cond.notify_all();
+            return 0;
+        }
+        if (is_eos()) {
+            *eos = true;
+            return 0;
+        }
+        return 1;
+    }
+    // 重试前丢弃owner上一次尝试已收到的行；其中已有行交给执行器时无法重试，返回-1
+    int reset_for_retry(const void* owner) {
+        std::unique_lock<bthread::Mutex> lck(_mutex);
+        if (_consumed_owners.count(owner) > 0) {
+            return -1;
+        }
+        auto iter = _batches.begin();
+        while (iter != _batches.end()) {
+            if (iter->first == owner) {
+                iter = _batches.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+        _cond.notify_all();
+        return 0;
+    }
+    void add_producer() {
+        std::unique_lock<bthread::Mutex> lck(_mutex);
+        ++_producers;
+        _started = true;
+    }
+    void remove_producer() {
+        std::unique_lock<bthread::Mutex> lck(_mutex);
+        --_producers;
+        _cond.notify_all();
+    }
+    // 执行器提前结束(limit/出错)时唤醒阻塞的接收端
+    void cancel() {
+        std::unique_lock<bthread::Mutex> lck(_mutex);
+        _cancelled = true;
+        _cond.notify_all();
+    }
+    // fetcher运行结束，没有任务的region(出错提前返回)也随之结束
+    void finish() {
+        std::unique_lock<bthread::Mutex> lck(_mutex);
+        _finished = true;
+        _cond.notify_all();
+    }
+
+private:
+    // 任务创建前producer为0，需等第一个任务开始后才能据此判断结束
+    bool is_eos() const {
+        return (_started && _producers == 0) || _finished || _cancelled;
+    }
+
+    bthread::Mutex _mutex;
+    bthread::ConditionVariable _cond;
+    std::deque<std::pair<const void*, std::shared_ptr<RowBatch>>> _batches;
+    std::set<const void*> _consumed_owners;
+    size_t _max_batches = 0;
+    int _producers = 0;
+    bool _started = false;
+    bool _finished = false;
+    bool _cancelled = false;
+};
+
+// streaming select的接收端，分块到达时增量解析成MemRow
+// 有StreamRowQueue时每个分块直接交给执行器，否则region完成后整体返回
+class SelectStreamReceiver : public CommonStreamReceiver {
+public:
+    SelectStreamReceiver(FetcherStore* fetcher_store, RuntimeState* state, int64_t region_id,
+            std::shared_ptr<StreamRowQueue> queue, const void* queue_owner) :
+        _fetcher_store(fetcher_store), _state(state), _region_id(region_id),
+        _batch(std::make_shared<RowBatch>()), _queue(queue), _queue_owner(queue_owner) {}
+
+    virtual int on_received_messages(brpc::StreamId id,
+        butil::IOBuf *const messages[],
+        size_t size) override;
+
+    virtual void on_closed(brpc::StreamId id) override {
+        // 没有收到结尾分块说明stream异常中断
+        if (_status != pb::StreamState::SS_SUCCESS) {
+            _status = pb::StreamState::SS_FAIL;
+        }
+        _cond.decrease_signal();
+    }
+
+    ErrorType error() const {
+        return _error;
+    }
+    int64_t row_cnt() const {
+        return _row_cnt;
+    }
+    std::shared_ptr<RowBatch> row_batch() {
+        return _batch;
+    }
+    std::vector<int64_t>& ttl_batch() {
+        return _ttl_batch;
+    }
+    // 结尾分块，包含errcode、scan_rows等信息，不包含行
+    pb::StoreRes* mutable_stream_end_response() {
+        return &_end_response;
+    }
+
+private:
+    int add_rows(pb::StoreRes& chunk);
+
+    FetcherStore* _fetcher_store;
+    RuntimeState* _state;
+    int64_t _region_id = 0;
+    int64_t _row_cnt = 0;
+    int64_t _used_size = 0;
+    ErrorType _error = E_OK;
+    std::shared_ptr<RowBatch> _batch;
+    std::shared_ptr<StreamRowQueue> _queue;
+    const void* _queue_owner = nullptr;
+    std::vector<int64_t> _ttl_batch;
+    pb::StoreRes _end_response;
+    static bvar::Adder<int64_t> streaming_select_rows;
+};
+
+// 记录各store已缓存的 sql_sign + tuple_sign/plan_sign
+// store成功处理带全量的请求后标记，之后发往该store的请求省略tuples/plan，store返回PLAN_CACHE_MISS时清除标记
+class StorePlanCacheMarks {
+public:
+    static StorePlanCacheMarks* get_instance() {
+        static StorePlanCacheMarks _instance;
+        return &_instance;
+    }
+    void mark(const std::string& addr, const pb::StoreReq& request);
+    void unmark(const std::string& addr, const pb::StoreReq& request);
+    // 按标记从请求中摘出或放回tuples和plan，backup request可能发往另一个store，两者都已缓存才省略
+    void omit_cached(const std::string& addr, const std::string& backup, pb::StoreReq* request,
+            google::protobuf::RepeatedPtrField<pb::TupleDescriptor>* omitted_tuples, pb::Plan* omitted_plan);
+private:
+    StorePlanCacheMarks() {
+        _marks.init(100000);
+    }
+    bool cached(const std::string& addr, const std::string& backup, const std::string& suffix);
+    static std::string tuple_suffix(const pb::StoreReq& request) {
+        return "_" + std::to_string(request.sql_sign()) + "_t" + std::to_string(request.tuple_sign());
+    }
+    static std::string plan_suffix(const pb::StoreReq& request) {
+        return "_" + std::to_string(request.sql_sign()) + "_p" + std::to_string(request.plan_sign());
+    }
+    Cache<std::string, bool> _marks;
+};
+
 class OnRPCDone: public google::protobuf::Closure {
 public:
     OnRPCDone(FetcherStore* fetcher_store, RuntimeState* state, ExecNode* store_request, pb::RegionInfo* info_ptr, 
@@ -107,6 +291,34 @@ public:
     void send_request();
     ErrorType handle_version_old();
     ErrorType handle_response(const std::string& remote_side);
+    void send_prepared();
+    ErrorType prepare_request();
+    ErrorType wait_stream_response();
+    void close_stream();
+    void omit_cached_plan();
+    // 非事务select可以与同store的其他region合并为multi_query
+    bool can_multi_query();
+    void start_multi_query(pb::StoreReq* request);
+    void multi_query_done(const brpc::Controller& cntl, pb::StoreReq* request, pb::StoreRes* response);
+    const std::string& addr() const {
+        return _addr;
+    }
+    int64_t region_lines() const {
+        return _info.num_table_lines();
+    }
+    FetcherStore* fetcher_store() {
+        return _fetcher_store;
+    }
+    uint64_t log_id() const {
+        return _state->log_id();
+    }
+    // 任务结束时调用，region的所有任务结束后执行器才能读完该region的队列
+    void release_stream_queue() {
+        if (_stream_queue != nullptr) {
+            _stream_queue->remove_producer();
+            _stream_queue.reset();
+        }
+    }
 
 private:
     FetcherStore* _fetcher_store;
@@ -135,12 +347,44 @@ private:
     brpc::Controller _cntl;
     RPCCtrl* _rpc_ctrl = nullptr;
     std::string _store_addr;
+    brpc::StreamId _stream_id = brpc::INVALID_STREAM_ID;
+    std::shared_ptr<SelectStreamReceiver> _stream_receiver;
+    std::shared_ptr<StreamRowQueue> _stream_queue;
+    // store已缓存tuples/plan时从请求中摘出，miss重发时放回
+    google::protobuf::RepeatedPtrField<pb::TupleDescriptor> _omitted_tuples;
+    pb::Plan _omitted_plan;
+    // multi_query返回时的store地址，_cntl未实际发送
+    std::string _multi_query_remote_side;
     static bvar::Adder<int64_t>  async_rpc_region_count;
     static bvar::LatencyRecorder total_send_request;
     static bvar::LatencyRecorder add_backup_send_request;
     static bvar::LatencyRecorder has_backup_send_request;
 };
 
+// 同一store上多个region的select合并为一次multi_query，返回后按region分发给各自的OnRPCDone处理
+class MultiQueryDone : public google::protobuf::Closure {
+public:
+    MultiQueryDone(const std::string& addr, const std::vector<OnRPCDone*>& tasks) :
+        _fetcher_store(tasks[0]->fetcher_store()), _log_id(tasks[0]->log_id()), _addr(addr), _tasks(tasks) { }
+    virtual ~MultiQueryDone() { }
+    void send();
+    virtual void Run();
+    // plan只在scan的region范围上有差异，相同的plan和tuples提到外层只发送一次
+    static void share_plan(pb::MultiStoreReq* request);
+    // 返回后将公共plan和tuples放回各request
+    static void restore_shared_plan(pb::MultiStoreReq* request);
+
+private:
+    FetcherStore* _fetcher_store;
+    uint64_t _log_id = 0;
+    std::string _addr;
+    std::vector<OnRPCDone*> _tasks;
+    brpc::Controller _cntl;
+    pb::MultiStoreReq _request;
+    pb::MultiStoreRes _response;
+    static bvar::Adder<int64_t> multi_query_region_count;
+};
+
 // RPCCtrl只控制rpc的异步发送和并发控制，具体rpc的成功与否结果收集由fetcher_store处理
 class RPCCtrl {
 public:
@@ -203,6 +447,7 @@ public:
     } 
 
     void task_finish(OnRPCDone* task) {
+        task->release_stream_queue();
         std::unique_lock<bthread::Mutex> lck(_mutex);
         auto task_group = _ip_task_group_map.at(task->key());
         _doing_cnt--;
@@ -236,12 +481,12 @@ public:
                 return;
             }
 
-            for (OnRPCDone* task : tasks) {
-                task->send_request();
-            }
+            send_tasks(tasks);
         }
     }
 
+    void send_tasks(const std::vector<OnRPCDone*>& tasks);
+
 private:
     struct TaskGroup {
         TaskGroup() { }
@@ -334,6 +579,8 @@ public:
         no_copy_cache_plan_set.clear();
         dynamic_timeout_ms = -1;
         callids.clear();
+        stream_queues.clear();
+        is_cancelled = false;
     }
 
     void cancel_rpc() {
@@ -342,6 +589,9 @@ public:
             brpc::StartCancel(callid);
         }
         is_cancelled = true;
+        for (auto& pair : stream_queues) {
+            pair.second->cancel();
+        }
     }
 
     void insert_callid(const brpc::CallId& callid) {
@@ -553,6 +803,8 @@ public:
     std::map<int64_t, std::shared_ptr<RowBatch>> region_batch;
     std::map<int64_t, std::shared_ptr<RowBatch>> split_region_batch;
     std::map<int64_t, std::vector<int64_t>> region_id_ttl_timestamp_batch;
+    // 执行器边收边消费时在run之前按region_id设置，run期间只读
+    std::map<int64_t, std::shared_ptr<StreamRowQueue>> stream_queues;
 
     std::multimap<std::string, int64_t> start_key_sort;
     std::multimap<std::string, int64_t> split_start_key_sort;
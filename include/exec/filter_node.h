@@ -57,6 +57,11 @@ public:
 
     virtual int open(RuntimeState* state);
     virtual int get_next(RuntimeState* state, RowBatch* batch, bool* eos);
+    virtual bool can_produce_columnar() {
+        return FLAGS_enable_columnar_execution && !_is_explain &&
+            _children.size() == 1 && _children[0]->can_produce_columnar();
+    }
+    virtual int get_next_columnar(RuntimeState* state, ColumnBatch* batch, bool* eos);
     virtual void close(RuntimeState* state);
     virtual void transfer_pb(int64_t region_id, pb::PlanNode* pb_node);
 
@@ -109,11 +114,13 @@ public:
 
 private:
     bool need_copy(MemRow* row);
+    int filter_columnar(RuntimeState* state, ColumnBatch* batch, int64_t& where_filter_cnt);
 private:
     std::vector<ExprNode*> _conjuncts;
     std::vector<ExprNode*> _pruned_conjuncts;
     std::vector<ExprNode*> _pruned_conjuncts_learner; // learner集群使用
     RowBatch _child_row_batch;
+    std::unique_ptr<MemRow> _columnar_row;
     size_t  _child_row_idx = 0;
     bool    _child_eos = false;
     pb::FilterNode _raw_filter_node;
@@ -76,6 +76,23 @@ public:
     }
     int hash_join(RuntimeState* state);
     int loop_hash_join(RuntimeState* state);
+    // 读取驱动表，内存不足时转为分区落盘
+    int fetcher_outer_table_data(RuntimeState* state, bool can_spill);
+    // 落盘后inner表也按相同hash分区
+    int fetcher_inner_partitions(RuntimeState* state);
+    int open_partitions(std::vector<std::unique_ptr<SpillFile>>& partitions);
+    int finish_partitions(std::vector<std::unique_ptr<SpillFile>>& partitions);
+    // 按等值key分区写盘并释放rows，bloom_filter不为空时写入key的hash
+    int spill_rows(std::vector<MemRow*>& rows,
+                   const std::vector<ExprNode*>& slot_refs,
+                   std::vector<std::unique_ptr<SpillFile>>& partitions,
+                   BloomFilter* bloom_filter);
+    int read_partition(SpillFile* file, std::vector<MemRow*>& rows);
+    // 清理上一个分区，加载下一个非空分区并建hash表
+    int load_next_partition(RuntimeState* state);
+    // inner join落盘后从当前分区读取probe数据
+    int read_probe_batch(RowBatch* batch, bool* eos);
+    void construct_bloom_filter(BloomFilter& bloom_filter);
 
     int nested_loop_join(RuntimeState* state);
 
@@ -95,6 +112,10 @@ public:
             std::map<int32_t, std::set<int32_t>>& tuple_equals_map, 
             std::vector<int32_t>& tuple_order,
             std::vector<ExprNode*>& conditions);
+
+    static bvar::Adder<int64_t> join_spill_rows;
+    static bvar::Adder<int64_t> join_spill_bytes;
+    static bvar::Adder<int64_t> join_bloom_filter_count;
 };
 }
 
@@ -21,6 +21,8 @@
 #include <butil/containers/flat_map.h>
 #endif
 #include "slot_ref.h"
+#include "spill_file.h"
+#include "bloom_filter.h"
 
 namespace baikaldb {
 struct ExprValueVec {
@@ -122,6 +124,10 @@ public:
     int construct_in_condition(std::vector<ExprNode*>& slot_refs,
                                   const ExprValueSet& in_values,
                                   std::vector<ExprNode*>& in_exprs);
+    // 等值key过多时代替in条件下推，probe端key不在bloom filter中的行直接过滤
+    int construct_bloom_filter_condition(std::vector<ExprNode*>& slot_refs,
+                                  const BloomFilter& bloom_filter,
+                                  std::vector<ExprNode*>& bloom_exprs);
     int fetcher_full_table_data(RuntimeState* state, ExecNode* child_node,
                             std::vector<MemRow*>& tuple_data);
     int fetcher_inner_table_data(RuntimeState* state,
@@ -186,6 +192,14 @@ protected:
     size_t  _loops = 0;
     RowBatch _inner_row_batch;
     std::map<int32_t, std::set<int32_t>> _inner_equal_field_ids; // 用于检查内查询的等值条件是否具有唯一性
+
+    // grace hash join：内存不足时两侧按等值key的hash分区落盘，逐个分区join
+    bool _is_spilled = false;
+    std::vector<std::unique_ptr<SpillFile>> _outer_partitions;
+    std::vector<std::unique_ptr<SpillFile>> _inner_partitions;
+    size_t _partition_idx = 0;
+    // 落盘时驱动表等值key构造的bloom filter，大小固定为join_bloom_filter_max_bytes
+    BloomFilter _spill_bloom_filter;
 };
 }
 
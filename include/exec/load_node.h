@@ -18,9 +18,8 @@
 #include "exec_node.h"
 #include "insert_manager_node.h"
 
-#include <iostream>
-#include <istream>
-#include <streambuf>
+#include <functional>
+#include <bvar/bvar.h>
 
 #ifdef BAIDU_INTERNAL
 #include <base/files/file.h>
@@ -47,19 +46,38 @@ public:
     virtual int init(const pb::PlanNode& node);
     virtual int open(RuntimeState* state);
 
-private:
-    int ignore_specified_lines(butil::File& file, char* data_buffer, int64_t buf_size);
-    int handle_lines(RuntimeState* state, std::vector<std::string>& row_lines);
+protected:
+    // 一批待解析的行，line指向读缓冲区，解析完成前缓冲区不能覆盖
+    struct LineBatch {
+        std::vector<butil::StringPiece> lines;
+        std::vector<int64_t> line_nos;
+        std::vector<SmartRecord> records;
+        // <行号, 原因>，按行号有序
+        std::vector<std::pair<int64_t, std::string>> err_lines;
+        int ret = 0;
+        // ret < 0时失败的行号
+        int64_t err_line_no = 0;
+    };
+    int read_lines(RuntimeState* state, butil::File& file);
+    // 读完一块后切好的行交给handle_batches，返回前行所在的缓冲区不会被覆盖
+    int read_blocks(RuntimeState* state, butil::File& file,
+            const std::function<int(std::vector<LineBatch>&)>& handle_batches);
+    void parse_batch(LineBatch& batch);
+    void parse_group(std::vector<LineBatch>& group);
+    int insert_records(RuntimeState* state, std::vector<SmartRecord>& records);
+    int parse_line(const butil::StringPiece& line, SmartRecord& row, std::string& reason);
+    void split_fields(const butil::StringPiece& line, std::vector<butil::StringPiece>& fields);
     ExprValue create_field_value(FieldInfo& field_info, std::string& str_val, bool& is_legal);
     int fill_field_value(SmartRecord record, FieldInfo& field, ExprValue& value);
 
-private:
-    const int64_t    BUFFER_SIZE = 8 * 1024 * 1024ULL; // 8M
-    struct MemBuf : std::streambuf{
-        MemBuf(char* begin, char* end) {
-            this->setg(begin, begin, end);
-        }
-    };
+protected:
+    static bvar::Adder<int64_t> load_read_bytes;
+    static bvar::Adder<int64_t> load_parse_lines;
+    static bvar::Adder<int64_t> load_error_lines;
+    static bvar::Adder<int64_t> load_insert_rows;
+    static bvar::PerSecond<bvar::Adder<int64_t>> load_read_bytes_second;
+    static bvar::PerSecond<bvar::Adder<int64_t>> load_insert_rows_second;
+
     int64_t _table_id = -1;
     int32_t _ignore_lines = 0;
 
@@ -73,10 +91,8 @@ private:
     std::string _escaped;
     std::string _line_starting;
     std::string _line_terminated;
-    bool       _read_eof = false;
-    bool       _has_get_line = false;
     int64_t    _file_cur_pos = 0;
-    int64_t    _buf_cur_pos = 0;
+    int64_t    _line_no = 0;
 
     std::vector<pb::SlotDescriptor> _set_slots;
     std::vector<ExprNode*> _set_exprs;
@@ -90,6 +106,9 @@ private:
 
     InsertManagerNode* _insert_manager = nullptr;
     int    _affected_rows = 0;
+    int64_t _error_line_count = 0;
+    // 已解析待插入的记录，与下一组的解析并行插入
+    std::vector<SmartRecord> _pending_records;
 };
 
 }
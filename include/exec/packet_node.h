@@ -82,7 +82,10 @@ private:
     int pack_eof();
     int fatch_expr_subquery_results(RuntimeState* state);
 
-private:
+protected:
+    // send_buf超过阈值时直接写出到socket，socket不可写时等待EPOLLOUT
+    int stream_send(RuntimeState* state);
+
     bool _binary_protocol = false;
     pb::OpType _op_type;
     std::vector<ExprNode*> _projections;
@@ -90,6 +93,7 @@ private:
     NetworkSocket* _client = nullptr;
     MysqlWrapper* _wrapper = nullptr;
     DataBuffer* _send_buf = nullptr;
+    bool _stream_send = false;
 };
 }
 /* vim: set ts=4 sw=4 sts=4 tw=100 */
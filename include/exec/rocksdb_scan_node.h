@@ -95,6 +95,8 @@ public:
     int index_condition_pushdown();
     virtual int open(RuntimeState* state);
     virtual int get_next(RuntimeState* state, RowBatch* batch, bool* eos);
+    virtual bool can_produce_columnar();
+    virtual int get_next_columnar(RuntimeState* state, ColumnBatch* batch, bool* eos);
     virtual void close(RuntimeState* state);
     bool contain_condition(ExprNode* expr) {
         std::unordered_set<int32_t> related_tuple_ids;
@@ -140,6 +142,8 @@ private:
     int get_next_by_table_seek(RuntimeState* state, RowBatch* batch, bool* eos);
     int get_next_by_index_get(RuntimeState* state, RowBatch* batch, bool* eos);
     int get_next_by_index_seek(RuntimeState* state, RowBatch* batch, bool* eos);
+    int get_next_by_table_seek_columnar(RuntimeState* state, ColumnBatch* batch, bool* eos);
+    int open_next_table_range(RuntimeState* state);
     int lock_primary(RuntimeState* state, MemRow* row);
     int index_ddl_work(RuntimeState* state, MemRow* row);
     int column_ddl_work(RuntimeState* state, MemRow* row);
@@ -218,6 +222,7 @@ private:
     std::vector<ExprNode*> _scan_conjuncts;
     IndexIterator* _index_iter = nullptr;
     TableIterator* _table_iter = nullptr;
+    std::unique_ptr<MemRow> _columnar_row;
     ReverseIndexBase* _reverse_index = nullptr;
 
     SmartTable       _table_info;
@@ -55,6 +55,7 @@ public:
     virtual int open(RuntimeState* state);
     virtual int get_next(RuntimeState* state, RowBatch* batch, bool* eos);
     virtual void close(RuntimeState* state) {
+        stop_stream_fetcher(state);
         ExecNode::close(state);
         if (_sub_query_node != nullptr) {
             _sub_query_node->close(state);
@@ -75,6 +76,10 @@ public:
     void multi_fetcher_store_open(FetcherInfo* self_fetcher, FetcherInfo* other_fetcher,
         RuntimeState* state, ExecNode* exec_node);
     int fetcher_store_run(RuntimeState* state, ExecNode* exec_node);
+    // streaming select且无需排序时，fetcher在后台运行，get_next按region顺序边收边消费
+    int stream_fetcher_run(RuntimeState* state, ScanIndexInfo* scan_index);
+    int stream_get_next(RuntimeState* state, RowBatch* batch, bool* eos);
+    void stop_stream_fetcher(RuntimeState* state);
     int open_global_index(FetcherInfo* fetcher, RuntimeState* state,
                           ExecNode* exec_node,
                           int64_t global_index_id,
@@ -121,6 +126,14 @@ private:
     std::vector<ExprNode*>  _derived_table_projections;
     std::map<int32_t, int32_t>  _slot_column_mapping;
     int32_t         _derived_tuple_id = 0;
+    // 边收边消费时后台运行的fetcher，队列按region的start_key排列
+    std::unique_ptr<FetcherInfo> _stream_fetcher;
+    Bthread _stream_bth;
+    bool _stream_running = false;
+    int _stream_ret = 0;
+    std::vector<std::shared_ptr<StreamRowQueue>> _stream_queues;
+    size_t _stream_idx = 0;
+    std::shared_ptr<RowBatch> _stream_batch;
 };
 }
 
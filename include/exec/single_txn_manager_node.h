@@ -27,6 +27,18 @@ public:
     }
     virtual int open(RuntimeState* state);
     virtual void reset(RuntimeState* state);
+    // 复用prepare的dml执行树时，执行结束后需要把缓存到连接上的begin/dml节点放回
+    void set_reuse_plan(bool reuse_plan) {
+        _reuse_plan = reuse_plan;
+    }
+protected:
+    // open时begin/dml节点会移交给连接的cache_plans，复用时先记下原始结构
+    void save_origin_children();
+    void restore_cached_children(NetworkSocket* client_conn);
+
+    bool _reuse_plan = false;
+    std::vector<ExecNode*> _origin_children;
+    ExecNode* _origin_dml_node = nullptr;
 };
 }
 
@@ -16,6 +16,8 @@
 
 #include "exec_node.h"
 #include "sorter.h"
+#include "topn_sorter.h"
+#include "external_sorter.h"
 #include "mem_row_compare.h"
 #include "property.h"
 
@@ -111,6 +113,9 @@ public:
 
 private:
     int fill_tuple(RowBatch* batch);
+    bool need_spill(RuntimeState* state, int64_t buffered_bytes);
+    // 把_sorter中的数据排序后写成一个run
+    int spill(RuntimeState* state, int count);
 
 private:
     std::vector<ExprNode*> _order_exprs;
@@ -121,6 +126,10 @@ private:
     std::vector<bool> _is_null_first;
     std::shared_ptr<MemRowCompare> _mem_row_compare;
     std::shared_ptr<Sorter> _sorter;
+    // 有limit时替代_sorter
+    std::shared_ptr<TopNSorter> _topn_sorter;
+    // 内存不足落盘后，替代_sorter输出
+    std::shared_ptr<ExternalSorter> _external_sorter;
     bool _monotonic = true; //是否单调(全部升序或降序)
 };
 }
@@ -33,6 +33,9 @@ public:
     virtual int exec_prepared_node(RuntimeState* state, ExecNode* prepared_node, int start_seq_id);
     virtual int exec_commit_node(RuntimeState* state, ExecNode* commit_node);
     virtual int exec_rollback_node(RuntimeState* state, ExecNode* rollback_node);
+    void reset_fetcher_store() {
+        _fetcher_store.clear();
+    }
 
 protected:
     FetcherStore _fetcher_store;
@@ -20,6 +20,7 @@
 #include "sorter.h"
 #include "mem_row_compare.h"
 #include "fetcher_store.h"
+#include <deque>
 
 namespace baikaldb {
 
@@ -27,6 +28,7 @@ class UnionNode : public ExecNode {
 public:
     UnionNode() {}
     virtual ~UnionNode() {
+        stop_branches();
         for (auto expr : _slot_order_exprs) {
             ExprNode::destroy_tree(expr);
         }
@@ -41,6 +43,7 @@ public:
     virtual int open(RuntimeState* state) override;
     virtual int get_next(RuntimeState* state, RowBatch* batch, bool* eos);
     virtual void close(RuntimeState* state) {
+        stop_branches();
         ExecNode::close(state);
         for (auto expr : _slot_order_exprs) {
             expr->close();
@@ -65,6 +68,16 @@ public:
         return _union_tuple_id;
     }
 private:
+    int project_batch(size_t idx, RowBatch& batch, std::shared_ptr<RowBatch>& batch_ptr);
+    void merge_branch_state(RuntimeState* state, RuntimeState* runtime_state);
+    void copy_branch_error(RuntimeState* state, RuntimeState* runtime_state);
+    // 各分支在bthread中并发执行，投影后的batch放入队列，get_next流式消费
+    void run_branches();
+    void run_branch(size_t idx);
+    void set_branch_error(size_t idx);
+    bool push_batch(std::shared_ptr<RowBatch> batch_ptr);
+    void stop_branches();
+
     std::vector<ExprNode*> _slot_order_exprs;
     std::vector<bool> _is_asc;
     std::vector<bool> _is_null_first;
@@ -75,6 +88,17 @@ private:
     std::shared_ptr<MemRowCompare> _mem_row_compare;
     std::vector<RuntimeState*> _select_runtime_states;
     std::vector<std::vector<ExprNode*>>  _select_projections;
+
+    bool _concurrent = false;
+    bool _branches_done = false;
+    bool _has_error = false;
+    size_t _error_branch = 0;
+    bool _stop = false;
+    bool _state_merged = false;
+    std::deque<std::shared_ptr<RowBatch>> _batch_queue;
+    bthread::Mutex _mutex;
+    bthread::ConditionVariable _cv;
+    BthreadCond _driver_cond;
 };
 }
 /* vim: set ts=4 sw=4 sts=4 tw=100 */
\ No newline at end of file
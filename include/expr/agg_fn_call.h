@@ -131,6 +131,23 @@ public:
                 return false;
         }
     }
+    // 聚合中间状态全部保存在行内，预聚合行落盘后可以再merge
+    bool state_in_row() const {
+        if (_is_distinct) {
+            return false;
+        }
+        switch (_agg_type) {
+            case COUNT_STAR:
+            case COUNT:
+            case SUM:
+            case AVG:
+            case MIN:
+            case MAX:
+                return true;
+            default:
+                return false;
+        }
+    }
     bool is_hll_agg() const {
         switch(_agg_type) {
             case HLL_ADD_AGG:
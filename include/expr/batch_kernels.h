@@ -0,0 +1,63 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "column_batch.h"
+
+namespace baikaldb {
+// ColumnBatch上的批量计算kernel
+// 只计算batch选择向量中的行，输出列与batch物理行对齐(size() == batch->size())
+// 无选择向量时走连续内存的无分支循环，便于编译器自动向量化
+namespace batch_kernels {
+enum CompareOp {
+    CMP_EQ,
+    CMP_NE,
+    CMP_GT,
+    CMP_GE,
+    CMP_LT,
+    CMP_LE
+};
+
+enum ArithOp {
+    ARITH_ADD,
+    ARITH_MINUS,
+    ARITH_MULTIPLIES,
+    ARITH_DIVIDES
+};
+
+// 与ExprValue::cast_to语义一致的列转换；类型编码相同时直接拷贝
+int cast_column(const ColumnBatch* batch, const ColumnVector& src,
+        pb::PrimitiveType type, ColumnVector* dst);
+// 常量广播
+void fill_constant(const ColumnBatch* batch, const ExprValue& value, ColumnVector* dst);
+
+// 比较kernel支持的参数类型(参数需已cast到该类型)
+bool support_compare(pb::PrimitiveType type);
+// 结果为BOOL列，任一侧为null时结果为null
+int compare(CompareOp op, const ColumnBatch* batch, const ColumnVector& left,
+        const ColumnVector& right, ColumnVector* result);
+
+// 算术kernel支持的参数类型：INT64/UINT64/DOUBLE
+bool support_arithmetic(pb::PrimitiveType type);
+// 除数为0时结果为null，与operators.cpp行为一致
+int arithmetic(ArithOp op, const ColumnBatch* batch, const ColumnVector& left,
+        const ColumnVector& right, ColumnVector* result);
+
+// 按sql真值语义判断(非null且非0)
+bool is_true(const ColumnVector& column, size_t idx);
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -23,6 +23,8 @@
 
 namespace baikaldb {
 const int NOT_BOOL_ERRCODE = -100;
+class ColumnBatch;
+class ColumnVector;
 class ExprNode {
 public:
     ExprNode() {}
@@ -158,6 +160,9 @@ public:
     virtual ExprValue get_value(const ExprValue& value) {
         return ExprValue::Null();
     }
+    // 对batch中选择向量内的行批量计算，result按batch物理行对齐
+    // 默认实现用row(调用方复用)逐行回退到get_value
+    virtual int get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result);
     //释放open创建的资源
     virtual void close() {
         for (auto e : _children) {
@@ -205,6 +205,7 @@ public:
     virtual ExprValue get_value(const ExprValue& value) {
         return _value.cast_to(_col_type);
     }
+    virtual int get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result);
 
 private:
     void value_to_node_type() {
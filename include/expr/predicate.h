@@ -17,6 +17,7 @@
 #include <set>
 #include "expr_value.h"
 #include "scalar_fn_call.h"
+#include "bloom_filter.h"
 #include "re2/re2.h"
 #include <boost/optional.hpp>
 
@@ -39,6 +40,7 @@ public:
         }
         return ExprValue::True();
     }
+    virtual int get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result);
 };
 
 class OrPredicate : public ScalarFnCall {
@@ -60,6 +62,7 @@ public:
         
         return ExprValue::False();
     }
+    virtual int get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result);
 };
 
 class XorPredicate : public ScalarFnCall {
@@ -86,6 +89,7 @@ public:
         }
         return ExprValue::False();
     }
+    virtual int get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result);
 };
 
 class IsTruePredicate : public ScalarFnCall {
@@ -104,6 +108,7 @@ public:
     InPredicate() {}
     virtual int open();
     virtual ExprValue get_value(MemRow* row);
+    virtual int get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result);
 
 private:
     int singel_open();
@@ -185,6 +190,22 @@ private:
     re2::RE2::Options _option;
 };
 
+// join时由build端key构造，下推到probe端的scan和store过滤
+// 前n个孩子为probe端key的slot_ref，最后一个孩子为序列化的bloom filter
+class BloomFilterPredicate : public ScalarFnCall {
+public:
+    virtual int type_inferer() {
+        int ret = ExprNode::type_inferer();
+        _col_type = pb::BOOL;
+        return ret;
+    }
+    virtual int open();
+    virtual ExprValue get_value(MemRow* row);
+
+private:
+    BloomFilter _bloom_filter;
+};
+
 class NotPredicate : public ScalarFnCall {
 public:
     virtual ExprValue get_value(MemRow* row) {
@@ -195,6 +216,7 @@ public:
         }
         return val;
     }
+    virtual int get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result);
     bool always_null_or_false() const {
         if (_children[0]->node_type() == pb::IN_PREDICATE) {
             return _children[0]->has_null();
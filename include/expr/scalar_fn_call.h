@@ -27,6 +27,8 @@ public:
     virtual int open();
     virtual ExprValue get_value(MemRow* row);
     virtual ExprValue get_value(const ExprValue& value);
+    // 比较和+-*/走列存kernel，其他函数回退到逐行计算
+    virtual int get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result);
     const pb::Function& fn() {
         return _fn;
     }
@@ -115,6 +117,10 @@ private:
         return ExprValue::True();
     }
 protected:
+    // 批量计算第idx个孩子并转换为type
+    int get_child_batch_value(size_t idx, pb::PrimitiveType type,
+            ColumnBatch* batch, MemRow* row, ColumnVector* column);
+
     pb::Function _fn;
     bool _is_row_expr = false;
     std::function<ExprValue(const std::vector<ExprValue>&)> _fn_call;
@@ -37,6 +37,7 @@ public:
     virtual ExprValue get_value(const ExprValue& value) {
         return value;
     }
+    virtual int get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result);
 
     SlotRef* clone() {
         SlotRef* s = new SlotRef;
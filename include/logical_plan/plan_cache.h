@@ -0,0 +1,74 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Brief:  session-independent plan cache for text protocol SELECT/DML
+#pragma once
+#include <memory>
+#include <bvar/bvar.h>
+#include "common.h"
+#include "lru_cache.h"
+#include "parser.h"
+#include "proto/plan.pb.h"
+
+namespace baikaldb {
+// 按prepare方式生成的逻辑计划模板，常量由PLACE_HOLDER代替
+struct PlanCacheItem {
+    // 模板不能复用时也缓存，避免重复尝试
+    bool cacheable = false;
+    parser::NodeType stmt_type;
+    bool is_select = false;
+    bool is_straight_join = false;
+    int64_t prepared_table_id = -1;
+    size_t param_count = 0;
+    pb::Plan plan;
+    std::vector<pb::TupleDescriptor> tuple_descs;
+    std::map<int64_t, std::map<std::string, int32_t>> ref_slot_id_mapping;
+    std::string family;
+    std::string table;
+    std::string sample_sql;
+    uint64_t sign = 0;
+    // table_id => 生成模板时的schema版本，命中时版本不一致则重新生成
+    std::map<int64_t, int64_t> table_versions;
+    // 模板生成失败(如表未建好、schema未同步)的时间，超过plan_cache_failed_expire_s后重新尝试
+    int64_t failed_time_us = 0;
+};
+typedef std::shared_ptr<PlanCacheItem> SmartPlanCacheItem;
+
+class PlanCache {
+public:
+    static const int SHARD_NUM = 16;
+    static PlanCache* get_instance() {
+        static PlanCache _instance;
+        return &_instance;
+    }
+    // 把比较运算/BETWEEN/IN列表/VALUES列表中的常量替换为'?'，常量按顺序转为pb::ExprNode
+    // 含注释、用户变量、'?'、多条语句或子查询等不能参数化的sql返回-1
+    static int normalize_sql(const std::string& sql,
+            std::string* normalized,
+            std::vector<pb::ExprNode>* params);
+
+    // 命中返回0
+    int find(const std::string& key, SmartPlanCacheItem* item);
+    void add(const std::string& key, const SmartPlanCacheItem& item);
+
+    static bvar::Adder<int64_t> plan_cache_hit;
+    static bvar::Adder<int64_t> plan_cache_miss;
+
+private:
+    PlanCache();
+    Cache<std::string, SmartPlanCacheItem> _shards[SHARD_NUM];
+};
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -17,6 +17,7 @@
 #include "logical_planner.h"
 #include "query_context.h"
 #include "parser.h"
+#include "plan_cache.h"
 
 namespace baikaldb {
 
@@ -29,10 +30,20 @@ public:
 
     virtual int plan();
 
+    // 文本协议sql按参数化后的模板复用逻辑计划
+    // 返回0表示命中，1表示需要走普通解析流程，-1表示出错
+    int plan_cache_execute();
+
 private:
     int stmt_prepare(const std::string& stmt_name, const std::string& stmt_sql);
     int stmt_execute(const std::string& stmt_name, std::vector<pb::ExprNode>& params);
     int stmt_close(const std::string& stmt_name);
+    int create_prepare_ctx(const std::string& stmt_sql, std::shared_ptr<QueryContext>& prepare_ctx);
+    int bind_params(std::vector<pb::ExprNode>& params);
+    bool can_reuse_dml_plan(QueryContext* prepare_ctx, bool in_txn);
+    void reset_reused_dml_plan(ExecNode* root);
+    bool check_plan_cache_item(const SmartPlanCacheItem& item);
+    void fill_plan_cache_item(QueryContext* prepare_ctx, size_t param_count, PlanCacheItem* item);
     
 };
 } //namespace baikal
\ No newline at end of file
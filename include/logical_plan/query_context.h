@@ -256,6 +256,7 @@ public:
     bool                new_prepared = false;  // flag for stmt_prepare
     bool                exec_prepared = false; // flag for stmt_execute
     bool                is_prepared = false;   // flag for stmt_execute
+    bool                reuse_prepared_plan = false; // dml执行树复用prepare的计划，执行后需保持完整
     bool                is_select = false;
     bool                need_destroy_tree = false;
     bool                has_derived_table = false;
@@ -31,6 +31,11 @@ public:
         return _slot_order_exprs.size() == 0;
     }
     int64_t compare(MemRow* left, MemRow* right);
+    // 是否预先编码排序key，用memcmp代替逐次的表达式计算和ExprValue比较
+    bool use_sort_key();
+    // 把各排序列编码成memcomparable的key，key的字节序与compare一致
+    // null按is_null_first编码成单独的标记字节，desc列按位取反
+    void encode_sort_key(MemRow* row, std::string* key);
 
     bool less(MemRow* left, MemRow* right) {
         return compare(left, right) < 0;
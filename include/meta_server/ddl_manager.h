@@ -256,6 +256,8 @@ public:
     int load_region_ddl_snapshot(const std::string& info);
 
     int update_region_ddlwork(const pb::RegionDdlWork& work);
+    // store副本本地构建索引失败，把已完成的region任务置为失败
+    void process_ddlwork_heartbeat_for_store(const pb::StoreHeartBeatRequest* request);
 
     void set_txn_ready(int64_t table_id, bool success) {
         DB_NOTICE("set txn ready.");
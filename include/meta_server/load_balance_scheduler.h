@@ -0,0 +1,93 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Brief:  按store心跳中的读写qps做leader/peer调度
+#pragma once
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <bvar/bvar.h>
+#include "common.h"
+#include "proto/meta.interface.pb.h"
+
+namespace baikaldb {
+DECLARE_bool(enable_load_balance_scheduler);
+DECLARE_string(load_balance_record_file);
+
+struct StoreLoad {
+    std::string resource_tag;
+    double score = 0;             // 平滑后的负载分
+    double dml_latency = 0;       // 平滑后的dml延时
+    int64_t update_time = 0;      // 最近一次心跳时间
+    int64_t last_schedule_time = 0;
+};
+
+// 判断target能否承接source上的leader/peer，如实例状态、机房约束；为空表示都可以
+typedef std::function<bool(const std::string& source, const std::string& target)> LoadBalanceFilter;
+
+// 只依赖心跳内容，不访问其他manager，离线模拟可以直接回放心跳
+class LoadBalanceScheduler {
+public:
+    static LoadBalanceScheduler* get_instance() {
+        static LoadBalanceScheduler _instance;
+        return &_instance;
+    }
+    // 用store上报的实例级qps和延时更新负载分
+    void update_store_load(const pb::InstanceInfo& instance_info, int64_t now_us);
+    // 对上报心跳的store做一轮调度，负载超过平均值(1+hysteresis)时迁出热点region的leader
+    // follower都不满足条件时，给热点region在冷store上增加peer，之后由check_peer_count删掉热点store上的peer
+    void schedule(const pb::StoreHeartBeatRequest& request,
+            int64_t now_us,
+            const LoadBalanceFilter& filter,
+            std::vector<pb::TransLeaderRequest>* trans_leaders,
+            std::vector<pb::AddPeer>* add_peers);
+    // 增加peer完成后优先删除的peer，没有返回false
+    bool get_pending_remove_peer(int64_t region_id, std::string* peer);
+    void clear_pending_remove_peer(int64_t region_id);
+
+    double get_store_score(const std::string& instance);
+    // resource_tag内存活store的负载分
+    void get_store_scores(const std::string& resource_tag, int64_t now_us,
+            std::map<std::string, double>* scores);
+    // resource_tag内存活store的平均负载分，没有store时返回0
+    double average_score(const std::string& resource_tag, int64_t now_us);
+    static double region_score(int64_t select_qps, int64_t dml_qps);
+    void clear();
+
+    static bvar::Adder<int64_t> load_balance_trans_leader_count;
+    static bvar::Adder<int64_t> load_balance_add_peer_count;
+
+private:
+    LoadBalanceScheduler() {}
+    bool is_alive(const StoreLoad& load, int64_t now_us);
+    // 以下函数调用方需持有_mutex
+    double do_average_score(const std::string& resource_tag, int64_t now_us);
+    double average_latency(const std::string& resource_tag, int64_t now_us);
+    // dml延时明显高于平均值的store负载分放大
+    double effective_score(const StoreLoad& load, double avg_latency);
+
+    std::mutex _mutex;
+    std::unordered_map<std::string, StoreLoad> _store_loads;
+    // region_id -> 上次调度时间，冷却期内不再调度，避免来回迁移
+    std::unordered_map<int64_t, int64_t> _region_schedule_time;
+    // region_id -> (增加peer后需要删除的热点store, 调度时间)
+    std::unordered_map<int64_t, std::pair<std::string, int64_t>> _pending_remove_peers;
+};
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -128,6 +128,13 @@ public:
                     bool load_balance,
                     const pb::StoreHeartBeatRequest* request,
                     pb::StoreHeartBeatResponse* response);
+    // enable_load_balance_scheduler时按读写qps代替leader数做均衡
+    void load_balance_by_qps(bool whether_can_decide,
+                    bool load_balance,
+                    const pb::StoreHeartBeatRequest* request,
+                    const std::set<int64_t>& trans_leader_region_ids,
+                    pb::StoreHeartBeatResponse* response);
+    void record_load_balance_heartbeat(const pb::StoreHeartBeatRequest* request, int64_t now_us);
     
     void leader_main_logical_room_check(const pb::StoreHeartBeatRequest* request,
                     pb::StoreHeartBeatResponse* response,
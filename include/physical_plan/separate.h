@@ -58,6 +58,8 @@ private:
 
     template<typename T>
     int separate_single_txn(QueryContext* ctx, T* node, pb::OpType op_type);
+    int check_reused_single_txn(QueryContext* ctx, PacketNode* packet_node,
+            const int64_t main_table_id, pb::OpType op_type);
 
     int separate_truncate(QueryContext* ctx);
     int separate_kill(QueryContext* ctx);
@@ -17,25 +17,37 @@
 #include <sys/epoll.h>
 #include <sys/types.h>
 #include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <bvar/bvar.h>
 #include "common.h" 
 
 namespace baikaldb {
 
 class NetworkSocket;
 
+// 单次epoll_wait返回的最大事件数
 const int32_t CONFIG_MPL_EPOLL_MAX_SIZE = 65536;
 
+// 一个reactor：独立的epoll集合，以及该reactor上连接的fd -> NetworkSocket映射
 class EpollInfo {
 public:
+    static const int FD_MAPPING_SHARD_NUM = 64;
+
     EpollInfo();
     ~EpollInfo();
 
-    bool init();    
+    bool init(int reactor_id = 0);
     int wait(uint32_t timeout);
+    int reactor_id() const {
+        return _reactor_id;
+    }
 
     bool set_fd_mapping(int fd, SmartSocket sock);
     SmartSocket get_fd_mapping(int fd);
     void delete_fd_mapping(int fd);
+    // 遍历时先拷贝快照，回调中可以释放连接
+    void traverse_fd_mapping(const std::function<void(const SmartSocket&)>& func);
     int get_ready_fd(int cnt);
     int get_ready_events(int cnt);
 
@@ -45,12 +57,32 @@ public:
 
     bool all_txn_time_large_then(int64_t query_time, int64_t table_id);
 
+    void add_accept_count() {
+        _accept_count << 1;
+    }
+    int64_t accept_count() const {
+        return _accept_count.get_value();
+    }
+    void add_event_count(int64_t count) {
+        _event_count << count;
+    }
+
 private:
-    SmartSocket         _fd_mapping[CONFIG_MPL_EPOLL_MAX_SIZE]; // fd -> NetworkSocket.
-    std::mutex          _mutex; // 保护_fd_mapping里的shared_ptr
+    struct FdMappingShard {
+        std::mutex mutex; // 保护sockets里的shared_ptr
+        std::unordered_map<int, SmartSocket> sockets;
+    };
+    FdMappingShard& shard(int fd) {
+        return _fd_mapping[fd % FD_MAPPING_SHARD_NUM];
+    }
+
+    FdMappingShard      _fd_mapping[FD_MAPPING_SHARD_NUM]; // fd -> NetworkSocket.
+    int                 _reactor_id = 0;
     int                 _epfd;
-    struct epoll_event  _events[CONFIG_MPL_EPOLL_MAX_SIZE];
-    size_t              _event_size;
+    std::vector<struct epoll_event> _events;
+    bvar::Adder<int64_t> _conn_count;
+    bvar::Adder<int64_t> _accept_count;
+    bvar::Adder<int64_t> _event_count;
 };
 
 } // namespace baikal
@@ -15,6 +15,7 @@
 // Brief:  The defination of Network Server.
 #pragma once
 
+#include <atomic>
 #include "network_socket.h"
 #include "state_machine.h"
 #include "epoll_info.h"
@@ -79,20 +80,28 @@ public:
 
     bool get_shutdown() { return _shutdown; }
 
-    EpollInfo* get_epoll_info() {
-        return _epoll_info;
+    // 每个reactor一个EpollInfo，连接只属于accept它的reactor
+    const std::vector<EpollInfo*>& get_epoll_infos() {
+        return _epoll_infos;
     }
 
     uint64_t get_instance_id() {
         return _instance_id;
     }
 
-private:
+protected:
     // For instance.
     NetworkServer();
+    SmartSocket create_listen_socket(bool reuse_port);
+    // 每个reactor创建一个SO_REUSEPORT监听socket和EpollInfo
+    int init_reactors(int reactor_num);
+    // 运行所有reactor直到shutdown，reactor 0在当前线程
+    int run_reactors();
+    int reactor_loop(EpollInfo* epoll_info, SmartSocket service);
+
+private:
     NetworkServer& operator=(const NetworkServer& other);
     bool set_fd_flags(int fd);
-    SmartSocket create_listen_socket();
     void construct_other_heart_beat_request(pb::BaikalOtherHeartBeatRequest& request);
     void process_other_heart_beat_response(const pb::BaikalOtherHeartBeatResponse& response);
 
@@ -130,10 +139,10 @@ private:
     // Server info.
     uint32_t        _counter = 0;       // Using counter++ to generate socket id.
     bool            _is_init = false;   // Flag of initialization status.
-    bool            _shutdown = false;  // Flag of graceful shutdown.
+    std::atomic<bool> _shutdown {false}; // Flag of graceful shutdown, written by every reactor thread.
     // Socket info.
-    SmartSocket     _service = nullptr;  // Server socket.
-    EpollInfo*      _epoll_info = nullptr;      // Epoll info and fd mapping.
+    std::vector<SmartSocket> _services;     // Server socket, one per reactor.
+    std::vector<EpollInfo*>  _epoll_infos;  // Epoll info and fd mapping, one per reactor.
 
     Bthread         _conn_check_bth;
     Bthread         _heartbeat_bth;
@@ -6,6 +6,7 @@
 namespace baikaldb {
 
 DECLARE_int32(worker_number);
+DECLARE_bool(ddl_index_use_sst_ingest);
 
 class TaskManager : public Singleton<TaskManager> {
 public:
@@ -15,6 +16,8 @@ public:
 
     void process_ddl_work(pb::RegionDdlWork work);
     void process_txn_ddl_work(pb::DdlWorkInfo work);
+    // 局部索引由store按region数据构建sst并ingest，成功或唯一键冲突返回0，其他情况返回-1走事务回填
+    int ingest_index_sst(pb::RegionDdlWork& work);
 
 private:
     ConcurrencyBthread _workers {FLAGS_worker_number};
@@ -157,6 +157,7 @@ private:
     rocksdb::ColumnFamilyHandle* _raftlog_handle;
     rocksdb::ColumnFamilyHandle* _binlog_handle;
     bool _is_binlog_region = false;
+    int64_t _cache_owner = 0;
 
     IndexTermMap _term_map;
     bthread_mutex_t _mutex; // for term_map     
@@ -0,0 +1,104 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include <bvar/bvar.h>
+#include <bthread/mutex.h>
+#ifdef BAIDU_INTERNAL
+#include <raft/log_entry.h>
+#else
+#include <braft/log_entry.h>
+#endif
+
+namespace baikaldb {
+// store级别的raft log内存缓存，保存各region最近append的数据日志，
+// get_entry/分裂追日志时先查缓存，未命中再读rocksdb
+// 每个region的日志按index连续存放，总内存超过上限时按append顺序淘汰
+class RaftLogCache {
+public:
+    struct CacheEntry {
+        int64_t index = 0;
+        int64_t term = 0;
+        butil::IOBuf data;
+    };
+    virtual ~RaftLogCache() {}
+
+    static RaftLogCache* get_instance() {
+        static RaftLogCache _instance;
+        return &_instance;
+    }
+    bool enabled() const;
+    // 每个log storage实例一个owner，同一region重建log storage时，
+    // 只有最新的owner能修改缓存，旧实例析构时不会清掉新实例的缓存
+    int64_t new_owner() {
+        return ++_max_owner;
+    }
+    // 切换owner时丢弃旧owner的缓存
+    void set_owner(int64_t region_id, int64_t owner);
+    // entries必须已经持久化
+    void append(int64_t region_id, int64_t owner, const std::vector<braft::LogEntry*>& entries);
+    // 命中返回0
+    int get(int64_t region_id, int64_t index, CacheEntry* entry);
+    braft::LogEntry* get_entry(int64_t region_id, int64_t index);
+    // 删除[0, first_index_kept)
+    void truncate_prefix(int64_t region_id, int64_t owner, int64_t first_index_kept);
+    // 删除(last_index_kept, +∞)
+    void truncate_suffix(int64_t region_id, int64_t owner, int64_t last_index_kept);
+    void remove(int64_t region_id, int64_t owner);
+    int64_t used_bytes() const {
+        return _used_bytes.get_value();
+    }
+
+private:
+    static const int SHARD_COUNT = 16;
+    struct Shard {
+        bthread::Mutex mutex;
+        std::unordered_map<int64_t, std::deque<CacheEntry>> region_entries;
+        // append顺序，用于全局淘汰，其中可能有已被truncate的过期项
+        std::deque<std::pair<int64_t, int64_t>> append_order;
+        // region_id -> owner
+        std::unordered_map<int64_t, int64_t> owners;
+        int64_t bytes = 0;
+        int64_t entry_count = 0;
+    };
+    RaftLogCache() : _hit_second("raft_log_cache_hit_second", &_hit),
+        _miss_second("raft_log_cache_miss_second", &_miss) {}
+    Shard& shard(int64_t region_id) {
+        return _shards[(uint64_t)region_id % SHARD_COUNT];
+    }
+    void pop_front(Shard& s, std::deque<CacheEntry>& entries);
+    void pop_back(Shard& s, std::deque<CacheEntry>& entries);
+    void evict(Shard& s);
+    void clear(Shard& s, int64_t region_id);
+    bool is_owner(Shard& s, int64_t region_id, int64_t owner) {
+        auto iter = s.owners.find(region_id);
+        return iter != s.owners.end() && iter->second == owner;
+    }
+
+    Shard _shards[SHARD_COUNT];
+    std::atomic<int64_t> _max_owner {0};
+    bvar::Adder<int64_t> _hit {"raft_log_cache_hit"};
+    bvar::Adder<int64_t> _miss {"raft_log_cache_miss"};
+    bvar::Adder<int64_t> _used_bytes {"raft_log_cache_bytes"};
+    bvar::PerSecond<bvar::Adder<int64_t>> _hit_second;
+    bvar::PerSecond<bvar::Adder<int64_t>> _miss_second;
+};
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
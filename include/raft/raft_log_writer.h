@@ -0,0 +1,66 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <bvar/bvar.h>
+#include "rocks_wrapper.h"
+#include "group_committer.h"
+
+namespace baikaldb {
+// store内所有region的raft log写入合并为一个WriteBatch，一次WAL写入(sync)
+// 第一个排队的调用者成为本轮写入者，收集窗口内其他region的写入后统一提交，
+// 其余调用者等待本轮完成后返回
+class RaftLogWriter {
+public:
+    typedef std::function<void(rocksdb::WriteBatch*)> FillFunc;
+    virtual ~RaftLogWriter() {}
+
+    static RaftLogWriter* get_instance() {
+        static RaftLogWriter _instance;
+        return &_instance;
+    }
+    // fill往batch中写入本region的kv，写入完成（或失败）后返回
+    rocksdb::Status write(const FillFunc& fill, int64_t entry_count);
+    int64_t write_count() const {
+        return _write_count.get_value();
+    }
+    int64_t request_count() const {
+        return _request_count.get_value();
+    }
+
+private:
+    struct Writer {
+        const FillFunc* fill = nullptr;
+        int64_t entry_count = 0;
+        rocksdb::Status status;
+    };
+    RaftLogWriter() : _db(RocksWrapper::get_instance()),
+        _committer([this](std::vector<Writer*>& group) { write_group(group); }) {}
+    void write_group(std::vector<Writer*>& group);
+
+    RocksWrapper* _db = nullptr;
+    GroupCommitter<Writer> _committer;
+
+    bvar::LatencyRecorder _write_latency {"raft_log_group_write"};
+    bvar::IntRecorder _group_size {"raft_log_group_size"};
+    bvar::IntRecorder _group_entries {"raft_log_group_entries"};
+    bvar::Adder<int64_t> _write_count {"raft_log_group_write_count"};
+    bvar::Adder<int64_t> _request_count {"raft_log_group_request_count"};
+};
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
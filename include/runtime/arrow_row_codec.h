@@ -0,0 +1,43 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "common.h"
+#include "mem_row_descriptor.h"
+#include "mem_row.h"
+#include "row_batch.h"
+#include "proto/store.interface.pb.h"
+
+namespace baikaldb {
+// store=>baikaldb select结果的arrow列式编码
+// 每个tuple的动态message按字段cpp_type映射为arrow列，未赋值的字段为null
+// 两端按相同的TupleDescriptor生成schema，序列化结果不携带schema
+class ArrowRowCodec {
+public:
+    // 所有tuple的字段类型都能映射为arrow列时才能使用列式编码
+    static bool support(MemRowDescriptor* desc);
+    // batch中的全部行按desc的tuple顺序编码，每个tuple一个record batch
+    static int encode(RowBatch* batch, MemRowDescriptor* desc, pb::ArrowBatchValue* value);
+    // 解码出的行追加到rows，tuple_ids与encode时的tuple顺序一致
+    static int decode(const pb::ArrowBatchValue& value,
+            const google::protobuf::RepeatedField<int32_t>& tuple_ids,
+            MemRowDescriptor* desc,
+            std::vector<std::unique_ptr<MemRow>>* rows);
+};
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,224 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <memory>
+#include <unordered_set>
+#include "common.h"
+#include "expr_value.h"
+#include "row_batch.h"
+#include "mem_row_descriptor.h"
+
+namespace baikaldb {
+DECLARE_bool(enable_columnar_execution);
+
+// 单列数据，按物理类型分桶存储，避免逐行的ExprValue/protobuf反射开销
+// null_map每行一个字节(1表示null)，便于向量化处理
+class ColumnVector {
+public:
+    enum Category {
+        INT_COLUMN,     // BOOL/INT8~INT64/TIME
+        UINT_COLUMN,    // UINT8~UINT64/DATE/DATETIME/TIMESTAMP
+        DOUBLE_COLUMN,  // FLOAT/DOUBLE
+        STRING_COLUMN,  // STRING/HEX/HLL/TDIGEST
+        VALUE_COLUMN    // 其他类型(BITMAP等)直接存ExprValue
+    };
+
+    explicit ColumnVector(pb::PrimitiveType type) : _type(type), _category(category_of(type)) {
+    }
+
+    static Category category_of(pb::PrimitiveType type);
+
+    pb::PrimitiveType type() const {
+        return _type;
+    }
+    Category category() const {
+        return _category;
+    }
+    size_t size() const {
+        return _null_map.size();
+    }
+    void reserve(size_t size);
+    void clear() {
+        _null_map.clear();
+        _int_data.clear();
+        _uint_data.clear();
+        _double_data.clear();
+        _string_data.clear();
+        _value_data.clear();
+    }
+    // 重置类型并分配size行(全部为null)，用于批量计算的输出
+    void reset(pb::PrimitiveType type, size_t size);
+    void append(const ExprValue& value);
+    void append_null();
+    // 字符串列直接追加原始字节，避免构造ExprValue
+    void append_string(const char* data, size_t len) {
+        _null_map.emplace_back(0);
+        _string_data.emplace_back(data, len);
+    }
+    // 丢弃size之后的行，用于回滚解码失败的行
+    void truncate(size_t size);
+    // 使用者保证idx < size()
+    void set_value(size_t idx, const ExprValue& value);
+    ExprValue get_value(size_t idx) const;
+
+    bool is_null(size_t idx) const {
+        return _null_map[idx] != 0;
+    }
+    const uint8_t* null_map() const {
+        return _null_map.data();
+    }
+    const int64_t* int_data() const {
+        return _int_data.data();
+    }
+    const uint64_t* uint_data() const {
+        return _uint_data.data();
+    }
+    const double* double_data() const {
+        return _double_data.data();
+    }
+    const std::string* string_data() const {
+        return _string_data.data();
+    }
+    uint8_t* mutable_null_map() {
+        return _null_map.data();
+    }
+    int64_t* mutable_int_data() {
+        return _int_data.data();
+    }
+    uint64_t* mutable_uint_data() {
+        return _uint_data.data();
+    }
+    double* mutable_double_data() {
+        return _double_data.data();
+    }
+    std::string* mutable_string_data() {
+        return _string_data.data();
+    }
+    int64_t used_size() const;
+
+private:
+    pb::PrimitiveType _type;
+    Category _category;
+    std::vector<uint8_t> _null_map;
+    std::vector<int64_t> _int_data;
+    std::vector<uint64_t> _uint_data;
+    std::vector<double> _double_data;
+    std::vector<std::string> _string_data;
+    std::vector<ExprValue> _value_data;
+};
+
+// 列存batch：按(tuple_id, slot_id)组织的列集合 + 选择向量
+// 选择向量为空时表示所有行都有效；FilterNode等只修改选择向量，不移动数据
+class ColumnBatch {
+public:
+    ColumnBatch() {}
+
+    // 按tuple描述初始化列布局；tuple_ids为空时使用全部tuple
+    int init(const std::vector<pb::TupleDescriptor>& tuple_descs,
+            const std::unordered_set<int32_t>& tuple_ids);
+    bool is_inited() const {
+        return _is_inited;
+    }
+    void set_capacity(size_t capacity) {
+        _capacity = capacity;
+    }
+    size_t capacity() const {
+        return _capacity;
+    }
+    // 物理行数
+    size_t size() const {
+        return _num_rows;
+    }
+    // 经过选择向量后的有效行数
+    size_t selected_size() const {
+        return _use_selection ? _selection.size() : _num_rows;
+    }
+    // 第i个有效行对应的物理行号
+    uint32_t selected_row(size_t i) const {
+        return _use_selection ? _selection[i] : i;
+    }
+    bool is_full() const {
+        return _num_rows >= _capacity;
+    }
+    // 保留列布局，清空数据
+    void clear();
+
+    ColumnVector* get_column(int32_t tuple_id, int32_t slot_id) {
+        if (tuple_id < 0 || tuple_id >= (int32_t)_column_index.size()) {
+            return nullptr;
+        }
+        auto& slots = _column_index[tuple_id];
+        if (slot_id <= 0 || slot_id >= (int32_t)slots.size() || slots[slot_id] < 0) {
+            return nullptr;
+        }
+        return _columns[slots[slot_id]].get();
+    }
+    ExprValue get_value(size_t row_idx, int32_t tuple_id, int32_t slot_id) {
+        ColumnVector* column = get_column(tuple_id, slot_id);
+        if (column == nullptr) {
+            return ExprValue::Null();
+        }
+        return column->get_value(row_idx);
+    }
+
+    bool use_selection() const {
+        return _use_selection;
+    }
+    const std::vector<uint32_t>& selection() const {
+        return _selection;
+    }
+    // 以新的选择向量替换当前选择，sel中为物理行号且保持递增
+    void set_selection(std::vector<uint32_t>& sel) {
+        _selection.swap(sel);
+        _use_selection = true;
+    }
+    // 只保留前num_keep个有效行，用于limit
+    void keep_first_selected(size_t num_keep);
+
+    // 行存适配：MemRow <=> ColumnBatch
+    int append_row(MemRow* row);
+    // 存储层直接解码到列：各列追加完成后调用finish_row，未追加的列补null；
+    // 解码失败时调用rollback_row丢弃本行已追加的值
+    void finish_row();
+    void rollback_row();
+    int append_row_batch(RowBatch* batch);
+    // 把物理行row_idx的各列写入row(row由调用方复用)
+    int fill_row(size_t row_idx, MemRow* row) const;
+    // 只转换选择向量中的行
+    int to_row_batch(MemRowDescriptor* desc, RowBatch* batch) const;
+
+    int64_t used_bytes_size() const;
+
+private:
+    struct ColumnSlot {
+        int32_t tuple_id;
+        int32_t slot_id;
+    };
+    bool _is_inited = false;
+    size_t _capacity = ROW_BATCH_CAPACITY;
+    size_t _num_rows = 0;
+    std::vector<std::unique_ptr<ColumnVector>> _columns;
+    std::vector<ColumnSlot> _column_slots;
+    // tuple_id => slot_id => _columns下标(-1表示无此列)
+    std::vector<std::vector<int>> _column_index;
+    std::vector<uint32_t> _selection;
+    bool _use_selection = false;
+};
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
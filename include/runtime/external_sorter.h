@@ -0,0 +1,72 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <bvar/bvar.h>
+#include "common.h"
+#include "sorter.h"
+#include "spill_file.h"
+
+namespace baikaldb {
+// 内存不足时的外排
+// 每次spill把Sorter中已有的数据排好序写成一个有序run并释放内存，读取时对所有run做k路归并
+// run数达到上限时先做一次中间归并
+class ExternalSorter {
+public:
+    ExternalSorter(MemRowCompare* comp, MemRowDescriptor* desc) :
+            _comp(comp), _desc(desc), _use_sort_key(comp->use_sort_key()) {
+    }
+    // 取走sorter中的全部数据，spilled_bytes返回落盘行原来占用的内存
+    int spill(Sorter* sorter, int64_t* spilled_bytes);
+    size_t run_size() const {
+        return _runs.size();
+    }
+    // 全部run写完后调用，初始化归并堆
+    int merge();
+    // run数达到sort_spill_max_runs时把已有run归并成一个，限制同时打开的文件数
+    int merge_runs();
+    int get_next(RowBatch* batch, bool* eos);
+
+    static bvar::Adder<int64_t> sort_spill_bytes;
+    static bvar::Adder<int64_t> sort_spill_runs;
+    static bvar::Adder<int64_t> sort_spill_rows;
+
+private:
+    struct RunCursor {
+        std::unique_ptr<SpillFile> file;
+        std::unique_ptr<MemRow> row;
+        std::string sort_key;
+    };
+    // 读run的下一行，读完时*eof为true
+    int advance(RunCursor* cursor, bool* eof);
+    // 堆中left是否应排在right之后(小顶堆)
+    bool greater(size_t left, size_t right) {
+        if (_use_sort_key) {
+            return _runs[left].sort_key > _runs[right].sort_key;
+        }
+        return _comp->less(_runs[right].row.get(), _runs[left].row.get());
+    }
+
+private:
+    MemRowCompare* _comp;
+    MemRowDescriptor* _desc;
+    bool _use_sort_key;
+    std::vector<RunCursor> _runs;
+    std::vector<size_t> _heap;
+};
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
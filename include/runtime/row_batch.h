@@ -17,6 +17,8 @@
 #include <stdint.h>
 #include <vector>
 #include <memory>
+#include <string>
+#include <algorithm>
 #include "mem_row_compare.h"
 
 namespace baikaldb {
@@ -97,8 +99,47 @@ public:
         _idx++;
     }
     void sort(MemRowCompare* comp) {
-        std::sort(_rows.begin(), _rows.end(), 
-                comp->get_less_func());
+        sort(comp, nullptr);
+    }
+    // 能用排序key时先对每行编码一次key，再按memcmp排序
+    // sort_keys非空时输出与排序后的行一一对应的key，供归并使用
+    void sort(MemRowCompare* comp, std::vector<std::string>* sort_keys) {
+        if (!comp->use_sort_key()) {
+            std::sort(_rows.begin(), _rows.end(), 
+                    comp->get_less_func());
+            if (sort_keys != nullptr) {
+                sort_keys->clear();
+            }
+            return;
+        }
+        size_t num_rows = _rows.size();
+        std::vector<std::string> keys(num_rows);
+        std::vector<uint32_t> order(num_rows);
+        for (size_t i = 0; i < num_rows; i++) {
+            comp->encode_sort_key(_rows[i].get(), &keys[i]);
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&keys](uint32_t left, uint32_t right) {
+            return keys[left] < keys[right];
+        });
+        std::vector<std::unique_ptr<MemRow>> rows(num_rows);
+        for (size_t i = 0; i < num_rows; i++) {
+            rows[i] = std::move(_rows[order[i]]);
+        }
+        _rows.swap(rows);
+        if (sort_keys != nullptr) {
+            sort_keys->resize(num_rows);
+            for (size_t i = 0; i < num_rows; i++) {
+                (*sort_keys)[i].swap(keys[order[i]]);
+            }
+        }
+    }
+    // 为已排好序的行生成key
+    void encode_sort_keys(MemRowCompare* comp, std::vector<std::string>* sort_keys) {
+        sort_keys->resize(_rows.size());
+        for (size_t i = 0; i < _rows.size(); i++) {
+            comp->encode_sort_key(_rows[i].get(), &(*sort_keys)[i]);
+        }
     }
     void swap(RowBatch& batch) {
         _rows.swap(batch._rows);
@@ -379,6 +379,8 @@ public:
     int memory_limit_exceeded(int64_t rows_to_check, int64_t bytes);
     int memory_limit_release(int64_t rows_to_check, int64_t bytes);
     int memory_limit_release_all();
+    // 已用内存超过query上限(或进程上限)的ratio%，供排序/聚合等算子提前落盘
+    bool memory_limit_approaching(int64_t ratio);
 
     int64_t calc_single_store_concurrency(pb::OpType op_type);
 
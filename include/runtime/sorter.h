@@ -39,12 +39,38 @@ public:
     }
 private:
     void multi_sort();
+    void multi_encode_sort_keys();
     void make_heap();
     void shiftdown(size_t index);
+    // 比较两个batch当前行，有排序key时直接比较key
+    bool less(size_t left, size_t right) {
+        if (_use_sort_key) {
+            return _sort_keys[left][_min_heap[left]->index()] <
+                _sort_keys[right][_min_heap[right]->index()];
+        }
+        return _comp->less(_min_heap[left]->get_row().get(),
+                _min_heap[right]->get_row().get());
+    }
+    void swap_batch(size_t left, size_t right) {
+        std::iter_swap(_min_heap.begin() + left, _min_heap.begin() + right);
+        if (_use_sort_key) {
+            _sort_keys[left].swap(_sort_keys[right]);
+        }
+    }
+    void pop_batch() {
+        swap_batch(0, _min_heap.size() - 1);
+        _min_heap.pop_back();
+        if (_use_sort_key) {
+            _sort_keys.pop_back();
+        }
+    }
 
 private:
     MemRowCompare* _comp;
     std::vector<std::shared_ptr<RowBatch>> _min_heap;
+    // 与_min_heap一一对应，每个batch各行的排序key
+    std::vector<std::vector<std::string>> _sort_keys;
+    bool _use_sort_key = false;
     size_t _idx;
 };
 }
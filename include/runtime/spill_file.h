@@ -0,0 +1,76 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <memory>
+#include <vector>
+#include "common.h"
+#include "mem_row_descriptor.h"
+#include "mem_row.h"
+#include "row_batch.h"
+
+namespace baikaldb {
+DECLARE_string(spill_dir);
+
+// 算子落盘用的本地临时文件，先顺序追加写，finish_write后顺序读
+// 行格式：每个tuple为 uint32长度 + tuple的protobuf二进制序列化，与store返回行数据的编码一致
+// 对象析构时删除文件
+class SpillFile {
+public:
+    explicit SpillFile(MemRowDescriptor* desc) : _desc(desc) {
+        for (auto& pair : desc->id_tuple_mapping()) {
+            _tuple_ids.push_back(pair.first);
+        }
+    }
+    ~SpillFile();
+    // 进程启动时调用，清理spill_dir下已退出进程(如crash)遗留的文件
+    static void clean_stale_files();
+
+    int open_write();
+    int write_row(MemRow* row);
+    int write_batch(RowBatch* batch);
+    // 刷盘并重新以读模式打开，写缓冲随之释放
+    int finish_write();
+    // 读到文件尾时*eof为true
+    int read_row(std::unique_ptr<MemRow>* row, bool* eof);
+
+    int64_t bytes() const {
+        return _bytes;
+    }
+    int64_t rows() const {
+        return _rows;
+    }
+    const std::string& path() const {
+        return _path;
+    }
+
+private:
+    void close_file();
+
+    MemRowDescriptor* _desc;
+    std::vector<int32_t> _tuple_ids;
+    std::string _path;
+    FILE* _file = nullptr;
+    std::string _buf;
+    int64_t _bytes = 0;
+    int64_t _rows = 0;
+    int64_t _read_rows = 0;
+    DISALLOW_COPY_AND_ASSIGN(SpillFile);
+};
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
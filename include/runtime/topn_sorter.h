@@ -0,0 +1,62 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "common.h"
+#include "row_batch.h"
+#include "mem_row_compare.h"
+
+namespace baikaldb {
+// ORDER BY ... LIMIT N使用的有界堆排序，只保留前N行
+// 堆顶为当前保留行中最大的一行，新行比堆顶小时替换堆顶
+class TopNSorter {
+public:
+    TopNSorter(MemRowCompare* comp, int64_t limit) : 
+            _comp(comp), _limit(limit), _use_sort_key(comp->use_sort_key()) {
+        _heap.reserve(limit);
+    }
+    // 取走batch中的行，被淘汰行的内存大小累加到released_bytes
+    void add_batch(RowBatch* batch, int64_t* released_bytes);
+    // 把堆排成升序，之后才能get_next
+    void sort();
+    int get_next(RowBatch* batch, bool* eos);
+
+    size_t size() const {
+        return _heap.size();
+    }
+private:
+    struct HeapItem {
+        std::string sort_key;
+        std::unique_ptr<MemRow> row;
+    };
+    bool less(const HeapItem& left, const HeapItem& right) {
+        if (_use_sort_key) {
+            return left.sort_key < right.sort_key;
+        }
+        return _comp->less(left.row.get(), right.row.get());
+    }
+
+private:
+    MemRowCompare* _comp;
+    size_t _limit;
+    bool _use_sort_key;
+    std::vector<HeapItem> _heap;
+    size_t _idx = 0;
+};
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
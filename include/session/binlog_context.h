@@ -18,6 +18,7 @@
 #include "expr_value.h"
 #include "schema_factory.h"
 #include "meta_server_interact.hpp"
+#include "group_committer.h"
 
 #ifdef BAIDU_INTERNAL
 #include <base/endpoint.h>
@@ -32,13 +33,45 @@
 #endif
 
 #include <memory>
+#include <vector>
+#include <bvar/bvar.h>
 
 namespace baikaldb {
 
 DECLARE_string(meta_server_bns);
+// 开启tso_batch_fetch后，并发的get_tso合并为一次count=N的OP_GEN_TSO请求
+// 第一个排队的调用者负责发请求，按排队顺序给每个调用者分配连续的tso
 class TsoFetcher {
 public:
+    virtual ~TsoFetcher() {}
+
+    static TsoFetcher* get_instance() {
+        static TsoFetcher _instance;
+        return &_instance;
+    }
     static int64_t get_tso();
+    // 申请count个连续的tso，返回第一个，失败返回<0
+    static int64_t gen_tso(int64_t count);
+
+protected:
+    TsoFetcher() : _committer([this](std::vector<Waiter*>& batch) { fetch_batch(batch); }) {}
+    int64_t batch_get_tso();
+    // 一次请求count个连续的tso
+    virtual int64_t fetch_tso(int64_t count) {
+        return gen_tso(count);
+    }
+
+private:
+    struct Waiter {
+        int64_t timestamp = 0;
+    };
+    void fetch_batch(std::vector<Waiter*>& batch);
+
+    GroupCommitter<Waiter> _committer;
+    bvar::LatencyRecorder _wait_latency {"tso_batch_wait"};
+    bvar::IntRecorder _batch_size {"tso_batch_size"};
+    bvar::Adder<int64_t> _rpc_count {"tso_batch_rpc_count"};
+    bvar::Adder<int64_t> _request_count {"tso_batch_request_count"};
 };
 
 class BinlogContext {
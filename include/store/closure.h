@@ -26,6 +26,8 @@ struct DMLClosure : public braft::Closure {
 
     pb::OpType op_type;
     pb::StoreRes* response = nullptr;
+    // 提交raft的原始请求，生命周期同done，on_apply时免去反序列化
+    const pb::StoreReq* request = nullptr;
     google::protobuf::Closure* done = nullptr;
     Region* region = nullptr;
     SmartTransaction transaction = nullptr;
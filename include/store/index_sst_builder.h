@@ -0,0 +1,78 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "common.h"
+#include "schema_factory.h"
+#include "rocks_wrapper.h"
+#include "proto/store.interface.pb.h"
+
+namespace baikaldb {
+// 扫描region数据，按Transaction::put_secondary的编码生成局部索引，排序后写sst并ingest
+// 失败时删除本次已经ingest的索引数据
+class IndexSstBuilder {
+public:
+    enum BuildResult {
+        BUILD_FAIL = -1,        // 本副本本地失败(sst读写、ingest、解码等)，与其他副本结果可能不一致
+        BUILD_SUCCESS = 0,
+        BUILD_DUP_UNIQ = 1,     // 唯一索引冲突，各副本一致
+        BUILD_TOO_LARGE = 2     // region行数超过上限，各副本一致，回退到事务回填
+    };
+    IndexSstBuilder(int64_t region_id, int64_t table_id, SmartIndex index_ptr, SmartIndex pk_ptr) :
+        _region_id(region_id), _table_id(table_id), _index_ptr(index_ptr), _pk_ptr(pk_ptr),
+        _rocksdb(RocksWrapper::get_instance()) {}
+
+    // 区间为[start_key, end_key)，end_key为空表示无上界
+    void set_range(const std::string& start_key, const std::string& end_key) {
+        _start_key = start_key;
+        _end_key = end_key;
+    }
+    // sst_dir需要与rocksdb在同一个文件系统，保证ingest能move成功
+    // 结果同时写入response
+    BuildResult build(const std::string& sst_dir, int64_t batch_lines, int64_t max_lines,
+            pb::StoreRes* response);
+    // 删除region内该索引的全部数据
+    int remove_index_data();
+
+    int64_t scan_lines() const {
+        return _scan_lines;
+    }
+    int64_t index_lines() const {
+        return _index_lines;
+    }
+
+private:
+    BuildResult scan(const std::string& sst_dir, int64_t batch_lines, int64_t max_lines,
+            pb::StoreRes* response);
+    BuildResult flush_entries(const std::string& sst_dir, pb::StoreRes* response);
+
+    int64_t _region_id = 0;
+    int64_t _table_id = 0;
+    SmartIndex _index_ptr;
+    SmartIndex _pk_ptr;
+    RocksWrapper* _rocksdb = nullptr;
+    std::string _start_key;
+    std::string _end_key;
+    std::vector<std::pair<std::string, std::string>> _entries;
+    int64_t _scan_lines = 0;
+    int64_t _index_lines = 0;
+    int _sst_count = 0;
+};
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -423,6 +423,9 @@ public:
             _learner.reset(new braft::Learner(groupId, peerId));
         }
         _region_uuid = butil::fast_rand();
+        // apply依赖的成员在构造时即可用，init时重建resource
+        _meta_writer = MetaWriter::get_instance();
+        _resource.reset(new RegionResource);
     }
 
     int init(bool new_region, int32_t snapshot_times);
@@ -478,15 +481,32 @@ public:
             int64_t term,
             braft::Closure* done);
 
-    int select(const pb::StoreReq& request, pb::StoreRes& response);
+    // stream_id有效时，select_normal边执行边把结果分块推送到stream
+    int select(const pb::StoreReq& request, pb::StoreRes& response,
+            brpc::StreamId stream_id = brpc::INVALID_STREAM_ID);
     int select(const pb::StoreReq& request, 
             const pb::Plan& plan,
             const RepeatedPtrField<pb::TupleDescriptor>& tuples,
-            pb::StoreRes& response);
-    int select_normal(RuntimeState& state, ExecNode* root, pb::StoreRes& response);
+            pb::StoreRes& response,
+            brpc::StreamId stream_id = brpc::INVALID_STREAM_ID);
+    int select_normal(RuntimeState& state, ExecNode* root, pb::StoreRes& response,
+            brpc::StreamId stream_id = brpc::INVALID_STREAM_ID, bool use_arrow_format = false);
+    // 先回包建立stream，再执行select并通过stream推送结果
+    void select_streaming(brpc::Controller* cntl,
+            const pb::StoreReq* request,
+            pb::StoreRes* response,
+            google::protobuf::Closure* done);
+    int write_select_chunk(brpc::StreamId stream_id, pb::StoreRes& chunk);
     int select_sample(RuntimeState& state, ExecNode* root, const pb::AnalyzeInfo& analyze_info, pb::StoreRes& response);
     void do_apply(int64_t term, int64_t index, const pb::StoreReq& request, braft::Closure* done);
     virtual void on_apply(braft::Iterator& iter);
+    struct ApplyEntry {
+        int64_t term;
+        int64_t index;
+        std::shared_ptr<pb::StoreReq> request;
+    };
+    bool can_group_apply(const pb::StoreReq& request, braft::Closure* done);
+    void apply_kv_out_txn_group(std::vector<ApplyEntry>& apply_group);
    
     virtual void on_shutdown();
     virtual void on_leader_start(int64_t term);
@@ -574,6 +594,10 @@ public:
     void compact_data_in_queue();
     int ingest_snapshot_sst(const std::string& dir); 
     int ingest_sst_backup(const std::string& data_sst_file, const std::string& meta_sst_file); 
+    // 加局部索引时在apply中用当前数据构建索引sst并ingest，代替逐行事务回填
+    int ingest_index_sst(const pb::StoreReq& request, pb::StoreRes& response);
+    void apply_ingest_index_sst(int64_t term, int64_t index, const pb::StoreReq& request,
+            braft::Closure* done);
     // other thread
     void reverse_merge();
     // other thread
@@ -661,6 +685,8 @@ public:
             int64_t& split_end_index);
     
     int get_split_key(std::string& split_key, int64_t& split_key_term);
+    // 读写qps持续超过阈值时，按采样的key访问分布计算分裂点，返回0表示需要分裂
+    int get_load_split_key(std::string& split_key, int64_t& split_key_term);
     
     bool is_splitting() {
         return _split_param.new_region_id != 0;
@@ -934,6 +960,9 @@ public:
             pb::StoreRes* response,
             google::protobuf::Closure* done);
     
+    bool use_write_set(pb::OpType op_type);
+    // 写集执行时的region version与apply时不一致，各副本统一放弃
+    static bool is_write_set_stale(const pb::StoreReq& request, int64_t region_version);
     void exec_kv_out_txn(const pb::StoreReq* request, 
             pb::StoreRes* response,
             const char* remote_side,
@@ -1294,6 +1323,7 @@ private:
     void apply_kv_out_txn(const pb::StoreReq& request, braft::Closure* done, 
                                   int64_t index, int64_t term);
     bool validate_version(const pb::StoreReq* request, pb::StoreRes* response);
+    void fill_version_old_response(pb::StoreRes* response, const std::string& errmsg);
     void print_log_entry(const int64_t start_index, const int64_t end_index);
     void set_region(const pb::RegionInfo& region_info) {
         std::lock_guard<std::mutex> lock(_region_lock);
@@ -1448,6 +1478,7 @@ private:
 
     TimeCost                        _time_cost; //上次收到请求的时间，每次收到请求都重置一次
     LatencyOnly                     _dml_time_cost;
+    LatencyOnly                     _select_time_cost; // 上报region读qps，供meta按负载调度
     bool                                _restart = false;
     //计算存储分离开关，在store定时任务中更新，避免每次dml都访问schema factory
     bool                                _storage_compute_separate = false;
@@ -1472,6 +1503,8 @@ private:
     int64_t                             _applied_index_lastcycle = 0;  
     TimeCost                            _lastcycle_time_cost; //定时线程上次循环的时间，更新_applied_index_lastcycle时更新
     TimeCost                            _last_split_time_cost; //上次分裂时间戳
+    std::shared_ptr<KeySampler>         _key_sampler = std::make_shared<KeySampler>(); //热点region的key访问采样
+    int64_t                             _load_split_hot_rounds = 0;
     ApproximateInfo                     _approx_info;
 
     bool                                _report_peer_info = false;
@@ -1485,6 +1518,7 @@ private:
     // TODO:num_table_lines维护太麻烦，后续要考虑使用预估的方式获取
     std::atomic<int64_t>                _num_table_lines;  //total number of pk record in this region
     std::atomic<int64_t>                _num_delete_lines;  //total number of delete rows after last compact
+    std::atomic<int64_t>                _index_sst_fail_index_id {0}; //本副本构建失败的索引，通过心跳上报meta
     int64_t                             _snapshot_num_table_lines = 0;  //last snapshot number
     TimeCost                            _snapshot_time_cost;
     int64_t                             _snapshot_index = 0; //last snapshot log index
@@ -84,6 +84,11 @@ public:
                        pb::StoreRes* response,
                        google::protobuf::Closure* done);
 
+    virtual void multi_query(google::protobuf::RpcController* controller,
+                       const pb::MultiStoreReq* request,
+                       pb::MultiStoreRes* response,
+                       google::protobuf::Closure* done);
+
     void async_apply_log_entry(google::protobuf::RpcController* controller,
                               const pb::BatchStoreReq* request,
                               pb::BatchStoreRes* response,
@@ -319,7 +324,9 @@ private:
              dml_time_cost("dml_time_cost", 60),
              select_time_cost("select_time_cost", 60),
              peer_delay_latency("peer_delay_latency", 60),
-             heart_beat_count("heart_beat_count") {
+             heart_beat_count("heart_beat_count"),
+             apply_group_entries("apply_group_entries"),
+             apply_skip_parse_count("apply_skip_parse_count") {
         bthread_mutex_init(&_param_mutex, NULL);
     }
 
@@ -462,6 +469,9 @@ public:
     bvar::LatencyRecorder select_time_cost;
     bvar::LatencyRecorder peer_delay_latency;
     bvar::Adder<int64_t>  heart_beat_count;
+    // follower合并apply的日志条数，leader apply时复用已解析请求的次数
+    bvar::IntRecorder     apply_group_entries;
+    bvar::Adder<int64_t>  apply_skip_parse_count;
 
     //for fake binlog tso
     TimeCost gen_tso_time;
@@ -0,0 +1,56 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <bvar/bvar.h>
+#include "common.h"
+#include "lru_cache.h"
+#include "proto/store.interface.pb.h"
+
+namespace baikaldb {
+typedef std::shared_ptr<google::protobuf::RepeatedPtrField<pb::TupleDescriptor>> SmartTupleDescs;
+typedef std::shared_ptr<pb::Plan> SmartPbPlan;
+// store端按 sql_sign + tuple_sign/plan_sign 缓存select的TupleDescriptor和pb plan
+// baikaldb确认store已缓存后请求中不再携带tuples/plan，未命中时返回PLAN_CACHE_MISS由baikaldb带全量重发
+// 签名为内容的签名，表结构变更后签名随之变化，不需要额外的版本号
+// plan中含有region的扫描范围和sql的常量，只有同一region上重复的相同查询才能省略plan
+class StorePlanCache {
+public:
+    static const int SHARD_NUM = 16;
+    static StorePlanCache* get_instance() {
+        static StorePlanCache _instance;
+        return &_instance;
+    }
+    // 命中返回0
+    int find(uint64_t sql_sign, uint64_t tuple_sign, SmartTupleDescs* tuples);
+    void add(uint64_t sql_sign, uint64_t tuple_sign,
+            const google::protobuf::RepeatedPtrField<pb::TupleDescriptor>& tuples);
+    int find(uint64_t sql_sign, uint64_t plan_sign, SmartPbPlan* plan);
+    void add(uint64_t sql_sign, uint64_t plan_sign, const pb::Plan& plan);
+
+    static bvar::Adder<int64_t> store_plan_cache_hit;
+    static bvar::Adder<int64_t> store_plan_cache_miss;
+private:
+    StorePlanCache();
+    static std::string make_key(uint64_t sql_sign, uint64_t sign) {
+        return std::to_string(sql_sign) + "_" + std::to_string(sign);
+    }
+    Cache<std::string, SmartTupleDescs> _shards[SHARD_NUM];
+    Cache<std::string, SmartPbPlan> _plan_shards[SHARD_NUM];
+};
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -292,6 +292,94 @@ int TableKey::decode_field(Message* message,
     return 0;
 }
 
+int TableKey::decode_field(const FieldInfo& field_info, int& pos, ExprValue* value) const {
+    size_t len = 0;
+    switch (field_info.type) {
+        case pb::INT8:
+        case pb::UINT8:
+        case pb::BOOL:
+            len = sizeof(int8_t);
+            break;
+        case pb::INT16:
+        case pb::UINT16:
+            len = sizeof(int16_t);
+            break;
+        case pb::TIME:
+        case pb::INT32:
+        case pb::TIMESTAMP:
+        case pb::DATE:
+        case pb::UINT32:
+        case pb::FLOAT:
+            len = sizeof(int32_t);
+            break;
+        case pb::INT64:
+        case pb::DATETIME:
+        case pb::UINT64:
+        case pb::DOUBLE:
+            len = sizeof(int64_t);
+            break;
+        case pb::STRING:
+            len = 1;
+            break;
+        default:
+            DB_WARNING("un-supported field type: %d, %d", field_info.id, field_info.type);
+            return -1;
+    }
+    if (pos + len > size()) {
+        DB_WARNING("pos out of bound: %d %d %zu", field_info.id, pos, size());
+        return -2;
+    }
+    value->type = field_info.type;
+    switch (field_info.type) {
+        case pb::INT8:
+            value->_u.int8_val = extract_i8(pos);
+            break;
+        case pb::INT16:
+            value->_u.int16_val = extract_i16(pos);
+            break;
+        case pb::TIME:
+        case pb::INT32:
+            value->_u.int32_val = extract_i32(pos);
+            break;
+        case pb::INT64:
+            value->_u.int64_val = extract_i64(pos);
+            break;
+        case pb::UINT8:
+            value->_u.uint8_val = extract_u8(pos);
+            break;
+        case pb::UINT16:
+            value->_u.uint16_val = extract_u16(pos);
+            break;
+        case pb::TIMESTAMP:
+        case pb::DATE:
+        case pb::UINT32:
+            value->_u.uint32_val = extract_u32(pos);
+            break;
+        case pb::DATETIME:
+        case pb::UINT64:
+            value->_u.uint64_val = extract_u64(pos);
+            break;
+        case pb::FLOAT:
+            value->_u.float_val = extract_float(pos);
+            break;
+        case pb::DOUBLE:
+            value->_u.double_val = extract_double(pos);
+            break;
+        case pb::BOOL:
+            value->_u.bool_val = extract_boolean(pos);
+            break;
+        case pb::STRING:
+            value->str_val.clear();
+            extract_string(pos, value->str_val);
+            len = value->str_val.size() + 1;
+            break;
+        default:
+            break;
+    }
+    pos += len;
+    return 0;
+}
+
 //TODO: secondary key
 int TableKey::skip_field(const FieldInfo& field_info, int& pos) const {
     switch (field_info.type) {
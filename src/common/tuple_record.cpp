@@ -14,6 +14,7 @@
 
 #include "tuple_record.h"
 #include "message_helper.h"
+#include "column_batch.h"
 
 namespace baikaldb {
 inline const google::protobuf::FieldDescriptor* get_field(
@@ -278,4 +279,170 @@ int TupleRecord::decode_fields(const std::map<int32_t, FieldInfo*>& fields,
     return 0;
 }
 
+int TupleRecord::decode_fields(const std::map<int32_t, FieldInfo*>& fields,
+        const std::vector<int32_t>& field_slot, int32_t tuple_id, ColumnBatch* batch) {
+    uint64_t field_key  = 0;
+    uint64_t field_num  = 0;
+    int32_t  wired_type = 0;
+    auto iter = fields.begin();
+    auto get_column = [&field_slot, tuple_id, batch](FieldInfo* field_info) -> ColumnVector* {
+        ColumnVector* column = batch->get_column(tuple_id, field_slot[field_info->id]);
+        if (column == nullptr) {
+            DB_FATAL("field:%d, no column in batch, can't be here", field_info->id);
+        }
+        return column;
+    };
+
+    while (_offset < _size && iter != fields.end()) {
+        field_key = get_varint<uint64_t>();
+        field_num = field_key >> 3;
+        wired_type = field_key & 0x07;
+
+        if (_offset >= _size) {
+            DB_WARNING("error: %lu, %lu", _offset, _size);
+            return -1;
+        }
+
+        while (iter != fields.end() && field_num > static_cast<uint64_t>(iter->first)) {
+            ColumnVector* column = get_column(iter->second);
+            if (column == nullptr) {
+                return -1;
+            }
+            column->append(iter->second->default_expr_value);
+            iter++;
+        }
+        if (iter == fields.end()) {
+            return 0;
+        }
+        if (field_num < static_cast<uint64_t>(iter->first)) {
+            switch (wired_type) {
+                case 0:
+                    skip_varint();
+                    break;
+                case 1:
+                    skip_fixed<double>();
+                    break;
+                case 2:
+                    skip_string();
+                    break;
+                case 5:
+                    skip_fixed<float>();
+                    break;
+                default:
+                    DB_FATAL("invalid wired_type: %d, offset: %lu,%lu", wired_type, _offset, _size);
+                    return -1;
+            }
+            continue;
+        }
+        ColumnVector* column = get_column(iter->second);
+        if (column == nullptr) {
+            return -1;
+        }
+        // 与primitive_to_proto_type的映射一致
+        pb::PrimitiveType type = iter->second->type;
+        switch (type) {
+            case pb::INT8:
+            case pb::INT16:
+            case pb::INT32: {
+                //zigzag
+                ExprValue value(pb::INT32);
+                uint32_t raw_val = get_varint<uint32_t>();
+                value._u.int32_val = (raw_val >> 1) ^ -(int32_t)(raw_val & 0x1);
+                column->append(value);
+                break;
+            }
+            case pb::INT64: {
+                ExprValue value(pb::INT64);
+                uint64_t raw_val = get_varint<uint64_t>();
+                value._u.int64_val = (raw_val >> 1) ^ -(int64_t)(raw_val & 0x1);
+                column->append(value);
+                break;
+            }
+            case pb::TIME: {
+                ExprValue value(pb::TIME);
+                value._u.int32_val = get_fixed<int32_t>();
+                column->append(value);
+                break;
+            }
+            case pb::UINT8:
+            case pb::UINT16:
+            case pb::UINT32: {
+                ExprValue value(pb::UINT32);
+                value._u.uint32_val = get_varint<uint32_t>();
+                column->append(value);
+                break;
+            }
+            case pb::UINT64: {
+                ExprValue value(pb::UINT64);
+                value._u.uint64_val = get_varint<uint64_t>();
+                column->append(value);
+                break;
+            }
+            case pb::TIMESTAMP:
+            case pb::DATE: {
+                ExprValue value(type);
+                value._u.uint32_val = get_fixed<uint32_t>();
+                column->append(value);
+                break;
+            }
+            case pb::DATETIME: {
+                ExprValue value(pb::DATETIME);
+                value._u.uint64_val = get_fixed<uint64_t>();
+                column->append(value);
+                break;
+            }
+            case pb::FLOAT: {
+                ExprValue value(pb::FLOAT);
+                value._u.float_val = get_fixed<float>();
+                column->append(value);
+                break;
+            }
+            case pb::DOUBLE: {
+                ExprValue value(pb::DOUBLE);
+                value._u.double_val = get_fixed<double>();
+                column->append(value);
+                break;
+            }
+            case pb::BOOL: {
+                ExprValue value(pb::BOOL);
+                value._u.bool_val = get_varint<uint32_t>() != 0;
+                column->append(value);
+                break;
+            }
+            case pb::STRING:
+            case pb::HLL:
+            case pb::BITMAP:
+            case pb::TDIGEST: {
+                uint64_t length = get_varint<uint64_t>();
+                if (_offset + length > _size) {
+                    DB_WARNING("string out of bound: %lu, %lu, %lu", _offset, length, _size);
+                    return -1;
+                }
+                if (column->category() == ColumnVector::STRING_COLUMN) {
+                    column->append_string(_data + _offset, length);
+                } else {
+                    column->append(ExprValue(pb::STRING, std::string(_data + _offset, length)));
+                }
+                _offset += length;
+                break;
+            }
+            default: {
+                DB_FATAL("invalid TYPE: %d, field_id:%d, offset: %lu,%lu",
+                        type, iter->first, _offset, _size);
+                return -1;
+            }
+        }
+        iter++;
+    }
+    while (iter != fields.end()) {
+        ColumnVector* column = get_column(iter->second);
+        if (column == nullptr) {
+            return -1;
+        }
+        column->append(iter->second->default_expr_value);
+        iter++;
+    }
+    return 0;
+}
+
 } //namespace baikaldb
@@ -0,0 +1,98 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "key_sampler.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace baikaldb {
+DEFINE_int32(load_split_sample_rate, 16, "sample one of every N accesses of hot region, default: 16");
+DEFINE_int32(load_split_max_samples, 2048, "max sampled keys kept for one hot region, default: 2048");
+DEFINE_int32(load_split_min_samples, 256, "min sampled keys to compute load split key, default: 256");
+DEFINE_int32(load_split_min_balance_percent, 25, "give up load split when the smaller half gets less "
+        "than this percent of sampled accesses, default: 25%");
+
+void KeySampler::sample(const rocksdb::Slice& key) {
+    if (!enabled() || key.size() <= 2 * sizeof(int64_t)) {
+        return;
+    }
+    if (FLAGS_load_split_sample_rate > 1
+            && butil::fast_rand_less_than(FLAGS_load_split_sample_rate) != 0) {
+        return;
+    }
+    std::string pk(key.data() + 2 * sizeof(int64_t), key.size() - 2 * sizeof(int64_t));
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_seen_count;
+    if (_keys.size() < (size_t)FLAGS_load_split_max_samples) {
+        _keys.emplace_back(std::move(pk));
+        return;
+    }
+    uint64_t idx = butil::fast_rand_less_than(_seen_count);
+    if (idx < _keys.size()) {
+        _keys[idx] = std::move(pk);
+    }
+}
+
+int KeySampler::get_split_key(const std::string& start_key, const std::string& end_key,
+        std::string* split_key) {
+    std::vector<std::string> keys;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        keys.reserve(_keys.size());
+        // 分裂或merge后region范围变化，去掉范围外的key
+        for (auto& key : _keys) {
+            if (key >= start_key && (end_key.empty() || key < end_key)) {
+                keys.emplace_back(key);
+            }
+        }
+    }
+    if (keys.size() < (size_t)FLAGS_load_split_min_samples) {
+        return -1;
+    }
+    std::sort(keys.begin(), keys.end());
+    // 只能在不同key之间切分，keys[i]作为分裂点时左边有i次访问
+    int64_t total = keys.size();
+    int64_t best_left = -1;
+    for (int64_t i = 1; i < total; ++i) {
+        if (keys[i] == keys[i - 1]) {
+            continue;
+        }
+        if (best_left < 0 || std::abs(2 * i - total) < std::abs(2 * best_left - total)) {
+            best_left = i;
+        }
+    }
+    if (best_left < 0) {
+        return -1;
+    }
+    int64_t smaller = std::min(best_left, total - best_left);
+    if (smaller * 100 < total * FLAGS_load_split_min_balance_percent) {
+        return -1;
+    }
+    *split_key = keys[best_left];
+    return 0;
+}
+
+size_t KeySampler::sample_count() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _keys.size();
+}
+
+void KeySampler::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _keys.clear();
+    _seen_count = 0;
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -15,6 +15,7 @@
 #include "table_iterator.h"
 #include "transaction.h"
 #include "tuple_record.h"
+#include "column_batch.h"
 
 namespace baikaldb {
 DEFINE_bool(cstore_scan_fill_cache, true, "cstore_scan_fill_cache");
@@ -138,6 +139,10 @@ int Iterator::open(const IndexRange& range, std::map<int32_t, FieldInfo*>& field
         //没有指定left bound时，forward遍历从seek region+table开始，backward遍历到左边界停止
         _left_open = false;
     }
+    // 主键范围扫描以左边界近似访问位置
+    if (txn != nullptr && _idx_type == pb::I_PRIMARY && (range.left || range.left_key.size() > 0)) {
+        txn->sample_access_key(_region, _start.data());
+    }
 
     if (range.right) {
         int ret = range.right->encode_key(*_index_info, _end, right_secondary_field_cnt, false, like_prefix);
@@ -437,7 +442,43 @@ bool Iterator::_fits_prefix(const rocksdb::Slice& key, int32_t field_id) {
     return key.starts_with(prefix_key.data());
 }
 
-int TableIterator::get_next_internal(SmartRecord* record, int32_t tuple_id, std::unique_ptr<MemRow>* mem_row) {
+int TableIterator::decode_key(int32_t tuple_id, const TableKey& key, int& pos, ColumnBatch* batch) {
+    uint8_t null_flag = 0;
+    if (_index_info->type == pb::I_KEY || _index_info->type == pb::I_UNIQ) {
+        null_flag = key.extract_u8(pos);
+        pos += sizeof(uint8_t);
+    }
+    for (uint32_t idx = 0; idx < _index_info->fields.size(); ++idx) {
+        auto& field_info = _index_info->fields[idx];
+        // null值不追加，由finish_row补null
+        if (((null_flag >> (7 - idx)) & 0x01) && field_info.can_null) {
+            continue;
+        }
+        int32_t slot = _field_slot[field_info.id];
+        if (slot == 0) {
+            if (0 != key.skip_field(field_info, pos)) {
+                DB_WARNING("skip index field error");
+                return -1;
+            }
+            continue;
+        }
+        ColumnVector* column = batch->get_column(tuple_id, slot);
+        if (column == nullptr) {
+            DB_WARNING("invalid field: %d slot: %d", field_info.id, slot);
+            return -1;
+        }
+        ExprValue value;
+        if (0 != key.decode_field(field_info, pos, &value)) {
+            DB_WARNING("decode index field error");
+            return -1;
+        }
+        column->append(value);
+    }
+    return 0;
+}
+
+int TableIterator::get_next_internal(SmartRecord* record, int32_t tuple_id, std::unique_ptr<MemRow>* mem_row,
+        ColumnBatch* batch) {
     if (!_valid) {
         return -1;
     }
@@ -468,8 +509,17 @@ int TableIterator::get_next_internal(SmartRecord* record, int32_t tuple_id, std:
         if (!_is_cstore) {
             TupleRecord tuple_record(value_slice);
             // only decode the required field (field_ids stored in fields)
-            if (0 != tuple_record.decode_fields(_fields, &_field_slot, record, tuple_id, mem_row)) {
+            int ret = 0;
+            if (batch != nullptr) {
+                ret = tuple_record.decode_fields(_fields, _field_slot, tuple_id, batch);
+            } else {
+                ret = tuple_record.decode_fields(_fields, &_field_slot, record, tuple_id, mem_row);
+            }
+            if (0 != ret) {
                 DB_WARNING("decode value failed: %ld, _use_ttl:%d", _index_info->id, _use_ttl);
+                if (batch != nullptr) {
+                    batch->rollback_row();
+                }
                 _valid = false;
                 return -1;
             }
@@ -487,6 +537,13 @@ int TableIterator::get_next_internal(SmartRecord* record, int32_t tuple_id, std:
                 _valid = false;
                 return -1;
             } 
+        } else if (batch != nullptr) {
+            if (0 != decode_key(tuple_id, key, pos, batch)) {
+                DB_WARNING("decode key failed: %ld", _index_info->id);
+                batch->rollback_row();
+                _valid = false;
+                return -1;
+            }
         } else {
             if (0 != (*mem_row)->decode_key(tuple_id, *_index_info, _field_slot, key, pos)) {
                 DB_WARNING("decode key failed: %ld", _index_info->id);
@@ -495,6 +552,9 @@ int TableIterator::get_next_internal(SmartRecord* record, int32_t tuple_id, std:
             }
         }
     }
+    if (batch != nullptr) {
+        batch->finish_row();
+    }
     if (_forward) {
         _iter->Next();
     } else {
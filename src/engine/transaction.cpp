@@ -398,6 +398,7 @@ int Transaction::put_primary(int64_t region, IndexInfo& pk_index, SmartRecord re
     } else {
         value = "";
     }
+    sample_access_key(region, key.data());
     auto res = put_kv_without_lock(key.data(), value, _write_ttl_timestamp_us);
     if (res.IsTimedOut()) {
         print_txninfo_holding_lock(key.data());        
@@ -632,6 +633,7 @@ int Transaction::get_update_primary(
     }
     MutTableKey _key;
     _key.append_i64(region).append_i64(pk_index.id).append_index(key);
+    sample_access_key(region, _key.data());
 
     rocksdb::PinnableSlice pin_slice;
     rocksdb::Status res;
@@ -721,6 +723,9 @@ int Transaction::multiget_primary(
         std::vector<int32_t>& field_slot,
         bool sorted_input) {
     int64_t num_keys = rocksdb_keys.size();
+    for (auto& key : rocksdb_keys) {
+        sample_access_key(region, key);
+    }
     std::vector<rocksdb::PinnableSlice> values(num_keys);
     std::vector<rocksdb::Status> statuses(num_keys);
     TimeCost cost;
@@ -17,6 +17,13 @@
 #include "query_context.h"
 
 namespace baikaldb {
+DEFINE_bool(agg_spill_enable, false, "spill hash agg partitions to disk when memory is approaching limit, default: false");
+DEFINE_int64(agg_spill_memory_ratio, 80, "spill when memory consumed reach this percent of limit, default: 80");
+DEFINE_int32(agg_spill_partition_num, 8, "partition number of each spill level, default: 8");
+DEFINE_int32(agg_spill_max_level, 4, "max recursive partition level of spilled hash agg, default: 4");
+
+bvar::Adder<int64_t> AggNode::agg_spill_bytes {"agg_spill_bytes"};
+bvar::Adder<int64_t> AggNode::agg_spill_rows {"agg_spill_rows"};
 
 int AggNode::init(const pb::PlanNode& node) {
     int ret = 0;
@@ -121,11 +128,22 @@ int AggNode::open(RuntimeState* state) {
         }
     }
     _mem_row_desc = state->mem_row_desc();
+    _can_spill = can_spill();
+    _spill_level = 0;
 
     TimeCost cost;
     int64_t agg_time = 0;
     int64_t scan_time = 0;
     for (auto child : _children) {
+        if (!_is_merger && child->can_produce_columnar() && !state->is_full_export) {
+            ret = process_columnar_child(state, child, scan_time, agg_time);
+            if (ret < 0) {
+                _iter = _hash_map.begin();
+                DB_WARNING_STATE(state, "process_columnar_child fail, ret:%d", ret);
+                return ret;
+            }
+            continue;
+        }
         bool eos = false;
         do {
             if (state->is_cancelled()) {
@@ -154,6 +172,12 @@ int AggNode::open(RuntimeState* state) {
                 DB_WARNING_STATE(state, "memory limit exceeded");
                 return -1;
             }
+            _hash_map_bytes += used_size;
+            ret = check_spill(state);
+            if (ret < 0) {
+                _iter = _hash_map.begin();
+                return ret;
+            }
             // 对于用order by分组的特殊优化
             //if (_agg_tuple_id == -1 && _limit != -1 && (int64_t)_hash_map.size() >= _limit) {
             //    break;
@@ -163,6 +187,26 @@ int AggNode::open(RuntimeState* state) {
     LOCAL_TRACE_DESC << "agg time cost:" << agg_time << 
         " scan time cost:" << scan_time << " rows:" << _row_cnt;
 
+    if (!_writing_partitions.empty()) {
+        // 已经落过盘，剩余分组也写入各分区，之后逐个分区merge输出
+        ret = spill_hash_map(state);
+        if (ret < 0) {
+            _iter = _hash_map.begin();
+            return ret;
+        }
+        ret = finish_spill_partitions(0);
+        if (ret < 0) {
+            _iter = _hash_map.begin();
+            return ret;
+        }
+        ret = load_partition(state);
+        if (ret < 0) {
+            _iter = _hash_map.begin();
+            return ret;
+        }
+        LOCAL_TRACE_DESC << " spill partitions:" << _pending_partitions.size() + 1;
+    }
+
     // 兼容mysql: select count(*) from t; 无数据时返回0
     if (_hash_map.size() == 0 && _group_exprs.size() == 0) {
         ExecNode* packet = get_parent_node(pb::PACKET_NODE);
@@ -217,6 +261,7 @@ void AggNode::process_row_batch(RuntimeState* state, RowBatch& batch, int64_t& u
                 }
             }
             used_size += cur_row->used_size();
+            _input_row_bytes += cur_row->used_size();
             AggFnCall::initialize_all(_agg_fn_calls, key.data(), *agg_row, used_size, false);
             // 可能会rehash
             _hash_map.insert(key.data(), *agg_row);
@@ -231,6 +276,66 @@ void AggNode::process_row_batch(RuntimeState* state, RowBatch& batch, int64_t& u
     }
 }
 
+int AggNode::process_columnar_child(RuntimeState* state, ExecNode* child,
+        int64_t& scan_time, int64_t& agg_time) {
+    ColumnBatch batch;
+    // 已有分组只需用临时行计算，新分组才物化一个MemRow
+    std::unique_ptr<MemRow> scratch_row = _mem_row_desc->fetch_mem_row();
+    bool eos = false;
+    do {
+        if (state->is_cancelled()) {
+            DB_WARNING_STATE(state, "cancelled");
+            return 0;
+        }
+        TimeCost cost;
+        batch.clear();
+        int ret = child->get_next_columnar(state, &batch, &eos);
+        if (ret < 0) {
+            DB_WARNING_STATE(state, "child->get_next_columnar fail, ret:%d", ret);
+            return ret;
+        }
+        scan_time += cost.get_time();
+        cost.reset();
+        // fill_row会累加scratch_row的used_size，每个batch重置一次
+        scratch_row->clear();
+        int64_t used_size = 0;
+        size_t num_rows = batch.selected_size();
+        for (size_t i = 0; i < num_rows; ++i) {
+            uint32_t row_idx = batch.selected_row(i);
+            if (batch.fill_row(row_idx, scratch_row.get()) < 0) {
+                return -1;
+            }
+            MutTableKey key;
+            encode_agg_key(scratch_row.get(), key);
+            MemRow** agg_row = _hash_map.seek(key.data());
+            if (agg_row == nullptr) {
+                std::unique_ptr<MemRow> new_row = _mem_row_desc->fetch_mem_row();
+                if (batch.fill_row(row_idx, new_row.get()) < 0) {
+                    return -1;
+                }
+                used_size += new_row->used_size();
+                AggFnCall::initialize_all(_agg_fn_calls, key.data(), new_row.get(), used_size, false);
+                _hash_map.insert(key.data(), new_row.get());
+                agg_row = _hash_map.seek(key.data());
+                new_row.release();
+            }
+            AggFnCall::update_all(_agg_fn_calls, key.data(), scratch_row.get(), *agg_row, used_size);
+        }
+        agg_time += cost.get_time();
+        _row_cnt += num_rows;
+        if (state->memory_limit_exceeded(_row_cnt, used_size) != 0) {
+            DB_WARNING_STATE(state, "memory limit exceeded");
+            return -1;
+        }
+        _hash_map_bytes += used_size;
+        ret = check_spill(state);
+        if (ret < 0) {
+            return ret;
+        }
+    } while (!eos);
+    return 0;
+}
+
 int AggNode::get_next(RuntimeState* state, RowBatch* batch, bool* eos) {
     START_LOCAL_TRACE(get_trace(), state->get_trace_cost(), GET_NEXT_TRACE, ([this](TraceLocalNode& local_node) {
         local_node.set_affect_rows(_num_rows_returned);
@@ -242,10 +347,27 @@ int AggNode::get_next(RuntimeState* state, RowBatch* batch, bool* eos) {
             *eos = true;
             return 0;
         }
-        if (reached_limit() || _iter == _hash_map.end()) {
+        if (reached_limit()) {
             *eos = true;
             return 0;
         }
+        if (_iter == _hash_map.end()) {
+            if (_pending_partitions.empty()) {
+                *eos = true;
+                return 0;
+            }
+            // 当前分区输出完毕，加载下一个落盘分区
+            clear_hash_map();
+            state->memory_limit_release(_row_cnt, _hash_map_bytes);
+            _hash_map_bytes = 0;
+            int ret = load_partition(state);
+            _iter = _hash_map.begin();
+            if (ret < 0) {
+                DB_WARNING_STATE(state, "load_partition fail, ret:%d", ret);
+                return ret;
+            }
+            continue;
+        }
         if (batch->is_full()) {
             return 0;
         }
@@ -269,6 +391,159 @@ void AggNode::close(RuntimeState* state) {
         delete _iter->second;
     }
     _hash_map.clear();
+    _writing_partitions.clear();
+    _pending_partitions.clear();
+    _hash_map_bytes = 0;
+    _input_row_bytes = 0;
+}
+
+bool AggNode::can_spill() {
+    if (!FLAGS_agg_spill_enable || _group_exprs.empty()) {
+        return false;
+    }
+    for (auto agg : _agg_fn_calls) {
+        if (!agg->state_in_row()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int AggNode::check_spill(RuntimeState* state) {
+    if (!_can_spill || _spill_level > FLAGS_agg_spill_max_level) {
+        return 0;
+    }
+    if (!state->memory_limit_approaching(FLAGS_agg_spill_memory_ratio)) {
+        return 0;
+    }
+    return spill_hash_map(state);
+}
+
+int AggNode::spill_hash_map(RuntimeState* state) {
+    TimeCost cost;
+    if (_writing_partitions.empty()) {
+        for (int i = 0; i < FLAGS_agg_spill_partition_num; i++) {
+            std::unique_ptr<SpillFile> file(new SpillFile(_mem_row_desc));
+            if (file->open_write() < 0) {
+                return -1;
+            }
+            _writing_partitions.emplace_back(std::move(file));
+        }
+    }
+    int64_t rows = 0;
+    for (auto& pair : _hash_map) {
+        if (pair.second == nullptr) {
+            continue;
+        }
+        // 不同层级用不同的hash种子，保证递归分区能继续拆分
+        uint64_t out[2];
+        butil::MurmurHash3_x64_128(pair.first.data(), pair.first.size(), _spill_level + 1, out);
+        auto& file = _writing_partitions[out[0] % _writing_partitions.size()];
+        if (file->write_row(pair.second) < 0) {
+            DB_WARNING_STATE(state, "write spill file fail, path:%s", file->path().c_str());
+            return -1;
+        }
+        ++rows;
+    }
+    clear_hash_map();
+    // 子节点产出这些行时已计入内存，落盘后一并释放
+    state->memory_limit_release(_row_cnt, _hash_map_bytes + _input_row_bytes);
+    _input_row_bytes = 0;
+    agg_spill_rows << rows;
+    DB_WARNING_STATE(state, "spill hash agg, level:%d rows:%ld bytes:%ld time:%ld",
+            _spill_level, rows, _hash_map_bytes, cost.get_time());
+    _hash_map_bytes = 0;
+    return 0;
+}
+
+int AggNode::finish_spill_partitions(int level) {
+    for (auto& file : _writing_partitions) {
+        if (file->rows() == 0) {
+            continue;
+        }
+        if (file->finish_write() < 0) {
+            return -1;
+        }
+        agg_spill_bytes << file->bytes();
+        SpillPartition partition;
+        partition.file = std::move(file);
+        partition.level = level;
+        _pending_partitions.emplace_back(std::move(partition));
+    }
+    _writing_partitions.clear();
+    return 0;
+}
+
+int AggNode::load_partition(RuntimeState* state) {
+    while (!_pending_partitions.empty()) {
+        SpillPartition partition = std::move(_pending_partitions.back());
+        _pending_partitions.pop_back();
+        // 本分区再落盘时按下一层级拆分
+        _spill_level = partition.level + 1;
+        int64_t used_size = 0;
+        int64_t rows = 0;
+        while (true) {
+            if (state->is_cancelled()) {
+                DB_WARNING_STATE(state, "cancelled");
+                return 0;
+            }
+            std::unique_ptr<MemRow> row;
+            bool eof = false;
+            if (partition.file->read_row(&row, &eof) < 0) {
+                return -1;
+            }
+            if (eof) {
+                break;
+            }
+            // 落盘的都是预聚合行，与_is_merger相同走merge
+            MutTableKey key;
+            encode_agg_key(row.get(), key);
+            MemRow** agg_row = _hash_map.seek(key.data());
+            if (agg_row == nullptr) {
+                used_size += row->used_size();
+                _hash_map.insert(key.data(), row.release());
+            } else {
+                AggFnCall::merge_all(_agg_fn_calls, key.data(), row.get(), *agg_row, used_size);
+            }
+            if (++rows % ROW_BATCH_CAPACITY == 0) {
+                if (state->memory_limit_exceeded(_row_cnt, used_size) != 0) {
+                    DB_WARNING_STATE(state, "memory limit exceeded");
+                    return -1;
+                }
+                _hash_map_bytes += used_size;
+                used_size = 0;
+                int ret = check_spill(state);
+                if (ret < 0) {
+                    return ret;
+                }
+            }
+        }
+        if (state->memory_limit_exceeded(_row_cnt, used_size) != 0) {
+            DB_WARNING_STATE(state, "memory limit exceeded");
+            return -1;
+        }
+        _hash_map_bytes += used_size;
+        if (_writing_partitions.empty()) {
+            return 0;
+        }
+        // 单个分区仍放不下，剩余分组也落盘，子分区留待后续处理
+        int ret = spill_hash_map(state);
+        if (ret < 0) {
+            return ret;
+        }
+        ret = finish_spill_partitions(partition.level + 1);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+void AggNode::clear_hash_map() {
+    for (auto& pair : _hash_map) {
+        delete pair.second;
+    }
+    _hash_map.clear();
 }
 void AggNode::transfer_pb(int64_t region_id, pb::PlanNode* pb_node) {
     ExecNode::transfer_pb(region_id, pb_node);
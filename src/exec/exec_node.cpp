@@ -38,6 +38,7 @@
 #include "apply_node.h"
 #include "load_node.h"
 #include "runtime_state.h"
+#include "batch_kernels.h"
 
 namespace baikaldb {
 int ExecNode::init(const pb::PlanNode& node) {
@@ -222,6 +223,48 @@ int ExecNode::open(RuntimeState* state) {
     return num_affected_rows;
 }
 
+int ExecNode::get_next_columnar(RuntimeState* state, ColumnBatch* batch, bool* eos) {
+    if (!batch->is_inited()) {
+        if (batch->init(state->tuple_descs(), {}) < 0) {
+            DB_WARNING_STATE(state, "ColumnBatch init fail");
+            return -1;
+        }
+    }
+    RowBatch row_batch;
+    row_batch.set_capacity(batch->capacity());
+    int ret = get_next(state, &row_batch, eos);
+    if (ret < 0) {
+        return ret;
+    }
+    return batch->append_row_batch(&row_batch);
+}
+
+int ExecNode::filter_column_batch(std::vector<ExprNode*>& conjuncts, ColumnBatch* batch, MemRow* row) {
+    row->clear();
+    for (auto conjunct : conjuncts) {
+        if (batch->selected_size() == 0) {
+            break;
+        }
+        ColumnVector value(pb::BOOL);
+        int ret = conjunct->get_batch_value(batch, row, &value);
+        if (ret < 0) {
+            DB_WARNING("get_batch_value fail, ret:%d", ret);
+            return ret;
+        }
+        std::vector<uint32_t> selection;
+        size_t num_rows = batch->selected_size();
+        selection.reserve(num_rows);
+        for (size_t i = 0; i < num_rows; ++i) {
+            uint32_t row_idx = batch->selected_row(i);
+            if (batch_kernels::is_true(value, row_idx)) {
+                selection.emplace_back(row_idx);
+            }
+        }
+        batch->set_selection(selection);
+    }
+    return 0;
+}
+
 void ExecNode::transfer_pb(int64_t region_id, pb::PlanNode* pb_node) {
     _pb_node.set_node_type(_node_type);
     _pb_node.set_limit(_limit);
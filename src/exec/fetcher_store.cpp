@@ -26,6 +26,7 @@
 #include "dml_node.h"
 #include "scan_node.h"
 #include "trace_state.h"
+#include "arrow_row_codec.h"
 namespace baikaldb {
 
 DEFINE_int64(retry_interval_us, 500 * 1000, "retry interval ");
@@ -47,11 +48,122 @@ DECLARE_int32(transaction_clear_delay_ms);
 DEFINE_bool(use_dynamic_timeout, false, "whether use dynamic_timeout");
 DEFINE_bool(use_read_index, false, "whether use follower read");
 BRPC_VALIDATE_GFLAG(use_dynamic_timeout, brpc::PassValidate);
+DEFINE_bool(fetcher_streaming_select, false, "non-txn select fetch rows from store by brpc streaming");
+DEFINE_int32(fetcher_streaming_queue_batches, 16, "max chunks of one region buffered for the executor "
+        "before throttling the store, default: 16");
+DEFINE_bool(fetcher_arrow_format, false, "select rows returned by store in arrow columnar format");
+DEFINE_bool(fetcher_plan_cache, false, "omit tuples and plan of non-txn select when store has cached them by sign");
+DEFINE_bool(fetcher_multi_query, false, "batch non-txn select regions on the same store into one multi_query rpc");
+DEFINE_int32(fetcher_multi_query_max_regions, 16, "max regions batched into one multi_query rpc");
+DEFINE_int64(fetcher_multi_query_max_lines, 50000, "max total table lines of regions batched into one "
+        "multi_query rpc, larger regions are sent alone to keep the response under max_body_size");
 bvar::Adder<int64_t> OnRPCDone::async_rpc_region_count {"async_rpc_region_count"};
+bvar::Adder<int64_t> SelectStreamReceiver::streaming_select_rows {"streaming_select_rows"};
+bvar::Adder<int64_t> MultiQueryDone::multi_query_region_count {"multi_query_region_count"};
 bvar::LatencyRecorder OnRPCDone::total_send_request {"total_send_request"};
 bvar::LatencyRecorder OnRPCDone::add_backup_send_request {"add_backup_send_request"};
 bvar::LatencyRecorder OnRPCDone::has_backup_send_request {"has_backup_send_request"};
 
+int SelectStreamReceiver::on_received_messages(brpc::StreamId id,
+        butil::IOBuf *const messages[],
+        size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        if (_status == pb::StreamState::SS_FAIL || _status == pb::StreamState::SS_SUCCESS) {
+            return 0;
+        }
+        pb::StoreRes chunk;
+        butil::IOBufAsZeroCopyInputStream wrapper(*messages[i]);
+        if (!chunk.ParseFromZeroCopyStream(&wrapper)) {
+            DB_WARNING("parse select chunk fail, region_id: %ld, log_id: %lu", _region_id, _state->log_id());
+            _status = pb::StreamState::SS_FAIL;
+            brpc::StreamClose(id);
+            return 0;
+        }
+        _status = pb::StreamState::SS_PROCESSING;
+        if (add_rows(chunk) != 0) {
+            // 关闭stream后store端写失败，提前终止扫描
+            _status = pb::StreamState::SS_FAIL;
+            brpc::StreamClose(id);
+            return 0;
+        }
+        if (chunk.stream_end()) {
+            chunk.clear_row_values();
+            chunk.clear_arrow_values();
+            chunk.clear_ttl_timestamp();
+            _end_response.Swap(&chunk);
+            _status = pb::StreamState::SS_SUCCESS;
+        }
+    }
+    return 0;
+}
+
+int SelectStreamReceiver::add_rows(pb::StoreRes& chunk) {
+    std::vector<std::unique_ptr<MemRow>> rows;
+    rows.reserve(chunk.row_values_size());
+    for (auto& pb_row : chunk.row_values()) {
+        if (pb_row.tuple_values_size() != chunk.tuple_ids_size()) {
+            DB_WARNING("tuple_values_size:%d != tuple_ids_size:%d, region_id: %ld",
+                    pb_row.tuple_values_size(), chunk.tuple_ids_size(), _region_id);
+            return -1;
+        }
+        std::unique_ptr<MemRow> row = _state->mem_row_desc()->fetch_mem_row();
+        for (int i = 0; i < chunk.tuple_ids_size(); i++) {
+            row->from_string(chunk.tuple_ids(i), pb_row.tuple_values(i));
+        }
+        rows.emplace_back(std::move(row));
+    }
+    for (auto& arrow_value : chunk.arrow_values()) {
+        if (ArrowRowCodec::decode(arrow_value, chunk.tuple_ids(), _state->mem_row_desc(), &rows) != 0) {
+            DB_WARNING("decode arrow values fail, region_id: %ld", _region_id);
+            return -1;
+        }
+    }
+    if (rows.empty()) {
+        return 0;
+    }
+    _row_cnt += rows.size();
+    _fetcher_store->row_cnt += rows.size();
+    if ((!_state->is_full_export) && (_fetcher_store->row_cnt > FLAGS_max_select_rows)) {
+        DB_FATAL("_row_cnt:%ld > %ld max_select_rows, region_id: %ld, log_id: %lu",
+                _fetcher_store->row_cnt.load(), FLAGS_max_select_rows, _region_id, _state->log_id());
+        _error = E_BIG_SQL;
+        return -1;
+    }
+    bool with_ttl = ((int)rows.size() == chunk.ttl_timestamp_size());
+    int ttl_idx = 0;
+    // 交给执行器的分块单独成batch，队列满时在这里等待消费
+    std::shared_ptr<RowBatch> batch = _batch;
+    if (_queue != nullptr) {
+        batch = std::make_shared<RowBatch>();
+        with_ttl = false;
+    }
+    size_t num_rows = rows.size();
+    for (auto& row : rows) {
+        _used_size += row->used_size();
+        if (_used_size > 1024 * 1024LL) {
+            if (0 != _state->memory_limit_exceeded(_fetcher_store->row_cnt, _used_size)) {
+                BAIDU_SCOPED_LOCK(_fetcher_store->region_lock);
+                _state->error_code = ER_TOO_BIG_SELECT;
+                _state->error_msg.str("select reach memory limit");
+                _error = E_FATAL;
+                return -1;
+            }
+            _used_size = 0;
+        }
+        batch->move_row(std::move(row));
+        if (with_ttl) {
+            _ttl_batch.emplace_back(chunk.ttl_timestamp(ttl_idx++));
+        }
+    }
+    streaming_select_rows << num_rows;
+    if (_queue != nullptr && _queue->push(_queue_owner, batch) != 0) {
+        DB_WARNING("executor stopped consuming, region_id: %ld, log_id: %lu", _region_id, _state->log_id());
+        _error = E_FATAL;
+        return -1;
+    }
+    return 0;
+}
+
 OnRPCDone::OnRPCDone(FetcherStore* fetcher_store, RuntimeState* state, ExecNode* store_request, pb::RegionInfo* info_ptr, 
     int64_t old_region_id, int64_t region_id, int start_seq_id, int current_seq_id, pb::OpType op_type) : 
     _fetcher_store(fetcher_store), _state(state), _store_request(store_request), _info(*info_ptr),
@@ -66,10 +178,16 @@ OnRPCDone::OnRPCDone(FetcherStore* fetcher_store, RuntimeState* state, ExecNode*
     } else {
         _store_addr = _info.leader();
     }
+    auto queue_iter = _fetcher_store->stream_queues.find(_old_region_id);
+    if (queue_iter != _fetcher_store->stream_queues.end()) {
+        _stream_queue = queue_iter->second;
+        _stream_queue->add_producer();
+    }
     async_rpc_region_count << 1;
     DB_DONE(DEBUG, "OnRPCDone");
 }
 OnRPCDone::~OnRPCDone() {
+    release_stream_queue();
     async_rpc_region_count << -1;
 }
 // 检查状态，判断是否需要继续执行
@@ -93,6 +211,60 @@ ErrorType OnRPCDone::check_status() {
     return E_OK;
 }
 
+void StorePlanCacheMarks::mark(const std::string& addr, const pb::StoreReq& request) {
+    if (request.has_tuple_sign() && request.tuples_size() > 0) {
+        _marks.add(addr + tuple_suffix(request), true);
+    }
+    if (request.has_plan_sign() && request.has_plan()) {
+        _marks.add(addr + plan_suffix(request), true);
+    }
+}
+
+void StorePlanCacheMarks::unmark(const std::string& addr, const pb::StoreReq& request) {
+    // 不区分是tuples还是plan未命中，都清除
+    if (request.has_tuple_sign()) {
+        _marks.del(addr + tuple_suffix(request));
+    }
+    if (request.has_plan_sign()) {
+        _marks.del(addr + plan_suffix(request));
+    }
+}
+
+bool StorePlanCacheMarks::cached(const std::string& addr, const std::string& backup, const std::string& suffix) {
+    if (_marks.check(addr + suffix) != 0) {
+        return false;
+    }
+    if (!backup.empty() && backup != addr && _marks.check(backup + suffix) != 0) {
+        return false;
+    }
+    return true;
+}
+
+void StorePlanCacheMarks::omit_cached(const std::string& addr, const std::string& backup, pb::StoreReq* request,
+        google::protobuf::RepeatedPtrField<pb::TupleDescriptor>* omitted_tuples, pb::Plan* omitted_plan) {
+    if (request->has_tuple_sign()) {
+        if (request->tuples_size() == 0) {
+            request->mutable_tuples()->Swap(omitted_tuples);
+        }
+        if (cached(addr, backup, tuple_suffix(*request))) {
+            request->mutable_tuples()->Swap(omitted_tuples);
+        }
+    }
+    if (request->has_plan_sign()) {
+        if (!request->has_plan()) {
+            request->mutable_plan()->Swap(omitted_plan);
+        }
+        if (cached(addr, backup, plan_suffix(*request))) {
+            omitted_plan->Swap(request->mutable_plan());
+            request->clear_plan();
+        }
+    }
+}
+
+void OnRPCDone::omit_cached_plan() {
+    StorePlanCacheMarks::get_instance()->omit_cached(_addr, _backup, &_request, &_omitted_tuples, &_omitted_plan);
+}
+
 ErrorType OnRPCDone::fill_request() {
     if (_trace_node != nullptr) {
         _request.set_is_trace(true);
@@ -147,6 +319,24 @@ ErrorType OnRPCDone::fill_request() {
     }
     txn_info->set_start_seq_id(_start_seq_id);
     txn_info->set_optimize_1pc(_state->optimize_1pc());
+    // 非事务select才走streaming，事务中的select需要缓存response用于重放
+    if (FLAGS_fetcher_arrow_format && (_op_type == pb::OP_SELECT || _op_type == pb::OP_SELECT_FOR_UPDATE)) {
+        _request.set_use_arrow_format(true);
+    }
+    if (FLAGS_fetcher_streaming_select && _op_type == pb::OP_SELECT
+            && _state->txn_id == 0 && _state->explain_type != ANALYZE_STATISTICS) {
+        _request.set_use_streaming(true);
+    }
+    if (FLAGS_fetcher_plan_cache && _op_type == pb::OP_SELECT && _state->txn_id == 0
+            && _state->sign != 0 && _request.tuples_size() > 0) {
+        std::string tuples_str;
+        for (auto& tuple : _request.tuples()) {
+            tuple.AppendToString(&tuples_str);
+        }
+        uint64_t out[2];
+        butil::MurmurHash3_x64_128(tuples_str.c_str(), tuples_str.size(), 0x1234, out);
+        _request.set_tuple_sign(out[0]);
+    }
     if (_state->txn_id != 0) {
         txn_info->set_primary_region_id(_client_conn->primary_region_id.load());
         if (_fetcher_store->need_process_binlog(_state, _op_type)) {
@@ -235,6 +425,13 @@ ErrorType OnRPCDone::fill_request() {
     if (scan_node != nullptr) {
         scan_node->current_index_unlock();
     }
+    if (_request.has_tuple_sign()) {
+        std::string plan_str;
+        _request.plan().SerializeToString(&plan_str);
+        uint64_t out[2];
+        butil::MurmurHash3_x64_128(plan_str.c_str(), plan_str.size(), 0x1234, out);
+        _request.set_plan_sign(out[0]);
+    }
 
     return E_OK;
 }   
@@ -404,6 +601,17 @@ ErrorType OnRPCDone::send_async() {
     _cntl.Reset();
     _cntl.set_log_id(_state->log_id());
     _response.Clear();
+    if (_stream_receiver != nullptr) {
+        // 重试时丢弃上一次stream已经收到的行
+        _fetcher_store->row_cnt -= _stream_receiver->row_cnt();
+        _stream_receiver.reset();
+    }
+    if (_stream_queue != nullptr && _stream_queue->reset_for_retry(this) != 0) {
+        // 部分行已经交给执行器，重试会导致重复
+        DB_DONE(WARNING, "rows already consumed, can not retry");
+        return E_FATAL;
+    }
+    omit_cached_plan();
     if (_region_id == 0) {
         DB_DONE(FATAL, "region_id == 0");
         return E_FATAL;
@@ -412,7 +620,9 @@ ErrorType OnRPCDone::send_async() {
     option.max_retry = 1;
     option.connect_timeout_ms = FLAGS_fetcher_connect_timeout;
     option.timeout_ms = FLAGS_fetcher_request_timeout;
-    if (_fetcher_store->dynamic_timeout_ms > 0 && !_backup.empty() && _backup != _addr) {
+    // stream绑定在单个连接上，不能使用backup request
+    if (_fetcher_store->dynamic_timeout_ms > 0 && !_backup.empty() && _backup != _addr
+            && !_request.use_streaming()) {
         option.backup_request_ms = _fetcher_store->dynamic_timeout_ms;
     }
     // SelectiveChannel在init时会出core,开源版先注释掉
@@ -434,7 +644,8 @@ ErrorType OnRPCDone::send_async() {
         return E_FATAL;
     }
     channel.AddChannel(sub_channel1, NULL);
-    if (_fetcher_store->dynamic_timeout_ms > 0 && !_backup.empty() && _backup != _addr) {
+    if (_fetcher_store->dynamic_timeout_ms > 0 && !_backup.empty() && _backup != _addr
+            && !_request.use_streaming()) {
 
         //开源版brpc和内部不大一样
         brpc::SocketId sub_id2;
@@ -465,6 +676,18 @@ ErrorType OnRPCDone::send_async() {
         return E_FATAL;
     }
 #endif
+    if (_request.use_streaming()) {
+        _stream_receiver = std::make_shared<SelectStreamReceiver>(_fetcher_store, _state, _region_id, _stream_queue, this);
+        brpc::StreamOptions stream_options;
+        stream_options.handler = _stream_receiver.get();
+        stream_options.idle_timeout_ms = FLAGS_fetcher_request_timeout;
+        if (brpc::StreamCreate(&_stream_id, _cntl, &stream_options) != 0) {
+            DB_DONE(WARNING, "fail to create stream, fallback to normal select");
+            _stream_receiver.reset();
+            _stream_id = brpc::INVALID_STREAM_ID;
+            _request.set_use_streaming(false);
+        }
+    }
     _fetcher_store->insert_callid(_cntl.call_id());
     _query_time.reset();
     pb::StoreService_Stub(&channel).query(&_cntl, &_request, &_response, this);
@@ -475,6 +698,22 @@ void OnRPCDone::Run() {
     DB_DONE(DEBUG, "fetch store req: %s", _request.ShortDebugString().c_str());
     DB_DONE(DEBUG, "fetch store res: %s", _response.ShortDebugString().c_str());
     std::string remote_side = butil::endpoint2str(_cntl.remote_side()).c_str();
+    if (!_multi_query_remote_side.empty()) {
+        remote_side = _multi_query_remote_side;
+        _multi_query_remote_side.clear();
+    }
+    if (_stream_receiver != nullptr) {
+        auto err = wait_stream_response();
+        if (err == E_RETRY) {
+            bthread_usleep(_retry_times * FLAGS_retry_interval_us);
+            _rpc_ctrl->task_retry(this);
+            return;
+        } else if (err != E_OK) {
+            _fetcher_store->error = err;
+            _rpc_ctrl->task_finish(this);
+            return;
+        }
+    }
     int64_t query_cost = _query_time.get_time();
     if (query_cost > FLAGS_print_time_us || _retry_times > 0) {
         DB_DONE(WARNING, "version:%ld time:%ld rpc_time:%ld ip:%s",
@@ -538,6 +777,51 @@ void OnRPCDone::Run() {
     return;
 }
 
+// 等待stream接收完成，成功时用结尾分块替换_response，后续按普通response处理
+ErrorType OnRPCDone::wait_stream_response() {
+    // rpc失败或store未接受stream(not leader/老版本store等)，结果都在_response中
+    if (_cntl.Failed() || !_response.is_streaming()) {
+        close_stream();
+        _stream_receiver.reset();
+        return E_OK;
+    }
+    if (_stream_queue != nullptr) {
+        // 执行器边收边消费，耗时取决于消费速度，不设整体超时；store侧有写超时，stream有idle超时
+        while (_stream_receiver->timed_wait(100 * 1000LL) != 0) {
+            if (_state->is_cancelled() || _fetcher_store->is_cancelled) {
+                DB_DONE(WARNING, "stream cancelled, rows: %ld", _stream_receiver->row_cnt());
+                close_stream();
+                return E_FATAL;
+            }
+        }
+    } else if (_stream_receiver->timed_wait(FLAGS_fetcher_request_timeout * 1000LL) != 0) {
+        DB_DONE(WARNING, "wait stream timeout, rows: %ld", _stream_receiver->row_cnt());
+        close_stream();
+        return E_RETRY;
+    }
+    close_stream();
+    if (_stream_receiver->error() != E_OK) {
+        return _stream_receiver->error();
+    }
+    if (_stream_receiver->get_status() != pb::StreamState::SS_SUCCESS) {
+        DB_DONE(WARNING, "stream broken, rows: %ld", _stream_receiver->row_cnt());
+        return E_RETRY;
+    }
+    _response.Swap(_stream_receiver->mutable_stream_end_response());
+    return E_OK;
+}
+
+void OnRPCDone::close_stream() {
+    if (_stream_id == brpc::INVALID_STREAM_ID) {
+        return;
+    }
+    // 对端已关闭时StreamClose返回失败，不影响on_closed回调
+    brpc::StreamClose(_stream_id);
+    // on_closed之后brpc不会再访问receiver
+    _stream_receiver->wait();
+    _stream_id = brpc::INVALID_STREAM_ID;
+}
+
 ErrorType OnRPCDone::handle_version_old() {
     SchemaFactory* schema_factory = SchemaFactory::get_instance();
     DB_DONE(WARNING, "VERSION_OLD, now:%s", _info.ShortDebugString().c_str());
@@ -717,6 +1001,12 @@ ErrorType OnRPCDone::handle_response(const std::string& remote_side) {
         return E_RETRY;
     }
 
+    if (_response.errcode() == pb::PLAN_CACHE_MISS) {
+        // store重启或淘汰了缓存，带上tuples立即重发
+        DB_DONE(WARNING, "plan cache miss, tuple_sign: %lu", _request.tuple_sign());
+        StorePlanCacheMarks::get_instance()->unmark(remote_side, _request);
+        return E_RETRY;
+    }
     if (_response.errcode() == pb::VERSION_OLD) {
         return handle_version_old();
     }
@@ -752,6 +1042,7 @@ ErrorType OnRPCDone::handle_response(const std::string& remote_side) {
         }
         return E_FATAL;
     }
+    StorePlanCacheMarks::get_instance()->mark(remote_side, _request);
 
     if (_response.records_size() > 0) {
         int64_t main_table_id = _info.has_main_table_id() ? _info.main_table_id() : _info.table_id();
@@ -820,8 +1111,17 @@ ErrorType OnRPCDone::handle_response(const std::string& remote_side) {
         }
     }
     TimeCost cost;
-    if (_response.row_values_size() > 0) {
-        _fetcher_store->row_cnt += _response.row_values_size();
+    // arrow列式编码的行先整体解码，再与行格式的结果一起追加
+    std::vector<std::unique_ptr<MemRow>> arrow_rows;
+    for (auto& arrow_value : _response.arrow_values()) {
+        if (ArrowRowCodec::decode(arrow_value, _response.tuple_ids(), _state->mem_row_desc(), &arrow_rows) != 0) {
+            DB_DONE(WARNING, "decode arrow values fail");
+            return E_FATAL;
+        }
+    }
+    int64_t response_rows = _response.row_values_size() + arrow_rows.size();
+    if (response_rows > 0) {
+        _fetcher_store->row_cnt += response_rows;
     }
     // TODO reduce mem used by streaming
     if ((!_state->is_full_export) && (_fetcher_store->row_cnt > FLAGS_max_select_rows)) {
@@ -831,9 +1131,34 @@ ErrorType OnRPCDone::handle_response(const std::string& remote_side) {
     std::shared_ptr<RowBatch> batch = std::make_shared<RowBatch>();
     std::vector<int64_t> ttl_batch;
     ttl_batch.reserve(100);
-    bool global_ddl_with_ttl = (_response.row_values_size() > 0 && _response.row_values_size() == _response.ttl_timestamp_size()) ? true : false;
+    bool global_ddl_with_ttl = (response_rows > 0 && response_rows == _response.ttl_timestamp_size()) ? true : false;
+    if (_stream_receiver != nullptr) {
+        // streaming的行在接收时已增量解析，结尾分块中不再包含行
+        batch = _stream_receiver->row_batch();
+        ttl_batch.swap(_stream_receiver->ttl_batch());
+        global_ddl_with_ttl = !ttl_batch.empty();
+    }
     int ttl_idx = 0;
     int64_t used_size = 0;
+    auto append_row = [&](std::unique_ptr<MemRow> row) -> ErrorType {
+        used_size += row->used_size();
+        if (used_size > 1024 * 1024LL) {
+            if (0 != _state->memory_limit_exceeded(_fetcher_store->row_cnt, used_size)) {
+                BAIDU_SCOPED_LOCK(_fetcher_store->region_lock);
+                _state->error_code = ER_TOO_BIG_SELECT;
+                _state->error_msg.str("select reach memory limit");
+                return E_FATAL;
+            }
+            used_size = 0;
+        }
+        batch->move_row(std::move(row));
+        if (global_ddl_with_ttl) {
+            int64_t time_us = _response.ttl_timestamp(ttl_idx++);
+            ttl_batch.emplace_back(time_us);
+            DB_DEBUG("region_id: %ld, ttl_timestamp: %ld", _region_id, time_us);
+        }
+        return E_OK;
+    };
     for (auto& pb_row : _response.row_values()) {
         if (pb_row.tuple_values_size() != _response.tuple_ids_size()) {
             // brpc SelectiveChannel+backup_request有bug，pb的repeated字段merge到一起了
@@ -849,21 +1174,15 @@ ErrorType OnRPCDone::handle_response(const std::string& remote_side) {
             int32_t tuple_id = _response.tuple_ids(i);
             row->from_string(tuple_id, pb_row.tuple_values(i));
         }
-        used_size += row->used_size();
-        if (used_size > 1024 * 1024LL) {
-            if (0 != _state->memory_limit_exceeded(_fetcher_store->row_cnt, used_size)) {
-                BAIDU_SCOPED_LOCK(_fetcher_store->region_lock);
-                _state->error_code = ER_TOO_BIG_SELECT;
-                _state->error_msg.str("select reach memory limit");
-                return E_FATAL;
-            }
-            used_size = 0;
+        auto err = append_row(std::move(row));
+        if (err != E_OK) {
+            return err;
         }
-        batch->move_row(std::move(row));
-        if (global_ddl_with_ttl) {
-            int64_t time_us = _response.ttl_timestamp(ttl_idx++);
-            ttl_batch.emplace_back(time_us);
-            DB_DEBUG("region_id: %ld, ttl_timestamp: %ld", _region_id, time_us);
+    }
+    for (auto& row : arrow_rows) {
+        auto err = append_row(std::move(row));
+        if (err != E_OK) {
+            return err;
         }
     }
     if (global_ddl_with_ttl) {
@@ -875,6 +1194,14 @@ ErrorType OnRPCDone::handle_response(const std::string& remote_side) {
         _state->cmsketch->add_proto(_response.cmsketch());
         DB_DONE(WARNING, "cmsketch:%s", _response.cmsketch().ShortDebugString().c_str());
     }
+    if (_stream_queue != nullptr) {
+        // store未接受stream时行在response中，同样交给执行器
+        if (batch->size() > 0 && _stream_queue->push(this, batch) != 0) {
+            DB_DONE(WARNING, "executor stopped consuming");
+            return E_FATAL;
+        }
+        batch = std::make_shared<RowBatch>();
+    }
     // 减少锁冲突
     if (_fetcher_store->region_batch.count(_region_id) == 1) {
         _fetcher_store->region_batch[_region_id] = batch;
@@ -907,12 +1234,13 @@ ErrorType OnRPCDone::handle_response(const std::string& remote_side) {
     return E_OK;
 }
 
-void OnRPCDone::send_request() {
+// 失败时已经结束任务
+ErrorType OnRPCDone::prepare_request() {
     auto err = check_status();
     if (err != E_OK) {
         _fetcher_store->error = err;
         _rpc_ctrl->task_finish(this);
-        return;
+        return err;
     }
 
     // 处理request，重试时不用再填充req
@@ -921,15 +1249,25 @@ void OnRPCDone::send_request() {
         if (err != E_OK) {
             _fetcher_store->error = err;
             _rpc_ctrl->task_finish(this);
-            return;
+            return err;
         }
         _has_fill_request = true;
     }
 
     // 选择请求的store地址
     select_addr();
+    return E_OK;
+}
 
-    err = send_async();
+void OnRPCDone::send_request() {
+    if (prepare_request() != E_OK) {
+        return;
+    }
+    send_prepared();
+}
+
+void OnRPCDone::send_prepared() {
+    auto err = send_async();
     if (err == E_RETRY) {
         _rpc_ctrl->task_retry(this);
     } else if (err != E_ASYNC) {
@@ -940,6 +1278,160 @@ void OnRPCDone::send_request() {
     }
 }
 
+bool OnRPCDone::can_multi_query() {
+    // 重试的请求单独发送，避免再次和其他region合并
+    return _op_type == pb::OP_SELECT && _state->txn_id == 0 && !_request.use_streaming()
+        && _retry_times == 0 && _info.num_table_lines() <= FLAGS_fetcher_multi_query_max_lines;
+}
+
+void OnRPCDone::start_multi_query(pb::StoreReq* request) {
+    _cntl.Reset();
+    _response.Clear();
+    omit_cached_plan();
+    _query_time.reset();
+    request->Swap(&_request);
+}
+
+void OnRPCDone::multi_query_done(const brpc::Controller& cntl, pb::StoreReq* request, pb::StoreRes* response) {
+    _request.Swap(request);
+    _multi_query_remote_side = butil::endpoint2str(cntl.remote_side()).c_str();
+    if (cntl.Failed()) {
+        _cntl.SetFailed(cntl.ErrorCode(), "%s", cntl.ErrorText().c_str());
+    } else if (response == nullptr) {
+        _cntl.SetFailed(brpc::ERESPONSE, "multi_query response size mismatch");
+    } else {
+        _response.Swap(response);
+    }
+}
+
+void MultiQueryDone::share_plan(pb::MultiStoreReq* request) {
+    std::string plan_str;
+    std::string tuples_str;
+    for (int i = 0; i < request->requests_size(); i++) {
+        pb::StoreReq* req = request->mutable_requests(i);
+        // store已缓存而省略了plan或tuples的request不参与
+        if (!req->has_plan() || req->tuples_size() == 0) {
+            continue;
+        }
+        std::string req_tuples_str;
+        for (auto& tuple : req->tuples()) {
+            tuple.AppendToString(&req_tuples_str);
+        }
+        if (!request->has_plan()) {
+            request->mutable_plan()->CopyFrom(req->plan());
+            request->mutable_tuples()->CopyFrom(req->tuples());
+            request->plan().SerializeToString(&plan_str);
+            tuples_str = req_tuples_str;
+        } else if (req_tuples_str != tuples_str || req->plan().SerializeAsString() != plan_str) {
+            continue;
+        }
+        req->clear_plan();
+        req->clear_tuples();
+        request->add_shared_plan_requests(i);
+    }
+}
+
+void MultiQueryDone::restore_shared_plan(pb::MultiStoreReq* request) {
+    for (int idx : request->shared_plan_requests()) {
+        if (idx < 0 || idx >= request->requests_size()) {
+            continue;
+        }
+        pb::StoreReq* req = request->mutable_requests(idx);
+        req->mutable_plan()->CopyFrom(request->plan());
+        req->mutable_tuples()->CopyFrom(request->tuples());
+    }
+    request->clear_shared_plan_requests();
+    request->clear_plan();
+    request->clear_tuples();
+}
+
+void MultiQueryDone::send() {
+    for (auto task : _tasks) {
+        task->start_multi_query(_request.add_requests());
+    }
+    share_plan(&_request);
+    brpc::ChannelOptions option;
+    option.max_retry = 1;
+    option.connect_timeout_ms = FLAGS_fetcher_connect_timeout;
+    option.timeout_ms = FLAGS_fetcher_request_timeout;
+    brpc::Channel channel;
+    int ret = channel.Init(_addr.c_str(), &option);
+    if (ret != 0) {
+        DB_WARNING("channel init failed, addr:%s, ret:%d, log_id:%lu", _addr.c_str(), ret, _log_id);
+        _cntl.SetFailed(EHOSTDOWN, "channel init failed");
+        Run();
+        return;
+    }
+    _cntl.set_log_id(_log_id);
+    _fetcher_store->insert_callid(_cntl.call_id());
+    multi_query_region_count << _tasks.size();
+    pb::StoreService_Stub(&channel).multi_query(&_cntl, &_request, &_response, this);
+}
+
+void MultiQueryDone::Run() {
+    // 各region处理结果和重试时需要完整的request
+    restore_shared_plan(&_request);
+    bool size_match = _response.responses_size() == (int)_tasks.size();
+    for (size_t i = 0; i < _tasks.size(); i++) {
+        pb::StoreRes* response = size_match ? _response.mutable_responses(i) : nullptr;
+        _tasks[i]->multi_query_done(_cntl, _request.mutable_requests(i), response);
+    }
+    // 各region的结果处理可能sleep后重试，并行处理避免互相阻塞
+    for (auto task : _tasks) {
+        Bthread bth(&BTHREAD_ATTR_SMALL);
+        bth.run([task]() {
+            task->Run();
+        });
+    }
+    delete this;
+}
+
+void RPCCtrl::send_tasks(const std::vector<OnRPCDone*>& tasks) {
+    if (!FLAGS_fetcher_multi_query) {
+        for (OnRPCDone* task : tasks) {
+            task->send_request();
+        }
+        return;
+    }
+    // 同一store的非事务select合并为一次multi_query
+    std::map<std::string, std::vector<OnRPCDone*>> addr_tasks;
+    for (OnRPCDone* task : tasks) {
+        if (task->prepare_request() != E_OK) {
+            continue;
+        }
+        if (task->can_multi_query()) {
+            addr_tasks[task->addr()].emplace_back(task);
+        } else {
+            task->send_prepared();
+        }
+    }
+    // 按region数和行数切分，避免大范围扫描的结果合并后超过max_body_size
+    auto send_batch = [](const std::string& addr, std::vector<OnRPCDone*>& batch) {
+        if (batch.size() == 1) {
+            batch[0]->send_prepared();
+        } else if (batch.size() > 1) {
+            MultiQueryDone* done = new MultiQueryDone(addr, batch);
+            done->send();
+        }
+        batch.clear();
+    };
+    size_t max_regions = std::max(FLAGS_fetcher_multi_query_max_regions, 1);
+    for (auto& pair : addr_tasks) {
+        std::vector<OnRPCDone*> batch;
+        int64_t batch_lines = 0;
+        for (OnRPCDone* task : pair.second) {
+            if (!batch.empty() && (batch.size() >= max_regions
+                    || batch_lines + task->region_lines() > FLAGS_fetcher_multi_query_max_lines)) {
+                send_batch(pair.first, batch);
+                batch_lines = 0;
+            }
+            batch.emplace_back(task);
+            batch_lines += task->region_lines();
+        }
+        send_batch(pair.first, batch);
+    }
+}
+
 void FetcherStore::choose_other_if_dead(pb::RegionInfo& info, std::string& addr) {
     SchemaFactory* schema_factory = SchemaFactory::get_instance();
     auto status = schema_factory->get_instance_status(addr);
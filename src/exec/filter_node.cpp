@@ -685,6 +685,69 @@ int FilterNode::get_next(RuntimeState* state, RowBatch* batch, bool* eos) {
     return 0;
 }
 
+int FilterNode::filter_columnar(RuntimeState* state, ColumnBatch* batch, int64_t& where_filter_cnt) {
+    if (_columnar_row == nullptr) {
+        _columnar_row = state->mem_row_desc()->fetch_mem_row();
+    }
+    size_t input_rows = batch->selected_size();
+    int ret = filter_column_batch(_pruned_conjuncts, batch, _columnar_row.get());
+    if (ret < 0) {
+        DB_WARNING_STATE(state, "filter_column_batch fail, ret:%d", ret);
+        return ret;
+    }
+    int64_t filter_rows = input_rows - batch->selected_size();
+    state->inc_num_filter_rows(filter_rows);
+    where_filter_cnt += filter_rows;
+    return 0;
+}
+
+int FilterNode::get_next_columnar(RuntimeState* state, ColumnBatch* batch, bool* eos) {
+    // fullexport多轮计算依赖行存路径的状态
+    if (!can_produce_columnar() || state->is_full_export) {
+        return ExecNode::get_next_columnar(state, batch, eos);
+    }
+    int64_t where_filter_cnt = 0;
+    START_LOCAL_TRACE(get_trace(), state->get_trace_cost(), GET_NEXT_TRACE, ([this, &where_filter_cnt](TraceLocalNode& local_node) {
+        local_node.add_where_filter_rows(where_filter_cnt);
+        local_node.set_affect_rows(_num_rows_returned);
+    }));
+    if (_return_empty) {
+        DB_WARNING_STATE(state, "return_empty");
+        state->set_eos();
+        *eos = true;
+        return 0;
+    }
+    while (1) {
+        batch->clear();
+        bool child_eos = false;
+        int ret = _children[0]->get_next_columnar(state, batch, &child_eos);
+        if (ret < 0) {
+            DB_WARNING_STATE(state, "_children get_next_columnar fail");
+            return ret;
+        }
+        ret = filter_columnar(state, batch, where_filter_cnt);
+        if (ret < 0) {
+            DB_WARNING_STATE(state, "filter_columnar fail");
+            return ret;
+        }
+        _num_rows_returned += batch->selected_size();
+        if (reached_limit()) {
+            batch->keep_first_selected(batch->selected_size() - (_num_rows_returned - _limit));
+            _num_rows_returned = _limit;
+            *eos = true;
+            return 0;
+        }
+        if (child_eos) {
+            *eos = true;
+            return 0;
+        }
+        if (batch->selected_size() > 0) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
 void FilterNode::remove_additional_predicate(std::vector<ExprNode*>& input_exprs) {
     auto iter1 = _conjuncts.begin();
     while (iter1 != _conjuncts.end()) {
@@ -715,6 +778,7 @@ void FilterNode::remove_additional_predicate(std::vector<ExprNode*>& input_exprs
 
 void FilterNode::close(RuntimeState* state) {
     ExecNode::close(state);
+    _columnar_row.reset();
     for (auto conjunct : _conjuncts) {
         conjunct->close();
     }
@@ -24,6 +24,19 @@
 #include "literal.h"
 
 namespace baikaldb {
+DEFINE_bool(join_spill_enable, false, "partition and spill hash join to disk when memory is approaching limit, default: false");
+DEFINE_int64(join_spill_memory_ratio, 80, "spill when memory consumed reach this percent of limit, default: 80");
+DEFINE_int32(join_spill_partition_num, 16, "partition number of spilled hash join, default: 16");
+// 旧版本store不识别BLOOM_FILTER_PREDICATE，所有store升级后再开启
+DEFINE_bool(join_bloom_filter_pushdown, false, "push down build side bloom filter to probe side scan, default: false");
+DEFINE_int64(join_bloom_filter_min_values, 50000, "push down bloom filter instead of in condition when join values exceed this, default: 50000");
+DEFINE_double(join_bloom_filter_fpp, 0.01, "false positive probability of join bloom filter, default: 0.01");
+DEFINE_int64(join_bloom_filter_max_bytes, 4 * 1024 * 1024, "max size of join bloom filter, default: 4M");
+
+bvar::Adder<int64_t> JoinNode::join_spill_rows {"join_spill_rows"};
+bvar::Adder<int64_t> JoinNode::join_spill_bytes {"join_spill_bytes"};
+bvar::Adder<int64_t> JoinNode::join_bloom_filter_count {"join_bloom_filter_count"};
+
 int JoinNode::init(const pb::PlanNode& node) {
     int ret = 0;
     ret = Joiner::init(node);
@@ -200,23 +213,39 @@ int JoinNode::hash_join(RuntimeState* state) {
         DB_WARNING("ExecNode:: left table open fail");
         return ret;
     }
-    ret = fetcher_full_table_data(state, _outer_node, _outer_tuple_data);
+    bool use_loop_hash_map = _outer_node->get_node(pb::FULL_EXPORT_NODE) != nullptr;
+    // 只限制join自身缓存的驱动表数据，子节点SelectManagerNode从store拉取的结果仍会先完整物化在内存中；
+    // 落盘后内表只能靠bloom filter过滤，未开启下推时不落盘，避免退化为内表全表扫描
+    bool can_spill = FLAGS_join_spill_enable && FLAGS_join_bloom_filter_pushdown && !use_loop_hash_map;
+    ret = fetcher_outer_table_data(state, can_spill);
     if (ret < 0) {
         DB_WARNING("ExecNode::join open fail when fetch left table");
         return ret;
     }
-    if (_outer_tuple_data.size() == 0) {
+    if (_outer_tuple_data.size() == 0 && !_is_spilled) {
         _outer_table_is_null = true;
         return 0;
     }
     // watt基准循环过滤
-    if (_outer_node->get_node(pb::FULL_EXPORT_NODE) != nullptr) {
+    if (use_loop_hash_map) {
         _use_loop_hash_map = true;
         return loop_hash_join(state);
     }
-    construct_equal_values(_outer_tuple_data, _outer_equal_slot);
+    if (!_is_spilled) {
+        construct_equal_values(_outer_tuple_data, _outer_equal_slot);
+    }
     std::vector<ExprNode*> in_exprs;
-    ret = construct_in_condition(_inner_equal_slot, _outer_join_values, in_exprs);
+    if (_is_spilled || (FLAGS_join_bloom_filter_pushdown
+            && (int64_t)_outer_join_values.size() > FLAGS_join_bloom_filter_min_values)) {
+        // 落盘或in条件过大时下推bloom filter，store端同样按bloom filter过滤
+        BloomFilter bloom_filter;
+        construct_bloom_filter(bloom_filter);
+        ret = construct_bloom_filter_condition(_inner_equal_slot, bloom_filter, in_exprs);
+        _outer_join_values.clear();
+        join_bloom_filter_count << 1;
+    } else {
+        ret = construct_in_condition(_inner_equal_slot, _outer_join_values, in_exprs);
+    }
     if (ret < 0) {
         DB_WARNING("ExecNode::create in condition for right table fail");
         return ret;
@@ -243,6 +272,14 @@ int JoinNode::hash_join(RuntimeState* state) {
         DB_WARNING("ExecNode::inner table open fial");
         return -1;
     }
+    if (_is_spilled) {
+        ret = fetcher_inner_partitions(state);
+        if (ret < 0) {
+            DB_WARNING("fetcher inner partitions fail");
+            return ret;
+        }
+        return load_next_partition(state);
+    }
     if (_join_type == pb::LEFT_JOIN 
             || _join_type == pb::RIGHT_JOIN) {
         ret = fetcher_full_table_data(state, _inner_node, _inner_tuple_data);
@@ -258,6 +295,218 @@ int JoinNode::hash_join(RuntimeState* state) {
     return 0;
 }
 
+int JoinNode::fetcher_outer_table_data(RuntimeState* state, bool can_spill) {
+    bool eos = false;
+    int64_t rows = 0;
+    int64_t buffered_bytes = 0;
+    do {
+        RowBatch batch;
+        auto ret = _outer_node->get_next(state, &batch, &eos);
+        if (ret < 0) {
+            DB_WARNING("children:get_next fail:%d", ret);
+            return ret;
+        }
+        rows += batch.size();
+        buffered_bytes += batch.used_bytes_size();
+        for (batch.reset(); !batch.is_traverse_over(); batch.next()) {
+            _outer_tuple_data.emplace_back(batch.get_row().release());
+        }
+        if (!_is_spilled && can_spill
+                && state->memory_limit_approaching(FLAGS_join_spill_memory_ratio)) {
+            ret = open_partitions(_outer_partitions);
+            if (ret < 0) {
+                return ret;
+            }
+            // 驱动表行数未知，bloom filter直接按最大大小分配，边落盘边写入，不再缓存每行的hash
+            double fpp = FLAGS_join_bloom_filter_fpp > 0 && FLAGS_join_bloom_filter_fpp < 1
+                    ? FLAGS_join_bloom_filter_fpp : 0.01;
+            int64_t expected_num = FLAGS_join_bloom_filter_max_bytes * 8 * M_LN2 * M_LN2 / -log(fpp);
+            _spill_bloom_filter.init(expected_num, fpp, FLAGS_join_bloom_filter_max_bytes);
+            _is_spilled = true;
+            DB_WARNING_STATE(state, "hash join spill, outer rows:%ld bytes:%ld", rows, buffered_bytes);
+        }
+        if (_is_spilled) {
+            ret = spill_rows(_outer_tuple_data, _outer_equal_slot, _outer_partitions, &_spill_bloom_filter);
+            if (ret < 0) {
+                return ret;
+            }
+            state->memory_limit_release(rows, buffered_bytes);
+            buffered_bytes = 0;
+        }
+    } while (!eos);
+    if (_is_spilled) {
+        return finish_partitions(_outer_partitions);
+    }
+    return 0;
+}
+
+int JoinNode::fetcher_inner_partitions(RuntimeState* state) {
+    int ret = open_partitions(_inner_partitions);
+    if (ret < 0) {
+        return ret;
+    }
+    bool eos = false;
+    int64_t rows = 0;
+    std::vector<MemRow*> inner_rows;
+    do {
+        RowBatch batch;
+        ret = _inner_node->get_next(state, &batch, &eos);
+        if (ret < 0) {
+            DB_WARNING("children:get_next fail:%d", ret);
+            return ret;
+        }
+        rows += batch.size();
+        int64_t used_bytes = batch.used_bytes_size();
+        for (batch.reset(); !batch.is_traverse_over(); batch.next()) {
+            inner_rows.emplace_back(batch.get_row().release());
+        }
+        ret = spill_rows(inner_rows, _inner_equal_slot, _inner_partitions, nullptr);
+        if (ret < 0) {
+            return ret;
+        }
+        state->memory_limit_release(rows, used_bytes);
+    } while (!eos);
+    return finish_partitions(_inner_partitions);
+}
+
+int JoinNode::open_partitions(std::vector<std::unique_ptr<SpillFile>>& partitions) {
+    partitions.clear();
+    for (int i = 0; i < FLAGS_join_spill_partition_num; i++) {
+        std::unique_ptr<SpillFile> file(new SpillFile(_mem_row_desc));
+        if (file->open_write() < 0) {
+            return -1;
+        }
+        partitions.emplace_back(std::move(file));
+    }
+    return 0;
+}
+
+int JoinNode::finish_partitions(std::vector<std::unique_ptr<SpillFile>>& partitions) {
+    for (auto& file : partitions) {
+        if (file->finish_write() < 0) {
+            return -1;
+        }
+        join_spill_rows << file->rows();
+        join_spill_bytes << file->bytes();
+    }
+    return 0;
+}
+
+int JoinNode::spill_rows(std::vector<MemRow*>& rows,
+                         const std::vector<ExprNode*>& slot_refs,
+                         std::vector<std::unique_ptr<SpillFile>>& partitions,
+                         BloomFilter* bloom_filter) {
+    int ret = 0;
+    for (auto& mem_row : rows) {
+        if (ret == 0) {
+            MutTableKey key;
+            encode_hash_key(mem_row, slot_refs, key);
+            uint64_t hash = BloomFilter::hash(key.data());
+            if (bloom_filter != nullptr) {
+                bloom_filter->add_hash(hash);
+            }
+            // 两侧用相同的hash分区，相等的key一定落在同一分区
+            auto& file = partitions[(hash >> 32) % partitions.size()];
+            if (file->write_row(mem_row) < 0) {
+                DB_WARNING("write spill file fail, path:%s", file->path().c_str());
+                ret = -1;
+            }
+        }
+        delete mem_row;
+    }
+    rows.clear();
+    return ret;
+}
+
+int JoinNode::read_partition(SpillFile* file, std::vector<MemRow*>& rows) {
+    while (true) {
+        std::unique_ptr<MemRow> row;
+        bool eof = false;
+        if (file->read_row(&row, &eof) < 0) {
+            return -1;
+        }
+        if (eof) {
+            return 0;
+        }
+        rows.emplace_back(row.release());
+    }
+    return 0;
+}
+
+int JoinNode::load_next_partition(RuntimeState* state) {
+    for (auto& mem_row : _outer_tuple_data) {
+        delete mem_row;
+    }
+    _outer_tuple_data.clear();
+    for (auto& mem_row : _inner_tuple_data) {
+        delete mem_row;
+    }
+    _inner_tuple_data.clear();
+    _hash_map.clear();
+    _inner_row_batch.clear();
+    _result_row_index = 0;
+    _child_eos = true;
+    while (_partition_idx < _outer_partitions.size()) {
+        size_t idx = _partition_idx++;
+        std::unique_ptr<SpillFile> outer_file = std::move(_outer_partitions[idx]);
+        int ret = read_partition(outer_file.get(), _outer_tuple_data);
+        if (ret < 0) {
+            return ret;
+        }
+        // 驱动表分区为空时该分区没有输出
+        if (_outer_tuple_data.empty()) {
+            _inner_partitions[idx].reset();
+            continue;
+        }
+        if (_join_type == pb::INNER_JOIN) {
+            construct_hash_map(_outer_tuple_data, _outer_equal_slot);
+            _child_eos = false;
+        } else {
+            ret = read_partition(_inner_partitions[idx].get(), _inner_tuple_data);
+            if (ret < 0) {
+                return ret;
+            }
+            _inner_partitions[idx].reset();
+            construct_hash_map(_inner_tuple_data, _inner_equal_slot);
+        }
+        break;
+    }
+    _outer_iter = _outer_tuple_data.begin();
+    return 0;
+}
+
+int JoinNode::read_probe_batch(RowBatch* batch, bool* eos) {
+    auto& file = _inner_partitions[_partition_idx - 1];
+    while (!batch->is_full()) {
+        std::unique_ptr<MemRow> row;
+        bool eof = false;
+        if (file->read_row(&row, &eof) < 0) {
+            return -1;
+        }
+        if (eof) {
+            *eos = true;
+            file.reset();
+            return 0;
+        }
+        batch->move_row(std::move(row));
+    }
+    return 0;
+}
+
+void JoinNode::construct_bloom_filter(BloomFilter& bloom_filter) {
+    if (_is_spilled) {
+        bloom_filter = _spill_bloom_filter;
+        return;
+    }
+    bloom_filter.init(_outer_join_values.size(), FLAGS_join_bloom_filter_fpp,
+            FLAGS_join_bloom_filter_max_bytes);
+    for (auto& mem_row : _outer_tuple_data) {
+        MutTableKey key;
+        encode_hash_key(mem_row, _outer_equal_slot, key);
+        bloom_filter.add_hash(BloomFilter::hash(key.data()));
+    }
+}
+
 int JoinNode::loop_hash_join(RuntimeState* state) {
     int ret = fetcher_inner_table_data(state, _outer_tuple_data, _inner_tuple_data);
     if (ret < 0) {
@@ -433,6 +682,14 @@ int JoinNode::get_next_for_hash_outer_join(RuntimeState* state, RowBatch* batch,
     TimeCost get_next_time;
     while (1) {
         if (_outer_iter == _outer_tuple_data.end()) {
+            if (_is_spilled && _partition_idx < _outer_partitions.size()) {
+                int ret = load_next_partition(state);
+                if (ret < 0) {
+                    DB_WARNING("load next partition fail");
+                    return ret;
+                }
+                continue;
+            }
             DB_WARNING("when join, outer iter is end, time_cost:%ld", get_next_time.get_time());
             *eos = true;
             return 0;
@@ -490,13 +747,26 @@ int JoinNode::get_next_for_hash_inner_join(RuntimeState* state, RowBatch* batch,
     while (1) {
         if (_inner_row_batch.is_traverse_over()) {
             if (_child_eos) {
+                if (_is_spilled && _partition_idx < _outer_partitions.size()) {
+                    int ret = load_next_partition(state);
+                    if (ret < 0) {
+                        DB_WARNING("load next partition fail");
+                        return ret;
+                    }
+                    continue;
+                }
                 *eos = true;
                 DB_WARNING("when join, get next complete, child eos, time_cost:%ld", 
                             get_next_time.get_time());
                 return 0;
             } else {
                 _inner_row_batch.clear();
-                int ret = _inner_node->get_next(state, &_inner_row_batch, &_child_eos);
+                int ret = 0;
+                if (_is_spilled) {
+                    ret = read_probe_batch(&_inner_row_batch, &_child_eos);
+                } else {
+                    ret = _inner_node->get_next(state, &_inner_row_batch, &_child_eos);
+                }
                 if (ret < 0) {
                     DB_WARNING("_children get_next fail");
                     return ret;
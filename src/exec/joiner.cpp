@@ -345,6 +345,45 @@ int Joiner::construct_in_condition(std::vector<ExprNode*>& slot_refs,
     return 0;
 }
 
+int Joiner::construct_bloom_filter_condition(std::vector<ExprNode*>& slot_refs,
+                             const BloomFilter& bloom_filter,
+                             std::vector<ExprNode*>& bloom_exprs) {
+    if (slot_refs.size() == 0 || bloom_filter.empty()) {
+        return 0;
+    }
+    pb::Expr expr;
+    ExprNode* conjunct = nullptr;
+    pb::ExprNode* bloom_node = expr.add_nodes();
+    bloom_node->set_node_type(pb::BLOOM_FILTER_PREDICATE);
+    bloom_node->set_col_type(pb::BOOL);
+    pb::Function* func = bloom_node->mutable_fn();
+    func->set_name("bloom_filter");
+    func->set_fn_op(parser::FT_COMMON);
+    bloom_node->set_num_children(slot_refs.size() + 1);
+    for (auto& slot_ref : slot_refs) {
+        pb::ExprNode* slot_node = expr.add_nodes();
+        slot_node->set_node_type(pb::SLOT_REF);
+        slot_node->set_col_type(slot_ref->col_type());
+        slot_node->set_num_children(0);
+        slot_node->mutable_derive_node()->set_tuple_id(static_cast<SlotRef*>(slot_ref)->tuple_id());
+        slot_node->mutable_derive_node()->set_slot_id(static_cast<SlotRef*>(slot_ref)->slot_id());
+        slot_node->mutable_derive_node()->set_field_id(static_cast<SlotRef*>(slot_ref)->field_id());
+    }
+    pb::ExprNode* filter_node = expr.add_nodes();
+    filter_node->set_node_type(pb::STRING_LITERAL);
+    filter_node->set_col_type(pb::STRING);
+    filter_node->set_num_children(0);
+    filter_node->mutable_derive_node()->set_string_val(bloom_filter.data());
+    auto ret = ExprNode::create_tree(expr, &conjunct);
+    if (ret < 0) {
+        DB_WARNING("create bloom filter condition fail");
+        return ret;
+    }
+    conjunct->type_inferer();
+    bloom_exprs.emplace_back(conjunct);
+    return 0;
+}
+
 void Joiner::construct_equal_values(const std::vector<MemRow*>& tuple_data,
                                 const std::vector<ExprNode*>& slot_refs) {
     for (auto& mem_row : tuple_data) {
@@ -478,6 +517,11 @@ void Joiner::close(RuntimeState* state) {
     _outer_table_is_null = false;
     _inner_row_batch.clear();
     _child_eos = false;
+    _is_spilled = false;
+    _outer_partitions.clear();
+    _inner_partitions.clear();
+    _partition_idx = 0;
+    _spill_bloom_filter = BloomFilter();
 }
 
 void Joiner::show_explain(std::vector<std::map<std::string, std::string>>& output) {
@@ -17,11 +17,23 @@
 
 #include <algorithm>
 #include <iterator>
-#include <boost/algorithm/string.hpp>
+#include <cstring>
 
 namespace baikaldb {
 
 DEFINE_uint64(row_batch_size, 200, "row_batch_size");
+DEFINE_int64(load_read_block_size, 64 * 1024 * 1024LL, "load data read block size, default: 64M");
+DEFINE_int32(load_parse_concurrency, 8, "load data parse bthreads, each parses row_batch_size lines; "
+        "rows parsed by one round are inserted in one batch, default: 8");
+
+bvar::Adder<int64_t> LoadNode::load_read_bytes {"load_read_bytes"};
+bvar::Adder<int64_t> LoadNode::load_parse_lines {"load_parse_lines"};
+bvar::Adder<int64_t> LoadNode::load_error_lines {"load_error_lines"};
+bvar::Adder<int64_t> LoadNode::load_insert_rows {"load_insert_rows"};
+bvar::PerSecond<bvar::Adder<int64_t>> LoadNode::load_read_bytes_second {
+        "load_read_bytes_second", &LoadNode::load_read_bytes};
+bvar::PerSecond<bvar::Adder<int64_t>> LoadNode::load_insert_rows_second {
+        "load_insert_rows_second", &LoadNode::load_insert_rows};
 
 int LoadNode::init(const pb::PlanNode& node) { 
     int ret = 0;
@@ -90,70 +102,230 @@ int LoadNode::open(RuntimeState* state) {
         DB_FATAL("file: %s open failed", _data_path.c_str());
         return -1;
     }
-    std::unique_ptr<char[]> data_buffer(new char[BUFFER_SIZE]);
-    if (data_buffer == nullptr) {
+    TimeCost cost;
+    if (0 != read_lines(state, file)) {
         return -1;
     }
+    if (state->is_cancelled()) {
+        DB_WARNING("load is cancelled, log_id: %lu", state->log_id());
+        return 0;
+    }
+    DB_WARNING("load data path: %s, lines: %ld, affected_rows: %d, error_lines: %ld, cost: %ld",
+            _data_path.c_str(), _line_no, _affected_rows, _error_line_count, cost.get_time());
+    return _affected_rows;
+}
 
-    if (0 != ignore_specified_lines(file, data_buffer.get(), BUFFER_SIZE)) {
+// 按块读文件，memchr切行，每块内的行按FLAGS_row_batch_size分批，
+// 每轮FLAGS_load_parse_concurrency批并发解析，同时插入上一轮解析好的记录
+int LoadNode::read_lines(RuntimeState* state, butil::File& file) {
+    size_t concurrency = std::max(FLAGS_load_parse_concurrency, 1);
+    int ret = read_blocks(state, file, [this, state, concurrency](std::vector<LineBatch>& batches) {
+        for (size_t i = 0; i < batches.size(); i += concurrency) {
+            if (state->is_cancelled()) {
+                return 0;
+            }
+            size_t group_end = std::min(i + concurrency, batches.size());
+            ConcurrencyBthread parser(concurrency);
+            for (size_t j = i; j < group_end; ++j) {
+                LineBatch* batch = &batches[j];
+                parser.run([this, batch]() {
+                    parse_batch(*batch);
+                });
+            }
+            int ret = insert_records(state, _pending_records);
+            parser.join();
+            if (ret < 0) {
+                return -1;
+            }
+            // 按行号顺序输出错误行，结果与并发度无关
+            for (size_t j = i; j < group_end; ++j) {
+                LineBatch& batch = batches[j];
+                if (batch.ret < 0) {
+                    DB_WARNING("path: %s parse line failed, line: %ld",
+                            _data_path.c_str(), batch.err_line_no);
+                    return -1;
+                }
+                for (auto& err : batch.err_lines) {
+                    DB_FATAL("path: %s, ERRLINE %ld: %s", _data_path.c_str(), err.first, err.second.c_str());
+                }
+                _error_line_count += batch.err_lines.size();
+                _pending_records.insert(_pending_records.end(),
+                        batch.records.begin(), batch.records.end());
+                batch.records.clear();
+            }
+        }
+        return 0;
+    });
+    if (ret < 0) {
         return -1;
     }
-    std::vector<std::string> row_lines;
-    row_lines.reserve(FLAGS_row_batch_size);
-    while (!_read_eof) {
+    if (state->is_cancelled()) {
+        return 0;
+    }
+    return insert_records(state, _pending_records);
+}
+
+// 跨块的不完整行留到下一块，单行超过缓冲区时扩容，文件末尾没有换行符的最后一行也作为一行
+int LoadNode::read_blocks(RuntimeState* state, butil::File& file,
+        const std::function<int(std::vector<LineBatch>&)>& handle_batches) {
+    int64_t buf_size = std::max<int64_t>(FLAGS_load_read_block_size, 1024);
+    std::unique_ptr<char[]> buf(new char[buf_size]);
+    int64_t data_len = 0;
+    bool eof = false;
+    size_t batch_size = std::max<uint64_t>(FLAGS_row_batch_size, 1);
+    while (!eof) {
         if (state->is_cancelled()) {
-            DB_WARNING("load is cancelled, log_id: %lu", state->log_id());
             return 0;
         }
-        int64_t size = file.Read(_file_cur_pos, data_buffer.get(), BUFFER_SIZE);
+        if (data_len == buf_size) {
+            // 单行超过缓冲区，扩容
+            std::unique_ptr<char[]> new_buf(new char[buf_size * 2]);
+            memcpy(new_buf.get(), buf.get(), data_len);
+            buf.swap(new_buf);
+            buf_size *= 2;
+            DB_WARNING("path: %s, line_size > %ld, grow buf_size to %ld",
+                    _data_path.c_str(), data_len, buf_size);
+        }
+        int64_t size = file.Read(_file_cur_pos, buf.get() + data_len, buf_size - data_len);
         if (size < 0) {
             DB_WARNING("file: %s read failed", _data_path.c_str());
             return -1;
         } else if (size == 0) {
-            break;
+            eof = true;
         }
-        MemBuf sbuf(data_buffer.get(), data_buffer.get() + size);
-        std::istream f(&sbuf);
-        while (!f.eof()) {
-            if (state->is_cancelled()) {
-                DB_WARNING("load is cancelled, log_id: %lu", state->log_id());
-                return 0;
-            }
-            std::string line;
-            std::getline(f, line);
-            if (f.eof()) {
-                // 首行没读完整说明line size > _buf size 暂时不支持
-                if (!_has_get_line) {
-                    DB_FATAL("path: %s, line_size: %lu > buf_size: %ld", _data_path.c_str(), line.size(), BUFFER_SIZE);
-                    return -1;
+        _file_cur_pos += size;
+        data_len += size;
+        load_read_bytes << size;
+
+        std::vector<LineBatch> batches;
+        const char* begin = buf.get();
+        const char* end = begin + data_len;
+        const char* pos = begin;
+        while (pos < end) {
+            const char* line_end = static_cast<const char*>(memchr(pos, '\n', end - pos));
+            if (line_end == nullptr) {
+                if (!eof) {
+                    // 不完整的行留到下一块
+                    break;
                 }
-                if (_file_cur_pos + line.size() == _file_size) {
-                    _read_eof = true;
-                    DB_WARNING("path: %s, eof, pos: %ld line_size:%ld", _data_path.c_str(), _file_cur_pos, line.size());
+                // 文件末尾没有换行符的最后一行
+                line_end = end;
+            }
+            ++_line_no;
+            if (_line_no > _ignore_lines && line_end > pos) {
+                if (batches.empty() || batches.back().lines.size() >= batch_size) {
+                    batches.emplace_back();
+                    batches.back().lines.reserve(batch_size);
+                    batches.back().line_nos.reserve(batch_size);
                 }
-                break;
+                batches.back().lines.emplace_back(pos, line_end - pos);
+                batches.back().line_nos.emplace_back(_line_no);
             }
+            pos = (line_end == end) ? end : line_end + 1;
+        }
+        if (handle_batches(batches) < 0) {
+            return -1;
+        }
+        int64_t consumed = pos - begin;
+        data_len -= consumed;
+        if (data_len > 0 && consumed > 0) {
+            memmove(buf.get(), begin + consumed, data_len);
+        }
+    }
+    return 0;
+}
 
-            _has_get_line = true;
-            _buf_cur_pos += line.size() + 1;
-            _file_cur_pos += line.size() + 1;
-            if(line.size() > 0) {
-                row_lines.emplace_back(line);
-            }
-            if (row_lines.size() >= FLAGS_row_batch_size) {
-                if (0 != handle_lines(state, row_lines)) {
-                    return -1;
-                }
-                row_lines.clear();
+void LoadNode::parse_batch(LineBatch& batch) {
+    batch.records.reserve(batch.lines.size());
+    for (size_t i = 0; i < batch.lines.size(); ++i) {
+        SmartRecord row;
+        std::string reason;
+        int ret = parse_line(batch.lines[i], row, reason);
+        if (ret < 0) {
+            batch.ret = -1;
+            batch.err_line_no = batch.line_nos[i];
+            return;
+        } else if (ret > 0) {
+            batch.err_lines.emplace_back(batch.line_nos[i], reason);
+            continue;
+        }
+        batch.records.emplace_back(row);
+    }
+    load_parse_lines << batch.lines.size();
+    load_error_lines << batch.err_lines.size();
+}
+
+void LoadNode::split_fields(const butil::StringPiece& line, std::vector<butil::StringPiece>& fields) {
+    if (_terminated.empty()) {
+        fields.emplace_back(line);
+        return;
+    }
+    const char* pos = line.data();
+    const char* end = line.data() + line.size();
+    while (true) {
+        const char* sep = nullptr;
+        if (_terminated.size() == 1) {
+            sep = static_cast<const char*>(memchr(pos, _terminated[0], end - pos));
+        } else {
+            // 多字符分隔符沿用原有语义：任意一个字符都作为分隔符
+            sep = std::find_first_of(pos, end, _terminated.begin(), _terminated.end());
+            if (sep == end) {
+                sep = nullptr;
             }
         }
+        if (sep == nullptr) {
+            fields.emplace_back(pos, end - pos);
+            return;
+        }
+        fields.emplace_back(pos, sep - pos);
+        pos = sep + 1;
     }
-    if (row_lines.size() > 0) {
-        if (0 != handle_lines(state, row_lines)) {
+}
+
+// 返回0成功，1为非法行需跳过，-1失败
+int LoadNode::parse_line(const butil::StringPiece& raw_line, SmartRecord& row, std::string& reason) {
+    butil::StringPiece line = raw_line;
+    if (line.ends_with(_terminated)) {
+        line.remove_suffix(_terminated.size());
+    }
+    std::vector<butil::StringPiece> fields;
+    fields.reserve(_field_ids.size() + _ingore_field_indexes.size());
+    split_fields(line, fields);
+    if (fields.size() != _field_ids.size() + _ingore_field_indexes.size()) {
+        reason = "field count " + std::to_string(fields.size()) + " != "
+            + std::to_string(_field_ids.size() + _ingore_field_indexes.size())
+            + ", line: " + raw_line.as_string();
+        return 1;
+    }
+    row = _factory->new_record(_table_id);
+    int field_index = 0;
+    for (size_t idx = 0; idx < fields.size(); ++idx) {
+        if (_ingore_field_indexes.count(idx) != 0) {
+            continue;
+        }
+        int32_t field_idx = _field_ids[field_index++];
+        FieldInfo& field_info = _table_info->fields[--field_idx];
+        std::string str_val = fields[idx].as_string();
+        stripslashes(str_val, _char_set == pb::GBK);
+        bool is_legal = true;
+        ExprValue value = create_field_value(field_info, str_val, is_legal);
+        if (!is_legal) {
+            reason = "field " + field_info.short_name + " illegal, line: " + raw_line.as_string();
+            return 1;
+        }
+        if (0 != fill_field_value(row, field_info, value)) {
             return -1;
         }
     }
-    return _affected_rows;
+    for (FieldInfo& field_info : _table_info->fields) {
+        if (_default_field_ids.count(field_info.id) != 0) {
+            ExprValue value(pb::NULL_TYPE);
+            if (0 != fill_field_value(row, field_info, value)) {
+                return -1;
+            }
+        }
+    }
+    return 0;
 }
 
 ExprValue LoadNode::create_field_value(FieldInfo& field_info, std::string& str_val, bool& is_legal) {
@@ -323,63 +495,14 @@ int LoadNode::fill_field_value(SmartRecord record, FieldInfo& field, ExprValue&
     return 0;
 }
 
-int LoadNode::handle_lines(RuntimeState* state, std::vector<std::string>& row_lines) {
-    std::string insert_values;
-    std::vector<SmartRecord> records;
-    TimeCost get_next_time;
-    records.reserve(row_lines.size());
-    for (auto& line : row_lines) {
-        std::vector<std::string> split_vec;
-        if (ends_with(line, _terminated)) {
-            line.erase(line.length() - _terminated.length(), line.length());
-        }
-        boost::split(split_vec, line, boost::is_any_of(_terminated));
-        if (split_vec.size() != _field_ids.size() + _ingore_field_indexes.size()) {
-            DB_FATAL("size diffrent %lu %lu", split_vec.size(), _field_ids.size() + _ingore_field_indexes.size());
-            DB_FATAL("ERRLINE:%s size:%ld", line.c_str(), line.size());
-            continue;
-        }
-        SmartRecord row = _factory->new_record(_table_id);
-        int field_index = 0;
-        bool is_legal = true;
-        for (size_t idx = 0; idx < split_vec.size(); ++idx) {
-            if (_ingore_field_indexes.count(idx) == 0) {
-                int32_t field_idx = _field_ids[field_index++];
-                FieldInfo& field_info = _table_info->fields[--field_idx];
-                if (_char_set == pb::GBK) {
-                    stripslashes(split_vec[idx], true);
-                } else {
-                    stripslashes(split_vec[idx], false);
-                }
-                is_legal = true;
-                ExprValue value = create_field_value(field_info, split_vec[idx], is_legal);
-                if (!is_legal) {
-                    break;
-                }
-                if (0 != fill_field_value(row, field_info, value)) {
-                    return -1;
-                }
-            }
-        }
-        if (!is_legal) {
-            DB_FATAL("ERRLINE:%s", line.c_str());
-            continue;
-        }
-        for (FieldInfo& field_info : _table_info->fields) {
-            if (_default_field_ids.count(field_info.id) != 0) {
-                ExprValue value(pb::NULL_TYPE);
-                if (0 != fill_field_value(row, field_info, value)) {
-                    return -1;
-                }
-            }
-        }
-        records.emplace_back(row);
-        //DB_WARNING("row %s", row->debug_string().c_str());
-    }
+int LoadNode::insert_records(RuntimeState* state, std::vector<SmartRecord>& records) {
     if (records.size() == 0) {
         return 0;
     }
+    TimeCost get_next_time;
+    // InsertManagerNode按region拆分，各region的请求并发发送
     _insert_manager->set_records(records);
+    records.clear();
     int ret = _children[0]->open(state);
     _children[0]->reset(state);
     _children[0]->close(state);
@@ -388,43 +511,7 @@ int LoadNode::handle_lines(RuntimeState* state, std::vector<std::string>& row_li
     }
     DB_WARNING("insert row %d cost:%ld", ret, get_next_time.get_time());
     _affected_rows += ret;
-    return 0;
-}
-
-int LoadNode::ignore_specified_lines(butil::File& file, char* data_buffer, int64_t buf_size) {
-    int64_t current_ignore_lines = 0;
-    if (_ignore_lines > 0) {
-        while (!_read_eof && current_ignore_lines != _ignore_lines) {
-            int64_t size = file.Read(_file_cur_pos, data_buffer, buf_size);
-            if (size < 0) {
-                DB_WARNING("file: %s read failed", _data_path.c_str());
-                return -1;
-            }
-            MemBuf sbuf(data_buffer, data_buffer + size);
-            std::istream f(&sbuf);
-            bool first_line = true;
-            while (_ignore_lines != current_ignore_lines) {
-                std::string line;
-                std::getline(f, line);
-                if (f.eof()) {
-                    if (first_line) {
-                        return -1;
-                    }
-                    break;
-                }
-                first_line = false;
-                _has_get_line = true;
-                current_ignore_lines++;
-                _buf_cur_pos += line.size() + 1;
-                _file_cur_pos += line.size() + 1;
-                if (_file_cur_pos >= _file_size) {
-                    _read_eof = true;
-                    DB_WARNING("ignore all data path: %s, pos: %ld", _data_path.c_str(), _file_cur_pos);
-                    return 0;
-                }
-            }
-        }
-    }
+    load_insert_rows << ret;
     return 0;
 }
 
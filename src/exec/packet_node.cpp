@@ -11,6 +11,8 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
+#include <unistd.h>
+#include <sys/epoll.h>
 #include "meta_server_interact.hpp"
 #include "packet_node.h"
 #include "full_export_node.h"
@@ -21,6 +23,10 @@
 namespace baikaldb {
 DEFINE_int32(expect_bucket_count, 100, "expect_bucket_count");
 DEFINE_bool(field_charsetnr_set_by_client, false, "set charsetnr by client");
+// 开启后大结果集会先发出部分结果包，之后的错误只能追加在已发出的结果后
+DEFINE_bool(enable_stream_send, false, "flush select result to client when send_buf is large, default: false");
+DEFINE_int64(stream_send_threshold, 1024 * 1024, "send_buf size to trigger stream send, default: 1M");
+DEFINE_int32(stream_send_timeout_ms, 60 * 1000, "max wait time for client socket writable, default: 60s");
 int PacketNode::init(const pb::PlanNode& node) {
     int ret = 0;
     ret = ExecNode::init(node);
@@ -366,6 +372,9 @@ int PacketNode::open(RuntimeState* state) {
     if (state->is_full_export) {
         return 0;
     }
+    // 单语句事务在PacketNode之后才提交，提交失败时需要只返回错误包，不能提前发送
+    _stream_send = FLAGS_enable_stream_send && _client != nullptr && _client->fd > 0
+            && !(state->txn_id != 0 && state->single_sql_autocommit());
 
     bool eos = false;
     int64_t pack_time = 0;
@@ -395,12 +404,54 @@ int PacketNode::open(RuntimeState* state) {
                 return ret;
             }
         }
+        ret = stream_send(state);
+        if (ret < 0) {
+            return ret;
+        }
     } while (!eos);
     //DB_WARNING("txn_id: %lu, pack_time: %ld", state->txn_id, pack_time);
     pack_eof();
     return 0;
 }
 
+int PacketNode::stream_send(RuntimeState* state) {
+    if (!_stream_send || _send_buf->_size < (size_t)FLAGS_stream_send_threshold) {
+        return 0;
+    }
+    size_t offset = 0;
+    while (offset < _send_buf->_size) {
+        size_t want = std::min(_send_buf->_size - offset, (size_t)MAX_WRITE_QUERY_RESULT_PACKET_LEN);
+        ssize_t len = write(_client->fd, _send_buf->_data + offset, want);
+        if (len > 0) {
+            offset += len;
+            continue;
+        }
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len < 0 && errno == EAGAIN) {
+            // reactor上该fd的事件已关闭，在bthread内等待可写
+            timespec abstime = butil::milliseconds_from_now(FLAGS_stream_send_timeout_ms);
+            if (bthread_fd_timedwait(_client->fd, EPOLLOUT, &abstime) == 0) {
+                continue;
+            }
+        }
+        DB_WARNING_CLIENT(_client, "stream send fail, fd:%d, offset:%lu, size:%lu, errno:%d",
+                _client->fd, offset, _send_buf->_size, errno);
+        state->error_code = ER_NET_ERROR_ON_WRITE;
+        state->error_msg << "write result to client failed";
+        return -1;
+    }
+    if (_client->query_ctx != nullptr) {
+        _client->query_ctx->stat_info.send_buf_size += _send_buf->_size;
+    }
+    // 已发出的包不能回退，错误包的packet_id从这里继续
+    _client->last_packet_id = _client->packet_id;
+    // 保留容量复用，不调用byte_array_clear
+    _send_buf->_size = 0;
+    return 0;
+}
+
 int PacketNode::open_trace(RuntimeState* state) {
     bool eos = false;
     int ret = 0;
@@ -29,6 +29,7 @@ DEFINE_bool(reverse_seek_first_level, false, "reverse index seek first level, de
 DEFINE_bool(scan_use_multi_get, true, "use MultiGet API, default(true)");
 DEFINE_int32(in_predicate_check_threshold, 4096, "in predicate threshold to check memory, default(4096)");
 DECLARE_int64(print_time_us);
+DECLARE_bool(enable_columnar_execution);
 
 int RocksdbScanNode::choose_index(RuntimeState* state) {
     // 做完logical plan还没有索引
@@ -615,6 +616,7 @@ int RocksdbScanNode::get_next(RuntimeState* state, RowBatch* batch, bool* eos) {
 
 void RocksdbScanNode::close(RuntimeState* state) {
     ScanNode::close(state);
+    _columnar_row.reset();
     for (auto expr : _scan_conjuncts) {
         expr->close();
     }
@@ -1030,6 +1032,164 @@ int RocksdbScanNode::process_ddl_work(RuntimeState* state, MemRow* row) {
     return 0;
 }
 
+int RocksdbScanNode::open_next_table_range(RuntimeState* state) {
+    IndexRange range;
+    if (_use_encoded_key) {
+        auto key_pair = _scan_range_keys.get_next();
+        range = IndexRange(key_pair->left_key(),
+                key_pair->right_key(),
+                _index_info.get(),
+                _pri_info.get(),
+                _region_info,
+                _left_field_cnts[_idx], 
+                _right_field_cnts[_idx], 
+                _left_opens[_idx], 
+                _right_opens[_idx],
+                _like_prefixs[_idx]);
+    } else {
+        range = IndexRange(_left_records[_idx].get(), 
+                _right_records[_idx].get(), 
+                _index_info.get(),
+                _pri_info.get(),
+                _region_info,
+                _left_field_cnts[_idx], 
+                _right_field_cnts[_idx], 
+                _left_opens[_idx], 
+                _right_opens[_idx],
+                _like_prefixs[_idx]);
+    }
+    delete _table_iter;
+    _table_iter = Iterator::scan_primary(
+            state->txn(), range, _field_ids, _field_slot, state->need_check_region(), _scan_forward);
+    if (_table_iter == nullptr) {
+        DB_WARNING_STATE(state, "open TableIterator fail, table_id:%ld", _index_id);
+        return -1;
+    }
+    if (_is_covering_index) {
+        _table_iter->set_mode(KEY_ONLY);
+    }
+    _num_rows_returned_by_range = 0;
+    _idx++;
+    return 0;
+}
+
+bool RocksdbScanNode::can_produce_columnar() {
+    // 目前只有主键seek的普通读走原生列存，其余路径通过适配器转换
+    return FLAGS_enable_columnar_execution
+        && !_is_explain
+        && _index_id == _table_id
+        && !_use_get
+        && _lock != pb::LOCK_GET
+        && _table_info != nullptr
+        && _table_info->engine != pb::ROCKSDB_CSTORE;
+}
+
+int RocksdbScanNode::get_next_columnar(RuntimeState* state, ColumnBatch* batch, bool* eos) {
+    if (!can_produce_columnar()) {
+        return ExecNode::get_next_columnar(state, batch, eos);
+    }
+    ON_SCOPE_EXIT(([this, state]() {
+        state->set_num_scan_rows(_scan_rows);
+    }));
+    if (StoreQos::get_instance()->need_reject()) {
+        return -1;
+    }
+    if (!batch->is_inited()) {
+        if (batch->init(state->tuple_descs(), {_tuple_id}) < 0) {
+            DB_WARNING_STATE(state, "ColumnBatch init fail, tuple_id:%d", _tuple_id);
+            return -1;
+        }
+    }
+    // ColumnBatch由消费方复用，大小受capacity限制，不计入MemTracker；
+    // 物化为MemRow的节点(agg/sort)按原有方式统计内存
+    int ret = get_next_by_table_seek_columnar(state, batch, eos);
+    StoreQos::get_instance()->update_statistics();
+    return ret;
+}
+
+int RocksdbScanNode::get_next_by_table_seek_columnar(RuntimeState* state, ColumnBatch* batch, bool* eos) {
+    int64_t index_filter_cnt = 0;
+    START_LOCAL_TRACE(get_trace(), state->get_trace_cost(), GET_NEXT_TRACE, ([this, &index_filter_cnt](TraceLocalNode& local_node) {
+        local_node.add_index_filter_rows(index_filter_cnt);
+        local_node.set_scan_rows(_scan_rows);
+    }));
+    // 存储行直接解码到列，不经过MemRow；_columnar_row只用于表达式逐行回退
+    if (!_scan_conjuncts.empty() && _columnar_row == nullptr) {
+        _columnar_row = _mem_row_desc->fetch_mem_row();
+    }
+    while (1) {
+        if (state->is_cancelled()) {
+            DB_WARNING_STATE(state, "cancelled");
+            *eos = true;
+            return 0;
+        }
+        if (reached_limit()) {
+            *eos = true;
+            return 0;
+        }
+        if (batch->is_full()) {
+            return 0;
+        }
+        if (_table_iter == nullptr || !_table_iter->valid() || range_reach_limit()) {
+            if (_idx >= _left_records.size() && _scan_range_keys.is_traverse_over()) {
+                *eos = true;
+                return 0;
+            }
+            if (open_next_table_range(state) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        // 每块不超过剩余的limit，scan条件按块批量计算，不会比行存路径多扫
+        int64_t chunk_rows = batch->capacity() - batch->size();
+        if (_limit != -1) {
+            chunk_rows = std::min(chunk_rows, _limit - _num_rows_returned);
+        }
+        if (_sort_use_index_by_range && _sort_limit_by_range != -1) {
+            chunk_rows = std::min(chunk_rows, _sort_limit_by_range - _num_rows_returned_by_range);
+        }
+        // 之前块已选中的行，本块过滤后追加在后面
+        std::vector<uint32_t> selection;
+        if (!_scan_conjuncts.empty()) {
+            if (batch->use_selection()) {
+                selection = batch->selection();
+            } else {
+                selection.reserve(batch->capacity());
+                for (uint32_t i = 0; i < batch->size(); ++i) {
+                    selection.emplace_back(i);
+                }
+            }
+        }
+        size_t begin = batch->size();
+        while ((int64_t)(batch->size() - begin) < chunk_rows && _table_iter->valid()) {
+            ++_scan_rows;
+            // 失败(如ttl过期)时不追加行
+            _table_iter->get_next(_tuple_id, batch);
+        }
+        int64_t decode_rows = batch->size() - begin;
+        int64_t return_rows = decode_rows;
+        if (!_scan_conjuncts.empty() && decode_rows > 0) {
+            std::vector<uint32_t> chunk_selection;
+            chunk_selection.reserve(decode_rows);
+            for (uint32_t i = begin; i < batch->size(); ++i) {
+                chunk_selection.emplace_back(i);
+            }
+            batch->set_selection(chunk_selection);
+            if (filter_column_batch(_scan_conjuncts, batch, _columnar_row.get()) < 0) {
+                DB_WARNING_STATE(state, "filter_column_batch fail");
+                return -1;
+            }
+            return_rows = batch->selected_size();
+            selection.insert(selection.end(), batch->selection().begin(), batch->selection().end());
+            batch->set_selection(selection);
+            state->inc_num_filter_rows(decode_rows - return_rows);
+            index_filter_cnt += decode_rows - return_rows;
+        }
+        _num_rows_returned += return_rows;
+        _num_rows_returned_by_range += return_rows;
+    }
+}
+
 int RocksdbScanNode::get_next_by_table_seek(RuntimeState* state, RowBatch* batch, bool* eos) {
     int64_t index_filter_cnt = 0;
     START_LOCAL_TRACE(get_trace(), state->get_trace_cost(), GET_NEXT_TRACE, ([this, &index_filter_cnt](TraceLocalNode& local_node) {
@@ -1056,43 +1216,9 @@ int RocksdbScanNode::get_next_by_table_seek(RuntimeState* state, RowBatch* batch
                 *eos = true;
                 return 0;
             } else {
-                IndexRange range;
-                if (_use_encoded_key) {
-                    auto key_pair = _scan_range_keys.get_next();
-                    range = IndexRange(key_pair->left_key(),
-                            key_pair->right_key(),
-                            _index_info.get(),
-                            _pri_info.get(),
-                            _region_info,
-                            _left_field_cnts[_idx], 
-                            _right_field_cnts[_idx], 
-                            _left_opens[_idx], 
-                            _right_opens[_idx],
-                            _like_prefixs[_idx]);
-                } else {
-                    range = IndexRange(_left_records[_idx].get(), 
-                            _right_records[_idx].get(), 
-                            _index_info.get(),
-                            _pri_info.get(),
-                            _region_info,
-                            _left_field_cnts[_idx], 
-                            _right_field_cnts[_idx], 
-                            _left_opens[_idx], 
-                            _right_opens[_idx],
-                            _like_prefixs[_idx]);
-                }
-                delete _table_iter;
-                _table_iter = Iterator::scan_primary(
-                        state->txn(), range, _field_ids, _field_slot, state->need_check_region(), _scan_forward);
-                if (_table_iter == nullptr) {
-                    DB_WARNING_STATE(state, "open TableIterator fail, table_id:%ld", _index_id);
+                if (open_next_table_range(state) != 0) {
                     return -1;
                 }
-                if (_is_covering_index) {
-                    _table_iter->set_mode(KEY_ONLY);
-                }
-                _num_rows_returned_by_range = 0;
-                _idx++;
                 continue;
             }
         }
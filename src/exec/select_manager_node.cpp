@@ -22,6 +22,8 @@
 
 namespace baikaldb {
 DEFINE_bool(global_index_read_consistent, true, "double check for global and primary region consistency");
+DECLARE_bool(fetcher_streaming_select);
+DECLARE_int32(fetcher_streaming_queue_batches);
 int SelectManagerNode::open(RuntimeState* state) {
     START_LOCAL_TRACE(get_trace(), state->get_trace_cost(), OPEN_TRACE, ([state](TraceLocalNode& local_node) {
         local_node.set_scan_rows(state->num_scan_rows());
@@ -129,7 +131,11 @@ int SelectManagerNode::get_next(RuntimeState* state, RowBatch* batch, bool* eos)
         return 0;
     }
     int ret = 0;
-    ret = _sorter->get_next(batch, eos);
+    if (_stream_fetcher != nullptr) {
+        ret = stream_get_next(state, batch, eos);
+    } else {
+        ret = _sorter->get_next(batch, eos);
+    }
     if (ret < 0) {
         DB_WARNING("sort get_next fail");
         return ret;
@@ -137,12 +143,121 @@ int SelectManagerNode::get_next(RuntimeState* state, RowBatch* batch, bool* eos)
     _num_rows_returned += batch->size();
     if (reached_limit()) {
         *eos = true;
+        batch->keep_first_rows(batch->size() - (_num_rows_returned - _limit));
         _num_rows_returned = _limit;
+        // 剩余region不再需要，尽早停止store扫描
+        stop_stream_fetcher(state);
         return 0;
     }
     return 0;
 }
 
+int SelectManagerNode::stream_fetcher_run(RuntimeState* state, ScanIndexInfo* scan_index) {
+    stop_stream_fetcher(state);
+    _stream_fetcher.reset(new FetcherInfo);
+    _stream_fetcher->scan_index = scan_index;
+    _stream_queues.clear();
+    _stream_idx = 0;
+    _stream_batch.reset();
+    _stream_ret = 0;
+    // 队列在run之前建立，run期间fetcher_store只读
+    FetcherStore& fetcher_store = _stream_fetcher->fetcher_store;
+    std::multimap<std::string, int64_t> start_key_sort;
+    for (auto& pair : scan_index->region_infos) {
+        start_key_sort.emplace(pair.second.start_key(), pair.first);
+    }
+    for (auto& pair : start_key_sort) {
+        auto queue = std::make_shared<StreamRowQueue>(FLAGS_fetcher_streaming_queue_batches);
+        fetcher_store.stream_queues[pair.second] = queue;
+        _stream_queues.emplace_back(queue);
+    }
+    auto client_conn = state->client_conn();
+    int seq_id = client_conn->seq_id;
+    auto run_func = [this, state, seq_id]() {
+        FetcherStore& fetcher_store = _stream_fetcher->fetcher_store;
+        _stream_ret = fetcher_store.run_not_set_state(state, _stream_fetcher->scan_index->region_infos,
+                _children[0], seq_id, seq_id, pb::OP_SELECT, GBT_INIT);
+        for (auto& queue : _stream_queues) {
+            queue->finish();
+        }
+    };
+    _stream_running = true;
+    _stream_bth.run(run_func);
+    return 0;
+}
+
+int SelectManagerNode::stream_get_next(RuntimeState* state, RowBatch* batch, bool* eos) {
+    *eos = false;
+    FetcherStore& fetcher_store = _stream_fetcher->fetcher_store;
+    while (!batch->is_full() && _stream_idx < _stream_queues.size()) {
+        if (_stream_batch != nullptr && !_stream_batch->is_traverse_over()) {
+            batch->move_row(std::move(_stream_batch->get_row()));
+            _stream_batch->next();
+            continue;
+        }
+        if (state->is_cancelled()) {
+            DB_WARNING_STATE(state, "cancelled");
+            stop_stream_fetcher(state);
+            *eos = true;
+            return 0;
+        }
+        bool region_eos = false;
+        int ret = _stream_queues[_stream_idx]->pop(&_stream_batch, &region_eos, 100 * 1000LL);
+        if (ret != 0) {
+            // 超时先返回已取到的行，避免慢region阻塞已到达的结果
+            if (batch->size() > 0) {
+                return 0;
+            }
+            continue;
+        }
+        if (region_eos) {
+            _stream_batch.reset();
+            ++_stream_idx;
+            if (fetcher_store.error != E_OK) {
+                // 其他region已失败，不再等待剩余region
+                break;
+            }
+            continue;
+        }
+        _stream_batch->reset();
+    }
+    if (_stream_idx < _stream_queues.size() && fetcher_store.error == E_OK) {
+        return 0;
+    }
+    if (_stream_running) {
+        if (fetcher_store.error != E_OK) {
+            // 唤醒阻塞在后续region队列上的接收端
+            fetcher_store.cancel_rpc();
+        }
+        _stream_bth.join();
+        _stream_running = false;
+        fetcher_store.update_state_info(state);
+    }
+    if (_stream_ret < 0) {
+        state->error_code = fetcher_store.error_code;
+        state->error_msg.str("");
+        state->error_msg << fetcher_store.error_msg.str();
+        DB_WARNING("stream fetcher run fail, txn_id: %lu, log_id:%lu, router index_id: %ld",
+                state->txn_id, state->log_id(), _stream_fetcher->scan_index->router_index_id);
+        return -1;
+    }
+    if (_stream_idx >= _stream_queues.size()) {
+        *eos = true;
+    }
+    return 0;
+}
+
+void SelectManagerNode::stop_stream_fetcher(RuntimeState* state) {
+    if (!_stream_running) {
+        return;
+    }
+    // 唤醒阻塞在队列上的接收端，store随stream关闭停止扫描
+    _stream_fetcher->fetcher_store.cancel_rpc();
+    _stream_bth.join();
+    _stream_running = false;
+    _stream_fetcher->fetcher_store.update_state_info(state);
+}
+
 int SelectManagerNode::single_fetcher_store_open(FetcherInfo* fetcher, RuntimeState* state, ExecNode* exec_node) {
     RocksdbScanNode* scan_node = static_cast<RocksdbScanNode*>(exec_node);
     ScanIndexInfo* scan_index_info = fetcher->scan_index;
@@ -220,8 +335,15 @@ int SelectManagerNode::fetcher_store_run(RuntimeState* state, ExecNode* exec_nod
     if (main_scan_index == nullptr) {
         return -1;
     }
+    // 无需排序的非事务select直接扫主表或覆盖索引时，不等全部region完成，交给get_next边收边消费
+    bool can_backup = backup_scan_index != nullptr && dynamic_timeout_ms > 0 && state->txn_id == 0;
+    if (FLAGS_fetcher_streaming_select && state->txn_id == 0 && _slot_order_exprs.empty()
+            && state->explain_type != ANALYZE_STATISTICS && !can_backup
+            && (main_scan_index->router_index_id == scan_node->table_id() || main_scan_index->covering_index)) {
+        return stream_fetcher_run(state, main_scan_index);
+    }
 
-    if (backup_scan_index != nullptr && dynamic_timeout_ms > 0 && state->txn_id == 0) {
+    if (can_backup) {
         // 非事务情况下才进行全局二级索引降级，txn_id != 0 情况下state中会有修改，无法多个请求并发使用state
         // 可以降级
         main_fetcher.scan_index = main_scan_index;
@@ -275,17 +397,23 @@ int SelectManagerNode::fetcher_store_run(RuntimeState* state, ExecNode* exec_nod
         }
     } 
 
+    // 有排序时各region返回的是已排好序的局部top-N，合并时每个region最多取前_limit行
+    bool region_topn = _limit > 0 && !_slot_order_exprs.empty();
     for (auto& pair : fetcher_store->start_key_sort) {
         auto iter = fetcher_store->region_batch.find(pair.second);
         if (iter != fetcher_store->region_batch.end()) {
             auto& batch = iter->second;
             if (batch != nullptr && batch->size() != 0) {
+                if (region_topn) {
+                    batch->keep_first_rows(_limit);
+                }
                 _sorter->add_batch(batch);
             }
             fetcher_store->region_batch.erase(iter);
         }
     }
     // 无sort节点时不会排序，按顺序输出
+    // 各region结果已在内存中，这里只做多路归并，不支持落盘(见sort_spill_enable)
     _sorter->merge_sort();
     return fetcher_store->affected_rows.load();
 
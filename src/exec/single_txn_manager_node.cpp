@@ -27,11 +27,17 @@ int SingleTxnManagerNode::open(RuntimeState* state) {
                 state->txn_id, state->client_conn()->seq_id, log_id);
         return -1;
     }
-    ON_SCOPE_EXIT([client_conn]() {
-        client_conn->on_commit_rollback();        
-    });
     ExecNode* begin_node = _children[0];
     ExecNode* dml_manager_node = _children[1];
+    if (_reuse_plan) {
+        save_origin_children();
+    }
+    ON_SCOPE_EXIT([this, client_conn]() {
+        if (_reuse_plan) {
+            restore_cached_children(client_conn);
+        }
+        client_conn->on_commit_rollback();        
+    });
     ExecNode* prepared_node = _children[2];
     ExecNode* commit_node   = _children[3];
     ExecNode* rollback_node = _children[4];
@@ -55,7 +61,9 @@ int SingleTxnManagerNode::open(RuntimeState* state) {
         _children.erase(_children.begin());
         dml_manager_node->clear_children();
         state->set_single_txn_cached();
-        delete dml_manager_node;
+        if (!_reuse_plan) {
+            delete dml_manager_node;
+        }
     } else {
         has_global_index = true;
         ret = dml_manager_node->open(state);
@@ -112,4 +120,33 @@ void SingleTxnManagerNode::reset(RuntimeState* state) {
     ExecNode::reset(state);
 }
 
+void SingleTxnManagerNode::save_origin_children() {
+    _origin_children = _children;
+    ExecNode* dml_manager_node = _children[1];
+    _origin_dml_node = dml_manager_node->children_size() > 0 ? dml_manager_node->children(0) : nullptr;
+}
+
+void SingleTxnManagerNode::restore_cached_children(NetworkSocket* client_conn) {
+    std::set<ExecNode*> origin_nodes(_origin_children.begin(), _origin_children.end());
+    if (_origin_dml_node != nullptr) {
+        origin_nodes.insert(_origin_dml_node);
+    }
+    // 从连接的cache中摘除，避免on_commit_rollback时被释放
+    for (auto iter = client_conn->cache_plans.begin(); iter != client_conn->cache_plans.end();) {
+        if (origin_nodes.count(iter->second.root) > 0) {
+            iter = client_conn->cache_plans.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    clear_children();
+    for (auto child : _origin_children) {
+        add_child(child);
+    }
+    ExecNode* dml_manager_node = _origin_children[1];
+    if (_origin_dml_node != nullptr && dml_manager_node->children_size() == 0) {
+        dml_manager_node->add_child(_origin_dml_node);
+    }
+}
+
 }
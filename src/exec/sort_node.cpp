@@ -17,6 +17,13 @@
 #include "query_context.h"
 
 namespace baikaldb {
+DEFINE_int64(topn_sort_max_limit, 100000, "use bounded heap for order by limit when offset+limit <= this, default: 100000");
+DEFINE_bool(sort_spill_enable, false, "spill sorted runs to disk when memory is approaching limit, default: false");
+DEFINE_int64(sort_spill_memory_ratio, 80, "spill when memory consumed reach this percent of limit, default: 80");
+DEFINE_int64(sort_spill_threshold_bytes, -1, "spill when rows buffered by one sort node exceed this, default: -1(no limit)");
+DEFINE_int64(sort_spill_min_run_bytes, 16 * 1024 * 1024, "min rows buffered before spilling a sort run, "
+        "avoids one run per batch under global memory pressure, default: 16M");
+
 int SortNode::init(const pb::PlanNode& node) {
     int ret = 0;
     ret = ExecNode::init(node);
@@ -157,32 +164,96 @@ int SortNode::open(RuntimeState* state) {
     _mem_row_desc = state->mem_row_desc();
     _mem_row_compare = std::make_shared<MemRowCompare>(
             _slot_order_exprs, _is_asc, _is_null_first);
-    _sorter = std::make_shared<Sorter>(_mem_row_compare.get());
+    // order by ... limit只需保留前limit行，用有界堆代替全量排序
+    if (_limit > 0 && _limit <= FLAGS_topn_sort_max_limit && !_mem_row_compare->need_not_compare()) {
+        _topn_sorter = std::make_shared<TopNSorter>(_mem_row_compare.get(), _limit);
+    } else {
+        _sorter = std::make_shared<Sorter>(_mem_row_compare.get());
+    }
 
     bool eos = false;
     int count = 0;
+    int64_t buffered_bytes = 0;
+    // 落盘只覆盖SortNode自身缓存的数据。SelectManagerNode归并各region有序结果时，
+    // 数据已由FetcherStore全部收齐在内存中，不落盘；store端select_normal同样整体缓存后回包，
+    // 开启fetcher_streaming_select时store端按分块推送
+    bool can_spill = _sorter != nullptr && FLAGS_sort_spill_enable
+            && !_mem_row_compare->need_not_compare();
+    // 子节点产出列存时，只物化选择向量中的行
+    bool use_columnar = _children[0]->can_produce_columnar() && !state->is_full_export;
+    ColumnBatch column_batch;
     do {
         if (state->is_cancelled()) {
             DB_WARNING_STATE(state, "cancelled");
             return 0;
         }
         std::shared_ptr<RowBatch> batch = std::make_shared<RowBatch>();
-        ret = _children[0]->get_next(state, batch.get(), &eos);
+        if (use_columnar) {
+            column_batch.clear();
+            ret = _children[0]->get_next_columnar(state, &column_batch, &eos);
+            if (ret == 0) {
+                ret = column_batch.to_row_batch(_mem_row_desc, batch.get());
+            }
+            if (ret == 0 && 0 != state->memory_limit_exceeded(count, batch->used_bytes_size())) {
+                DB_WARNING_STATE(state, "memory limit exceeded");
+                return -1;
+            }
+        } else {
+            ret = _children[0]->get_next(state, batch.get(), &eos);
+        }
         if (ret < 0) {
             DB_WARNING_STATE(state, "child->get_next fail, ret:%d", ret);
             return ret;
         }
+        if (use_columnar && batch->size() == 0) {
+            if (eos) {
+                break;
+            }
+            continue;
+        }
         //照理不会出现拿到0行数据
         if (batch->size() == 0) {
             break;
         }
         count += batch->size();
         fill_tuple(batch.get());
-        _sorter->add_batch(batch);
+        if (_topn_sorter != nullptr) {
+            int64_t released_bytes = 0;
+            _topn_sorter->add_batch(batch.get(), &released_bytes);
+            state->memory_limit_release(count, released_bytes);
+        } else {
+            buffered_bytes += batch->used_bytes_size();
+            _sorter->add_batch(batch);
+            if (can_spill && need_spill(state, buffered_bytes)) {
+                ret = spill(state, count);
+                if (ret < 0) {
+                    return ret;
+                }
+                buffered_bytes = 0;
+            }
+        }
     } while (!eos);
     //DB_WARNING_STATE(state, "sort_size:%d", count);
     TimeCost sort_time;
-    _sorter->sort();
+    if (_topn_sorter != nullptr) {
+        _topn_sorter->sort();
+    } else if (_external_sorter != nullptr) {
+        // 剩余数据也落盘，统一走多路归并
+        if (_sorter->batch_size() > 0) {
+            ret = spill(state, count);
+            if (ret < 0) {
+                return ret;
+            }
+        }
+        ret = _external_sorter->merge();
+        if (ret < 0) {
+            DB_WARNING_STATE(state, "external sorter merge fail");
+            return ret;
+        }
+        LOCAL_TRACE_DESC << "spill runs:" << _external_sorter->run_size();
+    } else {
+        _sorter->sort();
+    }
     LOCAL_TRACE_DESC <<  "sort time cost:" << sort_time.get_time() << " rows:" << count;  
     return 0;
 }
@@ -205,6 +276,10 @@ int SortNode::get_next(RuntimeState* state, RowBatch* batch, bool* eos) {
     TimeCost cost;
     if (state->sort_use_index()) {
         ret = _children[0]->get_next(state, batch, eos);
+    } else if (_topn_sorter != nullptr) {
+        ret = _topn_sorter->get_next(batch, eos);
+    } else if (_external_sorter != nullptr) {
+        ret = _external_sorter->get_next(batch, eos);
     } else {
         ret = _sorter->get_next(batch, eos);
     }
@@ -231,6 +306,35 @@ void SortNode::close(RuntimeState* state) {
         expr->close();
     }
     _sorter = nullptr;
+    _topn_sorter = nullptr;
+    _external_sorter = nullptr;
+}
+
+bool SortNode::need_spill(RuntimeState* state, int64_t buffered_bytes) {
+    if (FLAGS_sort_spill_threshold_bytes > 0 && buffered_bytes > FLAGS_sort_spill_threshold_bytes) {
+        return true;
+    }
+    // 全局内存紧张时也要攒够一定数据再落盘，避免每个batch各成一个run
+    if (buffered_bytes < FLAGS_sort_spill_min_run_bytes) {
+        return false;
+    }
+    return state->memory_limit_approaching(FLAGS_sort_spill_memory_ratio);
+}
+
+int SortNode::spill(RuntimeState* state, int count) {
+    if (_external_sorter == nullptr) {
+        _external_sorter = std::make_shared<ExternalSorter>(_mem_row_compare.get(), _mem_row_desc);
+    }
+    int64_t spilled_bytes = 0;
+    int ret = _external_sorter->spill(_sorter.get(), &spilled_bytes);
+    if (ret < 0) {
+        DB_WARNING_STATE(state, "spill sort run fail, runs:%lu", _external_sorter->run_size());
+        return ret;
+    }
+    // 落盘的行已经释放，换一个新的sorter接收后续数据
+    _sorter = std::make_shared<Sorter>(_mem_row_compare.get());
+    state->memory_limit_release(count, spilled_bytes);
+    return 0;
 }
 
 int SortNode::fill_tuple(RowBatch* batch) {
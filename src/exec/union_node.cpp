@@ -17,6 +17,10 @@
 #include "network_socket.h"
 
 namespace baikaldb {
+DEFINE_int32(union_branch_concurrency, 4, "UNION branches executed concurrently for one query, "
+        "1 means sequential, default: 4");
+DEFINE_int32(union_max_queue_batches, 16, "max buffered batches of concurrent UNION branches, default: 16");
+
 int UnionNode::init(const pb::PlanNode& node) {
     int ret = 0;
     ret = ExecNode::init(node);
@@ -64,11 +68,33 @@ int UnionNode::open(RuntimeState* state) {
     _mem_row_desc = state->mem_row_desc();
     _mem_row_compare = std::make_shared<MemRowCompare>(_slot_order_exprs, _is_asc, _is_null_first);
     _sorter = std::make_shared<Sorter>(_mem_row_compare.get());
+    // 事务内的分支共享连接上的事务状态，仍顺序执行
+    _concurrent = FLAGS_union_branch_concurrency > 1 && _children.size() > 1;
+    for (auto runtime_state : _select_runtime_states) {
+        if (runtime_state->txn_id != 0) {
+            _concurrent = false;
+        }
+    }
+    if (_concurrent) {
+        _branches_done = false;
+        _has_error = false;
+        _error_branch = 0;
+        _stop = false;
+        _state_merged = false;
+        _driver_cond.increase();
+        Bthread bth;
+        bth.run([this]() {
+            run_branches();
+            _driver_cond.decrease_signal();
+        });
+        return 0;
+    }
     for (size_t i = 0; i < _children.size(); i++) {
         auto runtime_state = _select_runtime_states[i];
         ret = _children[i]->open(runtime_state);
         if (ret < 0) {
             DB_WARNING("ExecNode::open fail:%d", ret);
+            copy_branch_error(state, runtime_state);
             return ret;
         }
         bool eos = false;
@@ -77,34 +103,137 @@ int UnionNode::open(RuntimeState* state) {
             ret = _children[i]->get_next(runtime_state, &batch, &eos);
             if (ret < 0) {
                 DB_WARNING("children:get_next fail:%d", ret);
+                copy_branch_error(state, runtime_state);
                 return ret;
             }
-            std::shared_ptr<RowBatch> batch_ptr = std::make_shared<RowBatch>();
-            for (batch.reset(); !batch.is_traverse_over(); batch.next()) {
-                MemRow* row = batch.get_row().get();
-                std::unique_ptr<MemRow> dual_row = _mem_row_desc->fetch_mem_row();
-                auto projections = _select_projections[i];
-                for (size_t i = 0; i < projections.size(); i++) {
-                    auto expr = projections[i];
-                    ExprValue result = expr->get_value(row).cast_to(expr->col_type());
-                    auto slot = _tuple_desc->slots(i);
-                    dual_row->set_value(slot.tuple_id(), slot.slot_id(), result);
-                }
-                batch_ptr->move_row(std::move(dual_row));
-            }
+            std::shared_ptr<RowBatch> batch_ptr;
+            project_batch(i, batch, batch_ptr);
             if (batch_ptr->size() != 0) {
                 _sorter->add_batch(batch_ptr);
             }
             runtime_state->inc_num_returned_rows(batch_ptr->size());
         } while (!eos);
-        state->set_num_affected_rows(state->num_affected_rows() + runtime_state->num_affected_rows());
-        state->set_num_scan_rows(state->num_scan_rows() + runtime_state->num_scan_rows());
-        state->set_num_filter_rows(state->num_filter_rows() + runtime_state->num_filter_rows());
-        state->region_count += runtime_state->region_count;
+        merge_branch_state(state, runtime_state);
     }
     return 0;
 }
 
+int UnionNode::project_batch(size_t idx, RowBatch& batch, std::shared_ptr<RowBatch>& batch_ptr) {
+    batch_ptr = std::make_shared<RowBatch>();
+    auto& projections = _select_projections[idx];
+    for (batch.reset(); !batch.is_traverse_over(); batch.next()) {
+        MemRow* row = batch.get_row().get();
+        std::unique_ptr<MemRow> dual_row = _mem_row_desc->fetch_mem_row();
+        for (size_t i = 0; i < projections.size(); i++) {
+            auto expr = projections[i];
+            ExprValue result = expr->get_value(row).cast_to(expr->col_type());
+            auto slot = _tuple_desc->slots(i);
+            dual_row->set_value(slot.tuple_id(), slot.slot_id(), result);
+        }
+        batch_ptr->move_row(std::move(dual_row));
+    }
+    return 0;
+}
+
+void UnionNode::merge_branch_state(RuntimeState* state, RuntimeState* runtime_state) {
+    state->set_num_affected_rows(state->num_affected_rows() + runtime_state->num_affected_rows());
+    state->set_num_scan_rows(state->num_scan_rows() + runtime_state->num_scan_rows());
+    state->set_num_filter_rows(state->num_filter_rows() + runtime_state->num_filter_rows());
+    state->region_count += runtime_state->region_count;
+}
+
+// 错误码和错误信息由分支的RuntimeState填写，需要带回给客户端
+void UnionNode::copy_branch_error(RuntimeState* state, RuntimeState* runtime_state) {
+    if (runtime_state->error_code == ER_ERROR_FIRST) {
+        return;
+    }
+    state->error_code = runtime_state->error_code;
+    state->error_msg.str(runtime_state->error_msg.str());
+}
+
+void UnionNode::run_branches() {
+    ConcurrencyBthread branch_bth(FLAGS_union_branch_concurrency);
+    for (size_t i = 0; i < _children.size(); i++) {
+        {
+            std::unique_lock<bthread::Mutex> lck(_mutex);
+            if (_stop || _has_error) {
+                break;
+            }
+        }
+        branch_bth.run([this, i]() {
+            run_branch(i);
+        });
+    }
+    branch_bth.join();
+    std::unique_lock<bthread::Mutex> lck(_mutex);
+    _branches_done = true;
+    _cv.notify_all();
+}
+
+void UnionNode::run_branch(size_t idx) {
+    auto runtime_state = _select_runtime_states[idx];
+    int ret = _children[idx]->open(runtime_state);
+    if (ret < 0) {
+        DB_WARNING("ExecNode::open fail:%d, branch: %lu", ret, idx);
+        set_branch_error(idx);
+        return;
+    }
+    bool eos = false;
+    do {
+        RowBatch batch;
+        ret = _children[idx]->get_next(runtime_state, &batch, &eos);
+        if (ret < 0) {
+            DB_WARNING("children:get_next fail:%d, branch: %lu", ret, idx);
+            set_branch_error(idx);
+            return;
+        }
+        std::shared_ptr<RowBatch> batch_ptr;
+        project_batch(idx, batch, batch_ptr);
+        runtime_state->inc_num_returned_rows(batch_ptr->size());
+        if (batch_ptr->size() != 0 && !push_batch(batch_ptr)) {
+            return;
+        }
+    } while (!eos);
+}
+
+// 只记录第一个失败的分支，其余分支随之停止
+void UnionNode::set_branch_error(size_t idx) {
+    std::unique_lock<bthread::Mutex> lck(_mutex);
+    if (!_has_error) {
+        _has_error = true;
+        _error_branch = idx;
+    }
+    _cv.notify_all();
+}
+
+// 队列满时等待消费，返回false表示已停止
+bool UnionNode::push_batch(std::shared_ptr<RowBatch> batch_ptr) {
+    std::unique_lock<bthread::Mutex> lck(_mutex);
+    while (!_stop && !_has_error
+            && _batch_queue.size() >= (size_t)std::max(FLAGS_union_max_queue_batches, 1)) {
+        _cv.wait(lck);
+    }
+    if (_stop || _has_error) {
+        return false;
+    }
+    _batch_queue.emplace_back(batch_ptr);
+    _cv.notify_all();
+    return true;
+}
+
+void UnionNode::stop_branches() {
+    if (!_concurrent) {
+        return;
+    }
+    {
+        std::unique_lock<bthread::Mutex> lck(_mutex);
+        _stop = true;
+        _cv.notify_all();
+    }
+    _driver_cond.wait();
+    _batch_queue.clear();
+}
+
 int UnionNode::get_next(RuntimeState* state, RowBatch* batch, bool* eos) {
     if (state->is_cancelled()) {
         DB_WARNING_STATE(state, "cancelled");
@@ -116,14 +245,47 @@ int UnionNode::get_next(RuntimeState* state, RowBatch* batch, bool* eos) {
         return 0;
     }
     int ret = 0;
-    ret = _sorter->get_next(batch, eos);
-    if (ret < 0) {
-        DB_WARNING("sort get_next fail");
-        return ret;
+    if (_concurrent) {
+        std::shared_ptr<RowBatch> batch_ptr;
+        {
+            std::unique_lock<bthread::Mutex> lck(_mutex);
+            while (_batch_queue.empty() && !_branches_done && !_has_error) {
+                _cv.wait(lck);
+            }
+            if (_has_error) {
+                DB_WARNING("union branch fail, branch: %lu", _error_branch);
+                copy_branch_error(state, _select_runtime_states[_error_branch]);
+                return -1;
+            }
+            if (!_batch_queue.empty()) {
+                batch_ptr = _batch_queue.front();
+                _batch_queue.pop_front();
+                _cv.notify_all();
+            }
+        }
+        if (batch_ptr == nullptr) {
+            // 所有分支都已结束，统计信息无并发写
+            if (!_state_merged) {
+                for (auto runtime_state : _select_runtime_states) {
+                    merge_branch_state(state, runtime_state);
+                }
+                _state_merged = true;
+            }
+            *eos = true;
+            return 0;
+        }
+        batch->swap(*batch_ptr);
+    } else {
+        ret = _sorter->get_next(batch, eos);
+        if (ret < 0) {
+            DB_WARNING("sort get_next fail");
+            return ret;
+        }
     }
     _num_rows_returned += batch->size();
     if (reached_limit()) {
         *eos = true;
+        batch->keep_first_rows(batch->size() - (_num_rows_returned - _limit));
         _num_rows_returned = _limit;
         return 0;
     }
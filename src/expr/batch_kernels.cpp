@@ -0,0 +1,368 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "batch_kernels.h"
+
+namespace baikaldb {
+namespace batch_kernels {
+namespace {
+// 纯数值类型(不含时间类型)，列内存值即数值本身
+bool is_plain_number(pb::PrimitiveType type) {
+    switch (type) {
+        case pb::BOOL:
+        case pb::INT8:
+        case pb::INT16:
+        case pb::INT32:
+        case pb::INT64:
+        case pb::UINT8:
+        case pb::UINT16:
+        case pb::UINT32:
+        case pb::UINT64:
+        case pb::FLOAT:
+        case pb::DOUBLE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+template <typename From>
+const From* column_data(const ColumnVector& column);
+template <>
+const int64_t* column_data<int64_t>(const ColumnVector& column) {
+    return column.int_data();
+}
+template <>
+const uint64_t* column_data<uint64_t>(const ColumnVector& column) {
+    return column.uint_data();
+}
+template <>
+const double* column_data<double>(const ColumnVector& column) {
+    return column.double_data();
+}
+
+template <typename To>
+To* mutable_column_data(ColumnVector* column);
+template <>
+int64_t* mutable_column_data<int64_t>(ColumnVector* column) {
+    return column->mutable_int_data();
+}
+template <>
+uint64_t* mutable_column_data<uint64_t>(ColumnVector* column) {
+    return column->mutable_uint_data();
+}
+template <>
+double* mutable_column_data<double>(ColumnVector* column) {
+    return column->mutable_double_data();
+}
+
+template <typename From, typename To>
+void convert_loop(const ColumnBatch* batch, const ColumnVector& src, ColumnVector* dst) {
+    const From* in = column_data<From>(src);
+    const uint8_t* in_null = src.null_map();
+    To* out = mutable_column_data<To>(dst);
+    uint8_t* out_null = dst->mutable_null_map();
+    size_t num_rows = batch->selected_size();
+    if (!batch->use_selection()) {
+        for (size_t i = 0; i < num_rows; ++i) {
+            out[i] = static_cast<To>(in[i]);
+            out_null[i] = in_null[i];
+        }
+        return;
+    }
+    const uint32_t* sel = batch->selection().data();
+    for (size_t i = 0; i < num_rows; ++i) {
+        uint32_t idx = sel[i];
+        out[idx] = static_cast<To>(in[idx]);
+        out_null[idx] = in_null[idx];
+    }
+}
+
+template <typename To>
+void convert_from(const ColumnBatch* batch, const ColumnVector& src, ColumnVector* dst) {
+    switch (src.category()) {
+        case ColumnVector::INT_COLUMN:
+            convert_loop<int64_t, To>(batch, src, dst);
+            break;
+        case ColumnVector::UINT_COLUMN:
+            convert_loop<uint64_t, To>(batch, src, dst);
+            break;
+        default:
+            convert_loop<double, To>(batch, src, dst);
+            break;
+    }
+}
+
+template <typename T, typename Op>
+void compare_loop(const ColumnBatch* batch, const T* l, const T* r,
+        const uint8_t* l_null, const uint8_t* r_null,
+        int64_t* out, uint8_t* out_null, Op op) {
+    size_t num_rows = batch->selected_size();
+    if (!batch->use_selection()) {
+        for (size_t i = 0; i < num_rows; ++i) {
+            out[i] = op(l[i], r[i]);
+            out_null[i] = l_null[i] | r_null[i];
+        }
+        return;
+    }
+    const uint32_t* sel = batch->selection().data();
+    for (size_t i = 0; i < num_rows; ++i) {
+        uint32_t idx = sel[i];
+        out[idx] = op(l[idx], r[idx]);
+        out_null[idx] = l_null[idx] | r_null[idx];
+    }
+}
+
+template <typename T>
+void compare_typed(CompareOp op, const ColumnBatch* batch, const T* l, const T* r,
+        const uint8_t* l_null, const uint8_t* r_null, int64_t* out, uint8_t* out_null) {
+    switch (op) {
+        case CMP_EQ:
+            compare_loop(batch, l, r, l_null, r_null, out, out_null,
+                    [](const T& a, const T& b) { return a == b; });
+            break;
+        case CMP_NE:
+            compare_loop(batch, l, r, l_null, r_null, out, out_null,
+                    [](const T& a, const T& b) { return a != b; });
+            break;
+        case CMP_GT:
+            compare_loop(batch, l, r, l_null, r_null, out, out_null,
+                    [](const T& a, const T& b) { return a > b; });
+            break;
+        case CMP_GE:
+            compare_loop(batch, l, r, l_null, r_null, out, out_null,
+                    [](const T& a, const T& b) { return a >= b; });
+            break;
+        case CMP_LT:
+            compare_loop(batch, l, r, l_null, r_null, out, out_null,
+                    [](const T& a, const T& b) { return a < b; });
+            break;
+        case CMP_LE:
+            compare_loop(batch, l, r, l_null, r_null, out, out_null,
+                    [](const T& a, const T& b) { return a <= b; });
+            break;
+    }
+}
+
+template <typename T, typename Op>
+void arith_loop(const ColumnBatch* batch, const T* l, const T* r,
+        const uint8_t* l_null, const uint8_t* r_null,
+        T* out, uint8_t* out_null, Op op) {
+    size_t num_rows = batch->selected_size();
+    if (!batch->use_selection()) {
+        for (size_t i = 0; i < num_rows; ++i) {
+            out[i] = op(l[i], r[i]);
+            out_null[i] = l_null[i] | r_null[i];
+        }
+        return;
+    }
+    const uint32_t* sel = batch->selection().data();
+    for (size_t i = 0; i < num_rows; ++i) {
+        uint32_t idx = sel[i];
+        out[idx] = op(l[idx], r[idx]);
+        out_null[idx] = l_null[idx] | r_null[idx];
+    }
+}
+
+// 除数为0的行置null，除法只在非0行上执行，避免整型除0
+template <typename T>
+void divide_loop(const ColumnBatch* batch, const T* l, const T* r,
+        const uint8_t* l_null, const uint8_t* r_null, T* out, uint8_t* out_null) {
+    size_t num_rows = batch->selected_size();
+    for (size_t i = 0; i < num_rows; ++i) {
+        uint32_t idx = batch->selected_row(i);
+        bool zero = (r[idx] == 0);
+        out_null[idx] = l_null[idx] | r_null[idx] | zero;
+        out[idx] = zero ? 0 : l[idx] / r[idx];
+    }
+}
+
+template <typename T>
+void arithmetic_typed(ArithOp op, const ColumnBatch* batch, const ColumnVector& left,
+        const ColumnVector& right, ColumnVector* result) {
+    const T* l = column_data<T>(left);
+    const T* r = column_data<T>(right);
+    T* out = mutable_column_data<T>(result);
+    uint8_t* out_null = result->mutable_null_map();
+    switch (op) {
+        case ARITH_ADD:
+            arith_loop(batch, l, r, left.null_map(), right.null_map(), out, out_null,
+                    [](const T& a, const T& b) { return a + b; });
+            break;
+        case ARITH_MINUS:
+            arith_loop(batch, l, r, left.null_map(), right.null_map(), out, out_null,
+                    [](const T& a, const T& b) { return a - b; });
+            break;
+        case ARITH_MULTIPLIES:
+            arith_loop(batch, l, r, left.null_map(), right.null_map(), out, out_null,
+                    [](const T& a, const T& b) { return a * b; });
+            break;
+        case ARITH_DIVIDES:
+            divide_loop(batch, l, r, left.null_map(), right.null_map(), out, out_null);
+            break;
+    }
+}
+}
+
+int cast_column(const ColumnBatch* batch, const ColumnVector& src,
+        pb::PrimitiveType type, ColumnVector* dst) {
+    if (src.size() < batch->size()) {
+        DB_WARNING("column size: %lu < batch size: %lu", src.size(), batch->size());
+        return -1;
+    }
+    dst->reset(type, batch->size());
+    size_t num_rows = batch->selected_size();
+    if (src.type() == type || (is_plain_number(src.type()) &&
+            (type == pb::INT64 || type == pb::UINT64 || type == pb::DOUBLE))) {
+        switch (dst->category()) {
+            case ColumnVector::INT_COLUMN:
+                convert_from<int64_t>(batch, src, dst);
+                return 0;
+            case ColumnVector::UINT_COLUMN:
+                convert_from<uint64_t>(batch, src, dst);
+                return 0;
+            case ColumnVector::DOUBLE_COLUMN:
+                convert_from<double>(batch, src, dst);
+                return 0;
+            default:
+                break;
+        }
+    }
+    if (src.type() == type && src.category() == ColumnVector::STRING_COLUMN) {
+        const std::string* in = src.string_data();
+        const uint8_t* in_null = src.null_map();
+        std::string* out = dst->mutable_string_data();
+        uint8_t* out_null = dst->mutable_null_map();
+        for (size_t i = 0; i < num_rows; ++i) {
+            uint32_t idx = batch->selected_row(i);
+            out_null[idx] = in_null[idx];
+            if (in_null[idx] == 0) {
+                out[idx] = in[idx];
+            }
+        }
+        return 0;
+    }
+    // 时间、字符串等需要编码转换的走逐行cast
+    for (size_t i = 0; i < num_rows; ++i) {
+        uint32_t idx = batch->selected_row(i);
+        ExprValue value = src.get_value(idx);
+        dst->set_value(idx, value.cast_to(type));
+    }
+    return 0;
+}
+
+void fill_constant(const ColumnBatch* batch, const ExprValue& value, ColumnVector* dst) {
+    pb::PrimitiveType type = value.is_null() ? pb::NULL_TYPE : value.type;
+    dst->reset(type, batch->size());
+    if (value.is_null()) {
+        return;
+    }
+    size_t num_rows = batch->selected_size();
+    for (size_t i = 0; i < num_rows; ++i) {
+        dst->set_value(batch->selected_row(i), value);
+    }
+}
+
+bool support_compare(pb::PrimitiveType type) {
+    switch (type) {
+        case pb::INT64:
+        case pb::UINT64:
+        case pb::DOUBLE:
+        case pb::DATETIME:
+        case pb::TIMESTAMP:
+        case pb::DATE:
+        case pb::TIME:
+        case pb::STRING:
+            return true;
+        default:
+            return false;
+    }
+}
+
+int compare(CompareOp op, const ColumnBatch* batch, const ColumnVector& left,
+        const ColumnVector& right, ColumnVector* result) {
+    if (left.type() != right.type() || !support_compare(left.type())) {
+        DB_WARNING("unsupported compare type: %d, %d", left.type(), right.type());
+        return -1;
+    }
+    result->reset(pb::BOOL, batch->size());
+    int64_t* out = result->mutable_int_data();
+    uint8_t* out_null = result->mutable_null_map();
+    switch (left.category()) {
+        case ColumnVector::INT_COLUMN:
+            compare_typed(op, batch, left.int_data(), right.int_data(),
+                    left.null_map(), right.null_map(), out, out_null);
+            break;
+        case ColumnVector::UINT_COLUMN:
+            compare_typed(op, batch, left.uint_data(), right.uint_data(),
+                    left.null_map(), right.null_map(), out, out_null);
+            break;
+        case ColumnVector::DOUBLE_COLUMN:
+            compare_typed(op, batch, left.double_data(), right.double_data(),
+                    left.null_map(), right.null_map(), out, out_null);
+            break;
+        case ColumnVector::STRING_COLUMN:
+            compare_typed(op, batch, left.string_data(), right.string_data(),
+                    left.null_map(), right.null_map(), out, out_null);
+            break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+bool support_arithmetic(pb::PrimitiveType type) {
+    return type == pb::INT64 || type == pb::UINT64 || type == pb::DOUBLE;
+}
+
+int arithmetic(ArithOp op, const ColumnBatch* batch, const ColumnVector& left,
+        const ColumnVector& right, ColumnVector* result) {
+    if (left.type() != right.type() || !support_arithmetic(left.type())) {
+        DB_WARNING("unsupported arithmetic type: %d, %d", left.type(), right.type());
+        return -1;
+    }
+    result->reset(left.type(), batch->size());
+    switch (left.category()) {
+        case ColumnVector::INT_COLUMN:
+            arithmetic_typed<int64_t>(op, batch, left, right, result);
+            break;
+        case ColumnVector::UINT_COLUMN:
+            arithmetic_typed<uint64_t>(op, batch, left, right, result);
+            break;
+        default:
+            arithmetic_typed<double>(op, batch, left, right, result);
+            break;
+    }
+    return 0;
+}
+
+bool is_true(const ColumnVector& column, size_t idx) {
+    if (column.is_null(idx)) {
+        return false;
+    }
+    switch (column.category()) {
+        case ColumnVector::INT_COLUMN:
+            return column.int_data()[idx] != 0;
+        case ColumnVector::UINT_COLUMN:
+            return column.uint_data()[idx] != 0;
+        case ColumnVector::DOUBLE_COLUMN:
+            return column.double_data()[idx] != 0;
+        default:
+            return column.get_value(idx).get_numberic<bool>();
+    }
+}
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
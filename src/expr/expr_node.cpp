@@ -19,6 +19,7 @@
 #include "agg_fn_call.h"
 #include "slot_ref.h"
 #include "row_expr.h"
+#include "batch_kernels.h"
 
 namespace baikaldb {
 bvar::Adder<int64_t> ExprNode::_s_non_boolean_sql_cnts{"non_boolean_sql_cnts"};
@@ -96,6 +97,36 @@ void ExprNode::const_pre_calc() {
     }
 }
 
+int ExprNode::get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result) {
+    result->reset(_col_type, batch->size());
+    if (row == nullptr) {
+        DB_WARNING("row is null, expr can not fallback to get_value");
+        return -1;
+    }
+    size_t num_rows = batch->selected_size();
+    for (size_t i = 0; i < num_rows; ++i) {
+        uint32_t row_idx = batch->selected_row(i);
+        if (batch->fill_row(row_idx, row) < 0) {
+            return -1;
+        }
+        result->set_value(row_idx, get_value(row));
+    }
+    return 0;
+}
+
+int SlotRef::get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result) {
+    ColumnVector* column = batch->get_column(_tuple_id, _slot_id);
+    if (column == nullptr || _col_type == pb::INVALID_TYPE || _col_type == pb::NULL_TYPE) {
+        return ExprNode::get_batch_value(batch, row, result);
+    }
+    return batch_kernels::cast_column(batch, *column, _col_type, result);
+}
+
+int Literal::get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result) {
+    batch_kernels::fill_constant(batch, _value.cast_to(_col_type), result);
+    return 0;
+}
+
 ExprNode* ExprNode::get_slot_ref(int32_t tuple_id, int32_t slot_id) {
     if (_node_type == pb::SLOT_REF) {
         if (static_cast<SlotRef*>(this)->tuple_id() == tuple_id &&
@@ -399,6 +430,10 @@ int ExprNode::create_expr_node(const pb::ExprNode& node, ExprNode** expr_node) {
             *expr_node = new RegexpPredicate;
             (*expr_node)->init(node);
             return 0;
+        case pb::BLOOM_FILTER_PREDICATE:
+            *expr_node = new BloomFilterPredicate;
+            (*expr_node)->init(node);
+            return 0;
         case pb::FUNCTION_CALL:
             *expr_node = new ScalarFnCall;
             (*expr_node)->init(node);
@@ -14,6 +14,8 @@
 
 #include "predicate.h"
 #include "parser.h"
+#include "batch_kernels.h"
+#include "mut_table_key.h"
 #include <boost/algorithm/string.hpp>
 
 namespace baikaldb {
@@ -184,6 +186,158 @@ ExprValue InPredicate::get_value(MemRow* row) {
     return _has_null ? ExprValue::Null() : ExprValue::False();
 }
 
+int InPredicate::get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result) {
+    if (_is_row_expr) {
+        return ExprNode::get_batch_value(batch, row, result);
+    }
+    switch (_map_type) {
+        case pb::INT64:
+        case pb::TIMESTAMP:
+        case pb::DATETIME:
+        case pb::TIME:
+        case pb::DATE:
+        case pb::DOUBLE:
+        case pb::STRING:
+            break;
+        default:
+            return ExprNode::get_batch_value(batch, row, result);
+    }
+    ColumnVector value(_map_type);
+    int ret = get_child_batch_value(0, _map_type, batch, row, &value);
+    if (ret < 0) {
+        return ret;
+    }
+    result->reset(pb::BOOL, batch->size());
+    int64_t* out = result->mutable_int_data();
+    uint8_t* out_null = result->mutable_null_map();
+    size_t num_rows = batch->selected_size();
+    for (size_t i = 0; i < num_rows; ++i) {
+        uint32_t idx = batch->selected_row(i);
+        if (value.is_null(idx)) {
+            continue;
+        }
+        bool found = false;
+        switch (value.category()) {
+            case ColumnVector::INT_COLUMN:
+                found = _int_set.count(value.int_data()[idx]) == 1;
+                break;
+            case ColumnVector::UINT_COLUMN:
+                found = _int_set.count((int64_t)value.uint_data()[idx]) == 1;
+                break;
+            case ColumnVector::DOUBLE_COLUMN:
+                found = _double_set.count(value.double_data()[idx]) == 1;
+                break;
+            default:
+                found = _str_set.count(value.string_data()[idx]) == 1;
+                break;
+        }
+        if (found) {
+            out[idx] = 1;
+            out_null[idx] = 0;
+        } else if (!_has_null) {
+            out[idx] = 0;
+            out_null[idx] = 0;
+        }
+    }
+    return 0;
+}
+
+int AndPredicate::get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result) {
+    result->reset(pb::BOOL, batch->size());
+    int64_t* out = result->mutable_int_data();
+    uint8_t* out_null = result->mutable_null_map();
+    size_t num_rows = batch->selected_size();
+    for (size_t i = 0; i < num_rows; ++i) {
+        uint32_t idx = batch->selected_row(i);
+        out[idx] = 1;
+        out_null[idx] = 0;
+    }
+    // 出现false即为false，否则出现null为null
+    for (int c = 0; c < children_size(); c++) {
+        ColumnVector value(_children[c]->col_type());
+        int ret = _children[c]->get_batch_value(batch, row, &value);
+        if (ret < 0) {
+            return ret;
+        }
+        for (size_t i = 0; i < num_rows; ++i) {
+            uint32_t idx = batch->selected_row(i);
+            if (value.is_null(idx)) {
+                out_null[idx] = out[idx] != 0;
+            } else if (!batch_kernels::is_true(value, idx)) {
+                out[idx] = 0;
+                out_null[idx] = 0;
+            }
+        }
+    }
+    return 0;
+}
+
+int OrPredicate::get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result) {
+    result->reset(pb::BOOL, batch->size());
+    int64_t* out = result->mutable_int_data();
+    uint8_t* out_null = result->mutable_null_map();
+    size_t num_rows = batch->selected_size();
+    for (size_t i = 0; i < num_rows; ++i) {
+        uint32_t idx = batch->selected_row(i);
+        out[idx] = 0;
+        out_null[idx] = 0;
+    }
+    // 出现true即为true，否则出现null为null
+    for (int c = 0; c < children_size(); c++) {
+        ColumnVector value(_children[c]->col_type());
+        int ret = _children[c]->get_batch_value(batch, row, &value);
+        if (ret < 0) {
+            return ret;
+        }
+        for (size_t i = 0; i < num_rows; ++i) {
+            uint32_t idx = batch->selected_row(i);
+            if (value.is_null(idx)) {
+                out_null[idx] = out[idx] == 0;
+            } else if (batch_kernels::is_true(value, idx)) {
+                out[idx] = 1;
+                out_null[idx] = 0;
+            }
+        }
+    }
+    return 0;
+}
+
+int IsNullPredicate::get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result) {
+    ColumnVector value(_children[0]->col_type());
+    int ret = _children[0]->get_batch_value(batch, row, &value);
+    if (ret < 0) {
+        return ret;
+    }
+    result->reset(pb::BOOL, batch->size());
+    int64_t* out = result->mutable_int_data();
+    uint8_t* out_null = result->mutable_null_map();
+    size_t num_rows = batch->selected_size();
+    for (size_t i = 0; i < num_rows; ++i) {
+        uint32_t idx = batch->selected_row(i);
+        out[idx] = value.is_null(idx);
+        out_null[idx] = 0;
+    }
+    return 0;
+}
+
+int NotPredicate::get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result) {
+    ColumnVector value(_children[0]->col_type());
+    int ret = _children[0]->get_batch_value(batch, row, &value);
+    if (ret < 0) {
+        return ret;
+    }
+    result->reset(pb::BOOL, batch->size());
+    int64_t* out = result->mutable_int_data();
+    uint8_t* out_null = result->mutable_null_map();
+    size_t num_rows = batch->selected_size();
+    for (size_t i = 0; i < num_rows; ++i) {
+        uint32_t idx = batch->selected_row(i);
+        out_null[idx] = value.is_null(idx);
+        out[idx] = !batch_kernels::is_true(value, idx);
+    }
+    return 0;
+}
+
 void LikePredicate::reset_pattern(MemRow* row) {
     _pattern = children(1)->get_value(row).get_string();
 }
@@ -498,6 +652,41 @@ ExprValue RegexpPredicate::get_value(MemRow* row) {
     return ret;
 }
 
+int BloomFilterPredicate::open() {
+    int ret = 0;
+    ret = ExprNode::open();
+    if (ret < 0) {
+        DB_WARNING("ExprNode::open fail:%d", ret);
+        return ret;
+    }
+    if (children_size() < 2 || !_children.back()->is_literal()) {
+        DB_WARNING("BloomFilterPredicate _children.size:%lu", _children.size());
+        return -1;
+    }
+    ExprValue filter = _children.back()->get_value(nullptr);
+    if (!_bloom_filter.init_from_string(filter.str_val)) {
+        DB_WARNING("invalid bloom filter, size:%lu", filter.str_val.size());
+        return -1;
+    }
+    return 0;
+}
+
+ExprValue BloomFilterPredicate::get_value(MemRow* row) {
+    // 与Joiner::encode_hash_key编码一致
+    MutTableKey key;
+    for (size_t i = 0; i + 1 < _children.size(); i++) {
+        ExprValue value = _children[i]->get_value(row);
+        if (value.is_null()) {
+            return ExprValue::False();
+        }
+        key.append_value(value.cast_to(pb::STRING));
+    }
+    if (_bloom_filter.may_contain_hash(BloomFilter::hash(key.data()))) {
+        return ExprValue::True();
+    }
+    return ExprValue::False();
+}
+
 size_t LikePredicate::UTF8Charset::get_char_size(size_t idx) {
     size_t num = 1;
     while (++idx < str.size() && (str[idx] & 0xC0) == 0x80) {
@@ -17,6 +17,7 @@
 #include "row_expr.h"
 #include "literal.h"
 #include "parser.h"
+#include "batch_kernels.h"
 
 namespace baikaldb {
 DEFINE_bool(open_nonboolean_sql_forbid, false, "open nonboolean sqls forbid default:false");
@@ -237,5 +238,97 @@ ExprValue ScalarFnCall::get_value(const ExprValue& value) {
     return _fn_call(args).cast_to(_col_type);
 }
 
+int ScalarFnCall::get_child_batch_value(size_t idx, pb::PrimitiveType type,
+        ColumnBatch* batch, MemRow* row, ColumnVector* column) {
+    ColumnVector value(type);
+    int ret = _children[idx]->get_batch_value(batch, row, &value);
+    if (ret < 0) {
+        return ret;
+    }
+    if (value.type() == type) {
+        *column = std::move(value);
+        return 0;
+    }
+    return batch_kernels::cast_column(batch, value, type, column);
+}
+
+int ScalarFnCall::get_batch_value(ColumnBatch* batch, MemRow* row, ColumnVector* result) {
+    if (_is_row_expr || _fn_call == NULL || _children.size() != 2 ||
+            _fn.arg_types_size() != 2 || _fn.arg_types(0) != _fn.arg_types(1)) {
+        return ExprNode::get_batch_value(batch, row, result);
+    }
+    pb::PrimitiveType arg_type = _fn.arg_types(0);
+    bool is_compare = true;
+    batch_kernels::CompareOp cmp_op = batch_kernels::CMP_EQ;
+    batch_kernels::ArithOp arith_op = batch_kernels::ARITH_ADD;
+    switch (_fn.fn_op()) {
+        case parser::FT_EQ:
+            cmp_op = batch_kernels::CMP_EQ;
+            break;
+        case parser::FT_NE:
+            cmp_op = batch_kernels::CMP_NE;
+            break;
+        case parser::FT_GT:
+            cmp_op = batch_kernels::CMP_GT;
+            break;
+        case parser::FT_GE:
+            cmp_op = batch_kernels::CMP_GE;
+            break;
+        case parser::FT_LT:
+            cmp_op = batch_kernels::CMP_LT;
+            break;
+        case parser::FT_LE:
+            cmp_op = batch_kernels::CMP_LE;
+            break;
+        case parser::FT_ADD:
+            is_compare = false;
+            arith_op = batch_kernels::ARITH_ADD;
+            break;
+        case parser::FT_MINUS:
+            is_compare = false;
+            arith_op = batch_kernels::ARITH_MINUS;
+            break;
+        case parser::FT_MULTIPLIES:
+            is_compare = false;
+            arith_op = batch_kernels::ARITH_MULTIPLIES;
+            break;
+        case parser::FT_DIVIDES:
+            is_compare = false;
+            arith_op = batch_kernels::ARITH_DIVIDES;
+            break;
+        default:
+            return ExprNode::get_batch_value(batch, row, result);
+    }
+    bool support = is_compare ? batch_kernels::support_compare(arg_type) :
+            batch_kernels::support_arithmetic(arg_type);
+    if (!support) {
+        return ExprNode::get_batch_value(batch, row, result);
+    }
+    ColumnVector left(arg_type);
+    ColumnVector right(arg_type);
+    int ret = get_child_batch_value(0, arg_type, batch, row, &left);
+    if (ret < 0) {
+        return ret;
+    }
+    ret = get_child_batch_value(1, arg_type, batch, row, &right);
+    if (ret < 0) {
+        return ret;
+    }
+    ColumnVector value(_fn.return_type());
+    ColumnVector* output = (_col_type == _fn.return_type()) ? result : &value;
+    if (is_compare) {
+        ret = batch_kernels::compare(cmp_op, batch, left, right, output);
+    } else {
+        ret = batch_kernels::arithmetic(arith_op, batch, left, right, output);
+    }
+    if (ret < 0) {
+        return ret;
+    }
+    if (output != result) {
+        return batch_kernels::cast_column(batch, value, _col_type, result);
+    }
+    return 0;
+}
+
 }
 /* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -35,26 +35,32 @@ int KillPlanner::plan() {
     kill->set_db_conn_id(db_conn_id);
     kill->set_is_query(k->is_query);
 
-    EpollInfo* epoll_info = NetworkServer::get_instance()->get_epoll_info();
     DB_WARNING("kill %ld", k->conn_id);
-    for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-        SmartSocket sock = epoll_info->get_fd_mapping(idx);
-        if (sock == NULL || sock->is_free || sock->fd == -1 || sock->ip == "") {
+    // 连接只注册在accept它的reactor上，client_free需要使用对应的EpollInfo
+    for (auto epoll_info : NetworkServer::get_instance()->get_epoll_infos()) {
+        SmartSocket sock;
+        epoll_info->traverse_fd_mapping([&sock, k](const SmartSocket& s) {
+            if (sock != nullptr || s->is_free || s->fd == -1 || s->ip == "") {
+                return;
+            }
+            if (s->conn_id == k->conn_id) {
+                sock = s;
+            }
+        });
+        if (sock == nullptr) {
             continue;
         }
-        if (sock->conn_id == k->conn_id) {
-            DB_WARNING("conn_id equal %ld is_query:%d", k->conn_id, k->is_query);
-            _ctx->kill_ctx = sock->query_ctx;
-            _ctx->kill_ctx->kill_all_ctx();
-            // kill xxx 复用client_free,会导致被kill的sock的DataBuffer被继续占用，导致下一次建立连接失败
-            // 但是kill指令用的很少，后续再考虑优化
-            // kill query xx没问题
-            if (!k->is_query) {
-//                client->state = STATE_ERROR;
-                StateMachine::get_instance()->client_free(sock, epoll_info);
-            }
-            break;
+        DB_WARNING("conn_id equal %ld is_query:%d", k->conn_id, k->is_query);
+        _ctx->kill_ctx = sock->query_ctx;
+        _ctx->kill_ctx->kill_all_ctx();
+        // kill xxx 复用client_free,会导致被kill的sock的DataBuffer被继续占用，导致下一次建立连接失败
+        // 但是kill指令用的很少，后续再考虑优化
+        // kill query xx没问题
+        if (!k->is_query) {
+//            client->state = STATE_ERROR;
+            StateMachine::get_instance()->client_free(sock, epoll_info);
         }
+        break;
     }
     return 0;
 }
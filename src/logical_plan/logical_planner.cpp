@@ -41,6 +41,7 @@ DECLARE_int32(bthread_concurrency); //bthread.cpp
 
 namespace baikaldb {
 DECLARE_string(log_plat_name);
+DECLARE_bool(enable_plan_cache);
 
 std::map<parser::JoinType, pb::JoinType> LogicalPlanner::join_type_mapping {
         { parser::JT_NONE, pb::NULL_JOIN},    
@@ -334,6 +335,12 @@ int LogicalPlanner::analyze(QueryContext* ctx) {
         }
         return 0;
     }
+    if (FLAGS_enable_plan_cache && ctx->mysql_cmd == COM_QUERY) {
+        int ret = PreparePlanner(ctx).plan_cache_execute();
+        if (ret <= 0) {
+            return ret;
+        }
+    }
     parser::SqlParser parser;
     parser.charset = ctx->charset;
     parser.parse(ctx->sql);
@@ -0,0 +1,335 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "plan_cache.h"
+#include <cerrno>
+#include <cstdlib>
+#include <boost/algorithm/string.hpp>
+
+namespace baikaldb {
+DEFINE_bool(enable_plan_cache, false, "cache logical plan of text protocol select/dml, default: false");
+DEFINE_int64(plan_cache_capacity, 10000, "max plans cached by plan cache, default: 1w");
+DEFINE_int64(plan_cache_failed_expire_s, 60, "retry building plan template after it failed, default: 60s");
+bvar::Adder<int64_t> PlanCache::plan_cache_hit {"plan_cache_hit"};
+bvar::Adder<int64_t> PlanCache::plan_cache_miss {"plan_cache_miss"};
+
+static double get_plan_cache_hit_ratio(void*) {
+    int64_t hit = PlanCache::plan_cache_hit.get_value();
+    int64_t total = hit + PlanCache::plan_cache_miss.get_value();
+    if (total == 0) {
+        return 0;
+    }
+    return (double)hit / total;
+}
+static bvar::PassiveStatus<double> plan_cache_hit_ratio(
+        "plan_cache_hit_ratio", get_plan_cache_hit_ratio, NULL);
+
+namespace {
+inline bool is_word_char(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '$';
+}
+inline bool is_number_start(const std::string& sql, size_t pos) {
+    if (pos >= sql.size()) {
+        return false;
+    }
+    if (isdigit((unsigned char)sql[pos])) {
+        return true;
+    }
+    return sql[pos] == '.' && pos + 1 < sql.size() && isdigit((unsigned char)sql[pos + 1]);
+}
+}
+
+PlanCache::PlanCache() {
+    int64_t shard_capacity = FLAGS_plan_cache_capacity / SHARD_NUM + 1;
+    for (auto& shard : _shards) {
+        shard.init(shard_capacity);
+    }
+}
+
+int PlanCache::find(const std::string& key, SmartPlanCacheItem* item) {
+    if (_shards[std::hash<std::string>()(key) % SHARD_NUM].find(key, item) != 0) {
+        plan_cache_miss << 1;
+        return -1;
+    }
+    if ((*item)->failed_time_us > 0 && butil::gettimeofday_us() - (*item)->failed_time_us
+            > FLAGS_plan_cache_failed_expire_s * 1000 * 1000LL) {
+        plan_cache_miss << 1;
+        return -1;
+    }
+    // 不可复用的标记只用于跳过重复生成，不算命中
+    if ((*item)->cacheable) {
+        plan_cache_hit << 1;
+    } else {
+        plan_cache_miss << 1;
+    }
+    return 0;
+}
+
+void PlanCache::add(const std::string& key, const SmartPlanCacheItem& item) {
+    _shards[std::hash<std::string>()(key) % SHARD_NUM].add(key, item);
+}
+
+int PlanCache::normalize_sql(const std::string& sql,
+        std::string* normalized,
+        std::vector<pb::ExprNode>* params) {
+    normalized->clear();
+    params->clear();
+    normalized->reserve(sql.size());
+    // 上一个token，单词转为小写
+    std::string prev;
+    // 括号栈，true表示IN/VALUES的常量列表
+    std::vector<bool> list_stack;
+    // 只在WHERE/ON/HAVING/SET/VALUES子句中参数化，select列表中的常量影响返回列名
+    bool clause_allowed = false;
+    bool between_pending = false;
+    bool values_mode = false;
+    bool first_word = true;
+    int select_count = 0;
+    size_t len = sql.size();
+    size_t i = 0;
+
+    auto in_param_context = [&]() -> bool {
+        if (!clause_allowed) {
+            return false;
+        }
+        if (prev == "=" || prev == "<" || prev == ">" || prev == "<=" || prev == ">="
+                || prev == "!=" || prev == "<>" || prev == "<=>" || prev == "between") {
+            return true;
+        }
+        if (prev == "and" && between_pending) {
+            return true;
+        }
+        return (prev == "(" || prev == ",") && !list_stack.empty() && list_stack.back();
+    };
+    auto append_param = [&](const pb::ExprNode& node) {
+        if (prev == "and") {
+            between_pending = false;
+        }
+        params->push_back(node);
+        normalized->push_back('?');
+        prev = "?";
+    };
+
+    while (i < len) {
+        char c = sql[i];
+        if (isspace((unsigned char)c)) {
+            while (i < len && isspace((unsigned char)sql[i])) {
+                ++i;
+            }
+            if (!normalized->empty()) {
+                normalized->push_back(' ');
+            }
+            continue;
+        }
+        // 注释、用户变量、多语句及已有的'?'不处理
+        if (c == '?' || c == '@' || c == '#' || c == ';' || (c & 0x80)) {
+            return -1;
+        }
+        if ((c == '/' && i + 1 < len && sql[i + 1] == '*')
+                || (c == '-' && i + 1 < len && sql[i + 1] == '-')) {
+            return -1;
+        }
+        if (c == '\'' || c == '"') {
+            size_t j = i + 1;
+            while (j < len && sql[j] != c) {
+                if (sql[j] == '\\') {
+                    ++j;
+                }
+                ++j;
+            }
+            if (j >= len) {
+                return -1;
+            }
+            // 'it''s' 这类连续引号不处理
+            if (j + 1 < len && sql[j + 1] == c) {
+                return -1;
+            }
+            if (in_param_context()) {
+                // 与词法分析一致：去掉引号并处理转义
+                butil::Arena arena;
+                parser::String str;
+                str.strdup(sql.c_str() + i + 1, j - i - 1, arena);
+                str.stripslashes();
+                pb::ExprNode node;
+                node.set_node_type(pb::STRING_LITERAL);
+                node.set_col_type(pb::STRING);
+                node.set_num_children(0);
+                node.mutable_derive_node()->set_string_val(str.value, str.length);
+                append_param(node);
+            } else {
+                normalized->append(sql, i, j + 1 - i);
+                prev = "'";
+            }
+            i = j + 1;
+            continue;
+        }
+        bool negative = false;
+        if (c == '-' && in_param_context() && is_number_start(sql, i + 1)) {
+            negative = true;
+            ++i;
+        }
+        if (is_number_start(sql, i)) {
+            size_t j = i;
+            bool is_double = false;
+            while (j < len && isdigit((unsigned char)sql[j])) {
+                ++j;
+            }
+            if (j < len && sql[j] == '.') {
+                is_double = true;
+                ++j;
+                while (j < len && isdigit((unsigned char)sql[j])) {
+                    ++j;
+                }
+            }
+            if (j < len && (sql[j] == 'e' || sql[j] == 'E')) {
+                size_t k = j + 1;
+                if (k < len && (sql[k] == '+' || sql[k] == '-')) {
+                    ++k;
+                }
+                if (k < len && isdigit((unsigned char)sql[k])) {
+                    is_double = true;
+                    j = k;
+                    while (j < len && isdigit((unsigned char)sql[j])) {
+                        ++j;
+                    }
+                }
+            }
+            // 0x1F、1abc等十六进制常量或标识符
+            if (j < len && is_word_char(sql[j])) {
+                return -1;
+            }
+            std::string text = sql.substr(i, j - i);
+            if (negative || in_param_context()) {
+                pb::ExprNode node;
+                node.set_num_children(0);
+                if (is_double) {
+                    double value = strtod(text.c_str(), NULL);
+                    node.set_node_type(pb::DOUBLE_LITERAL);
+                    node.set_col_type(pb::DOUBLE);
+                    node.mutable_derive_node()->set_double_val(negative ? -value : value);
+                } else {
+                    errno = 0;
+                    uint64_t value = strtoull(text.c_str(), NULL, 10);
+                    // 超出int64的常量由解析器按原逻辑处理
+                    if (errno == ERANGE || value > (uint64_t)INT64_MAX) {
+                        return -1;
+                    }
+                    node.set_node_type(pb::INT_LITERAL);
+                    node.set_col_type(pb::INT64);
+                    node.mutable_derive_node()->set_int_val(negative ? -(int64_t)value : (int64_t)value);
+                }
+                append_param(node);
+            } else {
+                normalized->append(text);
+                prev = "0";
+            }
+            i = j;
+            continue;
+        }
+        if (isalpha((unsigned char)c) || c == '_' || c == '$') {
+            size_t j = i;
+            while (j < len && is_word_char(sql[j])) {
+                ++j;
+            }
+            // x'1F'、b'01'、_utf8'abc' 等带前缀的常量
+            if (j < len && (sql[j] == '\'' || sql[j] == '"')) {
+                return -1;
+            }
+            std::string word = sql.substr(i, j - i);
+            std::string lower = boost::algorithm::to_lower_copy(word);
+            if (first_word) {
+                if (lower != "select" && lower != "insert" && lower != "replace"
+                        && lower != "update" && lower != "delete") {
+                    return -1;
+                }
+                first_word = false;
+            }
+            if (lower == "select" && ++select_count > 1) {
+                // 子查询、union
+                return -1;
+            }
+            if (lower == "where" || lower == "on" || lower == "having" || lower == "set"
+                    || lower == "values" || lower == "value") {
+                clause_allowed = true;
+            } else if (lower == "select" || lower == "order" || lower == "group" || lower == "limit") {
+                clause_allowed = false;
+            }
+            if (lower == "between") {
+                between_pending = true;
+            } else if ((lower == "values" || lower == "value") && list_stack.empty()) {
+                values_mode = true;
+            } else if (lower == "on" || lower == "select" || lower == "set") {
+                values_mode = false;
+            }
+            normalized->append(word);
+            prev = lower;
+            i = j;
+            continue;
+        }
+        if (c == '`') {
+            size_t j = sql.find('`', i + 1);
+            if (j == std::string::npos) {
+                return -1;
+            }
+            normalized->append(sql, i, j + 1 - i);
+            prev = "`";
+            i = j + 1;
+            continue;
+        }
+        if (c == '(') {
+            bool is_list = (prev == "in") || (values_mode && list_stack.empty());
+            list_stack.push_back(is_list);
+            normalized->push_back(c);
+            prev = "(";
+            ++i;
+            continue;
+        }
+        if (c == ')') {
+            if (list_stack.empty()) {
+                return -1;
+            }
+            list_stack.pop_back();
+            normalized->push_back(c);
+            prev = ")";
+            ++i;
+            continue;
+        }
+        // 运算符
+        size_t op_len = 1;
+        if (sql.compare(i, 3, "<=>") == 0) {
+            op_len = 3;
+        } else if (i + 1 < len) {
+            static const char* two_char_ops[] = {"<=", ">=", "!=", "<>", ":=", "&&", "||", "<<", ">>"};
+            for (auto op : two_char_ops) {
+                if (sql.compare(i, 2, op) == 0) {
+                    op_len = 2;
+                    break;
+                }
+            }
+        }
+        prev = sql.substr(i, op_len);
+        normalized->append(prev);
+        i += op_len;
+    }
+    if (first_word || !list_stack.empty()) {
+        return -1;
+    }
+    while (!normalized->empty() && normalized->back() == ' ') {
+        normalized->pop_back();
+    }
+    return 0;
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -21,11 +21,15 @@
 #include "transaction_planner.h"
 #include "exec_node.h"
 #include "packet_node.h"
+#include "dml_manager_node.h"
+#include "transaction_manager_node.h"
 #include "literal.h"
 #include "expr_optimizer.h"
+#include "plan_cache.h"
 
 namespace baikaldb {
 DECLARE_string(log_plat_name);
+DEFINE_bool(reuse_prepared_dml_plan, false, "reuse exec node tree of prepared insert/update/delete, default: false");
 
 int PreparePlanner::plan() {
     auto client = _ctx->client_conn;
@@ -132,6 +136,17 @@ int PreparePlanner::stmt_prepare(const std::string& stmt_name, const std::string
         return -1;
     }
     //DB_WARNING("stmt_name:%s stmt_sql:%s", stmt_name.c_str(), stmt_sql.c_str());
+    std::shared_ptr<QueryContext> prepare_ctx;
+    if (create_prepare_ctx(stmt_sql, prepare_ctx) != 0) {
+        return -1;
+    }
+    client->prepared_plans[stmt_name] = prepare_ctx;
+    NetworkSocket::bvar_prepare_count << 1;
+    return 0;
+}
+
+int PreparePlanner::create_prepare_ctx(const std::string& stmt_sql, std::shared_ptr<QueryContext>& prepare_ctx) {
+    auto client = _ctx->client_conn;
     parser::SqlParser parser;
     parser.parse(stmt_sql);
     if (parser.error != parser::SUCC) {
@@ -156,7 +171,7 @@ int PreparePlanner::stmt_prepare(const std::string& stmt_name, const std::string
     }
 
     // create commit fetcher node
-    std::shared_ptr<QueryContext> prepare_ctx(new (std::nothrow)QueryContext());
+    prepare_ctx.reset(new (std::nothrow)QueryContext());
     if (prepare_ctx.get() == nullptr) {
         DB_WARNING("create prepare context failed");
         return -1;
@@ -168,7 +183,7 @@ int PreparePlanner::stmt_prepare(const std::string& stmt_name, const std::string
     prepare_ctx->cur_db = _ctx->cur_db;
     prepare_ctx->user_info = _ctx->user_info;
     prepare_ctx->row_ttl_duration = _ctx->row_ttl_duration;
-    prepare_ctx->is_complex = _ctx->is_complex;
+    prepare_ctx->is_complex = _ctx->is_complex || prepare_ctx->stmt->is_complex_node();
     prepare_ctx->client_conn = client;
     prepare_ctx->get_runtime_state()->set_client_conn(client);
     prepare_ctx->sql = stmt_sql;
@@ -218,8 +233,6 @@ int PreparePlanner::stmt_prepare(const std::string& stmt_name, const std::string
         return ret;
     }
     */
-    client->prepared_plans[stmt_name] = prepare_ctx;
-    NetworkSocket::bvar_prepare_count << 1;
     return 0;
 }
 
@@ -255,17 +268,25 @@ int PreparePlanner::stmt_execute(const std::string& stmt_name, std::vector<pb::E
     _ctx->mutable_tuple_descs()->assign(tuple_descs.begin(), tuple_descs.end());
     _ctx->ref_slot_id_mapping.insert(prepare_ctx->ref_slot_id_mapping.begin(),
                                      prepare_ctx->ref_slot_id_mapping.end());
-    // TODO dml的plan复用
     if (!prepare_ctx->is_select) {
+        bool in_txn = (client->txn_id != 0);
         // enable_2pc=true or table has global index need generate txn_id
         set_dml_txn_state(prepare_ctx->prepared_table_id);
-        _ctx->plan.CopyFrom(prepare_ctx->plan);
-        int ret = _ctx->create_plan_tree();
-        if (ret < 0) {
-            DB_WARNING("Failed to pb_plan to execnode");
-            return -1;
+        if (can_reuse_dml_plan(prepare_ctx.get(), in_txn)) {
+            // dml prepare plan复用，物理计划阶段只更新记录和路由
+            _ctx->root = prepare_ctx->root;
+            _ctx->placeholders = prepare_ctx->placeholders;
+            _ctx->reuse_prepared_plan = true;
+            reset_reused_dml_plan(_ctx->root);
+        } else {
+            _ctx->plan.CopyFrom(prepare_ctx->plan);
+            int ret = _ctx->create_plan_tree();
+            if (ret < 0) {
+                DB_WARNING("Failed to pb_plan to execnode");
+                return -1;
+            }
+            _ctx->root->find_place_holder(_ctx->placeholders);
         }
-        _ctx->root->find_place_holder(_ctx->placeholders);
     } else {
         if (client->txn_id == 0) {
             prepare_ctx->get_runtime_state()->set_single_sql_autocommit(true);
@@ -278,6 +299,69 @@ int PreparePlanner::stmt_execute(const std::string& stmt_name, std::vector<pb::E
         _ctx->placeholders = prepare_ctx->placeholders;
     }
 
+    if (bind_params(params) != 0) {
+        return -1;
+    }
+    _ctx->stmt_type = prepare_ctx->stmt_type;
+    _ctx->exec_prepared = true;
+    return 0;
+}
+
+// 显式事务中dml节点会缓存到连接上直到提交，全局索引和binlog会拆分出多个dml节点，这些情况不复用
+bool PreparePlanner::can_reuse_dml_plan(QueryContext* prepare_ctx, bool in_txn) {
+    if (!FLAGS_reuse_prepared_dml_plan || in_txn || prepare_ctx->root == nullptr) {
+        return false;
+    }
+    if (prepare_ctx->stmt_type != parser::NT_INSERT && prepare_ctx->stmt_type != parser::NT_UPDATE
+            && prepare_ctx->stmt_type != parser::NT_DELETE) {
+        return false;
+    }
+    if (!prepare_ctx->sub_query_plans.empty() || !prepare_ctx->table_partition_names.empty()
+            || prepare_ctx->use_backup || prepare_ctx->need_learner_backup) {
+        return false;
+    }
+    int64_t table_id = prepare_ctx->prepared_table_id;
+    auto tbl_ptr = _factory->get_table_info_ptr(table_id);
+    if (tbl_ptr == nullptr || tbl_ptr->partition_num > 1) {
+        return false;
+    }
+    if (_factory->has_global_index(table_id) || _factory->has_open_binlog(table_id)) {
+        return false;
+    }
+    // 已完成物理计划的执行树，单语句事务的包装需要与本次一致
+    ExecNode* packet_node = prepare_ctx->root->get_node(pb::PACKET_NODE);
+    if (packet_node == nullptr || packet_node->children_size() == 0) {
+        return false;
+    }
+    pb::PlanNodeType child_type = packet_node->children(0)->node_type();
+    bool has_txn_node = (child_type == pb::SIGNEL_TXN_MANAGER_NODE);
+    bool is_separated = has_txn_node || child_type == pb::INSERT_MANAGER_NODE
+            || child_type == pb::UPDATE_MANAGER_NODE || child_type == pb::DELETE_MANAGER_NODE;
+    // 与Separate::need_separate_single_txn的判断一致，不一致时走拷贝计划重建
+    bool need_txn_node = _ctx->enable_2pc || _factory->need_begin_txn(table_id);
+    if (is_separated && has_txn_node != need_txn_node) {
+        return false;
+    }
+    return true;
+}
+
+// 执行树上的fetcher状态(包括kill设置的取消标记)会保留到下次执行，复用前清理
+void PreparePlanner::reset_reused_dml_plan(ExecNode* root) {
+    std::vector<ExecNode*> manager_nodes;
+    root->get_node(pb::INSERT_MANAGER_NODE, manager_nodes);
+    root->get_node(pb::UPDATE_MANAGER_NODE, manager_nodes);
+    root->get_node(pb::DELETE_MANAGER_NODE, manager_nodes);
+    for (auto node : manager_nodes) {
+        static_cast<DmlManagerNode*>(node)->reset_fetcher_store();
+    }
+    std::vector<ExecNode*> txn_nodes;
+    root->get_node(pb::SIGNEL_TXN_MANAGER_NODE, txn_nodes);
+    for (auto node : txn_nodes) {
+        static_cast<TransactionManagerNode*>(node)->reset_fetcher_store();
+    }
+}
+
+int PreparePlanner::bind_params(std::vector<pb::ExprNode>& params) {
     for (size_t idx = 0; idx < params.size(); ++idx) {
         auto place_holder_iter = _ctx->placeholders.find(idx);
         if (place_holder_iter == _ctx->placeholders.end() || place_holder_iter->second == nullptr) {
@@ -288,11 +372,169 @@ int PreparePlanner::stmt_execute(const std::string& stmt_name, std::vector<pb::E
         Literal* place_holder = static_cast<Literal*>(place_holder_iter->second);
         place_holder->init(params[idx]);
     }
-    _ctx->stmt_type = prepare_ctx->stmt_type;
+    return 0;
+}
+
+int PreparePlanner::plan_cache_execute() {
+    auto client = _ctx->client_conn;
+    // gbk下字符串的0x5c处理依赖词法分析
+    if (_ctx->charset == "gbk" || _ctx->user_info == nullptr) {
+        return 1;
+    }
+    // 注释中的ttl_duration/full_export/region_id等会进入计划或改变执行方式，不在缓存key中，走普通流程
+    if (!_ctx->comments.empty() || _ctx->row_ttl_duration > 0 || _ctx->is_complex) {
+        return 1;
+    }
+    std::string normalized;
+    std::vector<pb::ExprNode> params;
+    if (PlanCache::normalize_sql(_ctx->sql, &normalized, &params) != 0) {
+        return 1;
+    }
+    std::string key = _ctx->user_info->namespace_ + "\t" + _ctx->cur_db + "\t"
+                      + _ctx->charset + "\t" + normalized;
+    SmartPlanCacheItem item;
+    bool hit = (PlanCache::get_instance()->find(key, &item) == 0);
+    if (hit && item->cacheable && !check_plan_cache_item(item)) {
+        // schema或表配置有变化，重新生成模板
+        hit = false;
+    }
+    if (!hit) {
+        std::shared_ptr<QueryContext> prepare_ctx;
+        if (create_prepare_ctx(normalized, prepare_ctx) != 0) {
+            // 由普通流程重新解析并返回错误，缓存带过期时间的不可复用标记，避免每次重复解析模板
+            _ctx->stat_info.error_code = ER_ERROR_FIRST;
+            _ctx->stat_info.error_msg.str("");
+            item = std::make_shared<PlanCacheItem>();
+            item->failed_time_us = butil::gettimeofday_us();
+            PlanCache::get_instance()->add(key, item);
+            return 1;
+        }
+        item = std::make_shared<PlanCacheItem>();
+        fill_plan_cache_item(prepare_ctx.get(), params.size(), item.get());
+        PlanCache::get_instance()->add(key, item);
+        if (item->cacheable && !check_plan_cache_item(item)) {
+            return 1;
+        }
+    }
+    if (!item->cacheable) {
+        return 1;
+    }
+
+    _ctx->stat_info.family = item->family;
+    _ctx->stat_info.table = item->table;
+    _ctx->stat_info.sample_sql << item->sample_sql;
+    _ctx->stat_info.sign = item->sign;
+    _ctx->is_select = item->is_select;
+    _ctx->is_straight_join = item->is_straight_join;
+    _ctx->prepared_table_id = item->prepared_table_id;
+    _ctx->mutable_tuple_descs()->assign(item->tuple_descs.begin(), item->tuple_descs.end());
+    _ctx->ref_slot_id_mapping.insert(item->ref_slot_id_mapping.begin(), item->ref_slot_id_mapping.end());
+    if (!item->is_select) {
+        set_dml_txn_state(item->prepared_table_id);
+    } else {
+        _ctx->get_runtime_state()->set_single_sql_autocommit(client->txn_id == 0);
+    }
+    _ctx->plan.CopyFrom(item->plan);
+    if (_ctx->create_plan_tree() < 0) {
+        DB_WARNING("Failed to pb_plan to execnode");
+        return -1;
+    }
+    _ctx->root->find_place_holder(_ctx->placeholders);
+    if (bind_params(params) != 0) {
+        return -1;
+    }
+    _ctx->stmt_type = item->stmt_type;
     _ctx->exec_prepared = true;
     return 0;
 }
 
+bool PreparePlanner::check_plan_cache_item(const SmartPlanCacheItem& item) {
+    auto user_info = _ctx->user_info;
+    pb::OpType op_type = pb::OP_SELECT;
+    switch (item->stmt_type) {
+    case parser::NT_INSERT:
+        op_type = pb::OP_INSERT;
+        break;
+    case parser::NT_UPDATE:
+        op_type = pb::OP_UPDATE;
+        break;
+    case parser::NT_DELETE:
+        op_type = pb::OP_DELETE;
+        break;
+    default:
+        break;
+    }
+    for (auto& pair : item->table_versions) {
+        auto tbl_ptr = _factory->get_table_info_ptr(pair.first);
+        if (tbl_ptr == nullptr || tbl_ptr->version != pair.second) {
+            return false;
+        }
+        // 权限、降级、sql屏蔽等配置有变化时走普通流程
+        if (!user_info->allow_op(op_type, tbl_ptr->db_id, tbl_ptr->id)) {
+            return false;
+        }
+        if (tbl_ptr->need_learner_backup || !tbl_ptr->learner_resource_tags.empty()
+                || tbl_ptr->need_read_backup || tbl_ptr->need_write_backup) {
+            return false;
+        }
+        if (tbl_ptr->sign_blacklist.count(item->sign) > 0
+                || tbl_ptr->sign_forcelearner.count(item->sign) > 0
+                || !tbl_ptr->sign_forceindex.empty()) {
+            return false;
+        }
+        _ctx->stat_info.resource_tag = tbl_ptr->resource_tag;
+    }
+    return true;
+}
+
+void PreparePlanner::fill_plan_cache_item(QueryContext* prepare_ctx, size_t param_count,
+        PlanCacheItem* item) {
+    item->stmt_type = prepare_ctx->stmt_type;
+    item->is_select = prepare_ctx->is_select;
+    item->is_straight_join = prepare_ctx->is_straight_join;
+    item->prepared_table_id = prepare_ctx->prepared_table_id;
+    item->param_count = param_count;
+    item->family = prepare_ctx->stat_info.family;
+    item->table = prepare_ctx->stat_info.table;
+    item->sample_sql = prepare_ctx->stat_info.sample_sql.str();
+    item->sign = prepare_ctx->stat_info.sign;
+    if (prepare_ctx->is_complex || prepare_ctx->has_derived_table
+            || prepare_ctx->has_information_schema || prepare_ctx->use_backup
+            || prepare_ctx->need_learner_backup || prepare_ctx->is_full_export
+            || prepare_ctx->is_base_subscribe || !prepare_ctx->table_partition_names.empty()
+            || !prepare_ctx->sub_query_plans.empty()
+            || prepare_ctx->placeholders.size() != param_count) {
+        return;
+    }
+    if (item->stmt_type != parser::NT_SELECT && item->stmt_type != parser::NT_INSERT
+            && item->stmt_type != parser::NT_UPDATE && item->stmt_type != parser::NT_DELETE) {
+        return;
+    }
+    item->plan.CopyFrom(prepare_ctx->plan);
+    item->tuple_descs = prepare_ctx->tuple_descs();
+    item->ref_slot_id_mapping = prepare_ctx->ref_slot_id_mapping;
+    for (auto& tuple : item->tuple_descs) {
+        if (tuple.has_table_id() && tuple.table_id() > 0) {
+            item->table_versions[tuple.table_id()] = -1;
+        }
+    }
+    if (item->prepared_table_id > 0) {
+        item->table_versions[item->prepared_table_id] = -1;
+    }
+    if (item->table_versions.empty()) {
+        return;
+    }
+    for (auto& pair : item->table_versions) {
+        auto tbl_ptr = _factory->get_table_info_ptr(pair.first);
+        if (tbl_ptr == nullptr) {
+            item->failed_time_us = butil::gettimeofday_us();
+            return;
+        }
+        pair.second = tbl_ptr->version;
+    }
+    item->cacheable = true;
+}
+
 int PreparePlanner::stmt_close(const std::string& stmt_name) {
     auto client = _ctx->client_conn;
     auto iter = client->prepared_plans.find(stmt_name);
@@ -13,8 +13,60 @@
 // limitations under the License.
 
 #include "mem_row_compare.h"
+#include "mut_table_key.h"
 
 namespace baikaldb {
+DEFINE_bool(sort_use_normalized_key, true, "sort/merge on precomputed memcomparable keys, default: true");
+
+namespace {
+const uint8_t SORT_KEY_NULL_FIRST = 0;
+const uint8_t SORT_KEY_NOT_NULL = 1;
+const uint8_t SORT_KEY_NULL_LAST = 2;
+
+// 字符串中的'\0'转义为"\0\xFF"，以"\0\0"结尾，保证任意字符串下key无歧义且保序
+void append_sort_string(const std::string& str, MutTableKey* key) {
+    std::string& data = key->data();
+    data.reserve(data.size() + str.size() + 2);
+    for (char c : str) {
+        data.push_back(c);
+        if (c == '\0') {
+            data.push_back('\xFF');
+        }
+    }
+    data.append(2, '\0');
+}
+}
+
+bool MemRowCompare::use_sort_key() {
+    return FLAGS_sort_use_normalized_key && !need_not_compare();
+}
+
+void MemRowCompare::encode_sort_key(MemRow* row, std::string* key) {
+    MutTableKey sort_key;
+    for (size_t i = 0; i < _slot_order_exprs.size(); i++) {
+        ExprValue value = _slot_order_exprs[i]->get_value(row);
+        if (value.is_null()) {
+            sort_key.append_u8(_is_null_first[i] ? SORT_KEY_NULL_FIRST : SORT_KEY_NULL_LAST);
+            continue;
+        }
+        sort_key.append_u8(SORT_KEY_NOT_NULL);
+        size_t begin = sort_key.size();
+        if (value.type == pb::STRING || value.type == pb::HEX) {
+            append_sort_string(value.str_val, &sort_key);
+        } else {
+            // compare中不可比较的类型不会编码，视为相等
+            sort_key.append_value(value);
+        }
+        if (!_is_asc[i]) {
+            std::string& data = sort_key.data();
+            for (size_t pos = begin; pos < data.size(); pos++) {
+                data[pos] = ~data[pos];
+            }
+        }
+    }
+    key->swap(sort_key.data());
+}
+
 int64_t MemRowCompare::compare(MemRow* left, MemRow* right) {
     for (size_t i = 0; i < _slot_order_exprs.size(); i++) {
         auto expr = _slot_order_exprs[i];
@@ -1186,6 +1186,51 @@ int DDLManager::update_region_ddlwork(const pb::RegionDdlWork& work) {
     return 0;
 }
 
+void DDLManager::process_ddlwork_heartbeat_for_store(const pb::StoreHeartBeatRequest* request) {
+    for (auto& info : request->ddlwork_infos()) {
+        if (info.op_type() != pb::OP_ADD_INDEX || info.errcode() == pb::SUCCESS) {
+            continue;
+        }
+        int64_t table_id = info.table_id();
+        pb::DdlWorkInfo ddl_work;
+        if (!get_ddl_mem(table_id, ddl_work) || ddl_work.job_state() != pb::IS_WRITE_LOCAL) {
+            DB_WARNING("task_%ld_%ld ddl work not in write local, store: %s",
+                    table_id, info.region_id(), request->instance_info().address().c_str());
+            continue;
+        }
+        MemRegionDdlWorkMapPtr region_map_ptr;
+        {
+            BAIDU_SCOPED_LOCK(_region_mutex);
+            auto iter = _region_ddlwork.find(table_id);
+            if (iter != _region_ddlwork.end()) {
+                region_map_ptr = iter->second;
+            }
+        }
+        if (region_map_ptr == nullptr) {
+            continue;
+        }
+        // 只处理已完成的任务，执行中或已失败的任务会重新构建
+        pb::RegionDdlWork region_work;
+        bool need_fail = false;
+        region_map_ptr->call_and_get(info.region_id(), [&](MemRegionDdlWork& work) {
+            if (work.region_info.status() == pb::DdlWorkDone) {
+                work.region_info.set_status(pb::DdlWorkFail);
+                region_work = work.region_info;
+                need_fail = true;
+            }
+        });
+        if (!need_fail) {
+            continue;
+        }
+        DB_WARNING("task_%ld_%ld build index fail on store: %s, %s", table_id, info.region_id(),
+                request->instance_info().address().c_str(), region_work.ShortDebugString().c_str());
+        pb::MetaManagerRequest meta_request;
+        meta_request.mutable_index_ddl_request()->mutable_region_ddl_work()->CopyFrom(region_work);
+        meta_request.set_op_type(pb::OP_UPDATE_INDEX_REGION_DDL_WORK);
+        apply_raft(meta_request);
+    }
+}
+
 int DDLManager::delete_index_ddlwork_region_info(int64_t table_id) {
     DB_NOTICE("delete ddl region info.");
     {
@@ -0,0 +1,306 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "load_balance_scheduler.h"
+#include <algorithm>
+
+namespace baikaldb {
+DEFINE_bool(enable_load_balance_scheduler, false, "balance leader/peer by store read/write qps instead of "
+        "leader count, default: false");
+DEFINE_string(load_balance_record_file, "", "append store heartbeats used by load balance scheduler to "
+        "this file for offline simulation, default: empty(not record)");
+DEFINE_double(load_balance_read_weight, 1.0, "weight of select qps in load score");
+DEFINE_double(load_balance_write_weight, 3.0, "weight of dml qps in load score");
+DEFINE_double(load_balance_latency_weight, 0.5, "score amplification when dml latency is higher than average");
+DEFINE_double(load_balance_smooth_factor, 0.3, "ewma factor of new heartbeat in load score");
+DEFINE_int32(load_balance_hysteresis_percent, 20, "only schedule stores whose score is higher than "
+        "average * (100 + x) / 100, and targets stay below it");
+DEFINE_double(load_balance_min_store_score, 1000, "stores with lower score are never treated as hot");
+DEFINE_int32(load_balance_interval_s, 60, "min interval between two schedules of one store");
+DEFINE_int32(load_balance_region_cooldown_s, 600, "min interval between two schedules of one region");
+DEFINE_int32(load_balance_store_expire_s, 60, "stores without heartbeat for this long are ignored");
+DEFINE_int32(load_balance_max_trans_leader, 3, "max leader transfers for one store each round");
+DEFINE_int32(load_balance_max_add_peer, 1, "max peer moves for one store each round");
+
+bvar::Adder<int64_t> LoadBalanceScheduler::load_balance_trans_leader_count {"load_balance_trans_leader_count"};
+bvar::Adder<int64_t> LoadBalanceScheduler::load_balance_add_peer_count {"load_balance_add_peer_count"};
+
+double LoadBalanceScheduler::region_score(int64_t select_qps, int64_t dml_qps) {
+    return select_qps * FLAGS_load_balance_read_weight + dml_qps * FLAGS_load_balance_write_weight;
+}
+
+void LoadBalanceScheduler::update_store_load(const pb::InstanceInfo& instance_info, int64_t now_us) {
+    double score = region_score(instance_info.select_qps(), instance_info.dml_qps());
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _store_loads.find(instance_info.address());
+    if (iter == _store_loads.end() || !is_alive(iter->second, now_us)) {
+        StoreLoad& load = _store_loads[instance_info.address()];
+        load.score = score;
+        load.dml_latency = instance_info.dml_latency();
+        load.resource_tag = instance_info.resource_tag();
+        load.update_time = now_us;
+        return;
+    }
+    StoreLoad& load = iter->second;
+    double factor = FLAGS_load_balance_smooth_factor;
+    load.score = factor * score + (1 - factor) * load.score;
+    load.dml_latency = factor * instance_info.dml_latency() + (1 - factor) * load.dml_latency;
+    load.resource_tag = instance_info.resource_tag();
+    load.update_time = now_us;
+}
+
+bool LoadBalanceScheduler::is_alive(const StoreLoad& load, int64_t now_us) {
+    return now_us - load.update_time <= FLAGS_load_balance_store_expire_s * 1000 * 1000LL;
+}
+
+double LoadBalanceScheduler::do_average_score(const std::string& resource_tag, int64_t now_us) {
+    double total = 0;
+    int64_t count = 0;
+    for (auto& pair : _store_loads) {
+        if (pair.second.resource_tag != resource_tag || !is_alive(pair.second, now_us)) {
+            continue;
+        }
+        total += pair.second.score;
+        ++count;
+    }
+    return count == 0 ? 0 : total / count;
+}
+
+double LoadBalanceScheduler::average_latency(const std::string& resource_tag, int64_t now_us) {
+    double total = 0;
+    int64_t count = 0;
+    for (auto& pair : _store_loads) {
+        if (pair.second.resource_tag != resource_tag || !is_alive(pair.second, now_us)) {
+            continue;
+        }
+        total += pair.second.dml_latency;
+        ++count;
+    }
+    return count == 0 ? 0 : total / count;
+}
+
+double LoadBalanceScheduler::effective_score(const StoreLoad& load, double avg_latency) {
+    if (avg_latency <= 0 || load.dml_latency <= avg_latency) {
+        return load.score;
+    }
+    // 最多放大到2倍
+    double ratio = std::min(load.dml_latency / avg_latency - 1, 1.0);
+    return load.score * (1 + FLAGS_load_balance_latency_weight * ratio);
+}
+
+double LoadBalanceScheduler::average_score(const std::string& resource_tag, int64_t now_us) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return do_average_score(resource_tag, now_us);
+}
+
+double LoadBalanceScheduler::get_store_score(const std::string& instance) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _store_loads.find(instance);
+    if (iter == _store_loads.end()) {
+        return 0;
+    }
+    return iter->second.score;
+}
+
+void LoadBalanceScheduler::get_store_scores(const std::string& resource_tag, int64_t now_us,
+        std::map<std::string, double>* scores) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& pair : _store_loads) {
+        if (pair.second.resource_tag == resource_tag && is_alive(pair.second, now_us)) {
+            (*scores)[pair.first] = pair.second.score;
+        }
+    }
+}
+
+bool LoadBalanceScheduler::get_pending_remove_peer(int64_t region_id, std::string* peer) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _pending_remove_peers.find(region_id);
+    if (iter == _pending_remove_peers.end()) {
+        return false;
+    }
+    // add peer失败等情况下不再等待
+    if (butil::gettimeofday_us() - iter->second.second > FLAGS_load_balance_region_cooldown_s * 1000 * 1000LL) {
+        _pending_remove_peers.erase(iter);
+        return false;
+    }
+    *peer = iter->second.first;
+    return true;
+}
+
+void LoadBalanceScheduler::clear_pending_remove_peer(int64_t region_id) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _pending_remove_peers.erase(region_id);
+}
+
+void LoadBalanceScheduler::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _store_loads.clear();
+    _region_schedule_time.clear();
+    _pending_remove_peers.clear();
+}
+
+void LoadBalanceScheduler::schedule(const pb::StoreHeartBeatRequest& request,
+        int64_t now_us,
+        const LoadBalanceFilter& filter,
+        std::vector<pb::TransLeaderRequest>* trans_leaders,
+        std::vector<pb::AddPeer>* add_peers) {
+    const std::string& instance = request.instance_info().address();
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto source_iter = _store_loads.find(instance);
+    if (source_iter == _store_loads.end()) {
+        return;
+    }
+    StoreLoad& source = source_iter->second;
+    const std::string& resource_tag = source.resource_tag;
+    auto target_ok = [&](const std::string& target) -> StoreLoad* {
+        auto iter = _store_loads.find(target);
+        if (iter == _store_loads.end() || iter->second.resource_tag != resource_tag
+                || !is_alive(iter->second, now_us)) {
+            return nullptr;
+        }
+        if (filter != nullptr && !filter(instance, target)) {
+            return nullptr;
+        }
+        return &iter->second;
+    };
+
+    if (now_us - source.last_schedule_time < FLAGS_load_balance_interval_s * 1000 * 1000LL) {
+        return;
+    }
+    double avg_latency = average_latency(resource_tag, now_us);
+    double average = do_average_score(resource_tag, now_us);
+    double upper = average * (100 + FLAGS_load_balance_hysteresis_percent) / 100;
+    double source_score = effective_score(source, avg_latency);
+    if (average <= 0 || source_score < FLAGS_load_balance_min_store_score || source_score <= upper) {
+        return;
+    }
+    source.last_schedule_time = now_us;
+    double excess = source_score - average;
+    DB_WARNING("load balance hot instance: %s, resource_tag: %s, score: %.1f, average: %.1f, excess: %.1f",
+            instance.c_str(), resource_tag.c_str(), source_score, average, excess);
+
+    // 按region负载从高到低迁移
+    std::vector<std::pair<double, const pb::LeaderHeartBeat*>> candidates;
+    candidates.reserve(request.leader_regions_size());
+    for (auto& leader_region : request.leader_regions()) {
+        double score = region_score(leader_region.select_qps(), leader_region.dml_qps());
+        if (score > 0) {
+            candidates.emplace_back(score, &leader_region);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+            [](const std::pair<double, const pb::LeaderHeartBeat*>& l,
+                const std::pair<double, const pb::LeaderHeartBeat*>& r) {
+                return l.first > r.first;
+            });
+    int trans_leader_num = 0;
+    int add_peer_num = 0;
+    for (auto& candidate : candidates) {
+        if (excess <= 0 || (trans_leader_num >= FLAGS_load_balance_max_trans_leader
+                && add_peer_num >= FLAGS_load_balance_max_add_peer)) {
+            break;
+        }
+        double region_load = candidate.first;
+        const pb::LeaderHeartBeat& leader_region = *candidate.second;
+        const pb::RegionInfo& region = leader_region.region();
+        int64_t region_id = region.region_id();
+        if (leader_region.status() != pb::IDLE || region.peers_size() != region.replica_num()) {
+            continue;
+        }
+        auto time_iter = _region_schedule_time.find(region_id);
+        if (time_iter != _region_schedule_time.end()
+                && now_us - time_iter->second < FLAGS_load_balance_region_cooldown_s * 1000 * 1000LL) {
+            continue;
+        }
+        // 优先迁leader：选负载最低且迁入后不超过上限的follower
+        StoreLoad* best = nullptr;
+        std::string best_peer;
+        if (trans_leader_num < FLAGS_load_balance_max_trans_leader) {
+            for (auto& peer : region.peers()) {
+                if (peer == instance) {
+                    continue;
+                }
+                StoreLoad* load = target_ok(peer);
+                if (load == nullptr || load->score + region_load > upper) {
+                    continue;
+                }
+                if (best == nullptr || load->score < best->score) {
+                    best = load;
+                    best_peer = peer;
+                }
+            }
+        }
+        if (best != nullptr) {
+            pb::TransLeaderRequest trans_leader;
+            trans_leader.set_table_id(region.table_id());
+            trans_leader.set_region_id(region_id);
+            trans_leader.set_old_leader(instance);
+            trans_leader.set_new_leader(best_peer);
+            trans_leaders->emplace_back(trans_leader);
+            ++trans_leader_num;
+            load_balance_trans_leader_count << 1;
+        } else if (add_peer_num < FLAGS_load_balance_max_add_peer) {
+            // follower都热，在其他冷store上增加peer
+            for (auto& pair : _store_loads) {
+                if (pair.first == instance
+                        || std::find(region.peers().begin(), region.peers().end(), pair.first)
+                            != region.peers().end()) {
+                    continue;
+                }
+                StoreLoad* load = target_ok(pair.first);
+                if (load == nullptr || load->score + region_load > upper) {
+                    continue;
+                }
+                if (best == nullptr || load->score < best->score) {
+                    best = load;
+                    best_peer = pair.first;
+                }
+            }
+            if (best == nullptr) {
+                continue;
+            }
+            pb::AddPeer add_peer;
+            add_peer.set_region_id(region_id);
+            for (auto& peer : region.peers()) {
+                add_peer.add_old_peers(peer);
+                add_peer.add_new_peers(peer);
+            }
+            add_peer.add_new_peers(best_peer);
+            add_peers->emplace_back(add_peer);
+            _pending_remove_peers[region_id] = std::make_pair(instance, now_us);
+            ++add_peer_num;
+            load_balance_add_peer_count << 1;
+        } else {
+            continue;
+        }
+        DB_WARNING("load balance region_id: %ld, region_score: %.1f, from: %s(%.1f) to: %s(%.1f)",
+                region_id, region_load, instance.c_str(), source.score, best_peer.c_str(), best->score);
+        // 在下次心跳前按预估值调整，避免同一轮把多个region迁到同一个store
+        source.score -= region_load;
+        best->score += region_load;
+        excess -= region_load;
+        _region_schedule_time[region_id] = now_us;
+    }
+    // 清理过期的冷却记录
+    for (auto iter = _region_schedule_time.begin(); iter != _region_schedule_time.end();) {
+        if (now_us - iter->second >= FLAGS_load_balance_region_cooldown_s * 1000 * 1000LL) {
+            iter = _region_schedule_time.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
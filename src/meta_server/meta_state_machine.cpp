@@ -90,6 +90,11 @@ void MetaStateMachine::store_heartbeat(google::protobuf::RpcController* controll
     SchemaManager::get_instance()->process_leader_heartbeat_for_store(request, response, log_id);
     int64_t leader_time = step_time_cost.get_time();
     step_time_cost.reset();
+
+    //副本本地构建索引失败，ddl任务置为失败
+    if (request->ddlwork_infos_size() > 0) {
+        DDLManager::get_instance()->process_ddlwork_heartbeat_for_store(request);
+    }
     _store_heart_beat << time_cost.get_time();
     DB_DEBUG("store_heart_beat req[%s]", request->DebugString().c_str());
     DB_DEBUG("store_heart_beat resp[%s]", response->DebugString().c_str());
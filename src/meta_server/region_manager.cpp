@@ -21,6 +21,8 @@
 #include "meta_util.h"
 #include "table_manager.h"
 #include "meta_rocksdb.h"
+#include "load_balance_scheduler.h"
+#include <fstream>
 
 namespace baikaldb {
 DECLARE_int32(concurrency_num);
@@ -1062,6 +1064,10 @@ void RegionManager::leader_load_balance(bool whether_can_decide,
     
     leader_main_logical_room_check(request, response, leader_idc, table_replica, table_main_idc, trans_leader_region_ids);
 
+    if (FLAGS_enable_load_balance_scheduler && instance_status == pb::NORMAL) {
+        load_balance_by_qps(whether_can_decide, load_balance, request, trans_leader_region_ids, response);
+        return;
+    }
     if (!request->need_leader_balance() && 
             instance_status != pb::MIGRATE && instance_status != pb::SLOW) {
         return;
@@ -1243,6 +1249,92 @@ void RegionManager::leader_load_balance(bool whether_can_decide,
     }
 }
 
+void RegionManager::load_balance_by_qps(bool whether_can_decide,
+            bool load_balance,
+            const pb::StoreHeartBeatRequest* request,
+            const std::set<int64_t>& trans_leader_region_ids,
+            pb::StoreHeartBeatResponse* response) {
+    std::string instance = request->instance_info().address();
+    int64_t now = butil::gettimeofday_us();
+    LoadBalanceScheduler* scheduler = LoadBalanceScheduler::get_instance();
+    scheduler->update_store_load(request->instance_info(), now);
+    record_load_balance_heartbeat(request, now);
+    if (!whether_can_decide || !load_balance) {
+        return;
+    }
+    // 目标store状态正常，且与源store在同一逻辑机房，不改变副本的机房分布
+    auto filter = [](const std::string& source, const std::string& target) -> bool {
+        if (ClusterManager::get_instance()->get_instance_status(target) != pb::NORMAL) {
+            return false;
+        }
+        IdcInfo source_idc;
+        IdcInfo target_idc;
+        if (ClusterManager::get_instance()->get_instance_idc(source, source_idc) < 0
+                || ClusterManager::get_instance()->get_instance_idc(target, target_idc) < 0) {
+            return false;
+        }
+        source_idc.physical_room.clear();
+        return source_idc.match(target_idc);
+    };
+    std::vector<pb::TransLeaderRequest> trans_leaders;
+    std::vector<pb::AddPeer> add_peers;
+    scheduler->schedule(*request, now, filter, &trans_leaders, &add_peers);
+    for (auto& trans_leader : trans_leaders) {
+        if (trans_leader_region_ids.count(trans_leader.region_id()) > 0) {
+            continue;
+        }
+        *(response->add_trans_leader()) = trans_leader;
+        add_leader_count(trans_leader.new_leader(), trans_leader.table_id());
+        DB_WARNING("instance: %s load balance transfer leader, request: %s",
+                instance.c_str(), trans_leader.ShortDebugString().c_str());
+    }
+    if (add_peers.size() == 0) {
+        return;
+    }
+    Bthread bth(&BTHREAD_ATTR_SMALL);
+    auto add_peer_fun = 
+        [add_peers, instance]() {
+            for (auto& request : add_peers) {
+                StoreInteract store_interact(instance.c_str());
+                pb::StoreRes response; 
+                auto ret = store_interact.send_request("add_peer", request, response);
+                DB_WARNING("instance: %s load balance, send add peer request:%s, response:%s, ret: %d",
+                            instance.c_str(),
+                            request.ShortDebugString().c_str(),
+                            response.ShortDebugString().c_str(), ret);
+            }
+        };
+    bth.run(add_peer_fun);
+}
+
+// 每行一个心跳：时间戳(us)\tStoreHeartBeatRequest文本格式，供离线回放
+void RegionManager::record_load_balance_heartbeat(const pb::StoreHeartBeatRequest* request, int64_t now_us) {
+    if (FLAGS_load_balance_record_file.empty()) {
+        return;
+    }
+    pb::StoreHeartBeatRequest record;
+    *record.mutable_instance_info() = request->instance_info();
+    for (auto& leader_region : request->leader_regions()) {
+        pb::LeaderHeartBeat* record_region = record.add_leader_regions();
+        *record_region = leader_region;
+        record_region->clear_peers_status();
+        record_region->mutable_region()->clear_start_key();
+        record_region->mutable_region()->clear_end_key();
+    }
+    static std::mutex record_mutex;
+    static std::ofstream record_file;
+    std::lock_guard<std::mutex> lock(record_mutex);
+    if (!record_file.is_open()) {
+        record_file.open(FLAGS_load_balance_record_file, std::ios::out | std::ios::app);
+        if (!record_file.is_open()) {
+            DB_WARNING("open load balance record file: %s fail", FLAGS_load_balance_record_file.c_str());
+            return;
+        }
+    }
+    record_file << now_us << "\t" << record.ShortDebugString() << "\n";
+    record_file.flush();
+}
+
 /*
  * pk_prefix_add_peer_counts:   pk_prefix_key -> 需要add peer的数量
  * pk_prefix_regions:           pk_prefix_key -> region_id list
@@ -2289,6 +2381,19 @@ void RegionManager::check_peer_count(int64_t region_id,
             DB_WARNING("table_id: %ld, region_id: %ld, remove peer: %s, because of not in replicaDist.",
                        table_id, region_id, remove_peer.c_str());
         }
+        // 负载调度增加的peer，删除热点store上的peer
+        std::string load_balance_remove_peer;
+        if (remove_peer.empty() && LoadBalanceScheduler::get_instance()->get_pending_remove_peer(
+                    region_id, &load_balance_remove_peer)
+                && candidate_remove_peers.count(load_balance_remove_peer) > 0) {
+            remove_peer = load_balance_remove_peer;
+            // 是leader时下面先transfer leader，下轮心跳再删除
+            if (remove_peer != leader_region_info.leader()) {
+                LoadBalanceScheduler::get_instance()->clear_pending_remove_peer(region_id);
+            }
+            DB_WARNING("table_id: %ld, region_id: %ld, remove peer: %s, because of load balance.",
+                       table_id, region_id, remove_peer.c_str());
+        }
         // 按照用户指定的副本分布来做remove_peer
         int64_t max_peer_count = 0;
         if (remove_peer.empty()) {
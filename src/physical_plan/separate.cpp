@@ -539,6 +539,25 @@ bool Separate::need_separate_single_txn(QueryContext* ctx, const int64_t main_ta
     return false;
 }
 
+// 复用的dml执行树与本次单语句事务的需要不一致时，就地补齐事务节点或按事务执行，不报错
+int Separate::check_reused_single_txn(QueryContext* ctx, PacketNode* packet_node,
+        const int64_t main_table_id, pb::OpType op_type) {
+    bool has_txn_node = (packet_node->get_node(pb::SIGNEL_TXN_MANAGER_NODE) != nullptr);
+    bool need_txn = need_separate_single_txn(ctx, main_table_id);
+    if (need_txn && !has_txn_node) {
+        DB_NOTICE("reused plan add single txn node, table_id:%ld", main_table_id);
+        return separate_single_txn(ctx, packet_node, op_type);
+    }
+    if (!need_txn && has_txn_node) {
+        // 已有事务节点，本次同样按单语句事务执行
+        auto client = ctx->client_conn;
+        if (client != nullptr && client->txn_id == 0) {
+            client->on_begin();
+        }
+    }
+    return 0;
+}
+
 bool Separate::need_separate_plan(QueryContext* ctx, const int64_t main_table_id) {
     if (_factory->has_global_index(main_table_id) || ctx->execute_global_flow) {
         return true;
@@ -595,7 +614,13 @@ int Separate::separate_insert(QueryContext* ctx) {
     ExecNode* plan = ctx->root;
     InsertNode* insert_node = static_cast<InsertNode*>(plan->get_node(pb::INSERT_NODE));
     PacketNode* packet_node = static_cast<PacketNode*>(plan->get_node(pb::PACKET_NODE));
-    // TODO:复用prepare的计划
+    InsertManagerNode* manager_node_inter = static_cast<InsertManagerNode*>(plan->get_node(pb::INSERT_MANAGER_NODE));
+    // 复用prepare的计划，只更新本次的记录和路由
+    if (manager_node_inter != nullptr) {
+        manager_node_inter->set_records(ctx->insert_records);
+        manager_node_inter->set_region_infos(insert_node->region_infos());
+        return check_reused_single_txn(ctx, packet_node, insert_node->table_id(), pb::OP_INSERT);
+    }
 
     pb::PlanNode pb_manager_node;
     pb_manager_node.set_node_type(pb::INSERT_MANAGER_NODE);
@@ -790,6 +815,12 @@ int Separate::separate_update(QueryContext* ctx) {
     UpdateNode* update_node = static_cast<UpdateNode*>(plan->get_node(pb::UPDATE_NODE));
     std::vector<ExecNode*> scan_nodes;
     plan->get_node(pb::SCAN_NODE, scan_nodes);
+    UpdateManagerNode* manager_node_inter = static_cast<UpdateManagerNode*>(plan->get_node(pb::UPDATE_MANAGER_NODE));
+    // 复用prepare的计划
+    if (manager_node_inter != nullptr) {
+        manager_node_inter->set_region_infos(static_cast<RocksdbScanNode*>(scan_nodes[0])->region_infos());
+        return check_reused_single_txn(ctx, packet_node, update_node->table_id(), pb::OP_UPDATE);
+    }
     pb::PlanNode pb_manager_node;
     pb_manager_node.set_node_type(pb::UPDATE_MANAGER_NODE);
     pb_manager_node.set_limit(-1);
@@ -831,6 +862,12 @@ int Separate::separate_delete(QueryContext* ctx) {
     std::vector<ExecNode*> scan_nodes;
     plan->get_node(pb::SCAN_NODE, scan_nodes);
     int64_t main_table_id = delete_node->table_id();
+    DeleteManagerNode* manager_node_inter = static_cast<DeleteManagerNode*>(plan->get_node(pb::DELETE_MANAGER_NODE));
+    // 复用prepare的计划
+    if (manager_node_inter != nullptr) {
+        manager_node_inter->set_region_infos(static_cast<RocksdbScanNode*>(scan_nodes[0])->region_infos());
+        return check_reused_single_txn(ctx, packet_node, main_table_id, pb::OP_DELETE);
+    }
     pb::PlanNode pb_manager_node;
     pb_manager_node.set_node_type(pb::DELETE_MANAGER_NODE);
     pb_manager_node.set_limit(-1);
@@ -1010,6 +1047,7 @@ int Separate::separate_single_txn(QueryContext* ctx, T* node, pb::OpType op_type
     }
     txn_manager_node->init(pb_plan_node);
     txn_manager_node->set_op_type(op_type);
+    txn_manager_node->set_reuse_plan(ctx->reuse_prepared_plan);
     ExecNode* dml_root = node->children(0);
     node->clear_children();
     node->add_child(txn_manager_node);
@@ -17,7 +17,7 @@
 
 namespace baikaldb {
 
-EpollInfo::EpollInfo(): _epfd(-1), _event_size(0) {}
+EpollInfo::EpollInfo(): _epfd(-1) {}
 
 EpollInfo::~EpollInfo() {
     if (_epfd > 0) {
@@ -25,48 +25,81 @@ EpollInfo::~EpollInfo() {
     }
 }
 
-bool EpollInfo::init() {
-    _event_size = CONFIG_MPL_EPOLL_MAX_SIZE;
+bool EpollInfo::init(int reactor_id) {
+    _reactor_id = reactor_id;
+    _events.resize(CONFIG_MPL_EPOLL_MAX_SIZE);
     _epfd = epoll_create(CONFIG_MPL_EPOLL_MAX_SIZE);
     if (_epfd < 0) {
         DB_FATAL("epoll_create() failed.");
         return false;
     }
+    std::string prefix = "epoll_reactor_" + std::to_string(reactor_id);
+    _conn_count.expose(prefix + "_conn_count");
+    _accept_count.expose(prefix + "_accept_count");
+    _event_count.expose(prefix + "_event_count");
     return true;
 }
 
 int EpollInfo::wait(uint32_t timeout) {
-    return epoll_wait(_epfd, _events, _event_size, timeout);
+    return epoll_wait(_epfd, &_events[0], _events.size(), timeout);
 }
 
 bool EpollInfo::set_fd_mapping(int fd, SmartSocket sock) {
-    if (fd < 0 || fd >= CONFIG_MPL_EPOLL_MAX_SIZE) {
+    if (fd < 0) {
         DB_FATAL("Wrong fd[%d]", fd);
         return false;
     }
-    std::unique_lock<std::mutex> lock(_mutex);
-    _fd_mapping[fd] = sock;
+    auto& fd_shard = shard(fd);
+    std::unique_lock<std::mutex> lock(fd_shard.mutex);
+    auto& old_sock = fd_shard.sockets[fd];
+    if (old_sock == nullptr) {
+        _conn_count << 1;
+    }
+    old_sock = sock;
     return true;
 }
 
 SmartSocket EpollInfo::get_fd_mapping(int fd) {
-    if (fd < 0 || fd >= CONFIG_MPL_EPOLL_MAX_SIZE) {
+    if (fd < 0) {
         DB_FATAL("Wrong fd[%d]", fd);
         return SmartSocket();
     }
-    std::unique_lock<std::mutex> lock(_mutex);
-    return _fd_mapping[fd];
+    auto& fd_shard = shard(fd);
+    std::unique_lock<std::mutex> lock(fd_shard.mutex);
+    auto iter = fd_shard.sockets.find(fd);
+    if (iter == fd_shard.sockets.end()) {
+        return SmartSocket();
+    }
+    return iter->second;
 }
 
 void EpollInfo::delete_fd_mapping(int fd) {
-    if (fd < 0 || fd >= CONFIG_MPL_EPOLL_MAX_SIZE) {
+    if (fd < 0) {
         return;
     }
-    std::unique_lock<std::mutex> lock(_mutex);
-    _fd_mapping[fd] = SmartSocket();
+    auto& fd_shard = shard(fd);
+    std::unique_lock<std::mutex> lock(fd_shard.mutex);
+    if (fd_shard.sockets.erase(fd) > 0) {
+        _conn_count << -1;
+    }
     return;
 }
 
+void EpollInfo::traverse_fd_mapping(const std::function<void(const SmartSocket&)>& func) {
+    std::vector<SmartSocket> sockets;
+    for (auto& fd_shard : _fd_mapping) {
+        std::unique_lock<std::mutex> lock(fd_shard.mutex);
+        for (auto& pair : fd_shard.sockets) {
+            if (pair.second != nullptr) {
+                sockets.emplace_back(pair.second);
+            }
+        }
+    }
+    for (auto& sock : sockets) {
+        func(sock);
+    }
+}
+
 int EpollInfo::get_ready_fd(int cnt) {
     return _events[cnt].data.fd;
 }
@@ -135,19 +168,19 @@ bool EpollInfo::poll_events_delete(SmartSocket sock) {
 }
 
 bool EpollInfo::all_txn_time_large_then(int64_t query_time, int64_t table_id) {
-    for (auto i = 0; i < CONFIG_MPL_EPOLL_MAX_SIZE; ++i) {
-        auto smart_socket = get_fd_mapping(i);
-        if (smart_socket == nullptr) {
-            continue;
+    bool all_large = true;
+    traverse_fd_mapping([&all_large, query_time, table_id](const SmartSocket& smart_socket) {
+        if (!all_large) {
+            return;
         }
         if (smart_socket->is_txn_tid_exist(table_id) && smart_socket->txn_start_time != 0) {
             if (smart_socket->txn_start_time < query_time) {
                 DB_DEBUG("start_time %ld", smart_socket->txn_start_time);
-                return false;
+                all_large = false;
             }
         }
-    }
-    return true;
+    });
+    return all_large;
 }
 
 } // namespace baikal
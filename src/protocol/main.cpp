@@ -28,6 +28,7 @@
 #include "schema_factory.h"
 #include "information_schema.h"
 #include "memory_profile.h"
+#include "spill_file.h"
 
 namespace baikaldb {
 
@@ -102,6 +103,7 @@ int main(int argc, char **argv) {
     baikaldb::ShowHelper::get_instance()->init();
     baikaldb::MemoryGCHandler::get_instance()->init();
     baikaldb::MemTrackerPool::get_instance()->init();
+    baikaldb::SpillFile::clean_stale_files();
     // Initail server.
     baikaldb::NetworkServer* server = baikaldb::NetworkServer::get_instance();
     if (!server->init()) {
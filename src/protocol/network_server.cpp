@@ -25,6 +25,7 @@
 #include "log.h"
 #include <gflags/gflags.h>
 #include <time.h>
+#include <thread>
 
 namespace bthread {
 DECLARE_int32(bthread_concurrency); //bthread.cpp
@@ -35,6 +36,7 @@ namespace baikaldb {
 DEFINE_int32(backlog, 1024, "Size of waitting queue in listen()");
 DEFINE_int32(baikal_port, 28282, "Server port");
 DEFINE_int32(epoll_timeout, 2000, "Epoll wait timeout in epoll_wait().");
+DEFINE_int32(epoll_reactor_num, 1, "number of epoll reactors, each listens on baikal_port with SO_REUSEPORT, default: 1");
 DEFINE_int32(check_interval, 10, "interval for conn idle timeout");
 DEFINE_int32(connect_idle_timeout_s, 1800, "connection idle timeout threshold (second)");
 DEFINE_int32(slow_query_timeout_s, 60, "slow query threshold (second)");
@@ -852,100 +854,96 @@ void NetworkServer::connection_timeout_check() {
             DB_WARNING("get current time failed.");
             return;
         }
-        if (_epoll_info == NULL) {
-            DB_WARNING("_epoll_info not initialized yet.");
-            return;
-        }
+        for (auto epoll_info : _epoll_infos) {
+            epoll_info->traverse_fd_mapping([&](const SmartSocket& sock) {
+                if (sock == NULL || sock->is_free || sock->fd == -1) {
+                    return;
+                }
 
-        for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-            SmartSocket sock = _epoll_info->get_fd_mapping(idx);
-            if (sock == NULL || sock->is_free || sock->fd == -1) {
-                continue;
-            }
+                // 处理客户端Hang住的情况，server端没有发送handshake包或者auth_result包
+                timeval current;
+                gettimeofday(&current, NULL);
+                int64_t diff_us = (current.tv_sec - sock->connect_time.tv_sec) * 1000000
+                    + (current.tv_usec - sock->connect_time.tv_usec);
+                if (!sock->is_authed && diff_us >= 1000000) {
+                    // 待现有工作处理完成，需要获取锁
+                    if (sock->mutex.try_lock() == false) {
+                        return;
+                    }
+                    if (sock->is_free || sock->fd == -1) {
+                        DB_WARNING("sock is already free.");
+                        sock->mutex.unlock();
+                        return;
+                    }
+                    DB_WARNING("close un_authed connection [fd=%d][ip=%s][port=%d].",
+                            sock->fd, sock->ip.c_str(), sock->port);
+                    sock->shutdown = true;
+                    MachineDriver::get_instance()->dispatch(sock, epoll_info,
+                            sock->shutdown || _shutdown);
+                    return;
+                }
+                time_now = time(NULL);
+                auto ctx = sock->get_query_ctx();
+                if (ctx != nullptr && 
+                        ctx->mysql_cmd != COM_SLEEP) {
+                    if (need_cancel_addrs.size() > 0) {
+                        // cancel dead addr 
+                        sock->cancel_rpc(need_cancel_addrs, sock->fd);
+                        DB_WARNING("%lu addrs is dead, cancel", need_cancel_addrs.size());
+                    }
 
-            // 处理客户端Hang住的情况，server端没有发送handshake包或者auth_result包
-            timeval current;
-            gettimeofday(&current, NULL);
-            int64_t diff_us = (current.tv_sec - sock->connect_time.tv_sec) * 1000000
-                + (current.tv_usec - sock->connect_time.tv_usec);
-            if (!sock->is_authed && diff_us >= 1000000) {
+                    int query_time_diff = time_now - ctx->stat_info.start_stamp.tv_sec;
+                    if (query_time_diff > FLAGS_slow_query_timeout_s) {
+                        DB_NOTICE("query is slow, [cost=%d][fd=%d][ip=%s:%d][now=%ld][active=%ld][user=%s][log_id=%lu][sql=%s]",
+                                query_time_diff, sock->fd, sock->ip.c_str(), sock->port,
+                                time_now, sock->last_active,
+                                sock->user_info->username.c_str(),
+                                ctx->stat_info.log_id,
+                                ctx->sql.c_str());
+                        if (FLAGS_open_to_collect_slow_query_infos) {
+                            SlowQueryInfo slow_query_info(ctx->stat_info.log_id, 
+                                ctx->stat_info.sign,
+                                ctx->stat_info.start_stamp.tv_sec,
+                                ctx->stat_info.end_stamp.tv_sec,
+                                query_time_diff,
+                                ctx->stat_info.num_filter_rows,
+                                ctx->stat_info.num_affected_rows,
+                                ctx->stat_info.num_scan_rows,
+                                ctx->stat_info.num_returned_rows,
+                                sock->ip,
+                                ctx->stat_info.resource_tag,
+                                sock->username,
+                                ctx->stat_info.family,
+                                ctx->stat_info.table,
+                                ctx->sql,
+                                false);
+                            slow_query_map << BvarSlowQueryMap(slow_query_info);
+                        }
+                        return;
+                    }
+                }
+                // 处理连接空闲时间过长的情况，踢掉空闲连接
+                double diff = difftime(time_now, sock->last_active);
+                if ((int32_t)diff < FLAGS_connect_idle_timeout_s) {
+                    return;
+                }
                 // 待现有工作处理完成，需要获取锁
                 if (sock->mutex.try_lock() == false) {
-                    continue;
+                    return;
                 }
                 if (sock->is_free || sock->fd == -1) {
                     DB_WARNING("sock is already free.");
                     sock->mutex.unlock();
-                    continue;
+                    return;
                 }
-                DB_WARNING("close un_authed connection [fd=%d][ip=%s][port=%d].",
-                        sock->fd, sock->ip.c_str(), sock->port);
+                DB_NOTICE("close idle connection [fd=%d][ip=%s:%d][now=%ld][active=%ld][user=%s]",
+                        sock->fd, sock->ip.c_str(), sock->port,
+                        time_now, sock->last_active,
+                        sock->user_info->username.c_str());
                 sock->shutdown = true;
-                MachineDriver::get_instance()->dispatch(sock, _epoll_info,
+                MachineDriver::get_instance()->dispatch(sock, epoll_info,
                         sock->shutdown || _shutdown);
-                continue;
-            }
-            time_now = time(NULL);
-            auto ctx = sock->get_query_ctx();
-            if (ctx != nullptr && 
-                    ctx->mysql_cmd != COM_SLEEP) {
-                if (need_cancel_addrs.size() > 0) {
-                    // cancel dead addr 
-                    sock->cancel_rpc(need_cancel_addrs, sock->fd);
-                    DB_WARNING("%lu addrs is dead, cancel", need_cancel_addrs.size());
-                }
-
-                int query_time_diff = time_now - ctx->stat_info.start_stamp.tv_sec;
-                if (query_time_diff > FLAGS_slow_query_timeout_s) {
-                    DB_NOTICE("query is slow, [cost=%d][fd=%d][ip=%s:%d][now=%ld][active=%ld][user=%s][log_id=%lu][sql=%s]",
-                            query_time_diff, sock->fd, sock->ip.c_str(), sock->port,
-                            time_now, sock->last_active,
-                            sock->user_info->username.c_str(),
-                            ctx->stat_info.log_id,
-                            ctx->sql.c_str());
-                    if (FLAGS_open_to_collect_slow_query_infos) {
-                        SlowQueryInfo slow_query_info(ctx->stat_info.log_id, 
-                            ctx->stat_info.sign,
-                            ctx->stat_info.start_stamp.tv_sec,
-                            ctx->stat_info.end_stamp.tv_sec,
-                            query_time_diff,
-                            ctx->stat_info.num_filter_rows,
-                            ctx->stat_info.num_affected_rows,
-                            ctx->stat_info.num_scan_rows,
-                            ctx->stat_info.num_returned_rows,
-                            sock->ip,
-                            ctx->stat_info.resource_tag,
-                            sock->username,
-                            ctx->stat_info.family,
-                            ctx->stat_info.table,
-                            ctx->sql,
-                            false);
-                        slow_query_map << BvarSlowQueryMap(slow_query_info);
-                    }
-                    continue;
-                }
-            }
-            // 处理连接空闲时间过长的情况，踢掉空闲连接
-            double diff = difftime(time_now, sock->last_active);
-            if ((int32_t)diff < FLAGS_connect_idle_timeout_s) {
-                continue;
-            }
-            // 待现有工作处理完成，需要获取锁
-            if (sock->mutex.try_lock() == false) {
-                continue;
-            }
-            if (sock->is_free || sock->fd == -1) {
-                DB_WARNING("sock is already free.");
-                sock->mutex.unlock();
-                continue;
-            }
-            DB_NOTICE("close idle connection [fd=%d][ip=%s:%d][now=%ld][active=%ld][user=%s]",
-                    sock->fd, sock->ip.c_str(), sock->port,
-                    time_now, sock->last_active,
-                    sock->user_info->username.c_str());
-            sock->shutdown = true;
-            MachineDriver::get_instance()->dispatch(sock, _epoll_info,
-                    sock->shutdown || _shutdown);
+            });
         }
     };
     while (!_shutdown) {
@@ -1056,7 +1054,6 @@ int NetworkServer::insert_slow_query_infos(const std::string& slow_query_info_va
 NetworkServer::NetworkServer():
         _is_init(false),
         _shutdown(false),
-        _epoll_info(NULL),
         _heart_beat_count("heart_beat_count") {
 }
 
@@ -1067,10 +1064,10 @@ NetworkServer::~NetworkServer() {
     _other_heartbeat_bth.join();
     _agg_sql_bth.join();
     _health_check_bth.join();
-    if (_epoll_info != NULL) {
-        delete _epoll_info;
-        _epoll_info = NULL;
+    for (auto epoll_info : _epoll_infos) {
+        delete epoll_info;
     }
+    _epoll_infos.clear();
 }
 
 int NetworkServer::fetch_instance_info() {
@@ -1161,24 +1158,21 @@ void NetworkServer::stop() {
     _heartbeat_bth.join();
     _other_heartbeat_bth.join();
 
-    if (_epoll_info == nullptr) {
-        DB_WARNING("_epoll_info not initialized yet.");
+    if (_epoll_infos.empty()) {
+        DB_WARNING("_epoll_infos not initialized yet.");
         return;
     }
-    for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-        SmartSocket sock = _epoll_info->get_fd_mapping(idx);
-        if (!sock) {
-            continue;
-        }
-        if (sock == nullptr || sock->fd == 0) {
-            continue;
-        }
-
-        // 待现有工作处理完成，需要获取锁
-        if (sock->mutex.try_lock()) {
-            sock->shutdown = true;
-            MachineDriver::get_instance()->dispatch(sock, _epoll_info, true);
-        }
+    for (auto epoll_info : _epoll_infos) {
+        epoll_info->traverse_fd_mapping([epoll_info](const SmartSocket& sock) {
+            if (sock == nullptr || sock->fd == 0) {
+                return;
+            }
+            // 待现有工作处理完成，需要获取锁
+            if (sock->mutex.try_lock()) {
+                sock->shutdown = true;
+                MachineDriver::get_instance()->dispatch(sock, epoll_info, true);
+            }
+        });
     }
     return;
 }
@@ -1197,7 +1191,7 @@ bool NetworkServer::start() {
     return true;
 }
 
-SmartSocket NetworkServer::create_listen_socket() {
+SmartSocket NetworkServer::create_listen_socket(bool reuse_port) {
     // Fetch a socket.
     SocketFactory* socket_pool = SocketFactory::get_instance();
     SmartSocket sock = socket_pool->create(SERVER_SOCKET);
@@ -1211,6 +1205,11 @@ SmartSocket NetworkServer::create_listen_socket() {
         DB_FATAL("setsockopt fail");
         return SmartSocket();
     }
+    // 多reactor时每个reactor各自监听同一端口，由内核分发新连接
+    if (reuse_port && setsockopt(sock->fd, SOL_SOCKET, SO_REUSEPORT, &val, sizeof(val)) != 0) {
+        DB_FATAL("setsockopt SO_REUSEPORT fail, errno=%d, error=%s", errno, strerror(errno));
+        return SmartSocket();
+    }
     
     if (FLAGS_enable_tcp_keep_alive && set_keep_tcp_alive(sock->fd) != 0) {
         DB_FATAL("setsockopt fail");
@@ -1291,6 +1290,9 @@ int NetworkServer::make_worker_process() {
         DB_FATAL("Failed to init machine driver.");
         exit(-1);
     }
+    if (init_reactors(std::max(FLAGS_epoll_reactor_num, 1)) != 0) {
+        return -1;
+    }
     _conn_check_bth.run([this]() {connection_timeout_check();});
     _heartbeat_bth.run([this]() {report_heart_beat();});
     _other_heartbeat_bth.run([this]() {report_other_heart_beat();});
@@ -1298,38 +1300,72 @@ int NetworkServer::make_worker_process() {
     if (FLAGS_need_health_check) {
         _health_check_bth.run([this]() {store_health_check();});
     }
+    int ret = run_reactors();
+    DB_NOTICE("Baikal instance exit.");
+    return ret;
+}
 
-
-    // Create listen socket.
-    _service = create_listen_socket();
-    if (_service == nullptr) {
-        DB_FATAL("Failed to create listen socket.");
-        return -1;
+int NetworkServer::init_reactors(int reactor_num) {
+    for (int i = 0; i < reactor_num; ++i) {
+        // Create listen socket.
+        SmartSocket service = create_listen_socket(reactor_num > 1);
+        if (service == nullptr) {
+            DB_FATAL("Failed to create listen socket.");
+            return -1;
+        }
+        // Initail epoll info.
+        EpollInfo* epoll_info = new EpollInfo();
+        _epoll_infos.emplace_back(epoll_info);
+        _services.emplace_back(service);
+        if (!epoll_info->init(i)) {
+            DB_FATAL("initial epoll info failed.");
+            return -1;
+        }
+        if (!epoll_info->poll_events_add(service, EPOLLIN)) {
+            DB_FATAL("poll_events_add add socket[%d] error", service->fd);
+            return -1;
+        }
     }
+    return 0;
+}
 
-    // Initail epoll info.
-    _epoll_info = new EpollInfo();
-    if (!_epoll_info->init()) {
-        DB_FATAL("initial epoll info failed.");
-        return -1;
+int NetworkServer::run_reactors() {
+    // epoll_wait会阻塞，其余reactor使用独立线程，不占用bthread worker
+    std::vector<std::thread> reactor_threads;
+    for (size_t i = 1; i < _epoll_infos.size(); ++i) {
+        reactor_threads.emplace_back([this, i]() {
+            if (reactor_loop(_epoll_infos[i], _services[i]) != 0) {
+                _shutdown = true;
+            }
+        });
     }
-    if (!_epoll_info->poll_events_add(_service, EPOLLIN)) {
-        DB_FATAL("poll_events_add add socket[%d] error", _service->fd);
-        return -1;
+    int ret = reactor_loop(_epoll_infos[0], _services[0]);
+    if (ret != 0) {
+        _shutdown = true;
+    }
+    for (auto& thread : reactor_threads) {
+        thread.join();
     }
+    return ret;
+}
+
+int NetworkServer::reactor_loop(EpollInfo* epoll_info, SmartSocket service) {
     // Process epoll events.
-    int listen_fd = _service->fd;
+    int listen_fd = service->fd;
     SocketFactory* socket_pool = SocketFactory::get_instance();
     while (!_shutdown) {
-        int fd_cnt = _epoll_info->wait(FLAGS_epoll_timeout);
+        int fd_cnt = epoll_info->wait(FLAGS_epoll_timeout);
+        if (fd_cnt > 0) {
+            epoll_info->add_event_count(fd_cnt);
+        }
         if (_shutdown) {
             // Delete event from epoll.
-            _epoll_info->poll_events_delete(_service);
+            epoll_info->poll_events_delete(service);
         }
 
         for (int cnt = 0; cnt < fd_cnt; ++cnt) {
-            int fd = _epoll_info->get_ready_fd(cnt);
-            int event = _epoll_info->get_ready_events(cnt);
+            int fd = epoll_info->get_ready_fd(cnt);
+            int event = epoll_info->get_ready_events(cnt);
 
             // New connection.
             if (!_shutdown && listen_fd == fd) {
@@ -1341,11 +1377,7 @@ int NetworkServer::make_worker_process() {
                     DB_WARNING("Wrong fd:[%d] errno:%d", client_fd, errno);
                     continue;
                 }
-                if (client_fd >= CONFIG_MPL_EPOLL_MAX_SIZE) {
-                    DB_WARNING("Wrong fd.fd=%d >= CONFIG_MENU_EPOLL_MAX_SIZE", client_fd);
-                    close(client_fd);
-                    continue;
-                }
+                epoll_info->add_accept_count();
                 // Set flags of client socket.
                 if (!set_fd_flags(client_fd)) {
                     DB_WARNING("client_fd=%d set_fd_flags error close(client)", client_fd);
@@ -1372,11 +1404,11 @@ int NetworkServer::make_worker_process() {
                 client_socket->server_instance_id = _instance_id;
 
                 // Set socket mapping and event.
-                if (!_epoll_info->set_fd_mapping(client_socket->fd, client_socket)) {
+                if (!epoll_info->set_fd_mapping(client_socket->fd, client_socket)) {
                     DB_FATAL("Failed to set fd mapping.");
                     return -1;
                 }
-                _epoll_info->poll_events_add(client_socket, 0);
+                epoll_info->poll_events_add(client_socket, 0);
 
                 // New connection will be handled immediately.
                 fd = client_fd;
@@ -1388,7 +1420,7 @@ int NetworkServer::make_worker_process() {
             }
 
             // Check if socket in fd_mapping or not.
-            SmartSocket sock = _epoll_info->get_fd_mapping(fd);
+            SmartSocket sock = epoll_info->get_fd_mapping(fd);
             if (sock == NULL) {
                 DB_DEBUG("Can't find fd in fd_mapping, fd:[%d], listen_fd:[%d], fd_cnt:[%d]",
                             fd, listen_fd, cnt);
@@ -1436,15 +1468,15 @@ int NetworkServer::make_worker_process() {
                 }
                 // close the socket event on epoll when the sock is being process
                 // and reopen it when finish process
-                _epoll_info->poll_events_mod(sock, 0);
-                MachineDriver::get_instance()->dispatch(sock, _epoll_info,
+                epoll_info->poll_events_mod(sock, 0);
+                MachineDriver::get_instance()->dispatch(sock, epoll_info,
                     sock->shutdown || _shutdown);
             } else {
                 DB_WARNING("unknown network socket type[%d].", sock->socket_type);
             }
         }
     }
-    DB_NOTICE("Baikal instance exit.");
+    DB_NOTICE("epoll reactor %d exit.", epoll_info->reactor_id());
     return 0;
 }
 
@@ -700,9 +700,13 @@ bool ShowHelper::_show_socket(const SmartSocket& client, const std::vector<std::
         fields.emplace_back(field);
     } while (0);
     std::map<std::string, std::map<std::string, int>> ip_map;
-    EpollInfo* epoll_info = NetworkServer::get_instance()->get_epoll_info();
-    for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-        const SmartSocket& sock = epoll_info->get_fd_mapping(idx);
+    std::vector<SmartSocket> sockets;
+    for (auto epoll_info : NetworkServer::get_instance()->get_epoll_infos()) {
+        epoll_info->traverse_fd_mapping([&sockets](const SmartSocket& sock) {
+            sockets.emplace_back(sock);
+        });
+    }
+    for (const SmartSocket& sock : sockets) {
         if (sock == NULL || sock->is_free || sock->fd == -1 || sock->ip == "") {
             continue;
         }
@@ -804,9 +808,13 @@ bool ShowHelper::_show_processlist(const SmartSocket& client, const std::vector<
     // Make rows.
     std::vector< std::vector<std::string> > rows;
     rows.reserve(10);
-    EpollInfo* epoll_info = NetworkServer::get_instance()->get_epoll_info();
-    for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-        const SmartSocket& sock = epoll_info->get_fd_mapping(idx);
+    std::vector<SmartSocket> sockets;
+    for (auto epoll_info : NetworkServer::get_instance()->get_epoll_infos()) {
+        epoll_info->traverse_fd_mapping([&sockets](const SmartSocket& sock) {
+            sockets.emplace_back(sock);
+        });
+    }
+    for (const SmartSocket& sock : sockets) {
         if (sock == NULL || sock->is_free || sock->fd == -1 || sock->ip == "") {
             if (sock != NULL) {
                 DB_WARNING_CLIENT(sock, "processlist, free:%d", sock->is_free);
@@ -1537,7 +1537,7 @@ void StateMachine::client_free(SmartSocket sock, EpollInfo* epoll_info) {
     }
     _print_query_time(sock);
     sock->reset_query_ctx(new QueryContext);
-    if (sock->fd > 0 && sock->fd < (int)CONFIG_MPL_EPOLL_MAX_SIZE) {
+    if (sock->fd > 0) {
         epoll_info->delete_fd_mapping(sock->fd);
     }
     epoll_info->poll_events_delete(sock);
@@ -1808,7 +1808,8 @@ bool StateMachine::_handle_client_query_common_query(SmartSocket client) {
             client->on_commit_rollback();
          }
         client->query_ctx->stat_info.query_exec_time = cost.get_time();
-        client->query_ctx->stat_info.send_buf_size = client->send_buf->_size;
+        // PacketNode流式发送的部分已累加
+        client->query_ctx->stat_info.send_buf_size += client->send_buf->_size;
     } else {
         ret = PhysicalPlanner::full_export_start(client->query_ctx.get(), client->send_buf);
         client->query_ctx->stat_info.query_exec_time += cost.get_time();
@@ -3,10 +3,15 @@
 #include "network_socket.h"
 #include "ddl_work_planner.h"
 #include "network_server.h"
+#include "store_interact.hpp"
+#include "mysql_err_code.h"
 
 namespace baikaldb {
 
 DEFINE_int32(worker_number, 20, "baikaldb worker number.");
+DEFINE_bool(ddl_index_use_sst_ingest, false, "build local index by store side sst ingest instead of "
+        "txn backfill, fall back when not supported, default: false");
+DEFINE_int32(ddl_index_sst_timeout_ms, 3600 * 1000, "timeout of building index sst for one region, default: 1h");
  
 int TaskManager::init() {
     _workers.run([this](){
@@ -63,9 +68,16 @@ void TaskManager::process_txn_ddl_work(pb::DdlWorkInfo work) {
                 continue;
             }
         }
-        auto epool_ptr = NetworkServer::get_instance()->get_epoll_info();
-        if (epool_ptr != nullptr) {
-            if (epool_ptr->all_txn_time_large_then(write_only_time, work.table_id())) {
+        auto& epoll_infos = NetworkServer::get_instance()->get_epoll_infos();
+        if (!epoll_infos.empty()) {
+            bool all_large = true;
+            for (auto epoll_info : epoll_infos) {
+                if (!epoll_info->all_txn_time_large_then(write_only_time, work.table_id())) {
+                    all_large = false;
+                    break;
+                }
+            }
+            if (all_large) {
                 DB_NOTICE("epool time write_only_time %ld", write_only_time);
                 work.set_status(pb::DdlWorkDone);
                 break;
@@ -84,6 +96,15 @@ void TaskManager::process_txn_ddl_work(pb::DdlWorkInfo work) {
 void TaskManager::process_ddl_work(pb::RegionDdlWork work) {
     DB_NOTICE("begin ddl work task_%ld_%ld : %s", work.table_id(), work.region_id(), work.ShortDebugString().c_str());
     int ret = 0;
+    if (FLAGS_ddl_index_use_sst_ingest && work.op_type() == pb::OP_ADD_INDEX
+            && ingest_index_sst(work) == 0) {
+        if (TaskFactory<pb::RegionDdlWork>::get_instance()->finish_task(work) != 0) {
+            DB_WARNING("finish work error");
+        }
+        DB_NOTICE("ddl work task_%ld_%ld finish by sst ingest! %s",
+                work.table_id(), work.region_id(), work.ShortDebugString().c_str());
+        return;
+    }
     SmartSocket client(new NetworkSocket);
     client->query_ctx->client_conn = client.get();
     client->is_index_ddl = true;
@@ -115,4 +136,57 @@ void TaskManager::process_ddl_work(pb::RegionDdlWork work) {
     DB_NOTICE("ddl work task_%ld_%ld finish ok! %s", work.table_id(), work.region_id(), work.ShortDebugString().c_str());
 }
 
+int TaskManager::ingest_index_sst(pb::RegionDdlWork& work) {
+    auto index_ptr = SchemaFactory::get_instance()->get_index_info_ptr(work.index_id());
+    if (index_ptr == nullptr || index_ptr->is_global
+            || (index_ptr->type != pb::I_KEY && index_ptr->type != pb::I_UNIQ)) {
+        return -1;
+    }
+    pb::RegionInfo info;
+    if (SchemaFactory::get_instance()->get_region_info(work.table_id(), work.region_id(), info) != 0) {
+        DB_WARNING("task_%ld_%ld region info not found", work.table_id(), work.region_id());
+        return -1;
+    }
+    // region分裂或merge后范围变化，按key范围走事务回填
+    if (info.start_key() != work.start_key() || info.end_key() != work.end_key()) {
+        DB_NOTICE("task_%ld_%ld region range changed", work.table_id(), work.region_id());
+        return -1;
+    }
+    pb::StoreReq req;
+    pb::StoreRes res;
+    req.set_op_type(pb::OP_INGEST_INDEX_SST);
+    req.set_region_id(info.region_id());
+    req.set_region_version(info.version());
+    req.mutable_ddlwork_info()->set_table_id(work.table_id());
+    req.mutable_ddlwork_info()->set_index_id(work.index_id());
+    req.mutable_ddlwork_info()->set_op_type(pb::OP_ADD_INDEX);
+    StoreReqOptions options;
+    options.request_timeout = FLAGS_ddl_index_sst_timeout_ms;
+    StoreInteract interact(info.leader(), options);
+    TimeCost cost;
+    interact.send_request_for_leader("query", req, res);
+    if (res.errcode() == pb::SUCCESS) {
+        work.set_status(pb::DdlWorkDone);
+        DB_NOTICE("task_%ld_%ld build index sst lines: %ld, cost: %ld",
+                work.table_id(), work.region_id(), res.affected_rows(), cost.get_time());
+        return 0;
+    }
+    if (res.mysql_errcode() == ER_DUP_ENTRY) {
+        work.set_status(pb::DdlWorkDupUniq);
+        DB_WARNING("task_%ld_%ld build index sst dup uniq: %s",
+                work.table_id(), work.region_id(), res.errmsg().c_str());
+        return 0;
+    }
+    if (res.errcode() == pb::EXEC_FAIL) {
+        // 已提交到raft后leader本地构建失败，由meta重试或回滚，不再回填
+        work.set_status(pb::DdlWorkFail);
+        DB_WARNING("task_%ld_%ld build index sst fail: %s",
+                work.table_id(), work.region_id(), res.ShortDebugString().c_str());
+        return 0;
+    }
+    DB_WARNING("task_%ld_%ld build index sst fail, fall back to txn, res: %s",
+            work.table_id(), work.region_id(), res.ShortDebugString().c_str());
+    return -1;
+}
+
 } // namespace baikaldb
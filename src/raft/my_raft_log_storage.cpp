@@ -17,9 +17,13 @@
 #include "raft_log_compaction_filter.h"
 #include "can_add_peer_setter.h"
 #include "concurrency.h"
+#include "raft_log_writer.h"
+#include "raft_log_cache.h"
 #include "proto/store.interface.pb.h"
 namespace baikaldb {
 DECLARE_int32(rocksdb_cost_sample);
+DECLARE_bool(raft_log_group_write);
+DECLARE_bool(raft_log_sync);
 
 static int parse_my_raft_log_uri(const std::string& uri, std::string& id, bool& is_binlog){
     size_t pos = uri.find("id=");
@@ -50,7 +54,8 @@ MyRaftLogStorage::MyRaftLogStorage(
             _region_id(region_id),
             _db(db),
             _raftlog_handle(raftlog_handle),
-            _binlog_handle(binlog_handle) {
+            _binlog_handle(binlog_handle),
+            _cache_owner(RaftLogCache::get_instance()->new_owner()) {
     if (_binlog_handle != NULL) {
         _is_binlog_region = true;
     }
@@ -58,6 +63,9 @@ MyRaftLogStorage::MyRaftLogStorage(
 }
 
 MyRaftLogStorage::~MyRaftLogStorage() {
+    if (_region_id != 0) {
+        RaftLogCache::get_instance()->remove(_region_id, _cache_owner);
+    }
     bthread_mutex_destroy(&_mutex);
 }
 
@@ -112,6 +120,10 @@ int MyRaftLogStorage::init(braft::ConfigurationManager* configuration_manager) {
                 _region_id);
         return -1;
     }
+    if (!_is_binlog_region) {
+        // 重建的实例接管本region的日志缓存
+        RaftLogCache::get_instance()->set_owner(_region_id, _cache_owner);
+    }
     int64_t first_log_index = 1;
     int64_t last_log_index = 0;
     std::string string_first_log_index;
@@ -270,6 +282,16 @@ int MyRaftLogStorage::get_binlog_entry(rocksdb::Slice& raftlog_value_slice, std:
 }
 
 braft::LogEntry* MyRaftLogStorage::get_entry(const int64_t index) {
+    if (!_is_binlog_region) {
+        braft::LogEntry* entry = RaftLogCache::get_instance()->get_entry(_region_id, index);
+        if (entry != NULL) {
+            // term不一致说明缓存已过期
+            if (entry->id.term == get_term(index)) {
+                return entry;
+            }
+            entry->Release();
+        }
+    }
     char buf[LOG_DATA_KEY_SIZE];
     _encode_log_data_key(buf, LOG_DATA_KEY_SIZE, index);
     std::string value;
@@ -402,20 +424,28 @@ int MyRaftLogStorage::append_entries(const std::vector<braft::LogEntry*>& entrie
     }
     
     // write date to rocksdb in batch
-    rocksdb::WriteBatch batch;
-    rocksdb::WriteOptions options;
-    //options.sync = true;
-    //options.disableWAL = true;
-    
-    for (auto iter = kv_raftlog_vec.begin(); iter != kv_raftlog_vec.end(); ++iter) {
-        batch.Put(_raftlog_handle, iter->first, iter->second);
-    }
-    
-    for (auto iter = kv_binlog_vec.begin(); iter != kv_binlog_vec.end(); ++iter) {
-        batch.Put(_binlog_handle, iter->first, iter->second);
-    }
-
-    {
+    auto fill_batch = [this, &kv_raftlog_vec, &kv_binlog_vec](rocksdb::WriteBatch* batch) {
+        for (auto iter = kv_raftlog_vec.begin(); iter != kv_raftlog_vec.end(); ++iter) {
+            batch->Put(_raftlog_handle, iter->first, iter->second);
+        }
+        for (auto iter = kv_binlog_vec.begin(); iter != kv_binlog_vec.end(); ++iter) {
+            batch->Put(_binlog_handle, iter->first, iter->second);
+        }
+    };
+    if (FLAGS_raft_log_group_write) {
+        // 与其他region的写入合并提交
+        auto status = RaftLogWriter::get_instance()->write(fill_batch, entries.size());
+        if (!status.ok()) {
+            DB_FATAL("Fail to write db, region_id: %ld, err_mes:%s",
+                    _region_id, status.ToString().c_str());
+            return -1;
+        }
+    } else {
+        rocksdb::WriteBatch batch;
+        rocksdb::WriteOptions options;
+        options.sync = FLAGS_raft_log_sync;
+        //options.disableWAL = true;
+        fill_batch(&batch);
         Concurrency::get_instance()->raft_write_concurrency.increase_wait();
         ON_SCOPE_EXIT([]() {
                 Concurrency::get_instance()->raft_write_concurrency.decrease_broadcast();
@@ -439,6 +469,9 @@ int MyRaftLogStorage::append_entries(const std::vector<braft::LogEntry*>& entrie
         }
         _last_log_index.fetch_add(entries.size());
     }
+    if (!_is_binlog_region) {
+        RaftLogCache::get_instance()->append(_region_id, _cache_owner, entries);
+    }
     //DB_WARNING("append_entry, entries.size:%ld, time_cost:%ld, region_id: %ld",
     //            entries.size(), time_cost.get_time(), _region_id);
     return (int)entries.size();
@@ -459,6 +492,7 @@ int MyRaftLogStorage::truncate_prefix(const int64_t first_index_kept) {
         std::unique_lock<bthread_mutex_t> lck(_mutex);
         _term_map.truncate_prefix(first_index_kept);
     }
+    RaftLogCache::get_instance()->truncate_prefix(_region_id, _cache_owner, first_index_kept);
     CanAddPeerSetter::get_instance()->set_can_add_peer(_region_id);
     //write first_log_index to rocksdb, real delete when compaction
     char key_buf[LOG_META_KEY_SIZE]; 
@@ -518,6 +552,7 @@ int MyRaftLogStorage::truncate_suffix(const int64_t last_index_kept) {
     _term_map.truncate_suffix(last_index_kept);
     _last_log_index.store(last_index_kept);
     lck.unlock();
+    RaftLogCache::get_instance()->truncate_suffix(_region_id, _cache_owner, last_index_kept);
     DB_WARNING("Truncating region_id: %ld to last index kept:%ld from last log index:%ld",
             _region_id, last_index_kept, _last_log_index.load()); 
     // delete from rocksdb
@@ -0,0 +1,226 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "raft_log_cache.h"
+#include <algorithm>
+#include <gflags/gflags.h>
+
+namespace baikaldb {
+DEFINE_int64(raft_log_cache_capacity_mb, 0, "store raft log entry cache size, 0 means disabled");
+DEFINE_int32(raft_log_cache_region_entries, 1024, "max cached raft log entries of one region, default: 1024");
+
+bool RaftLogCache::enabled() const {
+    return FLAGS_raft_log_cache_capacity_mb > 0;
+}
+
+void RaftLogCache::pop_front(Shard& s, std::deque<CacheEntry>& entries) {
+    s.bytes -= entries.front().data.size();
+    s.entry_count--;
+    _used_bytes << -(int64_t)entries.front().data.size();
+    entries.pop_front();
+}
+
+void RaftLogCache::pop_back(Shard& s, std::deque<CacheEntry>& entries) {
+    s.bytes -= entries.back().data.size();
+    s.entry_count--;
+    _used_bytes << -(int64_t)entries.back().data.size();
+    entries.pop_back();
+}
+
+void RaftLogCache::evict(Shard& s) {
+    int64_t shard_capacity = FLAGS_raft_log_cache_capacity_mb * 1024 * 1024LL / SHARD_COUNT;
+    while (s.bytes > shard_capacity && !s.append_order.empty()) {
+        auto pair = s.append_order.front();
+        s.append_order.pop_front();
+        auto iter = s.region_entries.find(pair.first);
+        if (iter == s.region_entries.end()) {
+            continue;
+        }
+        auto& entries = iter->second;
+        // 只淘汰仍在缓存中的最老日志，过期项直接跳过
+        if (!entries.empty() && entries.front().index == pair.second) {
+            pop_front(s, entries);
+        }
+        if (entries.empty()) {
+            s.region_entries.erase(iter);
+        }
+    }
+    // truncate留下的过期项过多时重建
+    if (s.append_order.size() > (size_t)s.entry_count * 2 + 1024) {
+        std::deque<std::pair<int64_t, int64_t>> append_order;
+        for (auto& pair : s.append_order) {
+            auto iter = s.region_entries.find(pair.first);
+            if (iter == s.region_entries.end() || iter->second.empty()) {
+                continue;
+            }
+            auto& entries = iter->second;
+            if (pair.second >= entries.front().index && pair.second <= entries.back().index) {
+                append_order.emplace_back(pair);
+            }
+        }
+        s.append_order.swap(append_order);
+    }
+}
+
+void RaftLogCache::clear(Shard& s, int64_t region_id) {
+    auto iter = s.region_entries.find(region_id);
+    if (iter == s.region_entries.end()) {
+        return;
+    }
+    while (!iter->second.empty()) {
+        pop_back(s, iter->second);
+    }
+    s.region_entries.erase(iter);
+}
+
+void RaftLogCache::set_owner(int64_t region_id, int64_t owner) {
+    Shard& s = shard(region_id);
+    std::lock_guard<bthread::Mutex> lock(s.mutex);
+    if (is_owner(s, region_id, owner)) {
+        return;
+    }
+    clear(s, region_id);
+    s.owners[region_id] = owner;
+}
+
+void RaftLogCache::append(int64_t region_id, int64_t owner,
+        const std::vector<braft::LogEntry*>& entries) {
+    if (!enabled() || entries.empty()) {
+        return;
+    }
+    Shard& s = shard(region_id);
+    std::lock_guard<bthread::Mutex> lock(s.mutex);
+    if (!is_owner(s, region_id, owner)) {
+        return;
+    }
+    auto& region_entries = s.region_entries[region_id];
+    for (auto entry : entries) {
+        if (!region_entries.empty() && region_entries.back().index + 1 != entry->id.index) {
+            // 不连续（truncate后重写等），丢弃旧缓存
+            while (!region_entries.empty()) {
+                pop_back(s, region_entries);
+            }
+        }
+        if (entry->type != braft::ENTRY_TYPE_DATA) {
+            // 只缓存数据日志，配置变更等日志保持缓存为空以维持连续
+            while (!region_entries.empty()) {
+                pop_back(s, region_entries);
+            }
+            continue;
+        }
+        CacheEntry cache_entry;
+        cache_entry.index = entry->id.index;
+        cache_entry.term = entry->id.term;
+        cache_entry.data = entry->data;
+        s.bytes += cache_entry.data.size();
+        s.entry_count++;
+        _used_bytes << cache_entry.data.size();
+        region_entries.emplace_back(cache_entry);
+        s.append_order.emplace_back(region_id, entry->id.index);
+        while (region_entries.size() > (size_t)std::max(FLAGS_raft_log_cache_region_entries, 1)) {
+            pop_front(s, region_entries);
+        }
+    }
+    if (region_entries.empty()) {
+        s.region_entries.erase(region_id);
+    }
+    evict(s);
+}
+
+int RaftLogCache::get(int64_t region_id, int64_t index, CacheEntry* entry) {
+    if (!enabled()) {
+        return -1;
+    }
+    Shard& s = shard(region_id);
+    {
+        std::lock_guard<bthread::Mutex> lock(s.mutex);
+        auto iter = s.region_entries.find(region_id);
+        if (iter != s.region_entries.end() && !iter->second.empty()) {
+            auto& entries = iter->second;
+            int64_t first_index = entries.front().index;
+            if (index >= first_index && index <= entries.back().index) {
+                *entry = entries[index - first_index];
+                _hit << 1;
+                return 0;
+            }
+        }
+    }
+    _miss << 1;
+    return -1;
+}
+
+braft::LogEntry* RaftLogCache::get_entry(int64_t region_id, int64_t index) {
+    CacheEntry cache_entry;
+    if (get(region_id, index, &cache_entry) != 0) {
+        return nullptr;
+    }
+    braft::LogEntry* entry = new braft::LogEntry;
+    entry->AddRef();
+    entry->type = braft::ENTRY_TYPE_DATA;
+    entry->id = braft::LogId(index, cache_entry.term);
+    entry->data = cache_entry.data;
+    return entry;
+}
+
+void RaftLogCache::truncate_prefix(int64_t region_id, int64_t owner, int64_t first_index_kept) {
+    Shard& s = shard(region_id);
+    std::lock_guard<bthread::Mutex> lock(s.mutex);
+    if (!is_owner(s, region_id, owner)) {
+        return;
+    }
+    auto iter = s.region_entries.find(region_id);
+    if (iter == s.region_entries.end()) {
+        return;
+    }
+    auto& entries = iter->second;
+    while (!entries.empty() && entries.front().index < first_index_kept) {
+        pop_front(s, entries);
+    }
+    if (entries.empty()) {
+        s.region_entries.erase(iter);
+    }
+}
+
+void RaftLogCache::truncate_suffix(int64_t region_id, int64_t owner, int64_t last_index_kept) {
+    Shard& s = shard(region_id);
+    std::lock_guard<bthread::Mutex> lock(s.mutex);
+    if (!is_owner(s, region_id, owner)) {
+        return;
+    }
+    auto iter = s.region_entries.find(region_id);
+    if (iter == s.region_entries.end()) {
+        return;
+    }
+    auto& entries = iter->second;
+    while (!entries.empty() && entries.back().index > last_index_kept) {
+        pop_back(s, entries);
+    }
+    if (entries.empty()) {
+        s.region_entries.erase(iter);
+    }
+}
+
+void RaftLogCache::remove(int64_t region_id, int64_t owner) {
+    Shard& s = shard(region_id);
+    std::lock_guard<bthread::Mutex> lock(s.mutex);
+    // 已被新实例接管时不清理
+    if (!is_owner(s, region_id, owner)) {
+        return;
+    }
+    clear(s, region_id);
+    s.owners.erase(region_id);
+}
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,68 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "raft_log_writer.h"
+#include "common.h"
+#include "concurrency.h"
+
+namespace baikaldb {
+DEFINE_bool(raft_log_group_write, false, "merge raft log writes of all regions on this store "
+        "into one rocksdb write");
+DEFINE_int64(raft_log_group_window_us, 0, "group writer waits this long for more regions "
+        "before writing, 0 means only merge writes queued during the previous write");
+DEFINE_int32(raft_log_group_max_writers, 512, "max region writes merged into one rocksdb write");
+DEFINE_bool(raft_log_sync, false, "sync wal when writing raft log");
+
+rocksdb::Status RaftLogWriter::write(const FillFunc& fill, int64_t entry_count) {
+    _request_count << 1;
+    Writer w;
+    w.fill = &fill;
+    w.entry_count = entry_count;
+    _committer.submit(&w, FLAGS_raft_log_group_window_us, FLAGS_raft_log_group_max_writers);
+    return w.status;
+}
+
+void RaftLogWriter::write_group(std::vector<Writer*>& group) {
+    TimeCost cost;
+    rocksdb::WriteBatch batch;
+    int64_t entries = 0;
+    for (auto writer : group) {
+        (*writer->fill)(&batch);
+        entries += writer->entry_count;
+    }
+    rocksdb::WriteOptions options;
+    options.sync = FLAGS_raft_log_sync;
+    rocksdb::Status status;
+    {
+        Concurrency::get_instance()->raft_write_concurrency.increase_wait();
+        ON_SCOPE_EXIT([]() {
+            Concurrency::get_instance()->raft_write_concurrency.decrease_broadcast();
+        });
+        status = _db->write(options, &batch);
+    }
+    if (!status.ok()) {
+        DB_FATAL("Fail to write raft log group, writers: %lu, err_mes:%s",
+                group.size(), status.ToString().c_str());
+    }
+    for (auto writer : group) {
+        writer->status = status;
+    }
+    _write_count << 1;
+    _group_size << group.size();
+    _group_entries << entries;
+    _write_latency << cost.get_time();
+}
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
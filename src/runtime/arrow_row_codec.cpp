@@ -0,0 +1,303 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "arrow_row_codec.h"
+#ifdef SNAPPY
+#undef SNAPPY
+#endif
+#ifdef LZ4
+#undef LZ4
+#endif
+#ifdef ZSTD
+#undef ZSTD
+#endif
+#include <arrow/api.h>
+#include <arrow/io/memory.h>
+#include <arrow/ipc/reader.h>
+#include <arrow/ipc/writer.h>
+
+namespace baikaldb {
+using google::protobuf::Descriptor;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::Message;
+using google::protobuf::Reflection;
+
+namespace {
+std::shared_ptr<arrow::DataType> arrow_type(const FieldDescriptor* field) {
+    if (field->is_repeated()) {
+        return nullptr;
+    }
+    switch (field->cpp_type()) {
+        case FieldDescriptor::CPPTYPE_INT32:
+            return arrow::int32();
+        case FieldDescriptor::CPPTYPE_INT64:
+            return arrow::int64();
+        case FieldDescriptor::CPPTYPE_UINT32:
+            return arrow::uint32();
+        case FieldDescriptor::CPPTYPE_UINT64:
+            return arrow::uint64();
+        case FieldDescriptor::CPPTYPE_FLOAT:
+            return arrow::float32();
+        case FieldDescriptor::CPPTYPE_DOUBLE:
+            return arrow::float64();
+        case FieldDescriptor::CPPTYPE_BOOL:
+            return arrow::boolean();
+        case FieldDescriptor::CPPTYPE_STRING:
+            return arrow::binary();
+        default:
+            return nullptr;
+    }
+}
+
+std::shared_ptr<arrow::Schema> make_schema(const Descriptor* descriptor) {
+    std::vector<std::shared_ptr<arrow::Field>> fields;
+    fields.reserve(descriptor->field_count());
+    for (int i = 0; i < descriptor->field_count(); ++i) {
+        auto type = arrow_type(descriptor->field(i));
+        if (type == nullptr) {
+            return nullptr;
+        }
+        fields.emplace_back(arrow::field(descriptor->field(i)->name(), type));
+    }
+    return arrow::schema(fields);
+}
+
+template <typename Builder, typename Getter>
+int build_column(RowBatch* batch, int32_t tuple_id, const FieldDescriptor* field,
+        Getter getter, std::shared_ptr<arrow::Array>* out) {
+    Builder builder;
+    if (!builder.Reserve(batch->size()).ok()) {
+        return -1;
+    }
+    for (size_t i = 0; i < batch->size(); ++i) {
+        MemRow* row = batch->get_row(i).get();
+        Message* message = (row == nullptr) ? nullptr : row->get_tuple(tuple_id);
+        if (message == nullptr) {
+            return -1;
+        }
+        const Reflection* reflection = message->GetReflection();
+        arrow::Status status = reflection->HasField(*message, field) ?
+            builder.Append(getter(reflection, message)) : builder.AppendNull();
+        if (!status.ok()) {
+            DB_WARNING("append arrow value fail: %s", status.ToString().c_str());
+            return -1;
+        }
+    }
+    if (!builder.Finish(out).ok()) {
+        return -1;
+    }
+    return 0;
+}
+
+int build_column(RowBatch* batch, int32_t tuple_id, const FieldDescriptor* field,
+        std::shared_ptr<arrow::Array>* out) {
+    switch (field->cpp_type()) {
+        case FieldDescriptor::CPPTYPE_INT32:
+            return build_column<arrow::Int32Builder>(batch, tuple_id, field,
+                [field](const Reflection* r, Message* m) { return r->GetInt32(*m, field); }, out);
+        case FieldDescriptor::CPPTYPE_INT64:
+            return build_column<arrow::Int64Builder>(batch, tuple_id, field,
+                [field](const Reflection* r, Message* m) { return r->GetInt64(*m, field); }, out);
+        case FieldDescriptor::CPPTYPE_UINT32:
+            return build_column<arrow::UInt32Builder>(batch, tuple_id, field,
+                [field](const Reflection* r, Message* m) { return r->GetUInt32(*m, field); }, out);
+        case FieldDescriptor::CPPTYPE_UINT64:
+            return build_column<arrow::UInt64Builder>(batch, tuple_id, field,
+                [field](const Reflection* r, Message* m) { return r->GetUInt64(*m, field); }, out);
+        case FieldDescriptor::CPPTYPE_FLOAT:
+            return build_column<arrow::FloatBuilder>(batch, tuple_id, field,
+                [field](const Reflection* r, Message* m) { return r->GetFloat(*m, field); }, out);
+        case FieldDescriptor::CPPTYPE_DOUBLE:
+            return build_column<arrow::DoubleBuilder>(batch, tuple_id, field,
+                [field](const Reflection* r, Message* m) { return r->GetDouble(*m, field); }, out);
+        case FieldDescriptor::CPPTYPE_BOOL:
+            return build_column<arrow::BooleanBuilder>(batch, tuple_id, field,
+                [field](const Reflection* r, Message* m) { return r->GetBool(*m, field); }, out);
+        case FieldDescriptor::CPPTYPE_STRING: {
+            std::string scratch;
+            return build_column<arrow::BinaryBuilder>(batch, tuple_id, field,
+                [field, &scratch](const Reflection* r, Message* m) -> const std::string& {
+                    return r->GetStringReference(*m, field, &scratch);
+                }, out);
+        }
+        default:
+            return -1;
+    }
+}
+
+template <typename ArrayType, typename Setter>
+void fill_column(const arrow::Array& column, std::vector<Message*>& messages, Setter setter) {
+    const ArrayType& array = static_cast<const ArrayType&>(column);
+    for (int64_t i = 0; i < array.length(); ++i) {
+        if (!array.IsNull(i)) {
+            Message* message = messages[i];
+            setter(message->GetReflection(), message, array.Value(i));
+        }
+    }
+}
+
+int fill_column(const arrow::Array& column, const FieldDescriptor* field,
+        std::vector<Message*>& messages) {
+    switch (field->cpp_type()) {
+        case FieldDescriptor::CPPTYPE_INT32:
+            fill_column<arrow::Int32Array>(column, messages,
+                [field](const Reflection* r, Message* m, int32_t v) { r->SetInt32(m, field, v); });
+            break;
+        case FieldDescriptor::CPPTYPE_INT64:
+            fill_column<arrow::Int64Array>(column, messages,
+                [field](const Reflection* r, Message* m, int64_t v) { r->SetInt64(m, field, v); });
+            break;
+        case FieldDescriptor::CPPTYPE_UINT32:
+            fill_column<arrow::UInt32Array>(column, messages,
+                [field](const Reflection* r, Message* m, uint32_t v) { r->SetUInt32(m, field, v); });
+            break;
+        case FieldDescriptor::CPPTYPE_UINT64:
+            fill_column<arrow::UInt64Array>(column, messages,
+                [field](const Reflection* r, Message* m, uint64_t v) { r->SetUInt64(m, field, v); });
+            break;
+        case FieldDescriptor::CPPTYPE_FLOAT:
+            fill_column<arrow::FloatArray>(column, messages,
+                [field](const Reflection* r, Message* m, float v) { r->SetFloat(m, field, v); });
+            break;
+        case FieldDescriptor::CPPTYPE_DOUBLE:
+            fill_column<arrow::DoubleArray>(column, messages,
+                [field](const Reflection* r, Message* m, double v) { r->SetDouble(m, field, v); });
+            break;
+        case FieldDescriptor::CPPTYPE_BOOL:
+            fill_column<arrow::BooleanArray>(column, messages,
+                [field](const Reflection* r, Message* m, bool v) { r->SetBool(m, field, v); });
+            break;
+        case FieldDescriptor::CPPTYPE_STRING: {
+            const arrow::BinaryArray& array = static_cast<const arrow::BinaryArray&>(column);
+            for (int64_t i = 0; i < array.length(); ++i) {
+                if (!array.IsNull(i)) {
+                    Message* message = messages[i];
+                    auto view = array.GetView(i);
+                    message->GetReflection()->SetString(message, field,
+                            std::string(view.data(), view.size()));
+                }
+            }
+            break;
+        }
+        default:
+            return -1;
+    }
+    return 0;
+}
+}
+
+bool ArrowRowCodec::support(MemRowDescriptor* desc) {
+    for (auto& pair : desc->id_tuple_mapping()) {
+        if (pair.second == nullptr || make_schema(pair.second->GetDescriptor()) == nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int ArrowRowCodec::encode(RowBatch* batch, MemRowDescriptor* desc, pb::ArrowBatchValue* value) {
+    for (auto& pair : desc->id_tuple_mapping()) {
+        int32_t tuple_id = pair.first;
+        const Descriptor* descriptor = pair.second->GetDescriptor();
+        auto schema = make_schema(descriptor);
+        if (schema == nullptr) {
+            DB_WARNING("tuple_id: %d not support arrow", tuple_id);
+            return -1;
+        }
+        std::vector<std::shared_ptr<arrow::Array>> columns;
+        columns.reserve(descriptor->field_count());
+        for (int i = 0; i < descriptor->field_count(); ++i) {
+            std::shared_ptr<arrow::Array> column;
+            if (build_column(batch, tuple_id, descriptor->field(i), &column) != 0) {
+                DB_WARNING("build arrow column fail, tuple_id: %d, field: %d", tuple_id, i);
+                return -1;
+            }
+            columns.emplace_back(column);
+        }
+        auto record_batch = arrow::RecordBatch::Make(schema, batch->size(), columns);
+        std::shared_ptr<arrow::Buffer> buffer;
+        auto status = arrow::ipc::SerializeRecordBatch(*record_batch, arrow::default_memory_pool(), &buffer);
+        if (!status.ok()) {
+            DB_WARNING("serialize record batch fail: %s", status.ToString().c_str());
+            return -1;
+        }
+        value->add_tuple_values()->assign((const char*)buffer->data(), buffer->size());
+    }
+    return 0;
+}
+
+int ArrowRowCodec::decode(const pb::ArrowBatchValue& value,
+        const google::protobuf::RepeatedField<int32_t>& tuple_ids,
+        MemRowDescriptor* desc,
+        std::vector<std::unique_ptr<MemRow>>* rows) {
+    if (value.tuple_values_size() != tuple_ids.size()) {
+        DB_WARNING("tuple_values_size: %d != tuple_ids_size: %d",
+                value.tuple_values_size(), tuple_ids.size());
+        return -1;
+    }
+    size_t start = rows->size();
+    int64_t num_rows = -1;
+    std::vector<Message*> messages;
+    for (int idx = 0; idx < tuple_ids.size(); ++idx) {
+        int32_t tuple_id = tuple_ids.Get(idx);
+        auto iter = desc->id_tuple_mapping().find(tuple_id);
+        if (iter == desc->id_tuple_mapping().end()) {
+            DB_WARNING("tuple_id: %d not found", tuple_id);
+            return -1;
+        }
+        const Descriptor* descriptor = iter->second->GetDescriptor();
+        auto schema = make_schema(descriptor);
+        if (schema == nullptr) {
+            DB_WARNING("tuple_id: %d not support arrow", tuple_id);
+            return -1;
+        }
+        const std::string& data = value.tuple_values(idx);
+        arrow::io::BufferReader reader((const uint8_t*)data.data(), data.size());
+        std::shared_ptr<arrow::RecordBatch> record_batch;
+        auto status = arrow::ipc::ReadRecordBatch(schema, nullptr, &reader, &record_batch);
+        if (!status.ok()) {
+            DB_WARNING("read record batch fail: %s", status.ToString().c_str());
+            return -1;
+        }
+        if (num_rows < 0) {
+            num_rows = record_batch->num_rows();
+            for (int64_t i = 0; i < num_rows; ++i) {
+                rows->emplace_back(desc->fetch_mem_row());
+            }
+        } else if (num_rows != record_batch->num_rows()) {
+            DB_WARNING("tuple_id: %d rows: %ld != %ld", tuple_id, record_batch->num_rows(), num_rows);
+            return -1;
+        }
+        if (num_rows == 0) {
+            continue;
+        }
+        messages.clear();
+        for (int64_t i = 0; i < num_rows; ++i) {
+            MemRow* row = (*rows)[start + i].get();
+            messages.emplace_back(row->get_tuple(tuple_id));
+            // 与from_string一致按编码大小估算内存
+            row->update_used_size(data.size() / num_rows);
+        }
+        for (int i = 0; i < descriptor->field_count(); ++i) {
+            if (fill_column(*record_batch->column(i), descriptor->field(i), messages) != 0) {
+                DB_WARNING("fill arrow column fail, tuple_id: %d, field: %d", tuple_id, i);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,446 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "column_batch.h"
+#include "mem_row.h"
+
+namespace baikaldb {
+DEFINE_bool(enable_columnar_execution, false,
+        "scan/filter/agg/sort/packet exchange ColumnBatch instead of MemRow when possible, default: false");
+
+ColumnVector::Category ColumnVector::category_of(pb::PrimitiveType type) {
+    switch (type) {
+        case pb::BOOL:
+        case pb::INT8:
+        case pb::INT16:
+        case pb::INT32:
+        case pb::INT64:
+        case pb::TIME:
+            return INT_COLUMN;
+        case pb::UINT8:
+        case pb::UINT16:
+        case pb::UINT32:
+        case pb::UINT64:
+        case pb::DATE:
+        case pb::DATETIME:
+        case pb::TIMESTAMP:
+            return UINT_COLUMN;
+        case pb::FLOAT:
+        case pb::DOUBLE:
+            return DOUBLE_COLUMN;
+        case pb::STRING:
+        case pb::HEX:
+        case pb::HLL:
+        case pb::TDIGEST:
+            return STRING_COLUMN;
+        default:
+            return VALUE_COLUMN;
+    }
+}
+
+void ColumnVector::reserve(size_t size) {
+    _null_map.reserve(size);
+    switch (_category) {
+        case INT_COLUMN:
+            _int_data.reserve(size);
+            break;
+        case UINT_COLUMN:
+            _uint_data.reserve(size);
+            break;
+        case DOUBLE_COLUMN:
+            _double_data.reserve(size);
+            break;
+        case STRING_COLUMN:
+            _string_data.reserve(size);
+            break;
+        default:
+            _value_data.reserve(size);
+            break;
+    }
+}
+
+void ColumnVector::reset(pb::PrimitiveType type, size_t size) {
+    _type = type;
+    _category = category_of(type);
+    clear();
+    _null_map.resize(size, 1);
+    switch (_category) {
+        case INT_COLUMN:
+            _int_data.resize(size, 0);
+            break;
+        case UINT_COLUMN:
+            _uint_data.resize(size, 0);
+            break;
+        case DOUBLE_COLUMN:
+            _double_data.resize(size, 0);
+            break;
+        case STRING_COLUMN:
+            _string_data.resize(size);
+            break;
+        default:
+            _value_data.resize(size);
+            break;
+    }
+}
+
+void ColumnVector::append_null() {
+    _null_map.emplace_back(1);
+    switch (_category) {
+        case INT_COLUMN:
+            _int_data.emplace_back(0);
+            break;
+        case UINT_COLUMN:
+            _uint_data.emplace_back(0);
+            break;
+        case DOUBLE_COLUMN:
+            _double_data.emplace_back(0);
+            break;
+        case STRING_COLUMN:
+            _string_data.emplace_back();
+            break;
+        default:
+            _value_data.emplace_back();
+            break;
+    }
+}
+
+void ColumnVector::truncate(size_t size) {
+    if (size >= _null_map.size()) {
+        return;
+    }
+    _null_map.resize(size);
+    switch (_category) {
+        case INT_COLUMN:
+            _int_data.resize(size);
+            break;
+        case UINT_COLUMN:
+            _uint_data.resize(size);
+            break;
+        case DOUBLE_COLUMN:
+            _double_data.resize(size);
+            break;
+        case STRING_COLUMN:
+            _string_data.resize(size);
+            break;
+        default:
+            _value_data.resize(size);
+            break;
+    }
+}
+
+void ColumnVector::append(const ExprValue& value) {
+    if (value.is_null()) {
+        append_null();
+        return;
+    }
+    _null_map.emplace_back(0);
+    switch (_category) {
+        case INT_COLUMN: {
+            if (value.type == _type || value.is_numberic()) {
+                _int_data.emplace_back(value.get_numberic<int64_t>());
+            } else {
+                ExprValue tmp = value;
+                _int_data.emplace_back(tmp.cast_to(_type).get_numberic<int64_t>());
+            }
+            break;
+        }
+        case UINT_COLUMN: {
+            if (value.type == _type || value.is_numberic()) {
+                _uint_data.emplace_back(value.get_numberic<uint64_t>());
+            } else {
+                ExprValue tmp = value;
+                _uint_data.emplace_back(tmp.cast_to(_type).get_numberic<uint64_t>());
+            }
+            break;
+        }
+        case DOUBLE_COLUMN:
+            _double_data.emplace_back(value.get_numberic<double>());
+            break;
+        case STRING_COLUMN:
+            if (value.is_string()) {
+                _string_data.emplace_back(value.str_val);
+            } else {
+                _string_data.emplace_back(value.get_string());
+            }
+            break;
+        default:
+            _value_data.emplace_back(value);
+            break;
+    }
+}
+
+void ColumnVector::set_value(size_t idx, const ExprValue& value) {
+    if (value.is_null()) {
+        _null_map[idx] = 1;
+        return;
+    }
+    _null_map[idx] = 0;
+    switch (_category) {
+        case INT_COLUMN: {
+            if (value.type == _type || value.is_numberic()) {
+                _int_data[idx] = value.get_numberic<int64_t>();
+            } else {
+                ExprValue tmp = value;
+                _int_data[idx] = tmp.cast_to(_type).get_numberic<int64_t>();
+            }
+            break;
+        }
+        case UINT_COLUMN: {
+            if (value.type == _type || value.is_numberic()) {
+                _uint_data[idx] = value.get_numberic<uint64_t>();
+            } else {
+                ExprValue tmp = value;
+                _uint_data[idx] = tmp.cast_to(_type).get_numberic<uint64_t>();
+            }
+            break;
+        }
+        case DOUBLE_COLUMN:
+            _double_data[idx] = value.get_numberic<double>();
+            break;
+        case STRING_COLUMN:
+            _string_data[idx] = value.is_string() ? value.str_val : value.get_string();
+            break;
+        default:
+            _value_data[idx] = value;
+            break;
+    }
+}
+
+ExprValue ColumnVector::get_value(size_t idx) const {
+    if (_null_map[idx] != 0) {
+        return ExprValue::Null();
+    }
+    switch (_category) {
+        case INT_COLUMN: {
+            ExprValue value(_type);
+            int64_t v = _int_data[idx];
+            switch (_type) {
+                case pb::BOOL:
+                    value._u.bool_val = (v != 0);
+                    break;
+                case pb::INT8:
+                    value._u.int8_val = v;
+                    break;
+                case pb::INT16:
+                    value._u.int16_val = v;
+                    break;
+                case pb::INT32:
+                case pb::TIME:
+                    value._u.int32_val = v;
+                    break;
+                default:
+                    value._u.int64_val = v;
+                    break;
+            }
+            return value;
+        }
+        case UINT_COLUMN: {
+            ExprValue value(_type);
+            uint64_t v = _uint_data[idx];
+            switch (_type) {
+                case pb::UINT8:
+                    value._u.uint8_val = v;
+                    break;
+                case pb::UINT16:
+                    value._u.uint16_val = v;
+                    break;
+                case pb::UINT32:
+                case pb::DATE:
+                case pb::TIMESTAMP:
+                    value._u.uint32_val = v;
+                    break;
+                default:
+                    value._u.uint64_val = v;
+                    break;
+            }
+            return value;
+        }
+        case DOUBLE_COLUMN: {
+            ExprValue value(_type);
+            if (_type == pb::FLOAT) {
+                value._u.float_val = _double_data[idx];
+            } else {
+                value._u.double_val = _double_data[idx];
+            }
+            return value;
+        }
+        case STRING_COLUMN: {
+            ExprValue value(pb::STRING);
+            value.type = _type;
+            value.str_val = _string_data[idx];
+            return value;
+        }
+        default:
+            return _value_data[idx];
+    }
+}
+
+int64_t ColumnVector::used_size() const {
+    int64_t used_size = _null_map.size();
+    switch (_category) {
+        case INT_COLUMN:
+        case UINT_COLUMN:
+        case DOUBLE_COLUMN:
+            used_size += _null_map.size() * 8;
+            break;
+        case STRING_COLUMN:
+            for (auto& str : _string_data) {
+                used_size += str.size() + sizeof(std::string);
+            }
+            break;
+        default:
+            for (auto& value : _value_data) {
+                used_size += value.size() + sizeof(ExprValue);
+            }
+            break;
+    }
+    return used_size;
+}
+
+int ColumnBatch::init(const std::vector<pb::TupleDescriptor>& tuple_descs,
+        const std::unordered_set<int32_t>& tuple_ids) {
+    _columns.clear();
+    _column_slots.clear();
+    _column_index.clear();
+    for (auto& tuple_desc : tuple_descs) {
+        int32_t tuple_id = tuple_desc.tuple_id();
+        if (!tuple_ids.empty() && tuple_ids.count(tuple_id) == 0) {
+            continue;
+        }
+        if (tuple_id < 0) {
+            DB_WARNING("invalid tuple_id: %d", tuple_id);
+            return -1;
+        }
+        if (tuple_id >= (int32_t)_column_index.size()) {
+            _column_index.resize(tuple_id + 1);
+        }
+        auto& slots = _column_index[tuple_id];
+        for (auto& slot : tuple_desc.slots()) {
+            if (slot.slot_id() >= (int32_t)slots.size()) {
+                slots.resize(slot.slot_id() + 1, -1);
+            }
+            slots[slot.slot_id()] = _columns.size();
+            _columns.emplace_back(new ColumnVector(slot.slot_type()));
+            _columns.back()->reserve(_capacity);
+            _column_slots.push_back({tuple_id, slot.slot_id()});
+        }
+    }
+    _is_inited = true;
+    clear();
+    return 0;
+}
+
+void ColumnBatch::clear() {
+    for (auto& column : _columns) {
+        column->clear();
+    }
+    _num_rows = 0;
+    _selection.clear();
+    _use_selection = false;
+}
+
+void ColumnBatch::keep_first_selected(size_t num_keep) {
+    if (num_keep >= selected_size()) {
+        return;
+    }
+    if (!_use_selection) {
+        _selection.resize(num_keep);
+        for (size_t i = 0; i < num_keep; ++i) {
+            _selection[i] = i;
+        }
+        _use_selection = true;
+        return;
+    }
+    _selection.resize(num_keep);
+}
+
+int ColumnBatch::append_row(MemRow* row) {
+    for (size_t i = 0; i < _columns.size(); ++i) {
+        auto& column_slot = _column_slots[i];
+        _columns[i]->append(row->get_value(column_slot.tuple_id, column_slot.slot_id));
+    }
+    if (_use_selection) {
+        _selection.emplace_back(_num_rows);
+    }
+    ++_num_rows;
+    return 0;
+}
+
+void ColumnBatch::finish_row() {
+    for (auto& column : _columns) {
+        if (column->size() == _num_rows) {
+            column->append_null();
+        }
+    }
+    if (_use_selection) {
+        _selection.emplace_back(_num_rows);
+    }
+    ++_num_rows;
+}
+
+void ColumnBatch::rollback_row() {
+    for (auto& column : _columns) {
+        column->truncate(_num_rows);
+    }
+}
+
+int ColumnBatch::append_row_batch(RowBatch* batch) {
+    for (batch->reset(); !batch->is_traverse_over(); batch->next()) {
+        int ret = append_row(batch->get_row().get());
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+int ColumnBatch::fill_row(size_t row_idx, MemRow* row) const {
+    if (row_idx >= _num_rows) {
+        DB_WARNING("row_idx: %lu >= rows: %lu", row_idx, _num_rows);
+        return -1;
+    }
+    for (size_t i = 0; i < _columns.size(); ++i) {
+        auto& column_slot = _column_slots[i];
+        if (row->set_value(column_slot.tuple_id, column_slot.slot_id,
+                _columns[i]->get_value(row_idx)) < 0) {
+            DB_WARNING("set_value fail, tuple_id: %d, slot_id: %d",
+                    column_slot.tuple_id, column_slot.slot_id);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int ColumnBatch::to_row_batch(MemRowDescriptor* desc, RowBatch* batch) const {
+    size_t num_rows = selected_size();
+    for (size_t i = 0; i < num_rows; ++i) {
+        std::unique_ptr<MemRow> row = desc->fetch_mem_row();
+        if (fill_row(selected_row(i), row.get()) < 0) {
+            return -1;
+        }
+        batch->move_row(std::move(row));
+    }
+    return 0;
+}
+
+int64_t ColumnBatch::used_bytes_size() const {
+    int64_t used_size = _selection.size() * sizeof(uint32_t);
+    for (auto& column : _columns) {
+        used_size += column->used_size();
+    }
+    return used_size;
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
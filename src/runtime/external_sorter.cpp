@@ -0,0 +1,155 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "external_sorter.h"
+
+namespace baikaldb {
+DEFINE_int32(sort_spill_max_runs, 64, "merge spilled sort runs into one when runs reach this, "
+        "bounds open files of one sort, default: 64");
+bvar::Adder<int64_t> ExternalSorter::sort_spill_bytes {"sort_spill_bytes"};
+bvar::Adder<int64_t> ExternalSorter::sort_spill_runs {"sort_spill_runs"};
+bvar::Adder<int64_t> ExternalSorter::sort_spill_rows {"sort_spill_rows"};
+
+int ExternalSorter::spill(Sorter* sorter, int64_t* spilled_bytes) {
+    TimeCost cost;
+    std::unique_ptr<SpillFile> file(new SpillFile(_desc));
+    if (file->open_write() < 0) {
+        return -1;
+    }
+    sorter->sort();
+    bool eos = false;
+    RowBatch batch;
+    while (!eos) {
+        batch.clear();
+        int ret = sorter->get_next(&batch, &eos);
+        if (ret < 0) {
+            DB_WARNING("sorter get_next fail");
+            return ret;
+        }
+        *spilled_bytes += batch.used_bytes_size();
+        if (file->write_batch(&batch) < 0) {
+            return -1;
+        }
+    }
+    if (file->finish_write() < 0) {
+        return -1;
+    }
+    sort_spill_bytes << file->bytes();
+    sort_spill_rows << file->rows();
+    sort_spill_runs << 1;
+    DB_WARNING("spill sort run: %s rows: %ld bytes: %ld runs: %lu time: %ld",
+            file->path().c_str(), file->rows(), file->bytes(), _runs.size() + 1, cost.get_time());
+    RunCursor cursor;
+    cursor.file = std::move(file);
+    _runs.emplace_back(std::move(cursor));
+    if (FLAGS_sort_spill_max_runs > 1 && _runs.size() >= (size_t)FLAGS_sort_spill_max_runs) {
+        return merge_runs();
+    }
+    return 0;
+}
+
+int ExternalSorter::merge_runs() {
+    TimeCost cost;
+    std::unique_ptr<SpillFile> file(new SpillFile(_desc));
+    if (file->open_write() < 0) {
+        return -1;
+    }
+    size_t run_num = _runs.size();
+    int ret = merge();
+    if (ret < 0) {
+        return ret;
+    }
+    bool eos = false;
+    RowBatch batch;
+    while (!eos) {
+        batch.clear();
+        ret = get_next(&batch, &eos);
+        if (ret < 0) {
+            return ret;
+        }
+        if (file->write_batch(&batch) < 0) {
+            return -1;
+        }
+    }
+    if (file->finish_write() < 0) {
+        return -1;
+    }
+    DB_WARNING("merge sort runs: %lu into %s rows: %ld bytes: %ld time: %ld",
+            run_num, file->path().c_str(), file->rows(), file->bytes(), cost.get_time());
+    _heap.clear();
+    _runs.clear();
+    RunCursor cursor;
+    cursor.file = std::move(file);
+    _runs.emplace_back(std::move(cursor));
+    return 0;
+}
+
+int ExternalSorter::advance(RunCursor* cursor, bool* eof) {
+    int ret = cursor->file->read_row(&cursor->row, eof);
+    if (ret < 0 || *eof) {
+        return ret;
+    }
+    if (_use_sort_key) {
+        _comp->encode_sort_key(cursor->row.get(), &cursor->sort_key);
+    }
+    return 0;
+}
+
+int ExternalSorter::merge() {
+    auto comp = [this](size_t left, size_t right) {
+        return greater(left, right);
+    };
+    _heap.clear();
+    for (size_t i = 0; i < _runs.size(); i++) {
+        bool eof = false;
+        if (advance(&_runs[i], &eof) < 0) {
+            return -1;
+        }
+        if (!eof) {
+            _heap.push_back(i);
+        }
+    }
+    std::make_heap(_heap.begin(), _heap.end(), comp);
+    return 0;
+}
+
+int ExternalSorter::get_next(RowBatch* batch, bool* eos) {
+    auto comp = [this](size_t left, size_t right) {
+        return greater(left, right);
+    };
+    while (!batch->is_full()) {
+        if (_heap.empty()) {
+            *eos = true;
+            return 0;
+        }
+        std::pop_heap(_heap.begin(), _heap.end(), comp);
+        RunCursor& cursor = _runs[_heap.back()];
+        batch->move_row(std::move(cursor.row));
+        bool eof = false;
+        if (advance(&cursor, &eof) < 0) {
+            return -1;
+        }
+        if (eof) {
+            // 读完的run提前删除文件
+            cursor.file.reset();
+            _heap.pop_back();
+        } else {
+            std::push_heap(_heap.begin(), _heap.end(), comp);
+        }
+    }
+    return 0;
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -238,6 +238,23 @@ int RuntimeState::memory_limit_release(int64_t rows, int64_t bytes) {
     return 0;
 }
 
+bool RuntimeState::memory_limit_approaching(int64_t ratio) {
+    SmartMemTracker mem_tracker;
+    {
+        BAIDU_SCOPED_LOCK(_mem_lock);
+        mem_tracker = _mem_tracker;
+    }
+    MemTracker* tracker = mem_tracker.get();
+    while (tracker != nullptr) {
+        int64_t limit = tracker->bytes_limit();
+        if (limit > 0 && tracker->bytes_consumed() * 100 > limit * ratio) {
+            return true;
+        }
+        tracker = tracker->get_parent();
+    }
+    return false;
+}
+
 int RuntimeState::memory_limit_release_all() {
     if (_mem_tracker != nullptr) {
         _mem_tracker->release(_used_bytes);
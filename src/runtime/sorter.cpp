@@ -40,8 +40,7 @@ int Sorter::get_next(RowBatch* batch, bool* eos) {
         _min_heap[0]->next();
         //堆顶batch遍历完后，pop出去
         if (_min_heap[0]->is_traverse_over()) {
-            std::iter_swap(_min_heap.begin(), _min_heap.end() - 1);
-            _min_heap.pop_back();
+            pop_batch();
             if (!_min_heap.empty()) {
                 shiftdown(0);
             }
@@ -58,6 +57,7 @@ void Sorter::sort() {
     if (_min_heap.size() == 1) {
         _min_heap[0]->sort(_comp);
     } else if (_min_heap.size() > 1) {
+        _use_sort_key = _comp->use_sort_key();
         multi_sort();
         make_heap();
     }
@@ -67,6 +67,10 @@ void Sorter::merge_sort() {
         return;
     }
     if (_min_heap.size() > 1) {
+        _use_sort_key = _comp->use_sort_key();
+        if (_use_sort_key) {
+            multi_encode_sort_keys();
+        }
         make_heap();
     }
 }
@@ -78,11 +82,13 @@ void Sorter::make_heap() {
 
 void Sorter::multi_sort() {
     TimeCost cost;
+    _sort_keys.clear();
+    _sort_keys.resize(_min_heap.size());
     BthreadCond cond(_min_heap.size());
     for (size_t i = 0; i < _min_heap.size(); i++) {
         Bthread bth(&BTHREAD_ATTR_SMALL);
         bth.run([this, i, &cond]() {
-            _min_heap[i]->sort(_comp);
+            _min_heap[i]->sort(_comp, _use_sort_key ? &_sort_keys[i] : nullptr);
             cond.decrease_signal();
         });
     }
@@ -90,6 +96,21 @@ void Sorter::multi_sort() {
     DB_WARNING("sort time:%ld", cost.get_time());
 }
 
+// 各batch已有序(如store返回的结果)，只需并行生成key用于归并
+void Sorter::multi_encode_sort_keys() {
+    _sort_keys.clear();
+    _sort_keys.resize(_min_heap.size());
+    BthreadCond cond(_min_heap.size());
+    for (size_t i = 0; i < _min_heap.size(); i++) {
+        Bthread bth(&BTHREAD_ATTR_SMALL);
+        bth.run([this, i, &cond]() {
+            _min_heap[i]->encode_sort_keys(_comp, &_sort_keys[i]);
+            cond.decrease_signal();
+        });
+    }
+    cond.wait();
+}
+
 void Sorter::shiftdown(size_t index) {
     size_t left_index = index * 2 + 1;
     size_t right_index = left_index + 1;
@@ -97,18 +118,14 @@ void Sorter::shiftdown(size_t index) {
         return;
     }
     size_t min_index = index;
-    if (left_index < _min_heap.size() &&
-            _comp->less(_min_heap[left_index]->get_row().get(),
-                _min_heap[min_index]->get_row().get())) {
+    if (left_index < _min_heap.size() && less(left_index, min_index)) {
         min_index = left_index;
     }
-    if (right_index < _min_heap.size() && 
-            _comp->less(_min_heap[right_index]->get_row().get(),
-                _min_heap[min_index]->get_row().get())) {
+    if (right_index < _min_heap.size() && less(right_index, min_index)) {
         min_index = right_index;  
     }
     if (min_index != index) {
-        std::iter_swap(_min_heap.begin() + min_index, _min_heap.begin() + index);
+        swap_batch(min_index, index);
         shiftdown(min_index);
     }
 }
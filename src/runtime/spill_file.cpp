@@ -0,0 +1,171 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "spill_file.h"
+#include <signal.h>
+#include <unistd.h>
+#include <atomic>
+#include <boost/filesystem.hpp>
+#include "butil/file_util.h"
+
+namespace baikaldb {
+DEFINE_string(spill_dir, "./spill", "local dir for sort/agg/join spill files");
+DEFINE_int32(spill_file_buffer_size, 1024 * 1024, "stdio buffer size of spill file when writing, default: 1M");
+DEFINE_int32(spill_file_read_buffer_size, 64 * 1024, "stdio buffer size of spill file when reading, "
+        "many files may be read at the same time, default: 64K");
+
+namespace {
+std::atomic<uint64_t> g_spill_file_seq{0};
+}
+
+void SpillFile::clean_stale_files() {
+    boost::system::error_code ec;
+    boost::filesystem::directory_iterator iter(FLAGS_spill_dir, ec);
+    if (ec) {
+        return;
+    }
+    int cnt = 0;
+    for (boost::filesystem::directory_iterator end; iter != end; iter.increment(ec)) {
+        if (ec) {
+            break;
+        }
+        // 文件名为spill_{pid}_{time}_{seq}，只删除已退出进程留下的文件
+        std::string name = iter->path().filename().string();
+        if (name.compare(0, 6, "spill_") != 0) {
+            continue;
+        }
+        pid_t pid = strtol(name.c_str() + 6, nullptr, 10);
+        if (pid <= 0 || pid == getpid() || kill(pid, 0) == 0 || errno != ESRCH) {
+            continue;
+        }
+        boost::filesystem::remove(iter->path(), ec);
+        ++cnt;
+    }
+    if (cnt > 0) {
+        DB_WARNING("clean stale spill files: %d, dir: %s", cnt, FLAGS_spill_dir.c_str());
+    }
+}
+
+SpillFile::~SpillFile() {
+    close_file();
+    if (!_path.empty()) {
+        butil::DeleteFile(butil::FilePath(_path), false);
+    }
+}
+
+void SpillFile::close_file() {
+    if (_file != nullptr) {
+        fclose(_file);
+        _file = nullptr;
+    }
+}
+
+int SpillFile::open_write() {
+    butil::FilePath dir(FLAGS_spill_dir);
+    butil::File::Error error;
+    if (!butil::CreateDirectoryAndGetError(dir, &error)) {
+        DB_WARNING("create spill dir: %s fail, error: %d", FLAGS_spill_dir.c_str(), error);
+        return -1;
+    }
+    _path = FLAGS_spill_dir + "/spill_" + std::to_string(getpid()) + "_" +
+        std::to_string(butil::gettimeofday_us()) + "_" + std::to_string(++g_spill_file_seq);
+    _file = fopen(_path.c_str(), "wb+");
+    if (_file == nullptr) {
+        DB_WARNING("open spill file: %s fail, errno: %d", _path.c_str(), errno);
+        _path.clear();
+        return -1;
+    }
+    setvbuf(_file, nullptr, _IOFBF, FLAGS_spill_file_buffer_size);
+    return 0;
+}
+
+int SpillFile::write_row(MemRow* row) {
+    if (_file == nullptr) {
+        return -1;
+    }
+    for (auto tuple_id : _tuple_ids) {
+        _buf.clear();
+        row->to_string(tuple_id, &_buf);
+        uint32_t len = _buf.size();
+        if (fwrite(&len, sizeof(len), 1, _file) != 1 ||
+                (len > 0 && fwrite(_buf.data(), len, 1, _file) != 1)) {
+            DB_WARNING("write spill file: %s fail, errno: %d", _path.c_str(), errno);
+            return -1;
+        }
+        _bytes += sizeof(len) + len;
+    }
+    ++_rows;
+    return 0;
+}
+
+int SpillFile::write_batch(RowBatch* batch) {
+    for (batch->reset(); !batch->is_traverse_over(); batch->next()) {
+        if (write_row(batch->get_row().get()) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int SpillFile::finish_write() {
+    if (_file == nullptr) {
+        return -1;
+    }
+    // 重新以读方式打开，释放写缓冲，多个文件同时归并时只占用较小的读缓冲
+    int ret = fclose(_file);
+    _file = nullptr;
+    if (ret != 0) {
+        DB_WARNING("close spill file: %s fail, errno: %d", _path.c_str(), errno);
+        return -1;
+    }
+    _file = fopen(_path.c_str(), "rb");
+    if (_file == nullptr) {
+        DB_WARNING("open spill file: %s for read fail, errno: %d", _path.c_str(), errno);
+        return -1;
+    }
+    setvbuf(_file, nullptr, _IOFBF, FLAGS_spill_file_read_buffer_size);
+    _read_rows = 0;
+    return 0;
+}
+
+int SpillFile::read_row(std::unique_ptr<MemRow>* row, bool* eof) {
+    if (_file == nullptr) {
+        return -1;
+    }
+    if (_read_rows >= _rows) {
+        *eof = true;
+        return 0;
+    }
+    *eof = false;
+    std::unique_ptr<MemRow> mem_row = _desc->fetch_mem_row();
+    for (auto tuple_id : _tuple_ids) {
+        uint32_t len = 0;
+        if (fread(&len, sizeof(len), 1, _file) != 1) {
+            DB_WARNING("read spill file: %s fail, errno: %d", _path.c_str(), errno);
+            return -1;
+        }
+        _buf.resize(len);
+        if (len > 0 && fread(&_buf[0], len, 1, _file) != 1) {
+            DB_WARNING("read spill file: %s fail, errno: %d", _path.c_str(), errno);
+            return -1;
+        }
+        mem_row->from_string(tuple_id, _buf);
+    }
+    ++_read_rows;
+    *row = std::move(mem_row);
+    return 0;
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
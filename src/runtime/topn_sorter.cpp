@@ -0,0 +1,67 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "topn_sorter.h"
+
+namespace baikaldb {
+void TopNSorter::add_batch(RowBatch* batch, int64_t* released_bytes) {
+    auto comp = [this](const HeapItem& left, const HeapItem& right) {
+        return less(left, right);
+    };
+    HeapItem item;
+    for (batch->reset(); !batch->is_traverse_over(); batch->next()) {
+        item.row = std::move(batch->get_row());
+        if (_use_sort_key) {
+            _comp->encode_sort_key(item.row.get(), &item.sort_key);
+        }
+        if (_heap.size() < _limit) {
+            _heap.emplace_back(std::move(item));
+            std::push_heap(_heap.begin(), _heap.end(), comp);
+            continue;
+        }
+        if (_limit == 0 || !less(item, _heap.front())) {
+            *released_bytes += item.row->used_size();
+            item.row.reset();
+            continue;
+        }
+        std::pop_heap(_heap.begin(), _heap.end(), comp);
+        *released_bytes += _heap.back().row->used_size();
+        _heap.back() = std::move(item);
+        std::push_heap(_heap.begin(), _heap.end(), comp);
+    }
+    batch->clear();
+}
+
+void TopNSorter::sort() {
+    auto comp = [this](const HeapItem& left, const HeapItem& right) {
+        return less(left, right);
+    };
+    std::sort_heap(_heap.begin(), _heap.end(), comp);
+    _idx = 0;
+}
+
+int TopNSorter::get_next(RowBatch* batch, bool* eos) {
+    while (_idx < _heap.size()) {
+        if (batch->is_full()) {
+            return 0;
+        }
+        batch->move_row(std::move(_heap[_idx].row));
+        ++_idx;
+    }
+    *eos = true;
+    return 0;
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -13,14 +13,49 @@
 // limitations under the License.
 
 #include "binlog_context.h"
+#include <algorithm>
 #include "meta_server_interact.hpp"
 
 namespace baikaldb {
+DEFINE_bool(tso_batch_fetch, false, "merge concurrent tso requests into one meta rpc");
+DEFINE_int64(tso_batch_window_us, 0, "tso batch leader waits this long for more requests, "
+        "0 means only merge requests queued during the previous rpc");
+DEFINE_int32(tso_batch_max_count, 1024, "max tso requests merged into one meta rpc");
 
 int64_t TsoFetcher::get_tso() {
+    if (FLAGS_tso_batch_fetch) {
+        return get_instance()->batch_get_tso();
+    }
+    return gen_tso(1);
+}
+
+int64_t TsoFetcher::batch_get_tso() {
+    TimeCost cost;
+    _request_count << 1;
+    Waiter w;
+    // logical部分不能超过max_logical
+    size_t max_count = std::min<int64_t>(std::max(FLAGS_tso_batch_max_count, 1),
+            tso::max_logical / 2);
+    // 只加入尚未发出的请求，保证拿到的tso晚于调用时刻
+    _committer.submit(&w, FLAGS_tso_batch_window_us, max_count);
+    _wait_latency << cost.get_time();
+    return w.timestamp;
+}
+
+void TsoFetcher::fetch_batch(std::vector<Waiter*>& batch) {
+    int64_t timestamp = fetch_tso(batch.size());
+    _rpc_count << 1;
+    _batch_size << batch.size();
+    for (size_t i = 0; i < batch.size(); ++i) {
+        // 按排队顺序分配，失败时都返回错误码
+        batch[i]->timestamp = timestamp < 0 ? timestamp : timestamp + i;
+    }
+}
+
+int64_t TsoFetcher::gen_tso(int64_t count) {
     pb::TsoRequest request;
     request.set_op_type(pb::OP_GEN_TSO);
-    request.set_count(1);
+    request.set_count(count);
     pb::TsoResponse response;
     int retry_time = 0;
     int ret = 0;
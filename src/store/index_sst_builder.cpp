@@ -0,0 +1,229 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "index_sst_builder.h"
+#include <algorithm>
+#include <sstream>
+#include "mut_table_key.h"
+#include "table_key.h"
+#include "table_record.h"
+#include "sst_file_writer.h"
+#include "region_control.h"
+#include "mysql_err_code.h"
+#ifdef BAIDU_INTERNAL
+#include <base/files/file_util.h>
+#else
+#include <butil/files/file_util.h>
+#endif
+
+namespace baikaldb {
+
+IndexSstBuilder::BuildResult IndexSstBuilder::build(const std::string& sst_dir,
+        int64_t batch_lines, int64_t max_lines, pb::StoreRes* response) {
+    BuildResult ret = scan(sst_dir, batch_lines, max_lines, response);
+    _entries.clear();
+    if (ret == BUILD_SUCCESS) {
+        response->set_errcode(pb::SUCCESS);
+        response->set_affected_rows(_index_lines);
+        return ret;
+    }
+    // 之前批次已经ingest的数据需要删除，WRITE_LOCAL之后dml写入的索引也一并删除，
+    // 回退的事务回填会重新写入全部索引
+    if (remove_index_data() != 0) {
+        return BUILD_FAIL;
+    }
+    return ret;
+}
+
+int IndexSstBuilder::remove_index_data() {
+    MutTableKey start_key;
+    MutTableKey end_key;
+    start_key.append_i64(_region_id).append_i64(_index_ptr->id);
+    end_key.append_i64(_region_id).append_i64(_index_ptr->id).append_u64(UINT64_MAX);
+    auto data_cf = _rocksdb->get_data_handle();
+    if (data_cf == nullptr) {
+        DB_WARNING("get rocksdb data column family failed, region_id: %ld", _region_id);
+        return -1;
+    }
+    auto res = _rocksdb->remove_range(rocksdb::WriteOptions(), data_cf,
+            start_key.data(), end_key.data(), true);
+    if (!res.ok()) {
+        DB_FATAL("remove index data fail, region_id: %ld, index_id: %ld, err: %s",
+                _region_id, _index_ptr->id, res.ToString().c_str());
+        return -1;
+    }
+    _index_lines = 0;
+    DB_WARNING("remove index data, region_id: %ld, index_id: %ld", _region_id, _index_ptr->id);
+    return 0;
+}
+
+IndexSstBuilder::BuildResult IndexSstBuilder::scan(const std::string& sst_dir,
+        int64_t batch_lines, int64_t max_lines, pb::StoreRes* response) {
+    IndexInfo& index_info = *_index_ptr;
+    IndexInfo& pk_info = *_pk_ptr;
+    auto data_cf = _rocksdb->get_data_handle();
+    if (data_cf == nullptr) {
+        response->set_errcode(pb::EXEC_FAIL);
+        response->set_errmsg("get data cf fail");
+        return BUILD_FAIL;
+    }
+    rocksdb::ReadOptions read_options;
+    read_options.prefix_same_as_start = true;
+    read_options.total_order_seek = false;
+    read_options.fill_cache = false;
+    std::unique_ptr<rocksdb::Iterator> iter(_rocksdb->new_iterator(read_options, data_cf));
+    MutTableKey seek_key;
+    seek_key.append_i64(_region_id).append_i64(_table_id).append_index(_start_key);
+    _entries.reserve(std::min<int64_t>(batch_lines, 1024 * 1024));
+    for (iter->Seek(seek_key.data()); iter->Valid(); iter->Next()) {
+        rocksdb::Slice pk_slice(iter->key());
+        pk_slice.remove_prefix(2 * sizeof(int64_t));
+        if (!_end_key.empty() && pk_slice.compare(_end_key) >= 0) {
+            break;
+        }
+        // 扫描行数各副本一致，超过上限时所有副本都放弃
+        if (++_scan_lines > max_lines) {
+            response->set_errcode(pb::UNSUPPORT_REQ_TYPE);
+            response->set_errmsg("region too large to build index sst");
+            DB_WARNING("region_id: %ld, scan_lines: %ld too large to build index sst",
+                    _region_id, _scan_lines);
+            return BUILD_TOO_LARGE;
+        }
+        SmartRecord record = SchemaFactory::get_instance()->new_record(_table_id);
+        if (record == nullptr || record->decode(iter->value().data(), iter->value().size()) != 0
+                || record->decode_key(pk_info, TableKey(pk_slice, true)) != 0) {
+            DB_FATAL("decode record fail, region_id: %ld, key: %s",
+                    _region_id, iter->key().ToString(true).c_str());
+            response->set_errcode(pb::EXEC_FAIL);
+            response->set_errmsg("decode record fail");
+            return BUILD_FAIL;
+        }
+        // 与Transaction::put_secondary的编码保持一致
+        MutTableKey key;
+        key.append_i64(_region_id).append_i64(index_info.id);
+        if (key.append_index(index_info, record.get(), -1, false) != 0) {
+            response->set_errcode(pb::EXEC_FAIL);
+            response->set_errmsg("encode index fail");
+            return BUILD_FAIL;
+        }
+        MutTableKey pk;
+        if (index_info.type == pb::I_KEY) {
+            if (record->encode_primary_key(index_info, key, -1) != 0) {
+                response->set_errcode(pb::EXEC_FAIL);
+                response->set_errmsg("encode primary key fail");
+                return BUILD_FAIL;
+            }
+        } else if (record->encode_primary_key(index_info, pk, -1) != 0) {
+            response->set_errcode(pb::EXEC_FAIL);
+            response->set_errmsg("encode primary key fail");
+            return BUILD_FAIL;
+        }
+        _entries.emplace_back(key.data(), pk.data());
+        if ((int64_t)_entries.size() >= batch_lines) {
+            BuildResult ret = flush_entries(sst_dir, response);
+            if (ret != BUILD_SUCCESS) {
+                return ret;
+            }
+        }
+    }
+    if (!iter->status().ok()) {
+        DB_FATAL("iterate region data fail, region_id: %ld, err: %s",
+                _region_id, iter->status().ToString().c_str());
+        response->set_errcode(pb::EXEC_FAIL);
+        response->set_errmsg("iterate region data fail");
+        return BUILD_FAIL;
+    }
+    return flush_entries(sst_dir, response);
+}
+
+// 排序后写sst并ingest，unique索引需要和已有数据(之前的批次以及WRITE_LOCAL后的写入)检查冲突
+IndexSstBuilder::BuildResult IndexSstBuilder::flush_entries(const std::string& sst_dir,
+        pb::StoreRes* response) {
+    if (_entries.empty()) {
+        return BUILD_SUCCESS;
+    }
+    IndexInfo& index_info = *_index_ptr;
+    auto data_cf = _rocksdb->get_data_handle();
+    std::sort(_entries.begin(), _entries.end());
+    std::ostringstream os;
+    os << sst_dir << "/" << "index_ingest_sst." << _region_id << "." << index_info.id << "." << _sst_count++;
+    std::string path = os.str();
+    ON_SCOPE_EXIT(([path]() {
+        butil::DeleteFile(butil::FilePath(path), false);
+    }));
+    std::unique_ptr<SstFileWriter> writer(new SstFileWriter(_rocksdb->get_options(data_cf)));
+    auto s = writer->open(path);
+    if (!s.ok()) {
+        DB_FATAL("open sst file path: %s failed, err: %s, region_id: %ld",
+                path.c_str(), s.ToString().c_str(), _region_id);
+        response->set_errcode(pb::EXEC_FAIL);
+        response->set_errmsg("open sst file fail");
+        return BUILD_FAIL;
+    }
+    rocksdb::ReadOptions get_options;
+    int64_t write_lines = 0;
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        const std::string& key = _entries[i].first;
+        const std::string& value = _entries[i].second;
+        if (i > 0 && key == _entries[i - 1].first) {
+            if (value != _entries[i - 1].second) {
+                response->set_errcode(pb::EXEC_FAIL);
+                response->set_mysql_errcode(ER_DUP_ENTRY);
+                response->set_errmsg("Duplicate entry for key '" + index_info.short_name + "'");
+                return BUILD_DUP_UNIQ;
+            }
+            continue;
+        }
+        if (index_info.type == pb::I_UNIQ) {
+            std::string exist_value;
+            auto res = _rocksdb->get(get_options, data_cf, key, &exist_value);
+            if (res.ok() && exist_value != value) {
+                response->set_errcode(pb::EXEC_FAIL);
+                response->set_mysql_errcode(ER_DUP_ENTRY);
+                response->set_errmsg("Duplicate entry for key '" + index_info.short_name + "'");
+                return BUILD_DUP_UNIQ;
+            }
+        }
+        s = writer->put(key, value);
+        if (!s.ok()) {
+            DB_FATAL("write sst file failed, err: %s, region_id: %ld", s.ToString().c_str(), _region_id);
+            response->set_errcode(pb::EXEC_FAIL);
+            response->set_errmsg("write sst file fail");
+            return BUILD_FAIL;
+        }
+        ++write_lines;
+    }
+    _entries.clear();
+    if (write_lines == 0) {
+        return BUILD_SUCCESS;
+    }
+    s = writer->finish();
+    if (!s.ok()) {
+        DB_FATAL("finish sst file path: %s failed, err: %s, region_id: %ld",
+                path.c_str(), s.ToString().c_str(), _region_id);
+        response->set_errcode(pb::EXEC_FAIL);
+        response->set_errmsg("finish sst file fail");
+        return BUILD_FAIL;
+    }
+    if (RegionControl::ingest_data_sst(path, _region_id, true) != 0) {
+        response->set_errcode(pb::EXEC_FAIL);
+        response->set_errmsg("ingest sst fail");
+        return BUILD_FAIL;
+    }
+    _index_lines += write_lines;
+    return BUILD_SUCCESS;
+}
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
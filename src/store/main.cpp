@@ -32,6 +32,7 @@
 #include "schema_factory.h"
 #include "qos.h"
 #include "memory_profile.h"
+#include "spill_file.h"
 
 namespace baikaldb {
 DECLARE_int32(store_port);
@@ -182,6 +183,7 @@ int main(int argc, char **argv) {
     }
     baikaldb::MemoryGCHandler::get_instance()->init();
     baikaldb::MemTrackerPool::get_instance()->init();
+    baikaldb::SpillFile::clean_stale_files();
     //注册处理Store逻辑的service服务
     baikaldb::Store* store = baikaldb::Store::get_instance();
     std::vector<std::int64_t> init_region_ids;
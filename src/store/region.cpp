@@ -20,9 +20,13 @@
 #include "table_key.h"
 #include "runtime_state.h"
 #include "mem_row_descriptor.h"
+#include "arrow_row_codec.h"
+#include "store_plan_cache.h"
 #include "exec_node.h"
 #include "table_record.h"
 #include "my_raft_log_storage.h"
+#include "index_sst_builder.h"
+#include "raft_log_cache.h"
 #include "log_entry_reader.h"
 #include "raft_log_compaction_filter.h"
 #include "split_compaction_filter.h"
@@ -89,6 +93,27 @@ DEFINE_bool(demotion_read_index_without_leader, true, "demotion read index witho
 // 并发控制
 DEFINE_int64(sign_concurrency_timeout_rate,  5,      "sign_concurrency_timeout_rate, default: 5. (0 means without timeout)");
 DEFINE_int64(min_sign_concurrency_timeout_ms,1000,   "min_sign_concurrency_timeout_ms, default: 1s");
+DEFINE_int64(select_streaming_chunk_bytes, 1024 * 1024LL, "streaming select push a chunk when rows exceed this bytes, default: 1M");
+DEFINE_int64(select_streaming_max_buf_size, 8 * 1024 * 1024LL, "streaming select max unconsumed bytes before blocking store, default: 8M");
+DEFINE_int64(select_streaming_write_timeout_ms, 60 * 1000LL, "streaming select fails when consumer does not "
+        "accept a chunk within this time, default: 60s");
+// 按负载分裂
+DEFINE_bool(enable_load_split, false, "split small but hot region by sampled key access, default: false");
+DEFINE_int64(load_split_qps_threshold, 3000, "region read+write qps to start load split sampling, default: 3000");
+DEFINE_int32(load_split_hot_rounds, 3, "split after qps stays above threshold for this many split checks, default: 3");
+DEFINE_int64(load_split_cooldown_s, 600, "min interval between two load splits of one region, default: 10min");
+// sst方式加索引
+DEFINE_int64(ddl_index_sst_batch_lines, 1000000, "index entries sorted in memory before writing one sst, default: 100w");
+DEFINE_int64(ddl_index_sst_max_region_lines, 10000000, "regions with more lines fall back to txn index backfill, "
+        "since writes of the region wait while building, default: 1000w");
+DEFINE_int32(ddl_index_sst_wait_schema_s, 60, "max seconds to wait for index schema synced to this store "
+        "when applying index sst build, default: 60s");
+DEFINE_int32(apply_group_commit_max_entries, 64, "max consecutive out-txn write set log entries "
+        "committed as one rocksdb write on follower, 1 means no group commit, default: 64");
+// 单region DML写集复制
+DEFINE_bool(dml_1pc_write_set, false, "leader executes 1pc dml once and replicates the kv write set, "
+        "followers apply kvs without re-executing the plan");
+DECLARE_int64(streaming_idle_timeout_ms);
 DECLARE_int64(exec_1pc_out_fsm_timeout_ms);
 DECLARE_string(db_path);
 DECLARE_int64(print_time_us);
@@ -148,6 +173,7 @@ int Region::init(bool new_region, int32_t snapshot_times) {
     _meta_writer = MetaWriter::get_instance();
     TimeCost time_cost;
     _resource.reset(new RegionResource);
+    _resource->key_sampler = _key_sampler;
     //如果是新建region需要
     if (new_region) {
         std::string snapshot_path_str(FLAGS_snapshot_uri, FLAGS_snapshot_uri.find("//") + 2);
@@ -436,44 +462,48 @@ bool Region::check_region_legal_complete() {
 
 bool Region::validate_version(const pb::StoreReq* request, pb::StoreRes* response) {
     if (request->region_version() < get_version()) {
-        response->Clear();
-        response->set_errcode(pb::VERSION_OLD);
-        response->set_errmsg("region version too old");
-
-        std::string leader_str = butil::endpoint2str(get_leader()).c_str();
-        response->set_leader(leader_str);
-        auto region = response->add_regions();
-        copy_region(region);
-        region->set_leader(leader_str);
-        if (!region->start_key().empty() 
-                && region->start_key() == region->end_key()) {
-            //start key == end key region发生merge，已经为空
-            response->set_is_merge(true);
-            if (_merge_region_info.start_key() != region->start_key()) {
-                DB_FATAL("merge region:%ld start key ne regiond:%ld",
-                        _merge_region_info.region_id(),
-                        _region_id);
-            } else {
-                response->add_regions()->CopyFrom(_merge_region_info);
-                DB_WARNING("region id:%ld, merge region info:%s", 
-                           _region_id,
-                           pb2json(_merge_region_info).c_str());
-            }
+        fill_version_old_response(response, "region version too old");
+        return false;
+    }
+    return true;
+}
+
+void Region::fill_version_old_response(pb::StoreRes* response, const std::string& errmsg) {
+    response->Clear();
+    response->set_errcode(pb::VERSION_OLD);
+    response->set_errmsg(errmsg);
+
+    std::string leader_str = butil::endpoint2str(get_leader()).c_str();
+    response->set_leader(leader_str);
+    auto region = response->add_regions();
+    copy_region(region);
+    region->set_leader(leader_str);
+    if (!region->start_key().empty() 
+            && region->start_key() == region->end_key()) {
+        //start key == end key region发生merge，已经为空
+        response->set_is_merge(true);
+        if (_merge_region_info.start_key() != region->start_key()) {
+            DB_FATAL("merge region:%ld start key ne regiond:%ld",
+                    _merge_region_info.region_id(),
+                    _region_id);
         } else {
-            response->set_is_merge(false);
-            for (auto& r : _new_region_infos) {
-                if (r.region_id() != 0 && r.version() != 0) {
-                    response->add_regions()->CopyFrom(r);
-                    DB_WARNING("new region %ld, %ld", 
-                               _region_id, r.region_id());
-                } else {
-                    DB_FATAL("r:%s", pb2json(r).c_str());
-                }
+            response->add_regions()->CopyFrom(_merge_region_info);
+            DB_WARNING("region id:%ld, merge region info:%s", 
+                       _region_id,
+                       pb2json(_merge_region_info).c_str());
+        }
+    } else {
+        response->set_is_merge(false);
+        for (auto& r : _new_region_infos) {
+            if (r.region_id() != 0 && r.version() != 0) {
+                response->add_regions()->CopyFrom(r);
+                DB_WARNING("new region %ld, %ld", 
+                           _region_id, r.region_id());
+            } else {
+                DB_FATAL("r:%s", pb2json(r).c_str());
             }
         }
-        return false;
     }
-    return true;
 }
 
 int Region::execute_cached_cmd(const pb::StoreReq& request, pb::StoreRes& response, 
@@ -923,6 +953,7 @@ void Region::exec_in_txn_query(google::protobuf::RpcController* controller,
             ret = select(*request, *response);
             int64_t select_cost = cost.get_time();
             Store::get_instance()->select_time_cost << select_cost;
+            _select_time_cost << select_cost;
             if (select_cost > FLAGS_print_time_us) {
                 //担心ByteSizeLong对性能有影响，先对耗时长的，返回行多的请求做压缩
                 if (response->affected_rows() > 1024) {
@@ -1112,10 +1143,15 @@ void Region::exec_out_txn_query(google::protobuf::RpcController* controller,
     switch (op_type) {
         // OP_SELECT_FOR_UPDATE 只出现在事务中。
         case pb::OP_SELECT: {
+            if (request->use_streaming()) {
+                select_streaming(cntl, request, response, done_guard.release());
+                break;
+            }
             TimeCost cost;
             select(*request, *response);
             int64_t select_cost = cost.get_time();
             Store::get_instance()->select_time_cost << select_cost;
+            _select_time_cost << select_cost;
             if (select_cost > FLAGS_print_time_us) {
                 //担心ByteSizeLong对性能有影响，先对耗时长的，返回行多的请求做压缩
                 if (response->affected_rows() > 1024) {
@@ -1173,8 +1209,8 @@ void Region::exec_out_txn_query(google::protobuf::RpcController* controller,
                 return;
             }
 
-            if (is_dml_op_type(op_type) && _storage_compute_separate) {
-                //计算存储分离
+            if (use_write_set(op_type)) {
+                //计算存储分离或写集复制
                 exec_kv_out_txn(request, response, remote_side, done_guard.release());
             } else {
                 butil::IOBuf data;
@@ -1187,6 +1223,7 @@ void Region::exec_out_txn_query(google::protobuf::RpcController* controller,
                 c->op_type = op_type;
                 c->log_id = log_id;
                 c->response = response;
+                c->request = request;
                 c->region = this;
                 c->remote_side = remote_side;
                 int64_t expected_term = _expected_term;
@@ -1224,6 +1261,39 @@ void Region::exec_out_txn_query(google::protobuf::RpcController* controller,
     return;
 }
 
+// leader执行一次plan，raft只同步kv写集
+bool Region::use_write_set(pb::OpType op_type) {
+    if (!is_dml_op_type(op_type)) {
+        return false;
+    }
+    if (_storage_compute_separate) {
+        return true;
+    }
+    if (!FLAGS_dml_1pc_write_set || get_version() == 0) {
+        return false;
+    }
+    if (op_type != pb::OP_INSERT && op_type != pb::OP_DELETE && op_type != pb::OP_UPDATE) {
+        return false;
+    }
+    // 倒排索引和列存的写入不记录kv op，仍走plan复制
+    int64_t table_id = get_table_id();
+    if (_is_binlog_region || _factory->has_fulltext_index(table_id)) {
+        return false;
+    }
+    auto table_ptr = _factory->get_table_info_ptr(table_id);
+    if (table_ptr == nullptr || table_ptr->engine == pb::ROCKSDB_CSTORE) {
+        return false;
+    }
+    return true;
+}
+
+bool Region::is_write_set_stale(const pb::StoreReq& request, int64_t region_version) {
+    if (!request.check_write_set_version() || region_version == 0) {
+        return false;
+    }
+    return request.region_version() != 0 && request.region_version() != region_version;
+}
+
 void Region::exec_kv_out_txn(const pb::StoreReq* request, 
                               pb::StoreRes* response, 
                               const char* remote_side,
@@ -1319,11 +1389,22 @@ void Region::exec_kv_out_txn(const pb::StoreReq* request,
         DB_FATAL("_disable_write_cond wait timeout, log_id:%lu ret:%d, region_id: %ld", state.log_id(), ret, _region_id);
     } else if (response->errcode() == pb::SUCCESS) {
         response->set_affected_rows(ret);
+        response->set_scan_rows(state.num_scan_rows());
+        response->set_filter_rows(state.num_filter_rows());
+        if (state.last_insert_id != INT64_MIN) {
+            response->set_last_insert_id(state.last_insert_id);
+        }
         response->set_errcode(pb::SUCCESS);
     } else if (response->errcode() == pb::NOT_LEADER) {
         response->set_leader(butil::endpoint2str(get_leader()).c_str());
         DB_WARNING("not leader, region_id: %ld, error_msg:%s", 
                  _region_id, response->errmsg().c_str());
+    } else if (response->errcode() == pb::VERSION_OLD) {
+        // apply时region已分裂/merge，返回新的region信息供baikaldb重试
+        std::string errmsg = response->errmsg();
+        fill_version_old_response(response, errmsg);
+        DB_WARNING("write set version old, region_id: %ld, error_msg:%s", 
+                 _region_id, errmsg.c_str());
     } else {
         response->set_errcode(pb::EXEC_FAIL);
         DB_FATAL("txn commit failed, region_id: %ld, error_msg:%s", 
@@ -1654,6 +1735,23 @@ void Region::query(google::protobuf::RpcController* controller,
             }
             break;
         }
+        case pb::OP_INGEST_INDEX_SST:
+            // 提前拒绝，避免提交后各副本在apply中才失败
+            if (_factory->get_index_info_ptr(request->ddlwork_info().index_id()) == nullptr) {
+                response->set_errcode(pb::EXEC_FAIL);
+                response->set_errmsg("index info not found");
+                DB_WARNING("region_id: %ld, index_id: %ld info not found",
+                        _region_id, request->ddlwork_info().index_id());
+                return;
+            }
+            if (_num_table_lines.load() > FLAGS_ddl_index_sst_max_region_lines) {
+                response->set_errcode(pb::UNSUPPORT_REQ_TYPE);
+                response->set_errmsg("region too large to build index sst");
+                DB_WARNING("region_id: %ld, num_table_lines: %ld too large to build index sst",
+                        _region_id, _num_table_lines.load());
+                return;
+            }
+            // 与OP_NONE一样直接走raft
         case pb::OP_ADD_VERSION_FOR_SPLIT_REGION:
         case pb::OP_UPDATE_PRIMARY_TIMESTAMP:
         case pb::OP_NONE: {
@@ -1686,6 +1784,7 @@ void Region::query(google::protobuf::RpcController* controller,
             c->op_type = request->op_type();
             c->log_id = log_id;
             c->response = response;
+            c->request = request;
             c->done = done_guard.release();
             c->region = this;
             c->remote_side = remote_side;
@@ -2377,6 +2476,8 @@ void Region::kv_apply_raft(RuntimeState* state, SmartTransaction txn) {
     raft_req->set_region_id(state->region_id());
     raft_req->set_region_version(state->region_version());
     raft_req->set_num_increase_rows(txn->batch_num_increase_rows);
+    // 计算存储分离表保持原有行为，不做apply时的version校验
+    raft_req->set_check_write_set_version(!_storage_compute_separate);
     butil::IOBuf data;
     butil::IOBufAsZeroCopyOutputStream wrapper(&data);
     if (!raft_req->SerializeToZeroCopyStream(&wrapper)) {
@@ -2394,6 +2495,8 @@ void Region::kv_apply_raft(RuntimeState* state, SmartTransaction txn) {
     }
     DMLClosure* c = new DMLClosure(&state->txn_cond);
     c->response = state->response;
+    // raft_req归txn所有，closure持有txn，apply时直接使用
+    c->request = raft_req;
     c->region = this;
     c->log_id = state->log_id();
     c->op_type = pb::OP_KV_BATCH;
@@ -2430,14 +2533,43 @@ void deal_learner_plan(pb::Plan& plan) {
     }
 }
 
-int Region::select(const pb::StoreReq& request, pb::StoreRes& response) {
+int Region::select(const pb::StoreReq& request, pb::StoreRes& response, brpc::StreamId stream_id) {
     QosType type = QOS_SELECT;
     uint64_t sign = 0;
     if (request.has_sql_sign()) {
         sign = request.sql_sign();
     } 
+    // baikaldb确认过缓存的sql不带tuples/plan，从plan cache中取
+    SmartTupleDescs cache_tuples;
+    SmartPbPlan cache_plan;
+    const RepeatedPtrField<pb::TupleDescriptor>* tuples = &request.tuples();
+    const pb::Plan* pb_plan = &request.plan();
+    bool cache_miss = false;
+    if (request.has_tuple_sign() && sign != 0) {
+        if (request.tuples_size() > 0) {
+            StorePlanCache::get_instance()->add(sign, request.tuple_sign(), request.tuples());
+        } else if (StorePlanCache::get_instance()->find(sign, request.tuple_sign(), &cache_tuples) == 0) {
+            tuples = cache_tuples.get();
+        } else {
+            cache_miss = true;
+        }
+    }
+    if (request.has_plan_sign() && sign != 0) {
+        if (request.has_plan()) {
+            StorePlanCache::get_instance()->add(sign, request.plan_sign(), request.plan());
+        } else if (StorePlanCache::get_instance()->find(sign, request.plan_sign(), &cache_plan) == 0) {
+            pb_plan = cache_plan.get();
+        } else {
+            cache_miss = true;
+        }
+    }
+    if (cache_miss) {
+        response.set_errcode(pb::PLAN_CACHE_MISS);
+        response.set_errmsg("plan cache miss");
+        return -1;
+    }
     int64_t index_id = 0;
-    for (const auto& node : request.plan().nodes()) {
+    for (const auto& node : pb_plan->nodes()) {
         if (node.node_type() == pb::SCAN_NODE) {
             index_id = node.derive_node().scan_node().use_indexes(0);
             break;
@@ -2538,13 +2670,14 @@ int Region::select(const pb::StoreReq& request, pb::StoreRes& response) {
     if (_is_learner) {
         // learner集群可能涉及到降级，需要特殊处理scan node和filter node
         // 替换learner集群使用的索引和过滤条件
-        auto& plan = const_cast<pb::Plan&>(request.plan());
+        // 缓存的plan被多个请求共享，不能原地修改
+        pb::Plan plan = *pb_plan;
         deal_learner_plan(plan);
         DB_DEBUG("region_id: %ld, plan: %s => %s", 
-            _region_id, request.plan().ShortDebugString().c_str(), plan.ShortDebugString().c_str());
-        ret = select(request, plan, request.tuples(), response);
+            _region_id, pb_plan->ShortDebugString().c_str(), plan.ShortDebugString().c_str());
+        ret = select(request, plan, *tuples, response, stream_id);
     } else {
-        ret = select(request, request.plan(), request.tuples(), response);
+        ret = select(request, *pb_plan, *tuples, response, stream_id);
     }
     return_concurrency_quota();
     StoreQos::get_instance()->destroy_bthread_local();
@@ -2554,7 +2687,8 @@ int Region::select(const pb::StoreReq& request, pb::StoreRes& response) {
 int Region::select(const pb::StoreReq& request, 
         const pb::Plan& plan,
         const RepeatedPtrField<pb::TupleDescriptor>& tuples,
-        pb::StoreRes& response) {
+        pb::StoreRes& response,
+        brpc::StreamId stream_id) {
     //DB_WARNING("req:%s", request.DebugString().c_str());
     pb::TraceNode trace_node;
     std::string desc = "baikalStore select";
@@ -2715,7 +2849,7 @@ int Region::select(const pb::StoreReq& request,
     if (request.has_analyze_info()) {
         rows = select_sample(state, root, request.analyze_info(), response);
     } else {
-        rows = select_normal(state, root, response);
+        rows = select_normal(state, root, response, stream_id, request.use_arrow_format());
     }
     if (rows < 0) {
         root->close(&state);
@@ -2760,11 +2894,15 @@ int Region::select(const pb::StoreReq& request,
     return 0;
 }
 
-int Region::select_normal(RuntimeState& state, ExecNode* root, pb::StoreRes& response) {
+int Region::select_normal(RuntimeState& state, ExecNode* root, pb::StoreRes& response,
+        brpc::StreamId stream_id, bool use_arrow_format) {
     bool eos = false;
     int rows = 0;
     int ret = 0;
+    int64_t chunk_bytes = 0;
     MemRowDescriptor* mem_row_desc = state.mem_row_desc();
+    // 有不支持的字段类型时整个请求退化为行格式，保证结果行序不变
+    bool use_arrow = use_arrow_format && ArrowRowCodec::support(mem_row_desc);
 
     while (!eos) {
         RowBatch batch;
@@ -2784,30 +2922,143 @@ int Region::select_normal(RuntimeState& state, ExecNode* root, pb::StoreRes& res
             }
         }
 
-        int ttl_idx = 0;
-        for (batch.reset(); !batch.is_traverse_over(); batch.next()) {
-            MemRow* row = batch.get_row().get();
-            rows++;
-            ttl_idx++;
-            if (row == NULL) {
-                DB_FATAL("row is null; region_id: %ld, rows:%d", _region_id, rows);
-                continue;
+        if (use_arrow && batch.size() > 0) {
+            // 整个batch按tuple编码成arrow record batch，省去逐行逐tuple的protobuf序列化
+            pb::ArrowBatchValue* arrow_value = response.add_arrow_values();
+            if (ArrowRowCodec::encode(&batch, mem_row_desc, arrow_value) != 0) {
+                DB_FATAL("arrow encode fail, region_id: %ld, rows:%d", _region_id, rows);
+                return -1;
             }
-            pb::RowValue* row_value = response.add_row_values();
-            for (const auto& iter : mem_row_desc->id_tuple_mapping()) {
-                std::string* tuple_value = row_value->add_tuple_values();
-                row->to_string(iter.first, tuple_value);
+            rows += batch.size();
+            for (const auto& tuple_value : arrow_value->tuple_values()) {
+                chunk_bytes += tuple_value.size();
             }
-
             if (global_ddl_with_ttl) {
-                response.add_ttl_timestamp(state.ttl_timestamp_vec[ttl_idx - 1]);
+                for (int64_t ttl_timestamp : state.ttl_timestamp_vec) {
+                    response.add_ttl_timestamp(ttl_timestamp);
+                }
+            }
+        } else {
+            int ttl_idx = 0;
+            for (batch.reset(); !batch.is_traverse_over(); batch.next()) {
+                MemRow* row = batch.get_row().get();
+                rows++;
+                ttl_idx++;
+                if (row == NULL) {
+                    DB_FATAL("row is null; region_id: %ld, rows:%d", _region_id, rows);
+                    continue;
+                }
+                pb::RowValue* row_value = response.add_row_values();
+                for (const auto& iter : mem_row_desc->id_tuple_mapping()) {
+                    std::string* tuple_value = row_value->add_tuple_values();
+                    row->to_string(iter.first, tuple_value);
+                    chunk_bytes += tuple_value->size();
+                }
+
+                if (global_ddl_with_ttl) {
+                    response.add_ttl_timestamp(state.ttl_timestamp_vec[ttl_idx - 1]);
+                }
+            }
+        }
+        // streaming模式下攒够一个分块就推送，store内存不再随结果集增长
+        if (stream_id != brpc::INVALID_STREAM_ID && chunk_bytes >= FLAGS_select_streaming_chunk_bytes) {
+            pb::StoreRes chunk;
+            chunk.set_errcode(pb::SUCCESS);
+            chunk.mutable_tuple_ids()->CopyFrom(response.tuple_ids());
+            chunk.mutable_row_values()->Swap(response.mutable_row_values());
+            chunk.mutable_arrow_values()->Swap(response.mutable_arrow_values());
+            chunk.mutable_ttl_timestamp()->Swap(response.mutable_ttl_timestamp());
+            if (write_select_chunk(stream_id, chunk) != 0) {
+                DB_WARNING("write select chunk fail, region_id: %ld, rows: %d", _region_id, rows);
+                return -1;
             }
+            chunk_bytes = 0;
         }
     }
 
     return rows;
 }
 
+void Region::select_streaming(brpc::Controller* cntl,
+        const pb::StoreReq* request,
+        pb::StoreRes* response,
+        google::protobuf::Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    brpc::StreamId sd;
+    brpc::StreamOptions stream_options;
+    stream_options.max_buf_size = FLAGS_select_streaming_max_buf_size;
+    stream_options.idle_timeout_ms = FLAGS_streaming_idle_timeout_ms;
+    if (brpc::StreamAccept(&sd, *cntl, &stream_options) != 0) {
+        // 对端没有创建stream，退化为普通select
+        DB_WARNING("fail to accept stream, region_id: %ld, log_id: %lu", _region_id, request->log_id());
+        select(*request, *response);
+        return;
+    }
+    // stream在回包后才建立连接，回包前写入无法得到消费端的反馈，
+    // 所以先回包再执行；回包后request会被释放，需要先拷贝
+    pb::StoreReq stream_request = *request;
+    std::string remote_side = butil::endpoint2str(cntl->remote_side()).c_str();
+    response->set_errcode(pb::SUCCESS);
+    response->set_is_streaming(true);
+    done_guard.reset(nullptr);
+
+    TimeCost cost;
+    pb::StoreRes stream_response;
+    select(stream_request, stream_response, sd);
+    // 最后一个分块携带剩余的行以及errcode、scan_rows等信息
+    stream_response.set_stream_end(true);
+    write_select_chunk(sd, stream_response);
+    brpc::StreamClose(sd);
+    int64_t select_cost = cost.get_time();
+    Store::get_instance()->select_time_cost << select_cost;
+    _select_time_cost << select_cost;
+    if (select_cost > FLAGS_print_time_us) {
+        DB_NOTICE("streaming select region_id: %ld, time_cost: %ld, log_id: %lu, sign: %lu, "
+                "errcode: %s, rows: %ld, scan_rows: %ld, remote_side: %s",
+                _region_id, select_cost, stream_request.log_id(), stream_request.sql_sign(),
+                pb::ErrCode_Name(stream_response.errcode()).c_str(),
+                stream_response.affected_rows(), stream_response.scan_rows(), remote_side.c_str());
+    }
+}
+
+int Region::write_select_chunk(brpc::StreamId stream_id, pb::StoreRes& chunk) {
+    butil::IOBuf msg;
+    butil::IOBufAsZeroCopyOutputStream wrapper(&msg);
+    if (!chunk.SerializeToZeroCopyStream(&wrapper)) {
+        DB_FATAL("serialize select chunk fail, region_id: %ld", _region_id);
+        return -1;
+    }
+    // 消费端未确认的数据超过max_buf_size时返回EAGAIN，等待可写实现反压
+    TimeCost wait_cost;
+    int err = brpc::StreamWrite(stream_id, msg);
+    while (err == EAGAIN) {
+        if (_shutdown) {
+            return -1;
+        }
+        // 消费端长时间不读取，关闭stream，后续的写入直接失败
+        if (wait_cost.get_time() > FLAGS_select_streaming_write_timeout_ms * 1000) {
+            DB_WARNING("stream write timeout, region_id: %ld, stream_id: %lu, wait: %ld",
+                    _region_id, stream_id, wait_cost.get_time());
+            brpc::StreamClose(stream_id);
+            return -1;
+        }
+        timespec due_time = butil::milliseconds_from_now(100);
+        int ret = brpc::StreamWait(stream_id, &due_time);
+        if (ret != 0 && ret != ETIMEDOUT) {
+            DB_WARNING("stream wait fail, region_id: %ld, stream_id: %lu, ret: %d",
+                    _region_id, stream_id, ret);
+            return -1;
+        }
+        err = brpc::StreamWrite(stream_id, msg);
+    }
+    if (err != 0) {
+        DB_WARNING("stream write fail, region_id: %ld, stream_id: %lu, err: %d",
+                _region_id, stream_id, err);
+        return -1;
+    }
+    return 0;
+}
+
 //抽样采集
 int Region::select_sample(RuntimeState& state, ExecNode* root, const pb::AnalyzeInfo& analyze_info, pb::StoreRes& response) {
     bool eos = false;
@@ -2984,6 +3235,24 @@ void Region::construct_heart_beat_request(pb::StoreHeartBeatRequest& request, bo
             //_region_info.add_peers(butil::endpoint2str(peer.addr).c_str());
         }
         construct_peers_status(leader_heart);
+        leader_heart->set_select_qps(_select_time_cost.qps());
+        leader_heart->set_dml_qps(_dml_time_cost.qps());
+    }
+
+    int64_t fail_index_id = _index_sst_fail_index_id.load();
+    if (fail_index_id != 0) {
+        auto index_ptr = _factory->get_index_info_ptr(fail_index_id);
+        if (index_ptr != nullptr && index_ptr->state == pb::IS_WRITE_LOCAL) {
+            pb::DdlWorkInfoHeartBeat* ddl_info = request.add_ddlwork_infos();
+            ddl_info->set_table_id(get_table_id());
+            ddl_info->set_region_id(_region_id);
+            ddl_info->set_op_type(pb::OP_ADD_INDEX);
+            ddl_info->set_job_state(pb::IS_WRITE_LOCAL);
+            ddl_info->set_errcode(pb::EXEC_FAIL);
+        } else {
+            // ddl已结束或回滚，不再上报
+            _index_sst_fail_index_id.compare_exchange_strong(fail_index_id, 0);
+        }
     }
 
     if (is_learner()) {
@@ -3212,27 +3481,48 @@ void Region::do_apply(int64_t term, int64_t index, const pb::StoreReq& request,
 }
 
 void Region::on_apply(braft::Iterator& iter) {
+    // follower上连续的写集日志合并为一次rocksdb提交
+    std::vector<ApplyEntry> apply_group;
     for (; iter.valid(); iter.next()) {
         braft::Closure* done = iter.done();
         brpc::ClosureGuard done_guard(done);
-        butil::IOBuf data = iter.data();
-        butil::IOBufAsZeroCopyInputStream wrapper(data);
-        std::shared_ptr<pb::StoreReq> request = std::make_shared<pb::StoreReq>();
-        if (!request->ParseFromZeroCopyStream(&wrapper)) {
-            DB_FATAL("parse from protobuf fail, region_id: %ld", _region_id);
-            if (done != nullptr) {
-                ((DMLClosure*)done)->response->set_errcode(pb::PARSE_FROM_PB_FAIL);
-                ((DMLClosure*)done)->response->set_errmsg("parse from protobuf fail");
-                braft::run_closure_in_bthread(done_guard.release());
+        std::shared_ptr<pb::StoreReq> request;
+        // leader上直接使用提交时的请求，省去一次反序列化
+        const pb::StoreReq* proposed_request = nullptr;
+        if (done != nullptr && get_version() != 0) {
+            proposed_request = ((DMLClosure*)done)->request;
+        }
+        if (proposed_request == nullptr) {
+            butil::IOBuf data = iter.data();
+            butil::IOBufAsZeroCopyInputStream wrapper(data);
+            request = std::make_shared<pb::StoreReq>();
+            if (!request->ParseFromZeroCopyStream(&wrapper)) {
+                DB_FATAL("parse from protobuf fail, region_id: %ld", _region_id);
+                if (done != nullptr) {
+                    ((DMLClosure*)done)->response->set_errcode(pb::PARSE_FROM_PB_FAIL);
+                    ((DMLClosure*)done)->response->set_errmsg("parse from protobuf fail");
+                    braft::run_closure_in_bthread(done_guard.release());
+                }
+                continue;
             }
-            continue;
+            proposed_request = request.get();
+        } else {
+            Store::get_instance()->apply_skip_parse_count << 1;
         }
-        reset_timecost();
         auto term = iter.term();
         auto index = iter.index();
         _braft_apply_index = index;
-        if (request->op_type() == pb::OP_ADD_VERSION_FOR_SPLIT_REGION ||
-                (get_version() == 0 && request->op_type() == pb::OP_CLEAR_APPLYING_TXN)) {
+        if (can_group_apply(*proposed_request, done)) {
+            apply_group.emplace_back(ApplyEntry{term, index, request});
+            if (apply_group.size() >= (size_t)FLAGS_apply_group_commit_max_entries) {
+                apply_kv_out_txn_group(apply_group);
+            }
+            continue;
+        }
+        apply_kv_out_txn_group(apply_group);
+        reset_timecost();
+        if (proposed_request->op_type() == pb::OP_ADD_VERSION_FOR_SPLIT_REGION ||
+                (get_version() == 0 && proposed_request->op_type() == pb::OP_CLEAR_APPLYING_TXN)) {
             // 异步队列排空
             DB_WARNING("braft_apply_index: %lu, applied_index: %lu, region_id: %lu",
                        _braft_apply_index, _applied_index, _region_id);
@@ -3243,8 +3533,8 @@ void Region::on_apply(braft::Iterator& iter) {
         // OP_ADD_VERSION_FOR_SPLIT_REGION及分裂结束后，走正常同步的逻辑
         // version为0时，on_leader_start会提交一条pb::OP_CLEAR_APPLYING_TXN日志，这个同步
         if (get_version() == 0
-            && request->op_type() != pb::OP_CLEAR_APPLYING_TXN
-            && request->op_type() != pb::OP_ADD_VERSION_FOR_SPLIT_REGION) {
+            && proposed_request->op_type() != pb::OP_CLEAR_APPLYING_TXN
+            && proposed_request->op_type() != pb::OP_ADD_VERSION_FOR_SPLIT_REGION) {
             auto func = [this, term, index, request]() mutable {
                 pb::StoreReq& store_req = *request;
                 if (!is_async_apply_op_type(store_req.op_type())) {
@@ -3272,13 +3562,121 @@ void Region::on_apply(braft::Iterator& iter) {
                 ((DMLClosure*)done)->response->set_errcode(pb::SUCCESS);
                 ((DMLClosure*)done)->response->set_errmsg("success");
             }
+        } else if (proposed_request->op_type() == pb::OP_INGEST_INDEX_SST) {
+            apply_ingest_index_sst(term, index, *proposed_request, done);
         } else {
-            do_apply(term, index, *request, done);
+            do_apply(term, index, *proposed_request, done);
         }
         if (done != nullptr) {
             braft::run_closure_in_bthread(done_guard.release());
         }
     }
+    apply_kv_out_txn_group(apply_group);
+}
+
+// 只合并follower上region版本未变化的事务外写集日志，这类日志只有kv写入，
+// 不读数据也不依赖前面日志的执行结果
+bool Region::can_group_apply(const pb::StoreReq& request, braft::Closure* done) {
+    if (FLAGS_apply_group_commit_max_entries <= 1 || done != nullptr || get_version() == 0) {
+        return false;
+    }
+    if (request.op_type() != pb::OP_KV_BATCH) {
+        return false;
+    }
+    if (request.txn_infos_size() > 0 && request.txn_infos(0).txn_id() != 0) {
+        return false;
+    }
+    return request.region_version() == get_version();
+}
+
+void Region::apply_kv_out_txn_group(std::vector<ApplyEntry>& apply_group) {
+    if (apply_group.empty()) {
+        return;
+    }
+    ON_SCOPE_EXIT(([&apply_group]() {
+        apply_group.clear();
+    }));
+    reset_timecost();
+    if (apply_group.size() == 1) {
+        auto& entry = apply_group[0];
+        do_apply(entry.term, entry.index, *entry.request, nullptr);
+        return;
+    }
+    TimeCost cost;
+    SmartTransaction txn(new Transaction(0, &_txn_pool));
+    txn->set_resource(get_resource());
+    txn->begin(Transaction::TxnOptions());
+    int64_t num_increase_rows = 0;
+    int64_t last_index = 0;
+    int64_t last_term = 0;
+    bool write_succ = true;
+    for (auto& entry : apply_group) {
+        if (entry.index <= _applied_index) {
+            continue;
+        }
+        for (auto& kv_op : entry.request->kv_ops()) {
+            int ret = 0;
+            if (kv_op.op_type() == pb::OP_PUT_KV) {
+                ret = txn->put_kv(kv_op.key(), kv_op.value(), kv_op.ttl_timestamp_us());
+            } else {
+                ret = txn->delete_kv(kv_op.key());
+            }
+            if (ret < 0) {
+                write_succ = false;
+                break;
+            }
+        }
+        if (!write_succ) {
+            break;
+        }
+        num_increase_rows += entry.request->num_increase_rows();
+        last_index = entry.index;
+        last_term = entry.term;
+    }
+    // 合并失败退回逐条apply，失败只影响出错的那条日志
+    auto apply_one_by_one = [this, &apply_group]() {
+        for (auto& entry : apply_group) {
+            do_apply(entry.term, entry.index, *entry.request, nullptr);
+        }
+    };
+    if (!write_succ) {
+        txn->rollback();
+        DB_WARNING("group apply kv fail, fall back, region_id: %ld, entries: %lu",
+                _region_id, apply_group.size());
+        apply_one_by_one();
+        return;
+    }
+    if (last_index == 0) {
+        txn->rollback();
+        return;
+    }
+    int64_t num_table_lines = _num_table_lines + num_increase_rows;
+    _meta_writer->write_meta_index_and_num_table_lines(_region_id, last_index, last_index,
+            num_table_lines, txn);
+    auto res = txn->commit();
+    if (!res.ok()) {
+        DB_WARNING("group commit fail, fall back, region_id: %ld, applied_index: %ld, term: %ld, error: %s",
+                _region_id, last_index, last_term, res.ToString().c_str());
+        txn->rollback();
+        apply_one_by_one();
+        return;
+    }
+    _region_info.set_log_index(last_index);
+    _applied_index = last_index;
+    _data_index = last_index;
+    if (num_increase_rows < 0) {
+        _num_delete_lines -= num_increase_rows;
+    }
+    _num_table_lines = num_table_lines;
+    _done_applied_index = _applied_index;
+    Store::get_instance()->apply_group_entries << apply_group.size();
+    int64_t dml_cost = cost.get_time();
+    Store::get_instance()->dml_time_cost << dml_cost;
+    if (dml_cost > FLAGS_print_time_us) {
+        DB_NOTICE("group apply time_cost:%ld, region_id: %ld, entries: %lu, table_lines:%ld, "
+                "increase_lines:%ld, applied_index:%ld, term:%ld", dml_cost, _region_id,
+                apply_group.size(), _num_table_lines.load(), num_increase_rows, last_index, last_term);
+    }
 }
 
 bool Region::check_key_fits_region_range(SmartIndex pk_info, SmartTransaction txn,
@@ -3507,15 +3905,20 @@ void Region::apply_kv_out_txn(const pb::StoreReq& request, braft::Closure* done,
     int64_t num_table_lines = 0;
     auto resource = get_resource();
     int64_t num_increase_rows = 0;
-    ScopeGuard auto_rollback([this, &txn, &commit_succ, done]() {
+    pb::ErrCode fail_code = pb::EXEC_FAIL;
+    std::string fail_msg = "commit failed in fsm";
+    if (done != nullptr) {
+        txn = ((DMLClosure*)done)->transaction;
+    }
+    ScopeGuard auto_rollback([this, &txn, &commit_succ, &fail_code, &fail_msg, done]() {
         // rollback if not commit succ
         if (!commit_succ) {
             if (txn != nullptr) {
                 txn->rollback();
             }
             if (done != nullptr) {
-                ((DMLClosure*)done)->response->set_errcode(pb::EXEC_FAIL);
-                ((DMLClosure*)done)->response->set_errmsg("commit failed in fsm");
+                ((DMLClosure*)done)->response->set_errcode(fail_code);
+                ((DMLClosure*)done)->response->set_errmsg(fail_msg);
             }
             if (get_version() == 0) {
                 _async_apply_param.apply_log_failed = true;
@@ -3527,6 +3930,17 @@ void Region::apply_kv_out_txn(const pb::StoreReq& request, braft::Closure* done,
             }
         }
     });
+    // 写集在leader执行时生成，执行到apply之间region发生分裂/merge则写集可能越界，
+    // 各副本按相同的version判断，统一放弃该写集
+    if (is_write_set_stale(request, get_version())) {
+        fail_code = pb::VERSION_OLD;
+        fail_msg = "region version changed before write set applied";
+        _meta_writer->update_apply_index(_region_id, index, _data_index);
+        DB_WARNING("write set conflict, region_id: %ld, request_version: %ld, region_version: %ld, "
+                "applied_index: %ld, term: %ld", _region_id, request.region_version(),
+                get_version(), index, term);
+        return;
+    }
     if (done == nullptr) {
         // follower
         txn = SmartTransaction(new Transaction(0, &_txn_pool));
@@ -3576,9 +3990,6 @@ void Region::apply_kv_out_txn(const pb::StoreReq& request, braft::Closure* done,
             }
         }
         num_table_lines = _num_table_lines + num_increase_rows;
-    } else {
-        // leader
-        txn = ((DMLClosure*)done)->transaction;
     }
     if (get_version() != 0) {
         num_increase_rows = request.num_increase_rows();
@@ -4756,6 +5167,82 @@ int Region::ingest_snapshot_sst(const std::string& dir) {
     return 0;
 }
 
+// 各副本在同一条日志处按相同的数据构建，结果一致，不需要传输sst文件
+// 构建期间本region后续日志排队等待；之后的写入处于WRITE_LOCAL状态，由dml自己维护索引
+// 不支持、唯一冲突、region过大各副本结果一致，返回0；其他本地失败返回-1
+int Region::ingest_index_sst(const pb::StoreReq& request, pb::StoreRes& response) {
+    int64_t index_id = request.ddlwork_info().index_id();
+    SmartIndex index_ptr = _factory->get_index_info_ptr(index_id);
+    SmartIndex pk_ptr = _factory->get_index_info_ptr(_table_id);
+    SmartTable table_ptr = _factory->get_table_info_ptr(_table_id);
+    // 新索引的schema可能还没有同步到本store
+    for (int i = 0; i < FLAGS_ddl_index_sst_wait_schema_s && index_ptr == nullptr; ++i) {
+        DB_WARNING("region_id: %ld, index_id: %ld info not found, wait schema sync", _region_id, index_id);
+        bthread_usleep(1000 * 1000LL);
+        index_ptr = _factory->get_index_info_ptr(index_id);
+    }
+    if (index_ptr == nullptr || pk_ptr == nullptr || table_ptr == nullptr) {
+        response.set_errcode(pb::EXEC_FAIL);
+        response.set_errmsg("index info not found");
+        DB_FATAL("region_id: %ld, index_id: %ld info not found", _region_id, index_id);
+        return -1;
+    }
+    IndexInfo& index_info = *index_ptr;
+    if ((index_info.type != pb::I_KEY && index_info.type != pb::I_UNIQ) || index_info.is_global
+            || _is_global_index || _use_ttl || table_ptr->engine == pb::ROCKSDB_CSTORE) {
+        response.set_errcode(pb::UNSUPPORT_REQ_TYPE);
+        response.set_errmsg("index not support build by sst");
+        DB_WARNING("region_id: %ld, index_id: %ld not support build by sst", _region_id, index_id);
+        return 0;
+    }
+    TimeCost cost;
+    IndexSstBuilder builder(_region_id, _table_id, index_ptr, pk_ptr);
+    builder.set_range(get_start_key(), get_end_key());
+    auto ret = builder.build(FLAGS_db_path, FLAGS_ddl_index_sst_batch_lines,
+            FLAGS_ddl_index_sst_max_region_lines, &response);
+    DB_WARNING("region_id: %ld, index_id: %ld build index sst, ret: %d, scan_lines: %ld, index_lines: %ld, "
+            "cost: %ld", _region_id, index_id, ret, builder.scan_lines(), builder.index_lines(), cost.get_time());
+    return ret == IndexSstBuilder::BUILD_FAIL ? -1 : 0;
+}
+
+void Region::apply_ingest_index_sst(int64_t term, int64_t index, const pb::StoreReq& request,
+        braft::Closure* done) {
+    if (index <= _applied_index) {
+        return;
+    }
+    reset_timecost();
+    pb::StoreRes res;
+    int64_t index_id = request.ddlwork_info().index_id();
+    // 本副本构建失败时不停止状态机，局部数据已清理；leader返回失败，
+    // follower通过心跳上报，由meta把该region的ddl任务置为失败后重试或回滚
+    if (ingest_index_sst(request, res) != 0) {
+        DB_FATAL("region_id: %ld build index sst fail at log index: %ld, term: %ld, res: %s",
+                _region_id, index, term, res.ShortDebugString().c_str());
+        _index_sst_fail_index_id = index_id;
+        res.set_errcode(pb::EXEC_FAIL);
+        res.set_errmsg("build index sst fail");
+    } else if (_index_sst_fail_index_id.load() == index_id) {
+        _index_sst_fail_index_id = 0;
+    }
+    _region_info.set_log_index(index);
+    _applied_index = index;
+    _data_index = _applied_index;
+    _meta_writer->update_apply_index(_region_id, _applied_index, _data_index);
+    if (done != nullptr) {
+        ((DMLClosure*)done)->response->set_errcode(res.errcode());
+        ((DMLClosure*)done)->response->set_errmsg(res.errmsg());
+        if (res.has_mysql_errcode()) {
+            ((DMLClosure*)done)->response->set_mysql_errcode(res.mysql_errcode());
+        }
+        if (res.has_affected_rows()) {
+            ((DMLClosure*)done)->response->set_affected_rows(res.affected_rows());
+        }
+    }
+    DB_NOTICE("op_type: %s, region_id: %ld, applied_index:%ld, term:%ld, res: %s",
+              pb::OpType_Name(request.op_type()).c_str(), _region_id, _applied_index, term,
+              res.ShortDebugString().c_str());
+}
+
 int Region::ingest_sst_backup(const std::string& data_sst_file, const std::string& meta_sst_file) {
     if (boost::filesystem::exists(boost::filesystem::path(data_sst_file)) 
         && boost::filesystem::file_size(boost::filesystem::path(data_sst_file)) > 0) {
@@ -6747,8 +7234,56 @@ int Region::get_log_entry_for_split(const int64_t split_start_index,
     batch_request.set_region_id(_split_param.new_region_id);
     batch_request.set_resend_start_pos(0);
     butil::IOBuf attachment_data;
+    auto add_request = [&](pb::StoreReq& store_req) -> int {
+        if (!is_async_apply_op_type(store_req.op_type())) {
+            DB_WARNING("unexpected store_req:%s, region_id: %ld",
+                       pb2json(store_req).c_str(), _region_id);
+            return -1;
+        }
+        store_req.set_region_id(_split_param.new_region_id);
+        store_req.set_region_version(0);
+
+        butil::IOBuf data;
+        butil::IOBufAsZeroCopyOutputStream wrapper(&data);
+        if (!store_req.SerializeToZeroCopyStream(&wrapper)) {
+            return -1;
+        }
+
+        batch_request.add_request_lens(data.size());
+        attachment_data.append(data);
+        if (batch_request.request_lens_size() == FLAGS_split_send_log_batch_size) {
+            requests.emplace_back(batch_request);
+            attachment_datas.emplace_back(attachment_data);
+            batch_request.clear_request_lens();
+            attachment_data.clear();
+        }
+        ++start_index;
+        return 0;
+    };
+    // 最近append的日志优先从内存缓存读取，未命中后再从rocksdb继续读
+    int count = 0;
+    RaftLogCache::CacheEntry cache_entry;
+    for (; count < 10000; count++) {
+        if (RaftLogCache::get_instance()->get(_region_id, start_index, &cache_entry) != 0) {
+            break;
+        }
+        if (cache_entry.term != expected_term) {
+            DB_FATAL("term not equal to expect_term, term:%ld, expect_term:%ld, region_id: %ld", 
+                      cache_entry.term, expected_term, _region_id);
+            return -1;
+        }
+        pb::StoreReq store_req;
+        butil::IOBufAsZeroCopyInputStream wrapper(cache_entry.data);
+        if (!store_req.ParseFromZeroCopyStream(&wrapper)) {
+            DB_FATAL("Fail to parse request fail, split fail, region_id: %ld", _region_id);
+            return -1;
+        }
+        if (add_request(store_req) != 0) {
+            return -1;
+        }
+    }
     MutTableKey log_data_key;
-    log_data_key.append_i64(_region_id).append_u8(MyRaftLogStorage::LOG_DATA_IDENTIFY).append_i64(split_start_index);
+    log_data_key.append_i64(_region_id).append_u8(MyRaftLogStorage::LOG_DATA_IDENTIFY).append_i64(start_index);
     rocksdb::ReadOptions read_options;
     read_options.prefix_same_as_start = true;
     read_options.total_order_seek = false;
@@ -6756,7 +7291,7 @@ int Region::get_log_entry_for_split(const int64_t split_start_index,
     std::unique_ptr<rocksdb::Iterator> iter(_rocksdb->new_iterator(read_options, RocksWrapper::RAFT_LOG_CF));
     iter->Seek(log_data_key.data());
     // 小batch发送
-    for (int i = 0; iter->Valid() && i < 10000; iter->Next(), i++) {
+    for (; iter->Valid() && count < 10000; iter->Next(), count++) {
         TableKey key(iter->key());
         int64_t log_index = key.extract_i64(sizeof(int64_t) + 1);
         if (log_index != start_index) {
@@ -6783,29 +7318,9 @@ int Region::get_log_entry_for_split(const int64_t split_start_index,
             DB_FATAL("Fail to parse request fail, split fail, region_id: %ld", _region_id);
             return -1;
         }
-        if (!is_async_apply_op_type(store_req.op_type())) {
-            DB_WARNING("unexpected store_req:%s, region_id: %ld",
-                       pb2json(store_req).c_str(), _region_id);
+        if (add_request(store_req) != 0) {
             return -1;
         }
-        store_req.set_region_id(_split_param.new_region_id);
-        store_req.set_region_version(0);
-
-        butil::IOBuf data;
-        butil::IOBufAsZeroCopyOutputStream wrapper(&data);
-        if (!store_req.SerializeToZeroCopyStream(&wrapper)) {
-            return -1;
-        }
-
-        batch_request.add_request_lens(data.size());
-        attachment_data.append(data);
-        if (batch_request.request_lens_size() == FLAGS_split_send_log_batch_size) {
-            requests.emplace_back(batch_request);
-            attachment_datas.emplace_back(attachment_data);
-            batch_request.clear_request_lens();
-            attachment_data.clear();
-        }
-        ++start_index;
     }
     if (batch_request.request_lens_size() > 0) {
         requests.emplace_back(batch_request);
@@ -6868,6 +7383,49 @@ void Region::adjust_num_table_lines() {
     return;
 }
 
+int Region::get_load_split_key(std::string& split_key, int64_t& split_key_term) {
+    int64_t qps = _select_time_cost.qps() + _dml_time_cost.qps();
+    if (!FLAGS_enable_load_split || qps < FLAGS_load_split_qps_threshold) {
+        if (_key_sampler->enabled()) {
+            _key_sampler->set_enabled(false);
+            _key_sampler->clear();
+        }
+        _load_split_hot_rounds = 0;
+        return -1;
+    }
+    if (get_last_split_time_cost() < FLAGS_load_split_cooldown_s * 1000 * 1000LL) {
+        return -1;
+    }
+    if (!_key_sampler->enabled()) {
+        _key_sampler->clear();
+        _key_sampler->set_enabled(true);
+    }
+    if (++_load_split_hot_rounds < FLAGS_load_split_hot_rounds) {
+        return -1;
+    }
+    size_t sample_count = _key_sampler->sample_count();
+    if (sample_count < (size_t)FLAGS_load_split_min_samples) {
+        return -1;
+    }
+    // 访问集中在单个key上时分裂也无法分摊，重新开始采样窗口
+    if (0 != _key_sampler->get_split_key(get_start_key(), get_end_key(), &split_key)) {
+        DB_WARNING("region_id: %ld hot but access not splittable, qps: %ld, samples: %lu",
+                _region_id, qps, sample_count);
+        _key_sampler->clear();
+        _load_split_hot_rounds = 0;
+        return -1;
+    }
+    braft::NodeStatus s;
+    _node.get_status(&s);
+    split_key_term = s.term;
+    _key_sampler->set_enabled(false);
+    _key_sampler->clear();
+    _load_split_hot_rounds = 0;
+    DB_WARNING("region_id: %ld load split, qps: %ld, samples: %lu, split_key: %s",
+            _region_id, qps, sample_count, rocksdb::Slice(split_key).ToString(true).c_str());
+    return 0;
+}
+
 int Region::get_split_key(std::string& split_key, int64_t& split_key_term) {
     int64_t tableid = get_global_index_id();
     if (tableid < 0) {
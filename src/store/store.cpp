@@ -20,6 +20,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 #include <gflags/gflags.h>
+#include <brpc/details/controller_private_accessor.h>
 #include "rocksdb/utilities/memory_util.h"
 #include "rocksdb/iostats_context.h"
 #include "rocksdb/perf_context.h"
@@ -82,6 +83,7 @@ DEFINE_string(container_id, "", "container_id for zoombie instance");
 DEFINE_int32(rocksdb_perf_level, rocksdb::kDisable, "rocksdb_perf_level");
 DEFINE_bool(stop_ttl_data, false, "stop ttl data");
 DEFINE_int64(check_peer_delay_min, 1, "check peer delay min");
+DEFINE_int32(multi_query_concurrency, 10, "max concurrent regions for one multi_query request");
 DECLARE_bool(store_rocks_hang_check);
 DECLARE_int32(store_rocks_hang_check_timeout_s);
 DECLARE_int32(store_rocks_hang_cnt_limit);
@@ -574,6 +576,82 @@ void Store::query(google::protobuf::RpcController* controller,
                   done_guard.release());
 }
 
+void Store::multi_query(google::protobuf::RpcController* controller,
+                  const pb::MultiStoreReq* request,
+                  pb::MultiStoreRes* response,
+                  google::protobuf::Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    // 单个region的query可能异步完成，通过closure通知
+    struct RegionQueryDone : public google::protobuf::Closure {
+        explicit RegionQueryDone(BthreadCond* cond) : cond(cond) {}
+        virtual void Run() {
+            cond->decrease_signal();
+            delete this;
+        }
+        BthreadCond* cond;
+    };
+    std::vector<pb::StoreRes*> responses;
+    responses.reserve(request->requests_size());
+    for (int i = 0; i < request->requests_size(); i++) {
+        responses.emplace_back(response->add_responses());
+    }
+    // 各region相同的plan和tuples只发送了一次，放回各自的request
+    if (request->shared_plan_requests_size() > 0) {
+        pb::MultiStoreReq* mutable_request = const_cast<pb::MultiStoreReq*>(request);
+        for (int idx : request->shared_plan_requests()) {
+            if (idx < 0 || idx >= request->requests_size()) {
+                continue;
+            }
+            pb::StoreReq* req = mutable_request->mutable_requests(idx);
+            req->mutable_plan()->CopyFrom(request->plan());
+            req->mutable_tuples()->CopyFrom(request->tuples());
+        }
+    }
+    brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
+    // brpc::Controller非线程安全，每个region使用独立的controller，结束后再合并到外层
+    std::vector<std::unique_ptr<brpc::Controller>> cntls(request->requests_size());
+    BthreadCond cond;
+    for (int i = 0; i < request->requests_size(); i++) {
+        const pb::StoreReq* req = &request->requests(i);
+        pb::StoreRes* res = responses[i];
+        // 只支持非事务select，其他请求需要走query保证顺序
+        if (req->op_type() != pb::OP_SELECT || req->use_streaming()
+                || (req->txn_infos_size() > 0 && req->txn_infos(0).txn_id() != 0)) {
+            res->set_errcode(pb::UNSUPPORT_REQ_TYPE);
+            res->set_errmsg("unsupport op_type in multi_query");
+            continue;
+        }
+        cntls[i].reset(new brpc::Controller);
+        if (cntl->has_log_id()) {
+            cntls[i]->set_log_id(cntl->log_id());
+        }
+        // query中使用remote_side打日志
+        brpc::ControllerPrivateAccessor(cntls[i].get())
+            .set_remote_side(cntl->remote_side())
+            .set_local_side(cntl->local_side());
+        brpc::Controller* sub_cntl = cntls[i].get();
+        cond.increase_wait(FLAGS_multi_query_concurrency);
+        Bthread bth(&BTHREAD_ATTR_SMALL);
+        bth.run([this, sub_cntl, req, res, &cond]() {
+            query(sub_cntl, req, res, new RegionQueryDone(&cond));
+        });
+    }
+    cond.wait();
+    for (int i = 0; i < request->requests_size(); i++) {
+        if (cntls[i] == nullptr) {
+            continue;
+        }
+        // 单个region失败只影响该region的结果
+        if (cntls[i]->Failed()) {
+            responses[i]->set_errcode(pb::EXEC_FAIL);
+            responses[i]->set_errmsg(cntls[i]->ErrorText());
+        }
+        if (cntls[i]->response_compress_type() != brpc::COMPRESS_TYPE_NONE) {
+            cntl->set_response_compress_type(cntls[i]->response_compress_type());
+        }
+    }
+}
+
 void Store::query_binlog(google::protobuf::RpcController* controller,
                   const pb::StoreReq* request,
                   pb::StoreRes* response,
@@ -1533,6 +1611,10 @@ void Store::whether_split_thread() {
                         process_split_request(ptr_region->get_global_index_id(), region_ids[i], false, split_key, split_key_term);
                         continue;
                     }
+                } else if (ptr_region->get_load_split_key(split_key, split_key_term) == 0) {
+                    // 数据量小但读写热点的region按访问分布分裂，之后由meta按负载调度两半
+                    process_split_request(ptr_region->get_global_index_id(), region_ids[i], false, split_key, split_key_term);
+                    continue;
                 }
             }
             
@@ -0,0 +1,71 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "store_plan_cache.h"
+
+namespace baikaldb {
+DEFINE_int64(store_plan_cache_capacity, 20000, "max sql signs cached by store plan cache, default: 2w");
+bvar::Adder<int64_t> StorePlanCache::store_plan_cache_hit {"store_plan_cache_hit"};
+bvar::Adder<int64_t> StorePlanCache::store_plan_cache_miss {"store_plan_cache_miss"};
+
+StorePlanCache::StorePlanCache() {
+    int64_t shard_capacity = FLAGS_store_plan_cache_capacity / SHARD_NUM + 1;
+    for (auto& shard : _shards) {
+        shard.init(shard_capacity);
+    }
+    for (auto& shard : _plan_shards) {
+        shard.init(shard_capacity);
+    }
+}
+
+int StorePlanCache::find(uint64_t sql_sign, uint64_t tuple_sign, SmartTupleDescs* tuples) {
+    if (_shards[tuple_sign % SHARD_NUM].find(make_key(sql_sign, tuple_sign), tuples) != 0) {
+        store_plan_cache_miss << 1;
+        return -1;
+    }
+    store_plan_cache_hit << 1;
+    return 0;
+}
+
+void StorePlanCache::add(uint64_t sql_sign, uint64_t tuple_sign,
+        const google::protobuf::RepeatedPtrField<pb::TupleDescriptor>& tuples) {
+    auto& shard = _shards[tuple_sign % SHARD_NUM];
+    std::string key = make_key(sql_sign, tuple_sign);
+    if (shard.check(key) == 0) {
+        return;
+    }
+    SmartTupleDescs cache_tuples = std::make_shared<google::protobuf::RepeatedPtrField<pb::TupleDescriptor>>(tuples);
+    shard.add(key, cache_tuples);
+}
+
+int StorePlanCache::find(uint64_t sql_sign, uint64_t plan_sign, SmartPbPlan* plan) {
+    if (_plan_shards[plan_sign % SHARD_NUM].find(make_key(sql_sign, plan_sign), plan) != 0) {
+        store_plan_cache_miss << 1;
+        return -1;
+    }
+    store_plan_cache_hit << 1;
+    return 0;
+}
+
+void StorePlanCache::add(uint64_t sql_sign, uint64_t plan_sign, const pb::Plan& plan) {
+    auto& shard = _plan_shards[plan_sign % SHARD_NUM];
+    std::string key = make_key(sql_sign, plan_sign);
+    if (shard.check(key) == 0) {
+        return;
+    }
+    shard.add(key, std::make_shared<pb::Plan>(plan));
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
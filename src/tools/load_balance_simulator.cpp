@@ -0,0 +1,117 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// 回放meta记录的store心跳(load_balance_record_file)，离线评估负载调度的决策
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <gflags/gflags.h>
+#include <google/protobuf/text_format.h>
+#include "common.h"
+#include "load_balance_scheduler.h"
+
+namespace baikaldb {
+DEFINE_string(record_file, "", "heartbeat record file written by meta");
+DEFINE_bool(print_decision, true, "print every trans leader/add peer decision");
+
+// 最大负载与平均负载之比，越接近1越均衡
+static double imbalance(const std::map<std::string, double>& scores) {
+    double total = 0;
+    double max_score = 0;
+    for (auto& pair : scores) {
+        total += pair.second;
+        max_score = std::max(max_score, pair.second);
+    }
+    if (scores.empty() || total <= 0) {
+        return 1;
+    }
+    return max_score / (total / scores.size());
+}
+
+int simulate() {
+    std::ifstream input(FLAGS_record_file);
+    if (!input.is_open()) {
+        DB_WARNING("open record file: %s fail", FLAGS_record_file.c_str());
+        return -1;
+    }
+    LoadBalanceScheduler* scheduler = LoadBalanceScheduler::get_instance();
+    int64_t heartbeat_count = 0;
+    int64_t schedule_count = 0;
+    int64_t trans_leader_count = 0;
+    int64_t add_peer_count = 0;
+    double total_imbalance_before = 0;
+    double total_imbalance_after = 0;
+    std::string line;
+    while (std::getline(input, line)) {
+        auto pos = line.find('\t');
+        if (pos == std::string::npos) {
+            continue;
+        }
+        int64_t now_us = strtoll(line.substr(0, pos).c_str(), NULL, 10);
+        pb::StoreHeartBeatRequest request;
+        if (!google::protobuf::TextFormat::ParseFromString(line.substr(pos + 1), &request)) {
+            DB_WARNING("parse heartbeat fail: %s", line.c_str());
+            continue;
+        }
+        ++heartbeat_count;
+        const std::string& resource_tag = request.instance_info().resource_tag();
+        scheduler->update_store_load(request.instance_info(), now_us);
+        std::map<std::string, double> before;
+        scheduler->get_store_scores(resource_tag, now_us, &before);
+
+        std::vector<pb::TransLeaderRequest> trans_leaders;
+        std::vector<pb::AddPeer> add_peers;
+        scheduler->schedule(request, now_us, nullptr, &trans_leaders, &add_peers);
+        if (trans_leaders.empty() && add_peers.empty()) {
+            continue;
+        }
+        // 调度后的负载为按region qps预估的值
+        std::map<std::string, double> after;
+        scheduler->get_store_scores(resource_tag, now_us, &after);
+        ++schedule_count;
+        trans_leader_count += trans_leaders.size();
+        add_peer_count += add_peers.size();
+        total_imbalance_before += imbalance(before);
+        total_imbalance_after += imbalance(after);
+        if (!FLAGS_print_decision) {
+            continue;
+        }
+        std::cout << now_us << " instance: " << request.instance_info().address()
+                  << " imbalance: " << imbalance(before) << " -> " << imbalance(after) << std::endl;
+        for (auto& trans_leader : trans_leaders) {
+            std::cout << "    trans_leader " << trans_leader.ShortDebugString() << std::endl;
+        }
+        for (auto& add_peer : add_peers) {
+            std::cout << "    add_peer " << add_peer.ShortDebugString() << std::endl;
+        }
+    }
+    std::cout << "heartbeats: " << heartbeat_count << " schedules: " << schedule_count
+              << " trans_leader: " << trans_leader_count << " add_peer: " << add_peer_count << std::endl;
+    if (schedule_count > 0) {
+        std::cout << "average imbalance of scheduled rounds: " << total_imbalance_before / schedule_count
+                  << " -> " << total_imbalance_after / schedule_count << std::endl;
+    }
+    return 0;
+}
+} // namespace baikaldb
+
+int main(int argc, char **argv) {
+    google::ParseCommandLineFlags(&argc, &argv, true);
+    if (baikaldb::simulate() != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,251 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "mem_row_descriptor.h"
+#include "mem_row.h"
+#include "memory_profile.h"
+#include "runtime_state.h"
+#include "transaction_pool.h"
+#include "agg_node.h"
+
+namespace baikaldb {
+DECLARE_string(spill_dir);
+DECLARE_bool(agg_spill_enable);
+DECLARE_int32(agg_spill_max_level);
+DECLARE_int64(row_number_to_check_memory);
+DECLARE_int64(process_memory_limit_bytes);
+DECLARE_int64(query_memory_limit_ratio);
+
+static const int64_t GROUP_NUM = 200000;
+static const int64_t ROUND_NUM = 2;
+
+struct AggResult {
+    int64_t count = 0;
+    int64_t sum = 0;
+};
+
+// 按k = i % GROUP_NUM, v = i产出GROUP_NUM * ROUND_NUM行，与scan节点一样计入内存
+class VectorScanNode : public ExecNode {
+public:
+    virtual int get_next(RuntimeState* state, RowBatch* batch, bool* eos) {
+        MemRowDescriptor* desc = state->mem_row_desc();
+        while (!batch->is_full() && _next < GROUP_NUM * ROUND_NUM) {
+            std::unique_ptr<MemRow> row = desc->fetch_mem_row();
+            ExprValue k(pb::INT64);
+            k._u.int64_val = _next % GROUP_NUM;
+            ExprValue v(pb::INT64);
+            v._u.int64_val = _next;
+            row->set_value(0, 1, k);
+            row->set_value(0, 2, v);
+            batch->move_row(std::move(row));
+            ++_next;
+        }
+        *eos = (_next >= GROUP_NUM * ROUND_NUM);
+        if (state->memory_limit_exceeded(_next, batch->used_bytes_size()) != 0) {
+            return -1;
+        }
+        return 0;
+    }
+private:
+    int64_t _next = 0;
+};
+
+static pb::Expr slot_ref_expr(int32_t tuple_id, int32_t slot_id) {
+    pb::Expr expr;
+    pb::ExprNode* node = expr.add_nodes();
+    node->set_node_type(pb::SLOT_REF);
+    node->set_col_type(pb::INT64);
+    node->set_num_children(0);
+    node->mutable_derive_node()->set_tuple_id(tuple_id);
+    node->mutable_derive_node()->set_slot_id(slot_id);
+    return expr;
+}
+
+static pb::Expr agg_expr(const std::string& fn_name, int32_t slot_id) {
+    pb::Expr expr;
+    pb::ExprNode* node = expr.add_nodes();
+    node->set_node_type(pb::AGG_EXPR);
+    node->set_col_type(pb::INT64);
+    node->set_num_children(1);
+    node->mutable_fn()->set_name(fn_name);
+    node->mutable_fn()->set_fn_op(0);
+    node->mutable_derive_node()->set_tuple_id(1);
+    node->mutable_derive_node()->set_slot_id(slot_id);
+    node->mutable_derive_node()->set_intermediate_slot_id(slot_id);
+    expr.add_nodes()->CopyFrom(slot_ref_expr(0, 2).nodes(0));
+    return expr;
+}
+
+// select k, count(v), sum(v) from t group by k
+static pb::PlanNode agg_plan_node() {
+    pb::PlanNode pb_node;
+    pb_node.set_node_type(pb::AGG_NODE);
+    pb_node.set_limit(-1);
+    pb_node.set_num_children(1);
+    pb::AggNode* agg = pb_node.mutable_derive_node()->mutable_agg_node();
+    agg->add_group_exprs()->CopyFrom(slot_ref_expr(0, 1));
+    agg->add_agg_funcs()->CopyFrom(agg_expr("count", 1));
+    agg->add_agg_funcs()->CopyFrom(agg_expr("sum", 2));
+    agg->set_agg_tuple_id(1);
+    return pb_node;
+}
+
+static void build_tuples(pb::StoreReq* req) {
+    for (int32_t tuple_id = 0; tuple_id < 2; tuple_id++) {
+        pb::TupleDescriptor* tuple = req->add_tuples();
+        tuple->set_tuple_id(tuple_id);
+        tuple->set_table_id(1);
+        for (int32_t slot_id = 1; slot_id <= 2; slot_id++) {
+            pb::SlotDescriptor* slot = tuple->add_slots();
+            slot->set_slot_id(slot_id);
+            slot->set_slot_type(pb::INT64);
+            slot->set_tuple_id(tuple_id);
+        }
+    }
+}
+
+static int run_agg(uint64_t log_id, std::map<int64_t, AggResult>* results) {
+    pb::StoreReq req;
+    req.set_op_type(pb::OP_SELECT);
+    req.set_region_id(1);
+    req.set_region_version(1);
+    req.set_log_id(log_id);
+    build_tuples(&req);
+    pb::Plan plan;
+    plan.add_nodes()->CopyFrom(agg_plan_node());
+    TransactionPool pool;
+    RuntimeState state;
+    if (state.init(req, plan, req.tuples(), &pool, false) != 0) {
+        return -1;
+    }
+    std::unique_ptr<AggNode> agg_node(new AggNode);
+    if (agg_node->init(plan.nodes(0)) != 0) {
+        return -1;
+    }
+    for (auto agg : *agg_node->mutable_agg_fn_calls()) {
+        agg->type_inferer();
+    }
+    agg_node->add_child(new VectorScanNode);
+    int ret = agg_node->open(&state);
+    if (ret < 0) {
+        agg_node->close(&state);
+        return ret;
+    }
+    bool eos = false;
+    while (!eos) {
+        RowBatch batch;
+        ret = agg_node->get_next(&state, &batch, &eos);
+        if (ret < 0) {
+            agg_node->close(&state);
+            return ret;
+        }
+        for (batch.reset(); !batch.is_traverse_over(); batch.next()) {
+            MemRow* row = batch.get_row().get();
+            AggResult& result = (*results)[row->get_value(0, 1).get_numberic<int64_t>()];
+            result.count += row->get_value(1, 1).get_numberic<int64_t>();
+            result.sum += row->get_value(1, 2).get_numberic<int64_t>();
+        }
+    }
+    agg_node->close(&state);
+    return 0;
+}
+
+static void check_results(const std::map<int64_t, AggResult>& results) {
+    ASSERT_EQ(GROUP_NUM, (int64_t)results.size());
+    for (auto& pair : results) {
+        // 每个分组只能输出一次，count/sum与不落盘一致
+        ASSERT_EQ(ROUND_NUM, pair.second.count) << pair.first;
+        ASSERT_EQ(pair.first * 2 + GROUP_NUM, pair.second.sum) << pair.first;
+    }
+}
+
+class AggSpillTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        FLAGS_agg_spill_enable = true;
+        FLAGS_agg_spill_max_level = 4;
+        FLAGS_row_number_to_check_memory = 0;
+    }
+    virtual void TearDown() {
+        FLAGS_agg_spill_enable = true;
+        FLAGS_agg_spill_max_level = 4;
+        FLAGS_row_number_to_check_memory = 4096;
+    }
+};
+
+TEST_F(AggSpillTest, no_spill) {
+    // 不检查内存，全部在内存中聚合
+    FLAGS_agg_spill_enable = false;
+    FLAGS_row_number_to_check_memory = INT64_MAX;
+    int64_t spill_rows = AggNode::agg_spill_rows.get_value();
+    std::map<int64_t, AggResult> results;
+    ASSERT_EQ(0, run_agg(1, &results));
+    EXPECT_EQ(spill_rows, AggNode::agg_spill_rows.get_value());
+    check_results(results);
+}
+
+TEST_F(AggSpillTest, multi_level_spill) {
+    // 第0层每个分区约GROUP_NUM/8个分组，超过内存限制，需要继续按下一层拆分
+    int64_t spill_rows = AggNode::agg_spill_rows.get_value();
+    std::map<int64_t, AggResult> results;
+    ASSERT_EQ(0, run_agg(2, &results));
+    EXPECT_GT(AggNode::agg_spill_rows.get_value(), spill_rows);
+    check_results(results);
+}
+
+TEST_F(AggSpillTest, single_level_exceeded) {
+    // 只允许一层落盘时第0层分区放不下，超过内存限制失败
+    FLAGS_agg_spill_max_level = 0;
+    std::map<int64_t, AggResult> results;
+    EXPECT_NE(0, run_agg(3, &results));
+}
+
+TEST_F(AggSpillTest, spill_disabled_exceeded) {
+    FLAGS_agg_spill_enable = false;
+    std::map<int64_t, AggResult> results;
+    EXPECT_NE(0, run_agg(4, &results));
+}
+}  // namespace baikaldb
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    google::ParseCommandLineFlags(&argc, &argv, true);
+    baikaldb::FLAGS_spill_dir = "./spill_test";
+    // 内存上限按行大小设置：足够容纳两批新分组，远小于第0层单个分区
+    baikaldb::pb::StoreReq req;
+    baikaldb::build_tuples(&req);
+    std::vector<baikaldb::pb::TupleDescriptor> tuples(req.tuples().begin(), req.tuples().end());
+    baikaldb::MemRowDescriptor desc;
+    if (desc.init(tuples) != 0) {
+        return -1;
+    }
+    std::unique_ptr<baikaldb::MemRow> row = desc.fetch_mem_row();
+    for (int32_t tuple_id = 0; tuple_id < 2; tuple_id++) {
+        for (int32_t slot_id = 1; slot_id <= 2; slot_id++) {
+            baikaldb::ExprValue value(baikaldb::pb::INT64);
+            value._u.int64_val = baikaldb::GROUP_NUM;
+            row->set_value(tuple_id, slot_id, value);
+        }
+    }
+    baikaldb::FLAGS_process_memory_limit_bytes = row->used_size() * 16000;
+    baikaldb::FLAGS_query_memory_limit_ratio = 100;
+    baikaldb::MemTrackerPool::get_instance()->init();
+    return RUN_ALL_TESTS();
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
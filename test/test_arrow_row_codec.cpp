@@ -0,0 +1,102 @@
+// Copyright (c) 2018 Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <vector>
+#include "mem_row_descriptor.h"
+#include "mem_row.h"
+#include "arrow_row_codec.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+
+TEST(test_arrow_row_codec, case_all) {
+    std::vector<pb::TupleDescriptor> tuple_desc;
+    pb::PrimitiveType types[] = {pb::INT64, pb::UINT32, pb::DOUBLE, pb::STRING, pb::BOOL};
+    for (int tuple_id = 0; tuple_id < 2; tuple_id++) {
+        pb::TupleDescriptor tuple;
+        tuple.set_tuple_id(tuple_id);
+        tuple.set_table_id(1);
+        int slot_id = 1;
+        for (auto type : types) {
+            pb::SlotDescriptor* slot = tuple.add_slots();
+            slot->set_slot_id(slot_id++);
+            slot->set_slot_type(type);
+            slot->set_tuple_id(tuple_id);
+        }
+        tuple_desc.push_back(tuple);
+    }
+    MemRowDescriptor desc;
+    ASSERT_EQ(0, desc.init(tuple_desc));
+    ASSERT_TRUE(ArrowRowCodec::support(&desc));
+
+    RowBatch batch;
+    for (int i = 0; i < 10; i++) {
+        std::unique_ptr<MemRow> row = desc.fetch_mem_row();
+        ExprValue id(pb::INT64);
+        id._u.int64_val = -i;
+        row->set_value(0, 1, id);
+        ExprValue u(pb::UINT32);
+        u._u.uint32_val = i * 10;
+        row->set_value(1, 2, u);
+        if (i % 3 != 0) {
+            row->set_value(0, 4, ExprValue(pb::STRING, std::string("a\0b", 3) + std::to_string(i)));
+        }
+        ExprValue b(pb::BOOL);
+        b._u.bool_val = (i % 2 == 0);
+        row->set_value(1, 5, b);
+        batch.move_row(std::move(row));
+    }
+
+    pb::ArrowBatchValue value;
+    ASSERT_EQ(0, ArrowRowCodec::encode(&batch, &desc, &value));
+    ASSERT_EQ(2, value.tuple_values_size());
+
+    google::protobuf::RepeatedField<int32_t> tuple_ids;
+    tuple_ids.Add(0);
+    tuple_ids.Add(1);
+    std::vector<std::unique_ptr<MemRow>> rows;
+    ASSERT_EQ(0, ArrowRowCodec::decode(value, tuple_ids, &desc, &rows));
+    ASSERT_EQ(10, rows.size());
+    for (int i = 0; i < 10; i++) {
+        MemRow* row = rows[i].get();
+        EXPECT_EQ(-i, row->get_value(0, 1).get_numberic<int64_t>());
+        EXPECT_EQ(i * 10, row->get_value(1, 2).get_numberic<uint32_t>());
+        // 未赋值的字段解码后仍为null
+        EXPECT_TRUE(row->get_value(0, 2).is_null());
+        EXPECT_TRUE(row->get_value(1, 1).is_null());
+        if (i % 3 != 0) {
+            EXPECT_EQ(std::string("a\0b", 3) + std::to_string(i), row->get_value(0, 4).get_string());
+        } else {
+            EXPECT_TRUE(row->get_value(0, 4).is_null());
+        }
+        EXPECT_EQ(i % 2 == 0, row->get_value(1, 5)._u.bool_val);
+        // 与行格式的编码结果一致
+        std::string arrow_str;
+        std::string row_str;
+        row->to_string(0, &arrow_str);
+        batch.get_row(i)->to_string(0, &row_str);
+        EXPECT_EQ(row_str, arrow_str);
+    }
+
+    // tuple数量不一致时解码失败
+    tuple_ids.RemoveLast();
+    rows.clear();
+    EXPECT_NE(0, ArrowRowCodec::decode(value, tuple_ids, &desc, &rows));
+}
+}
@@ -0,0 +1,55 @@
+// Copyright (c) 2018 Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <string>
+#include "bloom_filter.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+
+TEST(test_bloom_filter, case_all) {
+    BloomFilter bloom_filter;
+    EXPECT_TRUE(bloom_filter.empty());
+    bloom_filter.init(10000, 0.01, 0);
+    for (int i = 0; i < 10000; i++) {
+        bloom_filter.add_hash(BloomFilter::hash("key" + std::to_string(i)));
+    }
+    // 序列化后下发到store的结果一致
+    BloomFilter remote;
+    ASSERT_TRUE(remote.init_from_string(bloom_filter.data()));
+    for (int i = 0; i < 10000; i++) {
+        EXPECT_TRUE(remote.may_contain_hash(BloomFilter::hash("key" + std::to_string(i))));
+    }
+    int false_positive = 0;
+    for (int i = 10000; i < 20000; i++) {
+        if (remote.may_contain_hash(BloomFilter::hash("key" + std::to_string(i)))) {
+            ++false_positive;
+        }
+    }
+    EXPECT_LT(false_positive, 300);
+    EXPECT_FALSE(remote.init_from_string(""));
+
+    // 超过max_bytes时截断大小
+    BloomFilter small;
+    small.init(1000000, 0.01, 1024);
+    EXPECT_EQ(1025, small.data().size());
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
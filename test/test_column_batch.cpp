@@ -0,0 +1,217 @@
+// Copyright (c) 2018 Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <vector>
+#include "mem_row_descriptor.h"
+#include "mem_row.h"
+#include "column_batch.h"
+#include "batch_kernels.h"
+#include "tuple_record.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+
+static std::vector<pb::TupleDescriptor> build_tuple_desc() {
+    std::vector<pb::TupleDescriptor> tuple_desc;
+    pb::TupleDescriptor tuple;
+    tuple.set_tuple_id(0);
+    tuple.set_table_id(1);
+    pb::PrimitiveType types[] = {pb::INT64, pb::UINT32, pb::DOUBLE, pb::STRING, pb::DATETIME};
+    int slot_id = 1;
+    for (auto type : types) {
+        pb::SlotDescriptor* slot = tuple.add_slots();
+        slot->set_slot_id(slot_id++);
+        slot->set_slot_type(type);
+        slot->set_tuple_id(0);
+    }
+    tuple_desc.push_back(tuple);
+    return tuple_desc;
+}
+
+TEST(test_column_vector, case_all) {
+    ColumnVector col(pb::INT32);
+    ExprValue v(pb::INT64);
+    v._u.int64_val = -5;
+    col.append(v);
+    col.append_null();
+    col.append(ExprValue(pb::STRING, "12"));
+    ASSERT_EQ(3, col.size());
+    EXPECT_EQ(-5, col.get_value(0).get_numberic<int32_t>());
+    EXPECT_EQ(pb::INT32, col.get_value(0).type);
+    EXPECT_TRUE(col.get_value(1).is_null());
+    EXPECT_EQ(12, col.get_value(2).get_numberic<int32_t>());
+
+    ColumnVector str_col(pb::STRING);
+    str_col.append(ExprValue(pb::STRING, "abc"));
+    EXPECT_EQ("abc", str_col.get_value(0).get_string());
+    str_col.set_value(0, ExprValue::Null());
+    EXPECT_TRUE(str_col.is_null(0));
+}
+
+TEST(test_column_batch, row_adapter) {
+    std::vector<pb::TupleDescriptor> tuple_desc = build_tuple_desc();
+    MemRowDescriptor desc;
+    ASSERT_EQ(0, desc.init(tuple_desc));
+    ColumnBatch batch;
+    ASSERT_EQ(0, batch.init(tuple_desc, {}));
+
+    RowBatch rows;
+    for (int i = 0; i < 10; i++) {
+        std::unique_ptr<MemRow> row = desc.fetch_mem_row();
+        ExprValue id(pb::INT64);
+        id._u.int64_val = i;
+        row->set_value(0, 1, id);
+        if (i % 2 == 0) {
+            row->set_value(0, 4, ExprValue(pb::STRING, "row" + std::to_string(i)));
+        }
+        rows.move_row(std::move(row));
+    }
+    ASSERT_EQ(0, batch.append_row_batch(&rows));
+    ASSERT_EQ(10, batch.size());
+    ASSERT_EQ(10, batch.selected_size());
+    EXPECT_TRUE(batch.get_value(3, 0, 4).is_null());
+    EXPECT_EQ("row4", batch.get_value(4, 0, 4).get_string());
+
+    std::vector<uint32_t> sel {1, 4, 7};
+    batch.set_selection(sel);
+    ASSERT_EQ(3, batch.selected_size());
+    EXPECT_EQ(4, batch.selected_row(1));
+
+    RowBatch out;
+    ASSERT_EQ(0, batch.to_row_batch(&desc, &out));
+    ASSERT_EQ(3, out.size());
+    EXPECT_EQ(7, out.get_row(2)->get_value(0, 1).get_numberic<int64_t>());
+    EXPECT_EQ("row4", out.get_row(1)->get_value(0, 4).get_string());
+
+    batch.keep_first_selected(2);
+    EXPECT_EQ(2, batch.selected_size());
+    batch.clear();
+    EXPECT_EQ(0, batch.size());
+    EXPECT_EQ(0, batch.selected_size());
+}
+
+TEST(test_column_batch, decode_fields) {
+    std::vector<pb::TupleDescriptor> tuple_desc = build_tuple_desc();
+    MemRowDescriptor desc;
+    ASSERT_EQ(0, desc.init(tuple_desc));
+    // MemRow的field number即slot_id，序列化结果与存储中的格式一致
+    std::unique_ptr<MemRow> row = desc.fetch_mem_row();
+    ExprValue id(pb::INT64);
+    id._u.int64_val = -7;
+    row->set_value(0, 1, id);
+    ExprValue u(pb::UINT32);
+    u._u.uint32_val = 300;
+    row->set_value(0, 2, u);
+    row->set_value(0, 4, ExprValue(pb::STRING, "abc"));
+    ExprValue dt(pb::DATETIME);
+    dt._u.uint64_val = 123456789;
+    row->set_value(0, 5, dt);
+    std::string value;
+    row->to_string(0, &value);
+
+    std::vector<FieldInfo> field_infos(5);
+    std::map<int32_t, FieldInfo*> fields;
+    std::vector<int32_t> field_slot {0, 1, 2, 3, 4, 5};
+    for (int i = 0; i < 5; ++i) {
+        field_infos[i].id = i + 1;
+        field_infos[i].type = tuple_desc[0].slots(i).slot_type();
+        fields[i + 1] = &field_infos[i];
+    }
+    // 缺失的字段取默认值
+    field_infos[2].default_expr_value = ExprValue(pb::DOUBLE, "1.5");
+
+    ColumnBatch batch;
+    ASSERT_EQ(0, batch.init(tuple_desc, {}));
+    TupleRecord record(value);
+    ASSERT_EQ(0, record.decode_fields(fields, field_slot, 0, &batch));
+    batch.finish_row();
+
+    std::unique_ptr<MemRow> expect = desc.fetch_mem_row();
+    TupleRecord row_record(value);
+    ASSERT_EQ(0, row_record.decode_fields(fields, field_slot, 0, expect));
+    ASSERT_EQ(1, batch.size());
+    for (int32_t slot_id = 1; slot_id <= 5; ++slot_id) {
+        EXPECT_EQ(expect->get_value(0, slot_id).get_string(),
+                batch.get_value(0, 0, slot_id).get_string());
+    }
+    EXPECT_EQ(-7, batch.get_value(0, 0, 1).get_numberic<int64_t>());
+    EXPECT_DOUBLE_EQ(1.5, batch.get_value(0, 0, 3).get_numberic<double>());
+
+    // 解码失败的行回滚，不影响已有的行
+    ExprValue partial(pb::INT64);
+    batch.get_column(0, 1)->append(partial);
+    batch.rollback_row();
+    EXPECT_EQ(1UL, batch.get_column(0, 1)->size());
+    // 未追加的列由finish_row补null
+    batch.get_column(0, 1)->append(id);
+    batch.finish_row();
+    ASSERT_EQ(2, batch.size());
+    EXPECT_TRUE(batch.get_value(1, 0, 4).is_null());
+    EXPECT_EQ(-7, batch.get_value(1, 0, 1).get_numberic<int64_t>());
+}
+
+TEST(test_batch_kernels, compare_arithmetic) {
+    std::vector<pb::TupleDescriptor> tuple_desc = build_tuple_desc();
+    ColumnBatch batch;
+    ASSERT_EQ(0, batch.init(tuple_desc, {}));
+    MemRowDescriptor desc;
+    ASSERT_EQ(0, desc.init(tuple_desc));
+    for (int i = 0; i < 8; i++) {
+        std::unique_ptr<MemRow> row = desc.fetch_mem_row();
+        ExprValue id(pb::INT64);
+        id._u.int64_val = i;
+        row->set_value(0, 1, id);
+        if (i != 3) {
+            ExprValue u(pb::UINT32);
+            u._u.uint32_val = i % 2;
+            row->set_value(0, 2, u);
+        }
+        ASSERT_EQ(0, batch.append_row(row.get()));
+    }
+    ColumnVector* id_col = batch.get_column(0, 1);
+    ColumnVector uint_col(pb::INT64);
+    ASSERT_EQ(0, batch_kernels::cast_column(&batch, *batch.get_column(0, 2), pb::INT64, &uint_col));
+    EXPECT_EQ(pb::INT64, uint_col.type());
+    EXPECT_TRUE(uint_col.is_null(3));
+
+    ExprValue four(pb::INT64);
+    four._u.int64_val = 4;
+    ColumnVector const_col(pb::INT64);
+    batch_kernels::fill_constant(&batch, four, &const_col);
+    ColumnVector cmp(pb::BOOL);
+    ASSERT_EQ(0, batch_kernels::compare(batch_kernels::CMP_GE, &batch, *id_col, const_col, &cmp));
+    EXPECT_FALSE(batch_kernels::is_true(cmp, 3));
+    EXPECT_TRUE(batch_kernels::is_true(cmp, 4));
+
+    ColumnVector div(pb::INT64);
+    ASSERT_EQ(0, batch_kernels::arithmetic(batch_kernels::ARITH_DIVIDES, &batch, *id_col, uint_col, &div));
+    // 除数为0或null时结果为null
+    EXPECT_TRUE(div.is_null(0));
+    EXPECT_TRUE(div.is_null(3));
+    EXPECT_EQ(5, div.int_data()[5]);
+
+    // 只计算选择向量中的行
+    std::vector<uint32_t> sel {1, 6};
+    batch.set_selection(sel);
+    ColumnVector add(pb::INT64);
+    ASSERT_EQ(0, batch_kernels::arithmetic(batch_kernels::ARITH_ADD, &batch, *id_col, *id_col, &add));
+    EXPECT_EQ(12, add.int_data()[6]);
+    EXPECT_TRUE(add.is_null(2));
+}
+}
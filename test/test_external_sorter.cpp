@@ -0,0 +1,203 @@
+// Copyright (c) 2018 Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <vector>
+#include "mem_row_descriptor.h"
+#include "mem_row.h"
+#include "spill_file.h"
+#include "external_sorter.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    baikaldb::FLAGS_spill_dir = "./spill_test";
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_int32(sort_spill_max_runs);
+
+static void build_desc(MemRowDescriptor* desc) {
+    std::vector<pb::TupleDescriptor> tuple_desc;
+    pb::TupleDescriptor tuple;
+    tuple.set_tuple_id(0);
+    tuple.set_table_id(1);
+    pb::SlotDescriptor* slot = tuple.add_slots();
+    slot->set_slot_id(1);
+    slot->set_slot_type(pb::INT64);
+    slot->set_tuple_id(0);
+    slot = tuple.add_slots();
+    slot->set_slot_id(2);
+    slot->set_slot_type(pb::STRING);
+    slot->set_tuple_id(0);
+    tuple_desc.push_back(tuple);
+    ASSERT_EQ(0, desc->init(tuple_desc));
+}
+
+static std::shared_ptr<RowBatch> build_batch(MemRowDescriptor* desc, int begin, int step) {
+    std::shared_ptr<RowBatch> batch = std::make_shared<RowBatch>();
+    for (int i = 0; i < 100; i++) {
+        std::unique_ptr<MemRow> row = desc->fetch_mem_row();
+        ExprValue id(pb::INT64);
+        id._u.int64_val = (begin + i * step) % 1000;
+        row->set_value(0, 1, id);
+        row->set_value(0, 2, ExprValue(pb::STRING, "v" + std::to_string(id._u.int64_val)));
+        batch->move_row(std::move(row));
+    }
+    return batch;
+}
+
+TEST(test_spill_file, round_trip) {
+    MemRowDescriptor desc;
+    build_desc(&desc);
+    std::string path;
+    {
+        SpillFile file(&desc);
+        ASSERT_EQ(0, file.open_write());
+        path = file.path();
+        std::shared_ptr<RowBatch> batch = build_batch(&desc, 0, 1);
+        ASSERT_EQ(0, file.write_batch(batch.get()));
+        ASSERT_EQ(100, file.rows());
+        ASSERT_EQ(0, file.finish_write());
+        for (int i = 0; i < 100; i++) {
+            std::unique_ptr<MemRow> row;
+            bool eof = false;
+            ASSERT_EQ(0, file.read_row(&row, &eof));
+            ASSERT_FALSE(eof);
+            EXPECT_EQ(i, row->get_value(0, 1).get_numberic<int64_t>());
+            EXPECT_EQ("v" + std::to_string(i), row->get_value(0, 2).get_string());
+        }
+        std::unique_ptr<MemRow> row;
+        bool eof = false;
+        ASSERT_EQ(0, file.read_row(&row, &eof));
+        EXPECT_TRUE(eof);
+    }
+    // 析构时删除文件
+    EXPECT_NE(0, access(path.c_str(), F_OK));
+}
+
+TEST(test_spill_file, clean_stale_files) {
+    MemRowDescriptor desc;
+    build_desc(&desc);
+    SpillFile file(&desc);
+    ASSERT_EQ(0, file.open_write());
+    // 不存在的进程留下的文件被删除，本进程正在使用的文件保留
+    std::string stale = FLAGS_spill_dir + "/spill_4194303_1_1";
+    FILE* fp = fopen(stale.c_str(), "w");
+    ASSERT_TRUE(fp != nullptr);
+    fclose(fp);
+    SpillFile::clean_stale_files();
+    EXPECT_NE(0, access(stale.c_str(), F_OK));
+    EXPECT_EQ(0, access(file.path().c_str(), F_OK));
+}
+
+TEST(test_external_sorter, merge_runs) {
+    MemRowDescriptor desc;
+    build_desc(&desc);
+    pb::Expr slot_expr;
+    pb::ExprNode* node = slot_expr.add_nodes();
+    node->set_node_type(pb::SLOT_REF);
+    node->set_col_type(pb::INT64);
+    node->set_num_children(0);
+    node->mutable_derive_node()->set_tuple_id(0);
+    node->mutable_derive_node()->set_slot_id(1);
+    ExprNode* order_expr = nullptr;
+    ASSERT_EQ(0, ExprNode::create_tree(slot_expr, &order_expr));
+    std::vector<ExprNode*> order_exprs {order_expr};
+    std::vector<bool> is_asc {true};
+    std::vector<bool> is_null_first {false};
+    MemRowCompare comp(order_exprs, is_asc, is_null_first);
+
+    ExternalSorter external_sorter(&comp, &desc);
+    for (int r = 0; r < 3; r++) {
+        Sorter sorter(&comp);
+        for (int b = 0; b < 2; b++) {
+            std::shared_ptr<RowBatch> batch = build_batch(&desc, r * 7 + b * 3, 37);
+            sorter.add_batch(batch);
+        }
+        int64_t spilled_bytes = 0;
+        ASSERT_EQ(0, external_sorter.spill(&sorter, &spilled_bytes));
+        EXPECT_GT(spilled_bytes, 0);
+    }
+    ASSERT_EQ(3, external_sorter.run_size());
+    ASSERT_EQ(0, external_sorter.merge());
+
+    int64_t count = 0;
+    int64_t last = -1;
+    bool eos = false;
+    while (!eos) {
+        RowBatch out;
+        ASSERT_EQ(0, external_sorter.get_next(&out, &eos));
+        for (out.reset(); !out.is_traverse_over(); out.next()) {
+            int64_t id = out.get_row()->get_value(0, 1).get_numberic<int64_t>();
+            EXPECT_LE(last, id);
+            EXPECT_EQ("v" + std::to_string(id), out.get_row()->get_value(0, 2).get_string());
+            last = id;
+            ++count;
+        }
+    }
+    EXPECT_EQ(600, count);
+    ExprNode::destroy_tree(order_expr);
+}
+
+TEST(test_external_sorter, intermediate_merge) {
+    MemRowDescriptor desc;
+    build_desc(&desc);
+    pb::Expr slot_expr;
+    pb::ExprNode* node = slot_expr.add_nodes();
+    node->set_node_type(pb::SLOT_REF);
+    node->set_col_type(pb::INT64);
+    node->set_num_children(0);
+    node->mutable_derive_node()->set_tuple_id(0);
+    node->mutable_derive_node()->set_slot_id(1);
+    ExprNode* order_expr = nullptr;
+    ASSERT_EQ(0, ExprNode::create_tree(slot_expr, &order_expr));
+    std::vector<ExprNode*> order_exprs {order_expr};
+    std::vector<bool> is_asc {true};
+    std::vector<bool> is_null_first {false};
+    MemRowCompare comp(order_exprs, is_asc, is_null_first);
+
+    // run数达到上限时归并为一个run，同时打开的文件数不超过上限
+    FLAGS_sort_spill_max_runs = 3;
+    ExternalSorter external_sorter(&comp, &desc);
+    for (int r = 0; r < 7; r++) {
+        Sorter sorter(&comp);
+        std::shared_ptr<RowBatch> batch = build_batch(&desc, r * 11, 37);
+        sorter.add_batch(batch);
+        int64_t spilled_bytes = 0;
+        ASSERT_EQ(0, external_sorter.spill(&sorter, &spilled_bytes));
+        EXPECT_LT(external_sorter.run_size(), 3UL);
+    }
+    ASSERT_EQ(0, external_sorter.merge());
+    int64_t count = 0;
+    int64_t last = -1;
+    bool eos = false;
+    while (!eos) {
+        RowBatch out;
+        ASSERT_EQ(0, external_sorter.get_next(&out, &eos));
+        for (out.reset(); !out.is_traverse_over(); out.next()) {
+            int64_t id = out.get_row()->get_value(0, 1).get_numberic<int64_t>();
+            EXPECT_LE(last, id);
+            last = id;
+            ++count;
+        }
+    }
+    EXPECT_EQ(700, count);
+    FLAGS_sort_spill_max_runs = 64;
+    ExprNode::destroy_tree(order_expr);
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,179 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include "common.h"
+#include "schema_factory.h"
+#include "rocks_wrapper.h"
+#include "mut_table_key.h"
+#include "table_record.h"
+#include "index_sst_builder.h"
+#include "mysql_err_code.h"
+
+namespace baikaldb {
+static const int64_t TABLE_ID = 1;
+static const int64_t KEY_INDEX_ID = 2;
+static const int64_t UNIQ_INDEX_ID = 3;
+
+static void init_table() {
+    pb::SchemaInfo info;
+    info.set_namespace_name("test_namespace");
+    info.set_database("test_database");
+    info.set_table_name("test_index_sst");
+    info.set_partition_num(1);
+    info.set_namespace_id(1);
+    info.set_database_id(1);
+    info.set_table_id(TABLE_ID);
+    info.set_version(1);
+    pb::FieldInfo* field = info.add_fields();
+    field->set_field_name("id");
+    field->set_field_id(1);
+    field->set_mysql_type(pb::INT64);
+    field = info.add_fields();
+    field->set_field_name("k");
+    field->set_field_id(2);
+    field->set_mysql_type(pb::INT64);
+    pb::IndexInfo* index = info.add_indexs();
+    index->set_index_type(pb::I_PRIMARY);
+    index->set_index_name("pk_index");
+    index->set_index_id(TABLE_ID);
+    index->add_field_ids(1);
+    index = info.add_indexs();
+    index->set_index_type(pb::I_KEY);
+    index->set_index_name("key_k");
+    index->set_index_id(KEY_INDEX_ID);
+    index->add_field_ids(2);
+    index = info.add_indexs();
+    index->set_index_type(pb::I_UNIQ);
+    index->set_index_name("uniq_k");
+    index->set_index_id(UNIQ_INDEX_ID);
+    index->add_field_ids(2);
+    SchemaFactory::get_instance()->init();
+    SchemaFactory::get_instance()->update_table(info);
+}
+
+static void put_row(int64_t region_id, int64_t id, int64_t k) {
+    SmartRecord record = SchemaFactory::get_instance()->new_record(TABLE_ID);
+    record->set_int64(record->get_field_by_tag(1), id);
+    record->set_int64(record->get_field_by_tag(2), k);
+    SmartIndex pk_ptr = SchemaFactory::get_instance()->get_index_info_ptr(TABLE_ID);
+    MutTableKey key;
+    key.append_i64(region_id).append_i64(TABLE_ID);
+    ASSERT_EQ(0, key.append_index(*pk_ptr, record.get(), -1, true));
+    std::string value;
+    ASSERT_EQ(0, record->encode(value));
+    auto rocksdb = RocksWrapper::get_instance();
+    ASSERT_TRUE(rocksdb->put(rocksdb::WriteOptions(), rocksdb->get_data_handle(), key.data(), value).ok());
+}
+
+static int64_t count_index(int64_t region_id, int64_t index_id) {
+    auto rocksdb = RocksWrapper::get_instance();
+    rocksdb::ReadOptions read_options;
+    read_options.prefix_same_as_start = true;
+    std::unique_ptr<rocksdb::Iterator> iter(rocksdb->new_iterator(read_options, rocksdb->get_data_handle()));
+    MutTableKey prefix;
+    prefix.append_i64(region_id).append_i64(index_id);
+    int64_t count = 0;
+    for (iter->Seek(prefix.data()); iter->Valid() && iter->key().starts_with(prefix.data()); iter->Next()) {
+        ++count;
+    }
+    return count;
+}
+
+static IndexSstBuilder::BuildResult build(int64_t region_id, int64_t index_id, int64_t batch_lines,
+        int64_t max_lines, pb::StoreRes* res) {
+    SmartIndex index_ptr = SchemaFactory::get_instance()->get_index_info_ptr(index_id);
+    SmartIndex pk_ptr = SchemaFactory::get_instance()->get_index_info_ptr(TABLE_ID);
+    IndexSstBuilder builder(region_id, TABLE_ID, index_ptr, pk_ptr);
+    builder.set_range("", "");
+    return builder.build(".", batch_lines, max_lines, res);
+}
+
+TEST(test_index_sst_builder, key_index) {
+    // k有重复，多个sst批次
+    for (int64_t id = 0; id < 100; ++id) {
+        put_row(101, id, id % 10);
+    }
+    pb::StoreRes res;
+    EXPECT_EQ(IndexSstBuilder::BUILD_SUCCESS, build(101, KEY_INDEX_ID, 16, 1000, &res));
+    EXPECT_EQ(pb::SUCCESS, res.errcode());
+    EXPECT_EQ(100, res.affected_rows());
+    EXPECT_EQ(100, count_index(101, KEY_INDEX_ID));
+    // 不影响其他region
+    EXPECT_EQ(0, count_index(102, KEY_INDEX_ID));
+}
+
+TEST(test_index_sst_builder, uniq_index) {
+    for (int64_t id = 0; id < 100; ++id) {
+        put_row(102, id, id);
+    }
+    pb::StoreRes res;
+    EXPECT_EQ(IndexSstBuilder::BUILD_SUCCESS, build(102, UNIQ_INDEX_ID, 16, 1000, &res));
+    EXPECT_EQ(100, count_index(102, UNIQ_INDEX_ID));
+    // 重复构建结果一致
+    EXPECT_EQ(IndexSstBuilder::BUILD_SUCCESS, build(102, UNIQ_INDEX_ID, 16, 1000, &res));
+    EXPECT_EQ(100, count_index(102, UNIQ_INDEX_ID));
+}
+
+TEST(test_index_sst_builder, uniq_dup) {
+    for (int64_t id = 0; id < 100; ++id) {
+        put_row(103, id, id);
+    }
+    // 与前面批次已经ingest的数据冲突
+    put_row(103, 100, 3);
+    pb::StoreRes res;
+    EXPECT_EQ(IndexSstBuilder::BUILD_DUP_UNIQ, build(103, UNIQ_INDEX_ID, 16, 1000, &res));
+    EXPECT_EQ(ER_DUP_ENTRY, res.mysql_errcode());
+    EXPECT_EQ(0, count_index(103, UNIQ_INDEX_ID));
+    // 同一批次内冲突
+    EXPECT_EQ(IndexSstBuilder::BUILD_DUP_UNIQ, build(103, UNIQ_INDEX_ID, 1000, 1000, &res));
+    EXPECT_EQ(0, count_index(103, UNIQ_INDEX_ID));
+}
+
+TEST(test_index_sst_builder, fall_back) {
+    for (int64_t id = 0; id < 100; ++id) {
+        put_row(104, id, id);
+    }
+    // 超过行数上限，回退到事务回填，之前批次的数据需要删除
+    pb::StoreRes res;
+    EXPECT_EQ(IndexSstBuilder::BUILD_TOO_LARGE, build(104, KEY_INDEX_ID, 16, 50, &res));
+    EXPECT_EQ(pb::UNSUPPORT_REQ_TYPE, res.errcode());
+    EXPECT_EQ(0, count_index(104, KEY_INDEX_ID));
+
+    // 解码失败属于本地失败
+    MutTableKey key;
+    key.append_i64(104).append_i64(TABLE_ID).append_i64(0x7FFFFFFFFFFFFFFF);
+    auto rocksdb = RocksWrapper::get_instance();
+    ASSERT_TRUE(rocksdb->put(rocksdb::WriteOptions(), rocksdb->get_data_handle(),
+            key.data(), std::string("\xff\xff\xff\xff", 4)).ok());
+    res.Clear();
+    EXPECT_EQ(IndexSstBuilder::BUILD_FAIL, build(104, KEY_INDEX_ID, 16, 1000, &res));
+    EXPECT_EQ(pb::EXEC_FAIL, res.errcode());
+    EXPECT_EQ(0, count_index(104, KEY_INDEX_ID));
+}
+} // namespace baikaldb
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    google::ParseCommandLineFlags(&argc, &argv, true);
+    if (baikaldb::RocksWrapper::get_instance()->init("rocks_index_sst_builder") != 0) {
+        std::cout << "rocksdb init fail" << std::endl;
+        return -1;
+    }
+    baikaldb::init_table();
+    return RUN_ALL_TESTS();
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
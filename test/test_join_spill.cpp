@@ -0,0 +1,190 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <map>
+#include <vector>
+#include "mem_row_descriptor.h"
+#include "mem_row.h"
+#include "spill_file.h"
+#include "bloom_filter.h"
+#include "join_node.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    baikaldb::FLAGS_spill_dir = "./spill_test";
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_int32(join_spill_partition_num);
+
+// 直接驱动JoinNode的分区落盘流程，不依赖下游store
+class SpillJoinNode : public JoinNode {
+public:
+    SpillJoinNode(MemRowDescriptor* desc, ExprNode* outer_slot, ExprNode* inner_slot) {
+        _mem_row_desc = desc;
+        _outer_equal_slot.push_back(outer_slot);
+        _inner_equal_slot.push_back(inner_slot);
+    }
+    std::vector<std::unique_ptr<SpillFile>>& outer_partitions() {
+        return _outer_partitions;
+    }
+    std::vector<std::unique_ptr<SpillFile>>& inner_partitions() {
+        return _inner_partitions;
+    }
+    BloomFilter* spill_bloom_filter() {
+        return &_spill_bloom_filter;
+    }
+    void set_spilled() {
+        _is_spilled = true;
+    }
+};
+
+static void build_desc(MemRowDescriptor* desc) {
+    std::vector<pb::TupleDescriptor> tuple_desc;
+    for (int32_t tuple_id = 0; tuple_id < 2; tuple_id++) {
+        pb::TupleDescriptor tuple;
+        tuple.set_tuple_id(tuple_id);
+        tuple.set_table_id(tuple_id + 1);
+        pb::SlotDescriptor* slot = tuple.add_slots();
+        slot->set_slot_id(1);
+        slot->set_slot_type(pb::INT64);
+        slot->set_tuple_id(tuple_id);
+        tuple_desc.push_back(tuple);
+    }
+    ASSERT_EQ(0, desc->init(tuple_desc));
+}
+
+static ExprNode* create_slot_ref(int32_t tuple_id) {
+    pb::Expr slot_expr;
+    pb::ExprNode* node = slot_expr.add_nodes();
+    node->set_node_type(pb::SLOT_REF);
+    node->set_col_type(pb::INT64);
+    node->set_num_children(0);
+    node->mutable_derive_node()->set_tuple_id(tuple_id);
+    node->mutable_derive_node()->set_slot_id(1);
+    ExprNode* expr = nullptr;
+    ExprNode::create_tree(slot_expr, &expr);
+    return expr;
+}
+
+static void build_rows(MemRowDescriptor* desc, int32_t tuple_id, int64_t begin, int64_t count,
+        int64_t mod, std::vector<MemRow*>& rows) {
+    for (int64_t i = begin; i < begin + count; i++) {
+        std::unique_ptr<MemRow> row = desc->fetch_mem_row();
+        ExprValue id(pb::INT64);
+        id._u.int64_val = i % mod;
+        row->set_value(tuple_id, 1, id);
+        rows.emplace_back(row.release());
+    }
+}
+
+static std::map<int64_t, int64_t> count_keys(std::vector<MemRow*>& rows, int32_t tuple_id) {
+    std::map<int64_t, int64_t> counts;
+    for (auto row : rows) {
+        counts[row->get_value(tuple_id, 1).get_numberic<int64_t>()]++;
+    }
+    return counts;
+}
+
+static int64_t join_rows(std::map<int64_t, int64_t>& outer, std::map<int64_t, int64_t>& inner) {
+    int64_t matched = 0;
+    for (auto& pair : outer) {
+        auto iter = inner.find(pair.first);
+        if (iter != inner.end()) {
+            matched += pair.second * iter->second;
+        }
+    }
+    return matched;
+}
+
+TEST(test_join_spill, partition_join) {
+    MemRowDescriptor desc;
+    build_desc(&desc);
+    ExprNode* outer_slot = create_slot_ref(0);
+    ExprNode* inner_slot = create_slot_ref(1);
+    ASSERT_TRUE(outer_slot != nullptr && inner_slot != nullptr);
+    SpillJoinNode join_node(&desc, outer_slot, inner_slot);
+
+    // 不落盘时的结果作为基准
+    std::vector<MemRow*> outer_rows;
+    std::vector<MemRow*> inner_rows;
+    build_rows(&desc, 0, 0, 3000, 1000, outer_rows);
+    build_rows(&desc, 1, 500, 2000, 1500, inner_rows);
+    auto outer_counts = count_keys(outer_rows, 0);
+    auto inner_counts = count_keys(inner_rows, 1);
+    int64_t expected = join_rows(outer_counts, inner_counts);
+    ASSERT_GT(expected, 0);
+
+    // 分多批写入，与fetcher_outer_table_data/fetcher_inner_partitions一致
+    ASSERT_EQ(0, join_node.open_partitions(join_node.outer_partitions()));
+    ASSERT_EQ(0, join_node.open_partitions(join_node.inner_partitions()));
+    ASSERT_EQ(FLAGS_join_spill_partition_num, (int)join_node.outer_partitions().size());
+    join_node.spill_bloom_filter()->init(1000, 0.01, 0);
+    while (!outer_rows.empty()) {
+        size_t n = std::min<size_t>(outer_rows.size(), 700);
+        std::vector<MemRow*> batch(outer_rows.end() - n, outer_rows.end());
+        outer_rows.resize(outer_rows.size() - n);
+        ASSERT_EQ(0, join_node.spill_rows(batch, {outer_slot}, join_node.outer_partitions(),
+                join_node.spill_bloom_filter()));
+        EXPECT_TRUE(batch.empty());
+    }
+    ASSERT_EQ(0, join_node.spill_rows(inner_rows, {inner_slot}, join_node.inner_partitions(), nullptr));
+    ASSERT_EQ(0, join_node.finish_partitions(join_node.outer_partitions()));
+    ASSERT_EQ(0, join_node.finish_partitions(join_node.inner_partitions()));
+
+    // 相同key落在相同分区，按分区join的结果与内存join一致
+    int64_t matched = 0;
+    int64_t outer_total = 0;
+    int non_empty = 0;
+    for (size_t i = 0; i < join_node.outer_partitions().size(); i++) {
+        std::vector<MemRow*> outer_part;
+        std::vector<MemRow*> inner_part;
+        ASSERT_EQ(0, join_node.read_partition(join_node.outer_partitions()[i].get(), outer_part));
+        ASSERT_EQ(0, join_node.read_partition(join_node.inner_partitions()[i].get(), inner_part));
+        auto outer_part_counts = count_keys(outer_part, 0);
+        auto inner_part_counts = count_keys(inner_part, 1);
+        matched += join_rows(outer_part_counts, inner_part_counts);
+        outer_total += outer_part.size();
+        non_empty += outer_part.empty() ? 0 : 1;
+        for (auto row : outer_part) {
+            delete row;
+        }
+        for (auto row : inner_part) {
+            delete row;
+        }
+    }
+    EXPECT_EQ(expected, matched);
+    EXPECT_EQ(3000, outer_total);
+    EXPECT_GT(non_empty, 1);
+
+    // 落盘后下推的bloom filter不能漏掉任何驱动表的key
+    join_node.set_spilled();
+    BloomFilter bloom_filter;
+    join_node.construct_bloom_filter(bloom_filter);
+    ASSERT_FALSE(bloom_filter.empty());
+    for (auto& pair : outer_counts) {
+        ExprValue value(pb::INT64);
+        value._u.int64_val = pair.first;
+        MutTableKey key;
+        key.append_value(value.cast_to(pb::STRING));
+        EXPECT_TRUE(bloom_filter.may_contain_hash(BloomFilter::hash(key.data())));
+    }
+    ExprNode::destroy_tree(outer_slot);
+    ExprNode::destroy_tree(inner_slot);
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,104 @@
+// Copyright (c) 2018 Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <string>
+#include "key_sampler.h"
+#include "mut_table_key.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+
+static std::string make_key(int64_t pk) {
+    MutTableKey key;
+    key.append_i64(1).append_i64(2).append_i64(pk);
+    return key.data();
+}
+
+static std::string make_pk(int64_t pk) {
+    MutTableKey key;
+    key.append_i64(pk);
+    return key.data();
+}
+
+TEST(test_key_sampler, disabled) {
+    FLAGS_load_split_sample_rate = 1;
+    KeySampler sampler;
+    for (int i = 0; i < 100; ++i) {
+        sampler.sample(make_key(i));
+    }
+    EXPECT_EQ(0, sampler.sample_count());
+}
+
+TEST(test_key_sampler, skewed_access) {
+    FLAGS_load_split_sample_rate = 1;
+    FLAGS_load_split_min_samples = 100;
+    KeySampler sampler;
+    sampler.set_enabled(true);
+    // 0~99每个访问1次，100~109每个访问50次，分裂点应落在热点区间内
+    for (int i = 0; i < 100; ++i) {
+        sampler.sample(make_key(i));
+    }
+    for (int round = 0; round < 50; ++round) {
+        for (int i = 100; i < 110; ++i) {
+            sampler.sample(make_key(i));
+        }
+    }
+    EXPECT_EQ(600, sampler.sample_count());
+    std::string split_key;
+    ASSERT_EQ(0, sampler.get_split_key("", "", &split_key));
+    EXPECT_EQ(make_pk(104), split_key);
+
+    // region范围变化后只统计范围内的key
+    ASSERT_EQ(0, sampler.get_split_key(make_pk(105), "", &split_key));
+    EXPECT_GT(split_key, make_pk(105));
+    sampler.clear();
+    EXPECT_EQ(0, sampler.sample_count());
+}
+
+TEST(test_key_sampler, single_hot_key) {
+    FLAGS_load_split_sample_rate = 1;
+    FLAGS_load_split_min_samples = 100;
+    KeySampler sampler;
+    sampler.set_enabled(true);
+    for (int i = 0; i < 1000; ++i) {
+        sampler.sample(make_key(7));
+    }
+    sampler.sample(make_key(8));
+    std::string split_key;
+    // 计数器单行热点无法均分
+    EXPECT_EQ(-1, sampler.get_split_key("", "", &split_key));
+}
+
+TEST(test_key_sampler, reservoir_limit) {
+    FLAGS_load_split_sample_rate = 1;
+    FLAGS_load_split_max_samples = 128;
+    FLAGS_load_split_min_samples = 64;
+    KeySampler sampler;
+    sampler.set_enabled(true);
+    for (int i = 0; i < 10000; ++i) {
+        sampler.sample(make_key(i));
+    }
+    EXPECT_EQ(128, sampler.sample_count());
+    std::string split_key;
+    ASSERT_EQ(0, sampler.get_split_key("", "", &split_key));
+    // 均匀访问时分裂点接近中间
+    EXPECT_GT(split_key, make_pk(2500));
+    EXPECT_LT(split_key, make_pk(7500));
+}
+} // namespace baikaldb
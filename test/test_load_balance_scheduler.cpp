@@ -0,0 +1,173 @@
+// Copyright (c) 2018 Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "load_balance_scheduler.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+static const int64_t SECOND = 1000 * 1000LL;
+
+static pb::InstanceInfo make_instance(const std::string& address, int64_t select_qps, int64_t dml_qps) {
+    pb::InstanceInfo info;
+    info.set_address(address);
+    info.set_resource_tag("tag");
+    info.set_select_qps(select_qps);
+    info.set_dml_qps(dml_qps);
+    info.set_dml_latency(1000);
+    return info;
+}
+
+static void add_leader_region(pb::StoreHeartBeatRequest* request, int64_t region_id,
+        const std::vector<std::string>& peers, int64_t select_qps) {
+    pb::LeaderHeartBeat* leader_region = request->add_leader_regions();
+    leader_region->set_status(pb::IDLE);
+    leader_region->set_select_qps(select_qps);
+    leader_region->set_dml_qps(0);
+    pb::RegionInfo* region = leader_region->mutable_region();
+    region->set_region_id(region_id);
+    region->set_table_id(1);
+    region->set_partition_id(0);
+    region->set_replica_num(peers.size());
+    region->set_version(1);
+    region->set_conf_version(1);
+    region->set_leader(request->instance_info().address());
+    for (auto& peer : peers) {
+        region->add_peers(peer);
+    }
+}
+
+TEST(test_load_balance_scheduler, transfer_hot_leader) {
+    LoadBalanceScheduler* scheduler = LoadBalanceScheduler::get_instance();
+    scheduler->clear();
+    int64_t now = 1000 * SECOND;
+    scheduler->update_store_load(make_instance("s1", 9000, 0), now);
+    scheduler->update_store_load(make_instance("s2", 1000, 0), now);
+    scheduler->update_store_load(make_instance("s3", 2000, 0), now);
+
+    pb::StoreHeartBeatRequest request;
+    *request.mutable_instance_info() = make_instance("s1", 9000, 0);
+    add_leader_region(&request, 1, {"s1", "s2", "s3"}, 4000);
+    add_leader_region(&request, 2, {"s1", "s2", "s3"}, 1500);
+    add_leader_region(&request, 3, {"s1", "s2", "s3"}, 100);
+    std::vector<pb::TransLeaderRequest> trans_leaders;
+    std::vector<pb::AddPeer> add_peers;
+    scheduler->schedule(request, now, nullptr, &trans_leaders, &add_peers);
+    // 平均4000，上限4800：region 1迁入任何follower都会超过上限
+    // region 2迁到s2后s2变为2500，region 3迁到负载更低的s3
+    ASSERT_EQ(2, trans_leaders.size());
+    EXPECT_EQ(2, trans_leaders[0].region_id());
+    EXPECT_EQ("s2", trans_leaders[0].new_leader());
+    EXPECT_EQ(3, trans_leaders[1].region_id());
+    EXPECT_EQ("s3", trans_leaders[1].new_leader());
+    EXPECT_EQ(0, add_peers.size());
+    EXPECT_DOUBLE_EQ(7400, scheduler->get_store_score("s1"));
+    EXPECT_DOUBLE_EQ(2500, scheduler->get_store_score("s2"));
+    EXPECT_DOUBLE_EQ(2100, scheduler->get_store_score("s3"));
+
+    // 调度间隔内不再调度
+    trans_leaders.clear();
+    scheduler->schedule(request, now + SECOND, nullptr, &trans_leaders, &add_peers);
+    EXPECT_EQ(0, trans_leaders.size());
+}
+
+TEST(test_load_balance_scheduler, balanced_cluster) {
+    LoadBalanceScheduler* scheduler = LoadBalanceScheduler::get_instance();
+    scheduler->clear();
+    int64_t now = 1000 * SECOND;
+    scheduler->update_store_load(make_instance("s1", 4500, 0), now);
+    scheduler->update_store_load(make_instance("s2", 4000, 0), now);
+    scheduler->update_store_load(make_instance("s3", 3500, 0), now);
+
+    pb::StoreHeartBeatRequest request;
+    *request.mutable_instance_info() = make_instance("s1", 4500, 0);
+    add_leader_region(&request, 1, {"s1", "s2", "s3"}, 500);
+    std::vector<pb::TransLeaderRequest> trans_leaders;
+    std::vector<pb::AddPeer> add_peers;
+    // 未超过平均值的120%，不调度
+    scheduler->schedule(request, now, nullptr, &trans_leaders, &add_peers);
+    EXPECT_EQ(0, trans_leaders.size());
+    EXPECT_EQ(0, add_peers.size());
+}
+
+TEST(test_load_balance_scheduler, add_peer_when_followers_hot) {
+    LoadBalanceScheduler* scheduler = LoadBalanceScheduler::get_instance();
+    scheduler->clear();
+    // pending remove peer按当前时间判断是否过期
+    int64_t now = butil::gettimeofday_us();
+    scheduler->update_store_load(make_instance("s1", 10000, 0), now);
+    scheduler->update_store_load(make_instance("s2", 5000, 0), now);
+    scheduler->update_store_load(make_instance("s3", 5000, 0), now);
+    scheduler->update_store_load(make_instance("s4", 0, 0), now);
+
+    pb::StoreHeartBeatRequest request;
+    *request.mutable_instance_info() = make_instance("s1", 10000, 0);
+    add_leader_region(&request, 1, {"s1", "s2", "s3"}, 3000);
+    std::vector<pb::TransLeaderRequest> trans_leaders;
+    std::vector<pb::AddPeer> add_peers;
+    scheduler->schedule(request, now, nullptr, &trans_leaders, &add_peers);
+    EXPECT_EQ(0, trans_leaders.size());
+    ASSERT_EQ(1, add_peers.size());
+    EXPECT_EQ(1, add_peers[0].region_id());
+    ASSERT_EQ(4, add_peers[0].new_peers_size());
+    EXPECT_EQ("s4", add_peers[0].new_peers(3));
+    std::string remove_peer;
+    ASSERT_TRUE(scheduler->get_pending_remove_peer(1, &remove_peer));
+    EXPECT_EQ("s1", remove_peer);
+
+    // filter拒绝时不调度
+    scheduler->clear();
+    scheduler->update_store_load(make_instance("s1", 10000, 0), now);
+    scheduler->update_store_load(make_instance("s2", 5000, 0), now);
+    scheduler->update_store_load(make_instance("s3", 5000, 0), now);
+    scheduler->update_store_load(make_instance("s4", 0, 0), now);
+    add_peers.clear();
+    scheduler->schedule(request, now, [](const std::string&, const std::string& target) {
+                return target != "s4";
+            }, &trans_leaders, &add_peers);
+    EXPECT_EQ(0, add_peers.size());
+}
+
+TEST(test_load_balance_scheduler, region_cooldown) {
+    LoadBalanceScheduler* scheduler = LoadBalanceScheduler::get_instance();
+    scheduler->clear();
+    int64_t now = 1000 * SECOND;
+    scheduler->update_store_load(make_instance("s1", 9000, 0), now);
+    scheduler->update_store_load(make_instance("s2", 0, 0), now);
+    scheduler->update_store_load(make_instance("s3", 0, 0), now);
+
+    pb::StoreHeartBeatRequest request;
+    *request.mutable_instance_info() = make_instance("s1", 9000, 0);
+    add_leader_region(&request, 1, {"s1", "s2", "s3"}, 1000);
+    std::vector<pb::TransLeaderRequest> trans_leaders;
+    std::vector<pb::AddPeer> add_peers;
+    scheduler->schedule(request, now, nullptr, &trans_leaders, &add_peers);
+    ASSERT_EQ(1, trans_leaders.size());
+
+    // 同一个region在冷却期内不会被再次调度
+    trans_leaders.clear();
+    now += 120 * SECOND;
+    scheduler->update_store_load(make_instance("s1", 9000, 0), now);
+    scheduler->update_store_load(make_instance("s2", 0, 0), now);
+    scheduler->update_store_load(make_instance("s3", 0, 0), now);
+    scheduler->schedule(request, now, nullptr, &trans_leaders, &add_peers);
+    EXPECT_EQ(0, trans_leaders.size());
+}
+} // namespace baikaldb
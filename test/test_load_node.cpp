@@ -0,0 +1,196 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "load_node.h"
+#include "runtime_state.h"
+#include "schema_factory.h"
+
+namespace baikaldb {
+DECLARE_int64(load_read_block_size);
+DECLARE_uint64(row_batch_size);
+
+static const int64_t TABLE_ID = 1;
+
+static void init_table() {
+    pb::SchemaInfo info;
+    info.set_namespace_name("test_namespace");
+    info.set_database("test_database");
+    info.set_table_name("test_load_node");
+    info.set_partition_num(1);
+    info.set_namespace_id(1);
+    info.set_database_id(1);
+    info.set_table_id(TABLE_ID);
+    info.set_version(1);
+    pb::FieldInfo* field = info.add_fields();
+    field->set_field_name("id");
+    field->set_field_id(1);
+    field->set_mysql_type(pb::INT64);
+    field = info.add_fields();
+    field->set_field_name("name");
+    field->set_field_id(2);
+    field->set_mysql_type(pb::STRING);
+    pb::IndexInfo* index = info.add_indexs();
+    index->set_index_type(pb::I_PRIMARY);
+    index->set_index_name("pk_index");
+    index->set_index_id(TABLE_ID);
+    index->add_field_ids(1);
+    SchemaFactory::get_instance()->init();
+    SchemaFactory::get_instance()->update_table(info);
+}
+
+class TestLoadNode : public LoadNode {
+public:
+    using LoadNode::LineBatch;
+    using LoadNode::read_blocks;
+    using LoadNode::parse_batch;
+    using LoadNode::parse_line;
+    using LoadNode::split_fields;
+    int init_node(const std::string& data_path, const std::string& terminated) {
+        pb::PlanNode node;
+        node.set_node_type(pb::LOAD_NODE);
+        node.set_limit(-1);
+        node.set_num_children(0);
+        pb::LoadNode* load_node = node.mutable_derive_node()->mutable_load_node();
+        load_node->set_table_id(TABLE_ID);
+        load_node->set_data_path(data_path);
+        load_node->set_terminated(terminated);
+        load_node->add_field_ids(1);
+        load_node->add_field_ids(2);
+        if (init(node) != 0) {
+            return -1;
+        }
+        _factory = SchemaFactory::get_instance();
+        _table_info = _factory->get_table_info_ptr(TABLE_ID);
+        return _table_info == nullptr ? -1 : 0;
+    }
+};
+
+static std::vector<std::string> split(TestLoadNode& node, const std::string& line) {
+    std::vector<butil::StringPiece> fields;
+    node.split_fields(line, fields);
+    std::vector<std::string> result;
+    for (auto& field : fields) {
+        result.emplace_back(field.as_string());
+    }
+    return result;
+}
+
+TEST(test_load_node, split_fields) {
+    TestLoadNode node;
+    ASSERT_EQ(0, node.init_node("", "\t"));
+    EXPECT_EQ(std::vector<std::string>({"1", "a b", ""}), split(node, "1\ta b\t"));
+    EXPECT_EQ(std::vector<std::string>({""}), split(node, ""));
+
+    // 多字符分隔符的任意一个字符都是分隔符
+    TestLoadNode multi_node;
+    ASSERT_EQ(0, multi_node.init_node("", ",;"));
+    EXPECT_EQ(std::vector<std::string>({"1", "2", "3"}), split(multi_node, "1,2;3"));
+
+    TestLoadNode no_sep_node;
+    ASSERT_EQ(0, no_sep_node.init_node("", ""));
+    EXPECT_EQ(std::vector<std::string>({"1,2"}), split(no_sep_node, "1,2"));
+}
+
+TEST(test_load_node, parse_line) {
+    TestLoadNode node;
+    ASSERT_EQ(0, node.init_node("", ","));
+    SmartRecord row;
+    std::string reason;
+    ASSERT_EQ(0, node.parse_line("7,abc", row, reason));
+    EXPECT_EQ(7, row->get_value(row->get_field_by_tag(1)).get_numberic<int64_t>());
+    EXPECT_EQ("abc", row->get_value(row->get_field_by_tag(2)).get_string());
+    // 行尾的分隔符去掉
+    ASSERT_EQ(0, node.parse_line("8,def,", row, reason));
+    EXPECT_EQ("def", row->get_value(row->get_field_by_tag(2)).get_string());
+
+    // 字段数不对和非法值的行跳过
+    EXPECT_EQ(1, node.parse_line("9", row, reason));
+    EXPECT_NE(std::string::npos, reason.find("field count"));
+    EXPECT_EQ(1, node.parse_line("x,abc", row, reason));
+    EXPECT_NE(std::string::npos, reason.find("illegal"));
+
+    TestLoadNode::LineBatch batch;
+    batch.lines = {"1,a", "2", "3,c"};
+    batch.line_nos = {10, 11, 12};
+    node.parse_batch(batch);
+    EXPECT_EQ(0, batch.ret);
+    EXPECT_EQ(2UL, batch.records.size());
+    ASSERT_EQ(1UL, batch.err_lines.size());
+    EXPECT_EQ(11, batch.err_lines[0].first);
+}
+
+TEST(test_load_node, block_boundary) {
+    FLAGS_load_read_block_size = 1024;
+    FLAGS_row_batch_size = 3;
+    const std::string path = "./test_load_node.data";
+    std::vector<std::pair<int64_t, std::string>> expected;
+    std::string content;
+    int64_t line_no = 0;
+    // 100字节左右的行，必然有行跨越1024字节的块边界
+    for (int i = 0; i < 30; ++i) {
+        std::string line = std::to_string(i) + "," + std::string(90 + i, 'a' + i % 26);
+        content += line + "\n";
+        expected.emplace_back(++line_no, line);
+    }
+    // 空行计入行号但不解析
+    content += "\n";
+    ++line_no;
+    // 超过块大小的行
+    std::string long_line = "100," + std::string(3000, 'x');
+    content += long_line + "\n";
+    expected.emplace_back(++line_no, long_line);
+    // 最后一行没有换行符
+    std::string last_line = "101,last";
+    content += last_line;
+    expected.emplace_back(++line_no, last_line);
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << content;
+    }
+
+    TestLoadNode node;
+    ASSERT_EQ(0, node.init_node(path, ","));
+    butil::File file(butil::FilePath{path}, butil::File::FLAG_OPEN);
+    ASSERT_TRUE(file.IsValid());
+    RuntimeState state;
+    std::vector<std::pair<int64_t, std::string>> lines;
+    int ret = node.read_blocks(&state, file, [&lines](std::vector<TestLoadNode::LineBatch>& batches) {
+        for (auto& batch : batches) {
+            EXPECT_LE(batch.lines.size(), 3UL);
+            for (size_t i = 0; i < batch.lines.size(); ++i) {
+                lines.emplace_back(batch.line_nos[i], batch.lines[i].as_string());
+            }
+        }
+        return 0;
+    });
+    EXPECT_EQ(0, ret);
+    EXPECT_EQ(expected, lines);
+    butil::DeleteFile(butil::FilePath{path}, false);
+    FLAGS_load_read_block_size = 64 * 1024 * 1024LL;
+    FLAGS_row_batch_size = 200;
+}
+}
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    baikaldb::init_table();
+    return RUN_ALL_TESTS();
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
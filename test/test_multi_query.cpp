@@ -0,0 +1,85 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <string>
+#include "fetcher_store.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+// scan的索引范围按region区分，其余部分相同
+static void build_request(int64_t region_id, const std::string& range, pb::StoreReq* request) {
+    request->set_op_type(pb::OP_SELECT);
+    request->set_region_id(region_id);
+    request->set_region_version(1);
+    pb::TupleDescriptor* tuple = request->add_tuples();
+    tuple->set_tuple_id(0);
+    tuple->set_table_id(1);
+    pb::PlanNode* node = request->mutable_plan()->add_nodes();
+    node->set_node_type(pb::SCAN_NODE);
+    node->set_limit(-1);
+    node->set_num_children(0);
+    pb::ScanNode* scan_node = node->mutable_derive_node()->mutable_scan_node();
+    scan_node->set_tuple_id(0);
+    scan_node->set_table_id(1);
+    scan_node->add_use_indexes(1);
+    scan_node->add_indexes(range);
+}
+
+TEST(test_multi_query, share_plan) {
+    pb::MultiStoreReq request;
+    build_request(1, "all", request.add_requests());
+    build_request(2, "all", request.add_requests());
+    build_request(3, "region_3", request.add_requests());
+    // store已缓存plan的request不带plan
+    build_request(4, "all", request.add_requests());
+    request.mutable_requests(3)->clear_plan();
+    const std::string origin = request.ShortDebugString();
+    const size_t origin_size = request.ByteSizeLong();
+
+    MultiQueryDone::share_plan(&request);
+    ASSERT_EQ(2, request.shared_plan_requests_size());
+    EXPECT_EQ(0, request.shared_plan_requests(0));
+    EXPECT_EQ(1, request.shared_plan_requests(1));
+    EXPECT_TRUE(request.has_plan());
+    EXPECT_EQ(1, request.tuples_size());
+    EXPECT_FALSE(request.requests(0).has_plan());
+    EXPECT_EQ(0, request.requests(1).tuples_size());
+    EXPECT_TRUE(request.requests(2).has_plan());
+    EXPECT_FALSE(request.requests(3).has_plan());
+    EXPECT_EQ(1, request.requests(3).tuples_size());
+    EXPECT_LT(request.ByteSizeLong(), origin_size);
+
+    MultiQueryDone::restore_shared_plan(&request);
+    EXPECT_EQ(origin, request.ShortDebugString());
+}
+
+TEST(test_multi_query, no_shared_plan) {
+    pb::MultiStoreReq request;
+    build_request(1, "region_1", request.add_requests());
+    request.mutable_requests(0)->clear_tuples();
+    const std::string origin = request.ShortDebugString();
+    MultiQueryDone::share_plan(&request);
+    EXPECT_EQ(0, request.shared_plan_requests_size());
+    EXPECT_FALSE(request.has_plan());
+    MultiQueryDone::restore_shared_plan(&request);
+    EXPECT_EQ(origin, request.ShortDebugString());
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,109 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <thread>
+#include <vector>
+#include "network_server.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    signal(SIGPIPE, SIG_IGN);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_int32(baikal_port);
+DECLARE_int32(epoll_timeout);
+
+class ReactorServer : public NetworkServer {
+public:
+    using NetworkServer::create_listen_socket;
+    using NetworkServer::init_reactors;
+    using NetworkServer::run_reactors;
+};
+
+// 连接后读取服务端发出的握手包，返回protocol version
+static int connect_and_read_handshake() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(FLAGS_baikal_port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    // 3字节长度 + 1字节序号 + protocol version
+    uint8_t header[5];
+    size_t received = 0;
+    while (received < sizeof(header)) {
+        ssize_t len = read(fd, header + received, sizeof(header) - received);
+        if (len <= 0) {
+            close(fd);
+            return -1;
+        }
+        received += len;
+    }
+    close(fd);
+    return header[4];
+}
+
+TEST(test_network_server_reactor, reuse_port_accept) {
+    FLAGS_baikal_port = 28000 + getpid() % 1000;
+    FLAGS_epoll_timeout = 10;
+    ASSERT_EQ(0, MachineDriver::get_instance()->init(4));
+    const int reactor_num = 4;
+    ReactorServer server;
+    ASSERT_EQ(0, server.init_reactors(reactor_num));
+    // 未设置SO_REUSEPORT的socket不能再监听同一端口
+    EXPECT_TRUE(server.create_listen_socket(false) == nullptr);
+
+    int ret = -1;
+    std::thread reactors([&server, &ret]() {
+        ret = server.run_reactors();
+    });
+    const int conn_num = 64;
+    for (int i = 0; i < conn_num; ++i) {
+        EXPECT_EQ(10, connect_and_read_handshake());
+    }
+    server.graceful_shutdown();
+    reactors.join();
+    EXPECT_EQ(0, ret);
+
+    // 内核按四元组把连接分给各reactor，所有连接都被accept且不止一个reactor参与
+    int64_t total = 0;
+    int active_reactors = 0;
+    ASSERT_EQ(reactor_num, (int)server.get_epoll_infos().size());
+    for (auto epoll_info : server.get_epoll_infos()) {
+        total += epoll_info->accept_count();
+        if (epoll_info->accept_count() > 0) {
+            ++active_reactors;
+        }
+    }
+    EXPECT_EQ(conn_num, total);
+    EXPECT_GT(active_reactors, 1);
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
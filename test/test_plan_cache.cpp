@@ -0,0 +1,112 @@
+// Copyright (c) 2018 Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "plan_cache.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_int64(plan_cache_failed_expire_s);
+
+TEST(test_plan_cache, normalize_select) {
+    std::string normalized;
+    std::vector<pb::ExprNode> params;
+    ASSERT_EQ(0, PlanCache::normalize_sql(
+            "SELECT a, 1 FROM t  WHERE id = 10 and  b >= -2.5 and c in (1, 'x\\'y') "
+            "and d between 3 and 4 order by a limit 10",
+            &normalized, &params));
+    EXPECT_EQ("SELECT a, 1 FROM t WHERE id = ? and b >= ? and c in (?, ?) "
+              "and d between ? and ? order by a limit 10", normalized);
+    ASSERT_EQ(6, params.size());
+    EXPECT_EQ(pb::INT_LITERAL, params[0].node_type());
+    EXPECT_EQ(10, params[0].derive_node().int_val());
+    EXPECT_EQ(pb::DOUBLE_LITERAL, params[1].node_type());
+    EXPECT_DOUBLE_EQ(-2.5, params[1].derive_node().double_val());
+    EXPECT_EQ(pb::STRING_LITERAL, params[3].node_type());
+    EXPECT_EQ("x'y", params[3].derive_node().string_val());
+    EXPECT_EQ(4, params[5].derive_node().int_val());
+
+    // 常量不同的sql得到相同模板
+    std::string normalized2;
+    ASSERT_EQ(0, PlanCache::normalize_sql(
+            "select a, 1 from t where id=20 and b>=7 and c in (5,'z') and d between 1 and 2 order by a limit 10",
+            &normalized2, &params));
+    EXPECT_EQ("select a, 1 from t where id=? and b>=? and c in (?,?) and d between ? and ? order by a limit 10",
+            normalized2);
+    ASSERT_EQ(6, params.size());
+    EXPECT_EQ(pb::INT_LITERAL, params[1].node_type());
+}
+
+TEST(test_plan_cache, normalize_dml) {
+    std::string normalized;
+    std::vector<pb::ExprNode> params;
+    ASSERT_EQ(0, PlanCache::normalize_sql(
+            "insert into t (a, b) values (1, 'a'), (-2, \"b\") on duplicate key update b = values(b)",
+            &normalized, &params));
+    EXPECT_EQ("insert into t (a, b) values (?, ?), (?, ?) on duplicate key update b = values(b)", normalized);
+    ASSERT_EQ(4, params.size());
+    EXPECT_EQ(-2, params[2].derive_node().int_val());
+
+    ASSERT_EQ(0, PlanCache::normalize_sql("update t set a = a + 1, b = 'x' where id = 3",
+            &normalized, &params));
+    EXPECT_EQ("update t set a = a + 1, b = ? where id = ?", normalized);
+    ASSERT_EQ(2, params.size());
+}
+
+TEST(test_plan_cache, normalize_unsupported) {
+    std::string normalized;
+    std::vector<pb::ExprNode> params;
+    const char* sqls[] = {
+        "select * from t where id = 1 /* comment */",
+        "select * from t where id = 1 -- comment",
+        "select * from t where id = ?",
+        "select * from t where id = @a",
+        "select * from t where id = 1; select 1",
+        "select * from t where id in (select id from t2)",
+        "select * from t where id = 0x1F",
+        "select * from t where id = x'1F'",
+        "select * from t where name = 'it''s'",
+        "select * from t where id = 99999999999999999999",
+        "show tables",
+        "explain select * from t where id = 1",
+    };
+    for (auto sql : sqls) {
+        EXPECT_NE(0, PlanCache::normalize_sql(sql, &normalized, &params)) << sql;
+    }
+}
+
+TEST(test_plan_cache, failed_marker) {
+    // 模板生成失败时缓存不可复用的标记，命中后直接走普通流程，不计入命中
+    std::string key = "ns\tdb\tutf8\tselect * from not_exist where id = ?";
+    SmartPlanCacheItem item;
+    EXPECT_NE(0, PlanCache::get_instance()->find(key, &item));
+    SmartPlanCacheItem marker = std::make_shared<PlanCacheItem>();
+    marker->failed_time_us = butil::gettimeofday_us();
+    PlanCache::get_instance()->add(key, marker);
+    int64_t hit = PlanCache::plan_cache_hit.get_value();
+    ASSERT_EQ(0, PlanCache::get_instance()->find(key, &item));
+    EXPECT_FALSE(item->cacheable);
+    EXPECT_EQ(hit, PlanCache::plan_cache_hit.get_value());
+
+    // 过期后重新生成模板
+    marker->failed_time_us = butil::gettimeofday_us() - (FLAGS_plan_cache_failed_expire_s + 1) * 1000 * 1000LL;
+    EXPECT_NE(0, PlanCache::get_instance()->find(key, &item));
+}
+}
@@ -0,0 +1,279 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <gflags/gflags.h>
+#include "delete_manager_node.h"
+#include "single_txn_manager_node.h"
+#include "separate.h"
+#include "network_socket.h"
+#include "user_info.h"
+
+namespace baikaldb {
+DECLARE_bool(reuse_prepared_dml_plan);
+static const int64_t TABLE_ID = 1;
+
+static void init_table() {
+    pb::SchemaInfo info;
+    info.set_namespace_name("test_namespace");
+    info.set_database("test_database");
+    info.set_table_name("test_prepared_dml_reuse");
+    info.set_partition_num(1);
+    info.set_namespace_id(1);
+    info.set_database_id(1);
+    info.set_table_id(TABLE_ID);
+    info.set_version(1);
+    pb::FieldInfo* field = info.add_fields();
+    field->set_field_name("id");
+    field->set_field_id(1);
+    field->set_mysql_type(pb::INT64);
+    field = info.add_fields();
+    field->set_field_name("v");
+    field->set_field_id(2);
+    field->set_mysql_type(pb::INT64);
+    pb::IndexInfo* index = info.add_indexs();
+    index->set_index_type(pb::I_PRIMARY);
+    index->set_index_name("pk_index");
+    index->set_index_id(TABLE_ID);
+    index->add_field_ids(1);
+    SchemaFactory::get_instance()->init();
+    SchemaFactory::get_instance()->update_table(info);
+}
+
+class ReusedDeleteManagerNode : public DeleteManagerNode {
+public:
+    FetcherStore& fetcher_store() {
+        return _fetcher_store;
+    }
+};
+
+class ReusedTxnManagerNode : public SingleTxnManagerNode {
+public:
+    FetcherStore& fetcher_store() {
+        return _fetcher_store;
+    }
+};
+
+// 模拟一次执行后的fetcher状态，kill时额外设置取消标记
+static void run_once(FetcherStore& fetcher_store, bool killed) {
+    EXPECT_FALSE(fetcher_store.is_cancelled);
+    EXPECT_EQ(E_OK, fetcher_store.error.load());
+    EXPECT_EQ(0, fetcher_store.affected_rows.load());
+    fetcher_store.affected_rows += 3;
+    fetcher_store.skip_region_set.insert(1);
+    if (killed) {
+        fetcher_store.cancel_rpc();
+        fetcher_store.error = E_FATAL;
+    }
+}
+
+TEST(test_prepared_dml_reuse, default_off) {
+    EXPECT_FALSE(FLAGS_reuse_prepared_dml_plan);
+}
+
+TEST(test_prepared_dml_reuse, repeated_execute_after_kill) {
+    ReusedDeleteManagerNode manager_node;
+    ReusedTxnManagerNode txn_node;
+    for (int i = 0; i < 6; ++i) {
+        // 第2、4次执行被kill，之后的执行不能继承取消状态
+        bool killed = (i % 2 == 1);
+        manager_node.reset_fetcher_store();
+        txn_node.reset_fetcher_store();
+        run_once(manager_node.fetcher_store(), killed);
+        run_once(txn_node.fetcher_store(), killed);
+        EXPECT_EQ(killed, manager_node.fetcher_store().is_cancelled);
+        EXPECT_EQ(killed, txn_node.fetcher_store().is_cancelled);
+    }
+}
+
+// prepare时生成的逻辑计划：packet -> dml -> (scan)
+static void build_dml_plan(pb::OpType op_type, pb::Plan* plan) {
+    pb::PlanNode* packet = plan->add_nodes();
+    packet->set_node_type(pb::PACKET_NODE);
+    packet->set_num_children(1);
+    packet->set_limit(-1);
+    packet->mutable_derive_node()->mutable_packet_node()->set_op_type(op_type);
+    pb::PlanNode* dml = plan->add_nodes();
+    dml->set_limit(-1);
+    if (op_type == pb::OP_INSERT) {
+        dml->set_node_type(pb::INSERT_NODE);
+        dml->set_num_children(0);
+        dml->mutable_derive_node()->mutable_insert_node()->set_table_id(TABLE_ID);
+        dml->mutable_derive_node()->mutable_insert_node()->set_tuple_id(0);
+        return;
+    }
+    if (op_type == pb::OP_UPDATE) {
+        dml->set_node_type(pb::UPDATE_NODE);
+        dml->mutable_derive_node()->mutable_update_node()->set_table_id(TABLE_ID);
+    } else {
+        dml->set_node_type(pb::DELETE_NODE);
+        dml->mutable_derive_node()->mutable_delete_node()->set_table_id(TABLE_ID);
+    }
+    dml->set_num_children(1);
+    pb::PlanNode* scan = plan->add_nodes();
+    scan->set_node_type(pb::SCAN_NODE);
+    scan->set_num_children(0);
+    scan->set_limit(-1);
+    scan->mutable_derive_node()->mutable_scan_node()->set_tuple_id(0);
+    scan->mutable_derive_node()->mutable_scan_node()->set_table_id(TABLE_ID);
+    scan->mutable_derive_node()->mutable_scan_node()->set_engine(pb::ROCKSDB);
+}
+
+static std::map<int64_t, pb::RegionInfo> make_region_infos(int64_t region_id) {
+    std::map<int64_t, pb::RegionInfo> region_infos;
+    region_infos[region_id].set_region_id(region_id);
+    region_infos[region_id].set_table_id(TABLE_ID);
+    return region_infos;
+}
+
+// 一次execute：本次的路由和记录写在prepare的执行树上，然后走物理计划的Separate
+static int execute_once(ExecNode* root, pb::OpType op_type, bool enable_2pc,
+        int64_t region_id, size_t record_num, NetworkSocket* client, QueryContext* ctx) {
+    ctx->root = root;
+    ctx->client_conn = client;
+    ctx->user_info = std::make_shared<UserInfo>();
+    ctx->reuse_prepared_plan = true;
+    ctx->enable_2pc = enable_2pc;
+    client->txn_id = 0;
+    ExecNode* route_node = nullptr;
+    if (op_type == pb::OP_INSERT) {
+        route_node = root->get_node(pb::INSERT_NODE);
+        for (size_t i = 0; i < record_num; ++i) {
+            ctx->insert_records.emplace_back(SchemaFactory::get_instance()->new_record(TABLE_ID));
+        }
+    } else {
+        route_node = root->get_node(pb::SCAN_NODE);
+    }
+    route_node->set_region_infos(make_region_infos(region_id));
+    return Separate().analyze(ctx);
+}
+
+static pb::PlanNodeType manager_type(pb::OpType op_type) {
+    switch (op_type) {
+        case pb::OP_INSERT:
+            return pb::INSERT_MANAGER_NODE;
+        case pb::OP_UPDATE:
+            return pb::UPDATE_MANAGER_NODE;
+        default:
+            return pb::DELETE_MANAGER_NODE;
+    }
+}
+
+static void check_reuse(pb::OpType op_type, bool enable_2pc) {
+    SCOPED_TRACE(pb::OpType_Name(op_type) + (enable_2pc ? " 2pc" : ""));
+    QueryContext prepare_ctx;
+    build_dml_plan(op_type, &prepare_ctx.plan);
+    ASSERT_EQ(0, prepare_ctx.create_plan_tree());
+    ExecNode* root = prepare_ctx.root;
+    NetworkSocket client;
+    pb::PlanNodeType type = manager_type(op_type);
+
+    QueryContext first_ctx;
+    ASSERT_EQ(0, execute_once(root, op_type, enable_2pc, 1, 2, &client, &first_ctx));
+    std::vector<ExecNode*> manager_nodes;
+    root->get_node(type, manager_nodes);
+    ASSERT_EQ(1UL, manager_nodes.size());
+    ExecNode* manager_node = manager_nodes[0];
+    ExecNode* packet_node = root->get_node(pb::PACKET_NODE);
+    ASSERT_EQ(1UL, packet_node->children_size());
+    ExecNode* top_node = packet_node->children(0);
+    EXPECT_EQ(enable_2pc ? pb::SIGNEL_TXN_MANAGER_NODE : type, top_node->node_type());
+    EXPECT_EQ(1UL, manager_node->region_infos().count(1));
+
+    // 第二次execute直接复用第一次分离好的执行树，只更新路由和记录
+    QueryContext second_ctx;
+    ASSERT_EQ(0, execute_once(root, op_type, enable_2pc, 2, 3, &client, &second_ctx));
+    manager_nodes.clear();
+    root->get_node(type, manager_nodes);
+    ASSERT_EQ(1UL, manager_nodes.size());
+    EXPECT_EQ(manager_node, manager_nodes[0]);
+    ASSERT_EQ(1UL, packet_node->children_size());
+    EXPECT_EQ(top_node, packet_node->children(0));
+    std::vector<ExecNode*> txn_nodes;
+    root->get_node(pb::SIGNEL_TXN_MANAGER_NODE, txn_nodes);
+    EXPECT_EQ(enable_2pc ? 1UL : 0UL, txn_nodes.size());
+    EXPECT_EQ(0UL, manager_node->region_infos().count(1));
+    EXPECT_EQ(1UL, manager_node->region_infos().count(2));
+    if (op_type == pb::OP_INSERT) {
+        // 本次的3条记录换入manager，换出上次的2条
+        EXPECT_EQ(2UL, second_ctx.insert_records.size());
+    }
+}
+
+TEST(test_prepared_dml_reuse, separate_reuses_plan) {
+    for (auto op_type : {pb::OP_INSERT, pb::OP_UPDATE, pb::OP_DELETE}) {
+        check_reuse(op_type, false);
+        check_reuse(op_type, true);
+    }
+}
+
+class RestoreTxnManagerNode : public SingleTxnManagerNode {
+public:
+    using SingleTxnManagerNode::save_origin_children;
+    using SingleTxnManagerNode::restore_cached_children;
+};
+
+TEST(test_prepared_dml_reuse, restore_cached_children) {
+    RestoreTxnManagerNode txn_node;
+    txn_node.set_reuse_plan(true);
+    std::vector<ExecNode*> children;
+    for (int i = 0; i < 5; ++i) {
+        children.push_back(new ExecNode);
+        txn_node.add_child(children.back());
+    }
+    ExecNode* dml_node = new ExecNode;
+    children[1]->add_child(dml_node);
+    txn_node.save_origin_children();
+
+    // 模拟open：begin和dml节点移交给连接缓存，dml manager被摘除
+    NetworkSocket client;
+    client.cache_plans[1].root = children[0];
+    client.cache_plans[2].root = dml_node;
+    ExecNode* other_node = new ExecNode;
+    client.cache_plans[3].root = other_node;
+    txn_node.mutable_children()->erase(txn_node.mutable_children()->begin());
+    txn_node.mutable_children()->erase(txn_node.mutable_children()->begin());
+    children[1]->clear_children();
+
+    txn_node.restore_cached_children(&client);
+    ASSERT_EQ(5UL, txn_node.children_size());
+    for (size_t i = 0; i < children.size(); ++i) {
+        EXPECT_EQ(children[i], txn_node.children(i));
+    }
+    ASSERT_EQ(1UL, children[1]->children_size());
+    EXPECT_EQ(dml_node, children[1]->children(0));
+    // 只摘除执行树自己的节点，其他缓存保留给on_commit_rollback释放
+    ASSERT_EQ(1UL, client.cache_plans.size());
+    EXPECT_EQ(other_node, client.cache_plans[3].root);
+}
+
+TEST(test_prepared_dml_reuse, clear_resets_cancel) {
+    FetcherStore fetcher_store;
+    fetcher_store.cancel_rpc();
+    fetcher_store.error = E_FATAL;
+    fetcher_store.affected_rows = 10;
+    ASSERT_TRUE(fetcher_store.is_cancelled);
+    fetcher_store.clear();
+    EXPECT_FALSE(fetcher_store.is_cancelled);
+    EXPECT_EQ(E_OK, fetcher_store.error.load());
+    EXPECT_EQ(0, fetcher_store.affected_rows.load());
+    EXPECT_TRUE(fetcher_store.skip_region_set.empty());
+}
+} // namespace baikaldb
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    baikaldb::init_table();
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <gflags/gflags.h>
+#include "raft_log_cache.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_int64(raft_log_cache_capacity_mb);
+DECLARE_int32(raft_log_cache_region_entries);
+
+static void append_logs(int64_t region_id, int64_t owner, int64_t start, int64_t end,
+        int64_t term, size_t size) {
+    std::vector<braft::LogEntry*> entries;
+    for (int64_t i = start; i <= end; ++i) {
+        braft::LogEntry* entry = new braft::LogEntry;
+        entry->AddRef();
+        entry->type = braft::ENTRY_TYPE_DATA;
+        entry->id = braft::LogId(i, term);
+        entry->data.append(std::string(size, 'a' + i % 26));
+        entries.emplace_back(entry);
+    }
+    RaftLogCache::get_instance()->append(region_id, owner, entries);
+    for (auto entry : entries) {
+        entry->Release();
+    }
+}
+
+TEST(test_raft_log_cache, get_and_truncate) {
+    FLAGS_raft_log_cache_capacity_mb = 16;
+    FLAGS_raft_log_cache_region_entries = 100;
+    RaftLogCache* cache = RaftLogCache::get_instance();
+    int64_t owner = cache->new_owner();
+    cache->set_owner(1, owner);
+    append_logs(1, owner, 1, 10, 1, 10);
+    braft::LogEntry* entry = cache->get_entry(1, 5);
+    ASSERT_TRUE(entry != nullptr);
+    EXPECT_EQ(1, entry->id.term);
+    EXPECT_EQ(std::string(10, 'f'), entry->data.to_string());
+    entry->Release();
+    EXPECT_TRUE(cache->get_entry(1, 11) == nullptr);
+    EXPECT_TRUE(cache->get_entry(2, 5) == nullptr);
+
+    cache->truncate_prefix(1, owner, 4);
+    EXPECT_TRUE(cache->get_entry(1, 3) == nullptr);
+    cache->truncate_suffix(1, owner, 6);
+    EXPECT_TRUE(cache->get_entry(1, 7) == nullptr);
+    RaftLogCache::CacheEntry cache_entry;
+    EXPECT_EQ(0, cache->get(1, 6, &cache_entry));
+
+    // 截断后以新term重写
+    append_logs(1, owner, 7, 8, 2, 10);
+    EXPECT_EQ(0, cache->get(1, 8, &cache_entry));
+    EXPECT_EQ(2, cache_entry.term);
+    // 不连续的append丢弃旧缓存
+    append_logs(1, owner, 20, 20, 2, 10);
+    EXPECT_EQ(-1, cache->get(1, 8, &cache_entry));
+    EXPECT_EQ(0, cache->get(1, 20, &cache_entry));
+    cache->remove(1, owner);
+    EXPECT_EQ(-1, cache->get(1, 20, &cache_entry));
+    EXPECT_EQ(0, cache->used_bytes());
+}
+
+TEST(test_raft_log_cache, eviction) {
+    FLAGS_raft_log_cache_capacity_mb = 1;
+    FLAGS_raft_log_cache_region_entries = 1000;
+    RaftLogCache* cache = RaftLogCache::get_instance();
+    int64_t owner = cache->new_owner();
+    for (int64_t region_id = 1; region_id <= 64; ++region_id) {
+        cache->set_owner(region_id, owner);
+    }
+    // region数量多于分片数，每条4K，总量超过1M后淘汰最老的日志
+    for (int64_t index = 1; index <= 100; ++index) {
+        for (int64_t region_id = 1; region_id <= 64; ++region_id) {
+            append_logs(region_id, owner, index, index, 1, 4096);
+        }
+    }
+    EXPECT_LE(cache->used_bytes(), 1024 * 1024);
+    RaftLogCache::CacheEntry cache_entry;
+    EXPECT_EQ(-1, cache->get(3, 1, &cache_entry));
+    EXPECT_EQ(0, cache->get(3, 100, &cache_entry));
+    // 单region条数上限
+    FLAGS_raft_log_cache_region_entries = 2;
+    append_logs(3, owner, 101, 103, 1, 10);
+    EXPECT_EQ(-1, cache->get(3, 101, &cache_entry));
+    EXPECT_EQ(0, cache->get(3, 102, &cache_entry));
+    for (int64_t region_id = 1; region_id <= 64; ++region_id) {
+        cache->remove(region_id, owner);
+    }
+    EXPECT_EQ(0, cache->used_bytes());
+}
+
+TEST(test_raft_log_cache, owner) {
+    FLAGS_raft_log_cache_capacity_mb = 16;
+    FLAGS_raft_log_cache_region_entries = 100;
+    RaftLogCache* cache = RaftLogCache::get_instance();
+    int64_t old_owner = cache->new_owner();
+    cache->set_owner(1, old_owner);
+    append_logs(1, old_owner, 1, 10, 1, 10);
+    RaftLogCache::CacheEntry cache_entry;
+    EXPECT_EQ(0, cache->get(1, 5, &cache_entry));
+
+    // 同一region重建log storage，新实例接管后旧实例的缓存被丢弃
+    int64_t new_owner = cache->new_owner();
+    cache->set_owner(1, new_owner);
+    EXPECT_EQ(-1, cache->get(1, 5, &cache_entry));
+    append_logs(1, new_owner, 11, 20, 2, 10);
+    EXPECT_EQ(0, cache->get(1, 15, &cache_entry));
+
+    // 旧实例的写入、截断和析构不影响新实例的缓存
+    append_logs(1, old_owner, 21, 21, 1, 10);
+    EXPECT_EQ(-1, cache->get(1, 21, &cache_entry));
+    cache->truncate_suffix(1, old_owner, 12);
+    cache->truncate_prefix(1, old_owner, 18);
+    cache->remove(1, old_owner);
+    EXPECT_EQ(0, cache->get(1, 11, &cache_entry));
+    EXPECT_EQ(0, cache->get(1, 20, &cache_entry));
+    EXPECT_EQ(2, cache_entry.term);
+
+    cache->remove(1, new_owner);
+    EXPECT_EQ(-1, cache->get(1, 20, &cache_entry));
+    EXPECT_EQ(0, cache->used_bytes());
+}
+} // namespace baikaldb
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,143 @@
+// Copyright (c) 2018 Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include "common.h"
+#include "rocks_wrapper.h"
+#include "raft_log_writer.h"
+#include "mut_table_key.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    google::ParseCommandLineFlags(&argc, &argv, true);
+    if (baikaldb::RocksWrapper::get_instance()->init("rocks_raft_log_writer") != 0) {
+        std::cout << "rocksdb init fail" << std::endl;
+        return -1;
+    }
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_bool(raft_log_sync);
+DECLARE_int64(raft_log_group_window_us);
+DECLARE_int32(raft_log_group_max_writers);
+
+static const int REGION_COUNT = 64;
+static const int WRITES_PER_REGION = 100;
+
+static std::string make_key(int64_t region_id, int64_t index) {
+    MutTableKey key;
+    key.append_i64(region_id).append_u8(0x02).append_i64(index);
+    return key.data();
+}
+
+// 64个region并发写，每个region顺序写100次，对比rocksdb写入(sync)次数
+TEST(test_raft_log_writer, group_vs_direct) {
+    FLAGS_raft_log_sync = true;
+    RocksWrapper* db = RocksWrapper::get_instance();
+    auto handle = db->get_raft_log_handle();
+
+    std::atomic<int64_t> direct_writes(0);
+    TimeCost direct_cost;
+    {
+        ConcurrencyBthread bths(REGION_COUNT);
+        for (int region_id = 1; region_id <= REGION_COUNT; ++region_id) {
+            bths.run([db, handle, region_id, &direct_writes]() {
+                for (int i = 0; i < WRITES_PER_REGION; ++i) {
+                    rocksdb::WriteBatch batch;
+                    batch.Put(handle, make_key(region_id, i), "value");
+                    rocksdb::WriteOptions options;
+                    options.sync = true;
+                    EXPECT_TRUE(db->write(options, &batch).ok());
+                    direct_writes++;
+                }
+            });
+        }
+        bths.join();
+    }
+    int64_t direct_time = direct_cost.get_time();
+
+    // 每轮等待1ms收集其他region的写入，合并效果不依赖fsync耗时
+    FLAGS_raft_log_group_window_us = 1000;
+    RaftLogWriter* writer = RaftLogWriter::get_instance();
+    int64_t write_count = writer->write_count();
+    int64_t request_count = writer->request_count();
+    TimeCost group_cost;
+    {
+        ConcurrencyBthread bths(REGION_COUNT);
+        for (int region_id = REGION_COUNT + 1; region_id <= 2 * REGION_COUNT; ++region_id) {
+            bths.run([writer, handle, region_id]() {
+                for (int i = 0; i < WRITES_PER_REGION; ++i) {
+                    std::string key = make_key(region_id, i);
+                    auto status = writer->write([handle, &key](rocksdb::WriteBatch* batch) {
+                        batch->Put(handle, key, "value");
+                    }, 1);
+                    EXPECT_TRUE(status.ok());
+                }
+            });
+        }
+        bths.join();
+    }
+    int64_t group_time = group_cost.get_time();
+    int64_t group_writes = writer->write_count() - write_count;
+    EXPECT_EQ(REGION_COUNT * WRITES_PER_REGION, writer->request_count() - request_count);
+    // 64个region并发，平均每次写入至少合并4个region
+    EXPECT_LT(group_writes * 4, REGION_COUNT * WRITES_PER_REGION);
+    FLAGS_raft_log_group_window_us = 0;
+    std::cout << "direct: writes(fsync): " << direct_writes.load() << " cost: " << direct_time
+              << "us; group: writes(fsync): " << group_writes << " cost: " << group_time << "us"
+              << std::endl;
+
+    // 合并写入的数据全部可见
+    for (int region_id = REGION_COUNT + 1; region_id <= 2 * REGION_COUNT; ++region_id) {
+        for (int i = 0; i < WRITES_PER_REGION; ++i) {
+            std::string value;
+            auto status = db->get(rocksdb::ReadOptions(), handle, make_key(region_id, i), &value);
+            ASSERT_TRUE(status.ok());
+            EXPECT_EQ("value", value);
+        }
+    }
+}
+// 单次合并的region数不超过raft_log_group_max_writers
+TEST(test_raft_log_writer, max_writers) {
+    FLAGS_raft_log_sync = true;
+    FLAGS_raft_log_group_window_us = 1000;
+    FLAGS_raft_log_group_max_writers = 8;
+    RocksWrapper* db = RocksWrapper::get_instance();
+    auto handle = db->get_raft_log_handle();
+    RaftLogWriter* writer = RaftLogWriter::get_instance();
+    int64_t write_count = writer->write_count();
+    {
+        ConcurrencyBthread bths(REGION_COUNT);
+        for (int region_id = 2 * REGION_COUNT + 1; region_id <= 3 * REGION_COUNT; ++region_id) {
+            bths.run([writer, handle, region_id]() {
+                for (int i = 0; i < WRITES_PER_REGION; ++i) {
+                    std::string key = make_key(region_id, i);
+                    auto status = writer->write([handle, &key](rocksdb::WriteBatch* batch) {
+                        batch->Put(handle, key, "value");
+                    }, 1);
+                    EXPECT_TRUE(status.ok());
+                }
+            });
+        }
+        bths.join();
+    }
+    int64_t group_writes = writer->write_count() - write_count;
+    EXPECT_GE(group_writes * 8, REGION_COUNT * WRITES_PER_REGION);
+    EXPECT_LT(group_writes * 4, REGION_COUNT * WRITES_PER_REGION);
+    FLAGS_raft_log_group_window_us = 0;
+    FLAGS_raft_log_group_max_writers = 512;
+}
+} // namespace baikaldb
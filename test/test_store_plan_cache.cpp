@@ -0,0 +1,113 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <string>
+#include "fetcher_store.h"
+#include "store_plan_cache.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+static void build_request(uint64_t sql_sign, pb::StoreReq* request) {
+    request->set_op_type(pb::OP_SELECT);
+    request->set_region_id(1);
+    request->set_region_version(1);
+    request->set_sql_sign(sql_sign);
+    pb::TupleDescriptor* tuple = request->add_tuples();
+    tuple->set_tuple_id(0);
+    tuple->set_table_id(1);
+    pb::PlanNode* node = request->mutable_plan()->add_nodes();
+    node->set_node_type(pb::SCAN_NODE);
+    node->set_limit(-1);
+    node->set_num_children(0);
+    request->set_tuple_sign(sql_sign + 1);
+    request->set_plan_sign(sql_sign + 2);
+}
+
+TEST(test_store_plan_cache, store_cache) {
+    StorePlanCache* cache = StorePlanCache::get_instance();
+    pb::StoreReq request;
+    build_request(100, &request);
+    SmartTupleDescs tuples;
+    SmartPbPlan plan;
+    EXPECT_EQ(-1, cache->find(100, request.tuple_sign(), &tuples));
+    EXPECT_EQ(-1, cache->find(100, request.plan_sign(), &plan));
+
+    cache->add(100, request.tuple_sign(), request.tuples());
+    cache->add(100, request.plan_sign(), request.plan());
+    ASSERT_EQ(0, cache->find(100, request.tuple_sign(), &tuples));
+    ASSERT_EQ(0, cache->find(100, request.plan_sign(), &plan));
+    ASSERT_EQ(1, tuples->size());
+    EXPECT_EQ(1, tuples->Get(0).table_id());
+    EXPECT_EQ(request.plan().ShortDebugString(), plan->ShortDebugString());
+
+    // 签名相同但sql不同不能命中
+    EXPECT_EQ(-1, cache->find(200, request.tuple_sign(), &tuples));
+    EXPECT_EQ(-1, cache->find(200, request.plan_sign(), &plan));
+}
+
+TEST(test_store_plan_cache, omit_and_resend) {
+    StorePlanCacheMarks* marks = StorePlanCacheMarks::get_instance();
+    const std::string addr = "127.0.0.1:8110";
+    const std::string backup = "127.0.0.1:8111";
+    pb::StoreReq request;
+    build_request(300, &request);
+    const std::string full = request.ShortDebugString();
+    google::protobuf::RepeatedPtrField<pb::TupleDescriptor> omitted_tuples;
+    pb::Plan omitted_plan;
+
+    // 首次请求带全量
+    marks->omit_cached(addr, "", &request, &omitted_tuples, &omitted_plan);
+    EXPECT_EQ(full, request.ShortDebugString());
+    marks->mark(addr, request);
+
+    // store已缓存后省略tuples和plan
+    marks->omit_cached(addr, "", &request, &omitted_tuples, &omitted_plan);
+    EXPECT_EQ(0, request.tuples_size());
+    EXPECT_FALSE(request.has_plan());
+    // 省略后的请求不会再次标记
+    marks->mark(addr, request);
+
+    // backup store未缓存时带全量
+    marks->omit_cached(addr, backup, &request, &omitted_tuples, &omitted_plan);
+    EXPECT_EQ(full, request.ShortDebugString());
+    marks->omit_cached(addr, "", &request, &omitted_tuples, &omitted_plan);
+    EXPECT_FALSE(request.has_plan());
+
+    // store返回PLAN_CACHE_MISS后清除标记，重发时带全量
+    marks->unmark(addr, request);
+    marks->omit_cached(addr, "", &request, &omitted_tuples, &omitted_plan);
+    EXPECT_EQ(full, request.ShortDebugString());
+    marks->mark(addr, request);
+    marks->omit_cached(addr, "", &request, &omitted_tuples, &omitted_plan);
+    EXPECT_EQ(0, request.tuples_size());
+    EXPECT_FALSE(request.has_plan());
+
+    // 相同sql不同常量的plan签名不同，只省略tuples
+    pb::StoreReq other;
+    build_request(300, &other);
+    other.set_plan_sign(request.plan_sign() + 1);
+    google::protobuf::RepeatedPtrField<pb::TupleDescriptor> other_tuples;
+    pb::Plan other_plan;
+    marks->omit_cached(addr, "", &other, &other_tuples, &other_plan);
+    EXPECT_EQ(0, other.tuples_size());
+    EXPECT_TRUE(other.has_plan());
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,137 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include "common.h"
+#include "fetcher_store.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+static std::shared_ptr<RowBatch> make_batch() {
+    return std::make_shared<RowBatch>();
+}
+
+TEST(test_stream_row_queue, backpressure) {
+    StreamRowQueue queue(2);
+    int owner = 0;
+    queue.add_producer();
+    std::atomic<int> pushed(0);
+    Bthread producer;
+    producer.run([&queue, &owner, &pushed]() {
+        for (int i = 0; i < 5; ++i) {
+            if (queue.push(&owner, make_batch()) != 0) {
+                return;
+            }
+            ++pushed;
+        }
+        queue.remove_producer();
+    });
+    // 未消费时接收端停在队列上限
+    bthread_usleep(100 * 1000);
+    EXPECT_EQ(2, pushed.load());
+
+    int popped = 0;
+    while (true) {
+        std::shared_ptr<RowBatch> batch;
+        bool eos = false;
+        int ret = queue.pop(&batch, &eos, 100 * 1000LL);
+        if (ret != 0) {
+            continue;
+        }
+        if (eos) {
+            break;
+        }
+        ASSERT_TRUE(batch != nullptr);
+        ++popped;
+    }
+    producer.join();
+    EXPECT_EQ(5, popped);
+    EXPECT_EQ(5, pushed.load());
+}
+
+TEST(test_stream_row_queue, eos_and_finish) {
+    StreamRowQueue queue(4);
+    std::shared_ptr<RowBatch> batch;
+    bool eos = false;
+    // 任务开始前不能判定结束
+    EXPECT_EQ(1, queue.pop(&batch, &eos, 1000));
+    EXPECT_FALSE(eos);
+    queue.finish();
+    EXPECT_EQ(0, queue.pop(&batch, &eos, 1000));
+    EXPECT_TRUE(eos);
+
+    // 分裂后的子任务先加入，父任务结束后仍等待子任务
+    StreamRowQueue split_queue(4);
+    int child = 0;
+    split_queue.add_producer();
+    split_queue.add_producer();
+    split_queue.remove_producer();
+    EXPECT_EQ(1, split_queue.pop(&batch, &eos, 1000));
+    EXPECT_EQ(0, split_queue.push(&child, make_batch()));
+    split_queue.remove_producer();
+    EXPECT_EQ(0, split_queue.pop(&batch, &eos, 1000));
+    EXPECT_FALSE(eos);
+    EXPECT_EQ(0, split_queue.pop(&batch, &eos, 1000));
+    EXPECT_TRUE(eos);
+}
+
+TEST(test_stream_row_queue, reset_for_retry) {
+    StreamRowQueue queue(4);
+    int first = 0;
+    int second = 0;
+    queue.add_producer();
+    queue.add_producer();
+    std::shared_ptr<RowBatch> first_batch = make_batch();
+    ASSERT_EQ(0, queue.push(&first, first_batch));
+    ASSERT_EQ(0, queue.push(&second, make_batch()));
+    ASSERT_EQ(0, queue.push(&second, make_batch()));
+    // 未被消费的行可以丢弃后重试，只丢弃自己的行
+    EXPECT_EQ(0, queue.reset_for_retry(&second));
+    std::shared_ptr<RowBatch> batch;
+    bool eos = false;
+    ASSERT_EQ(0, queue.pop(&batch, &eos, 1000));
+    EXPECT_EQ(first_batch, batch);
+    EXPECT_EQ(1, queue.pop(&batch, &eos, 1000));
+    // 已交给执行器的任务不能重试
+    EXPECT_EQ(-1, queue.reset_for_retry(&first));
+    EXPECT_EQ(0, queue.reset_for_retry(&second));
+}
+
+TEST(test_stream_row_queue, cancel_unblocks_push) {
+    StreamRowQueue queue(1);
+    int owner = 0;
+    queue.add_producer();
+    ASSERT_EQ(0, queue.push(&owner, make_batch()));
+    std::atomic<int> ret(0);
+    Bthread producer;
+    producer.run([&queue, &owner, &ret]() {
+        ret = queue.push(&owner, make_batch());
+    });
+    bthread_usleep(50 * 1000);
+    queue.cancel();
+    producer.join();
+    EXPECT_EQ(-1, ret.load());
+    std::shared_ptr<RowBatch> batch;
+    bool eos = false;
+    EXPECT_EQ(0, queue.pop(&batch, &eos, 1000));
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,113 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include "network_socket.h"
+#include "runtime_state.h"
+#include "packet_node.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    signal(SIGPIPE, SIG_IGN);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_bool(enable_stream_send);
+DECLARE_int64(stream_send_threshold);
+
+class StreamPacketNode : public PacketNode {
+public:
+    StreamPacketNode(NetworkSocket* client) {
+        _client = client;
+        _send_buf = client->send_buf;
+        _stream_send = true;
+    }
+    using PacketNode::stream_send;
+};
+
+// 客户端一侧读取指定字节数后关闭连接
+static void read_and_close(int fd, size_t size, std::string* received) {
+    char buf[4096];
+    while (received->size() < size) {
+        ssize_t len = read(fd, buf, std::min(sizeof(buf), size - received->size()));
+        if (len <= 0) {
+            break;
+        }
+        received->append(buf, len);
+    }
+    close(fd);
+}
+
+static std::string make_payload(size_t size, char seed) {
+    std::string payload(size, 0);
+    for (size_t i = 0; i < size; ++i) {
+        payload[i] = seed + i % 26;
+    }
+    return payload;
+}
+
+TEST(test_stream_send, default_off) {
+    EXPECT_FALSE(FLAGS_enable_stream_send);
+}
+
+TEST(test_stream_send, flush_then_error) {
+    FLAGS_stream_send_threshold = 64 * 1024;
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    // 与reactor上的client fd一致，使用非阻塞写
+    ASSERT_EQ(0, fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK));
+    NetworkSocket client;
+    client.fd = fds[0];
+    RuntimeState state;
+    StreamPacketNode packet_node(&client);
+    DataBuffer* send_buf = client.send_buf;
+
+    // 未达到阈值时不发送
+    std::string small = make_payload(1000, 'a');
+    ASSERT_TRUE(send_buf->byte_array_append_len((const uint8_t*)small.data(), small.size()));
+    ASSERT_EQ(0, packet_node.stream_send(&state));
+    EXPECT_EQ(small.size(), send_buf->_size);
+
+    // 超过阈值整体发出，远大于socket缓冲区，需要等待可写
+    std::string large = make_payload(1024 * 1024, 'A');
+    ASSERT_TRUE(send_buf->byte_array_append_len((const uint8_t*)large.data(), large.size()));
+    std::string received;
+    std::thread reader(read_and_close, fds[1], small.size() + large.size(), &received);
+    client.packet_id = 7;
+    int ret = packet_node.stream_send(&state);
+    reader.join();
+    ASSERT_EQ(0, ret);
+    EXPECT_EQ(0UL, send_buf->_size);
+    EXPECT_EQ(small + large, received);
+    EXPECT_EQ(7, client.last_packet_id);
+
+    // 部分结果已发出后客户端断开，返回写错误，错误包从已发出的packet_id之后继续
+    ASSERT_TRUE(send_buf->byte_array_append_len((const uint8_t*)large.data(), large.size()));
+    client.packet_id = 9;
+    EXPECT_EQ(-1, packet_node.stream_send(&state));
+    EXPECT_EQ(ER_NET_ERROR_ON_WRITE, state.error_code);
+    EXPECT_EQ(7, client.last_packet_id);
+    EXPECT_EQ(large.size(), send_buf->_size);
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
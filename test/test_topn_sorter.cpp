@@ -0,0 +1,152 @@
+// Copyright (c) 2018 Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <vector>
+#include "mem_row_descriptor.h"
+#include "mem_row.h"
+#include "topn_sorter.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+
+TEST(test_topn_sorter, case_all) {
+    std::vector<pb::TupleDescriptor> tuple_desc;
+    pb::TupleDescriptor tuple;
+    tuple.set_tuple_id(0);
+    tuple.set_table_id(1);
+    pb::SlotDescriptor* slot = tuple.add_slots();
+    slot->set_slot_id(1);
+    slot->set_slot_type(pb::INT64);
+    slot->set_tuple_id(0);
+    tuple_desc.push_back(tuple);
+    MemRowDescriptor desc;
+    ASSERT_EQ(0, desc.init(tuple_desc));
+
+    pb::Expr slot_expr;
+    pb::ExprNode* node = slot_expr.add_nodes();
+    node->set_node_type(pb::SLOT_REF);
+    node->set_col_type(pb::INT64);
+    node->set_num_children(0);
+    node->mutable_derive_node()->set_tuple_id(0);
+    node->mutable_derive_node()->set_slot_id(1);
+    ExprNode* order_expr = nullptr;
+    ASSERT_EQ(0, ExprNode::create_tree(slot_expr, &order_expr));
+    std::vector<ExprNode*> order_exprs {order_expr};
+    // order by id desc limit 5
+    std::vector<bool> is_asc {false};
+    std::vector<bool> is_null_first {false};
+    MemRowCompare comp(order_exprs, is_asc, is_null_first);
+    TopNSorter sorter(&comp, 5);
+
+    int64_t released_bytes = 0;
+    for (int b = 0; b < 4; b++) {
+        RowBatch batch;
+        for (int i = 0; i < 100; i++) {
+            std::unique_ptr<MemRow> row = desc.fetch_mem_row();
+            ExprValue id(pb::INT64);
+            id._u.int64_val = (i * 37 + b * 11) % 400;
+            row->set_value(0, 1, id);
+            batch.move_row(std::move(row));
+        }
+        sorter.add_batch(&batch, &released_bytes);
+        EXPECT_EQ(0, batch.size());
+    }
+    EXPECT_EQ(5, sorter.size());
+    EXPECT_GT(released_bytes, 0);
+    sorter.sort();
+
+    RowBatch out;
+    bool eos = false;
+    ASSERT_EQ(0, sorter.get_next(&out, &eos));
+    EXPECT_TRUE(eos);
+    ASSERT_EQ(5, out.size());
+    int64_t last = INT64_MAX;
+    for (out.reset(); !out.is_traverse_over(); out.next()) {
+        int64_t id = out.get_row()->get_value(0, 1).get_numberic<int64_t>();
+        EXPECT_LE(id, last);
+        last = id;
+    }
+    ExprNode::destroy_tree(order_expr);
+}
+
+TEST(test_mem_row_compare, sort_key) {
+    std::vector<pb::TupleDescriptor> tuple_desc;
+    pb::TupleDescriptor tuple;
+    tuple.set_tuple_id(0);
+    tuple.set_table_id(1);
+    pb::PrimitiveType types[] = {pb::INT64, pb::STRING};
+    for (int i = 0; i < 2; i++) {
+        pb::SlotDescriptor* slot = tuple.add_slots();
+        slot->set_slot_id(i + 1);
+        slot->set_slot_type(types[i]);
+        slot->set_tuple_id(0);
+    }
+    tuple_desc.push_back(tuple);
+    MemRowDescriptor desc;
+    ASSERT_EQ(0, desc.init(tuple_desc));
+
+    std::vector<ExprNode*> order_exprs;
+    for (int i = 0; i < 2; i++) {
+        pb::Expr slot_expr;
+        pb::ExprNode* node = slot_expr.add_nodes();
+        node->set_node_type(pb::SLOT_REF);
+        node->set_col_type(types[i]);
+        node->set_num_children(0);
+        node->mutable_derive_node()->set_tuple_id(0);
+        node->mutable_derive_node()->set_slot_id(i + 1);
+        ExprNode* order_expr = nullptr;
+        ASSERT_EQ(0, ExprNode::create_tree(slot_expr, &order_expr));
+        order_exprs.push_back(order_expr);
+    }
+    // order by id desc nulls first, name asc
+    std::vector<bool> is_asc {false, true};
+    std::vector<bool> is_null_first {true, false};
+    MemRowCompare comp(order_exprs, is_asc, is_null_first);
+
+    std::vector<std::unique_ptr<MemRow>> rows;
+    std::string names[] = {"", "a", std::string("a\0", 2), "ab", "b"};
+    for (int id = -2; id <= 2; id++) {
+        for (auto& name : names) {
+            std::unique_ptr<MemRow> row = desc.fetch_mem_row();
+            if (id != 0) {
+                ExprValue v(pb::INT64);
+                v._u.int64_val = id;
+                row->set_value(0, 1, v);
+            }
+            row->set_value(0, 2, ExprValue(pb::STRING, name));
+            rows.emplace_back(std::move(row));
+        }
+    }
+    std::vector<std::string> keys(rows.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        comp.encode_sort_key(rows[i].get(), &keys[i]);
+    }
+    for (size_t i = 0; i < rows.size(); i++) {
+        for (size_t j = 0; j < rows.size(); j++) {
+            int64_t expect = comp.compare(rows[i].get(), rows[j].get());
+            int actual = keys[i].compare(keys[j]);
+            EXPECT_EQ(expect < 0, actual < 0);
+            EXPECT_EQ(expect == 0, actual == 0);
+        }
+    }
+    for (auto expr : order_exprs) {
+        ExprNode::destroy_tree(expr);
+    }
+}
+}
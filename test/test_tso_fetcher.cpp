@@ -0,0 +1,121 @@
+// Copyright (c) 2020-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <vector>
+#include "binlog_context.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+// 模拟meta的tso分配，每次请求分配count个连续的tso
+class FakeTsoFetcher : public TsoFetcher {
+public:
+    using TsoFetcher::batch_get_tso;
+    virtual int64_t fetch_tso(int64_t count) {
+        bthread_usleep(2000);
+        std::lock_guard<std::mutex> lock(_mutex);
+        _batch_counts.emplace_back(count);
+        if (fail) {
+            return -1;
+        }
+        int64_t timestamp = _next;
+        _next += count;
+        return timestamp;
+    }
+    std::vector<int64_t> batch_counts() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _batch_counts;
+    }
+    std::atomic<bool> fail {false};
+private:
+    std::mutex _mutex;
+    int64_t _next = 1000;
+    std::vector<int64_t> _batch_counts;
+};
+
+TEST(test_tso_fetcher, unique_increasing) {
+    FakeTsoFetcher fetcher;
+    const int thread_num = 16;
+    const int call_num = 20;
+    std::vector<std::vector<int64_t>> results(thread_num);
+    ConcurrencyBthread callers(thread_num);
+    for (int i = 0; i < thread_num; ++i) {
+        std::vector<int64_t>* result = &results[i];
+        callers.run([&fetcher, result]() {
+            for (int j = 0; j < call_num; ++j) {
+                result->emplace_back(fetcher.batch_get_tso());
+            }
+        });
+    }
+    callers.join();
+    std::set<int64_t> all;
+    for (auto& result : results) {
+        ASSERT_EQ(call_num, (int)result.size());
+        for (size_t j = 0; j < result.size(); ++j) {
+            EXPECT_GE(result[j], 1000);
+            // 同一调用者后发起的请求拿到更大的tso
+            if (j > 0) {
+                EXPECT_GT(result[j], result[j - 1]);
+            }
+            all.insert(result[j]);
+        }
+    }
+    EXPECT_EQ(thread_num * call_num, (int)all.size());
+    std::vector<int64_t> counts = fetcher.batch_counts();
+    int64_t total = 0;
+    for (auto count : counts) {
+        total += count;
+    }
+    EXPECT_EQ(thread_num * call_num, total);
+    // rpc期间排队的请求合并发送
+    EXPECT_LT(counts.size(), (size_t)(thread_num * call_num));
+}
+
+TEST(test_tso_fetcher, fetch_failed) {
+    FakeTsoFetcher fetcher;
+    fetcher.fail = true;
+    const int thread_num = 16;
+    std::vector<int64_t> results(thread_num, 0);
+    ConcurrencyBthread callers(thread_num);
+    for (int i = 0; i < thread_num; ++i) {
+        int64_t* result = &results[i];
+        callers.run([&fetcher, result]() {
+            *result = fetcher.batch_get_tso();
+        });
+    }
+    callers.join();
+    // 同一批的所有调用者都拿到错误码
+    for (auto result : results) {
+        EXPECT_LT(result, 0);
+    }
+    std::vector<int64_t> counts = fetcher.batch_counts();
+    EXPECT_EQ(thread_num, std::accumulate(counts.begin(), counts.end(), 0L));
+    EXPECT_GT(*std::max_element(counts.begin(), counts.end()), 1);
+
+    // 失败后恢复，后续请求正常
+    fetcher.fail = false;
+    EXPECT_GE(fetcher.batch_get_tso(), 1000);
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
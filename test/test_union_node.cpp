@@ -0,0 +1,226 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "network_socket.h"
+#include "runtime_state.h"
+#include "transaction_pool.h"
+#include "union_node.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_int32(union_branch_concurrency);
+DECLARE_int32(union_max_queue_batches);
+
+static const int64_t BATCH_ROWS = 10;
+
+struct BranchOption {
+    int64_t begin = 0;
+    int64_t batch_num = 0;
+    int64_t sleep_us = 0;
+    // 第fail_at个batch时失败，-1表示不失败
+    int64_t fail_at = -1;
+};
+
+// 每个batch产出BATCH_ROWS行，值从begin开始递增
+class BranchNode : public ExecNode {
+public:
+    BranchNode(const BranchOption& option, std::atomic<int64_t>* produced) :
+        _option(option), _produced(produced) {}
+    virtual int get_next(RuntimeState* state, RowBatch* batch, bool* eos) {
+        if (_option.sleep_us > 0) {
+            bthread_usleep(_option.sleep_us);
+        }
+        if (_batch_idx == _option.fail_at) {
+            state->error_code = ER_LOCK_WAIT_TIMEOUT;
+            state->error_msg << "branch lock wait timeout";
+            return -1;
+        }
+        MemRowDescriptor* desc = state->mem_row_desc();
+        for (int64_t i = 0; i < BATCH_ROWS; ++i) {
+            std::unique_ptr<MemRow> row = desc->fetch_mem_row();
+            ExprValue value(pb::INT64);
+            value._u.int64_val = _option.begin + _batch_idx * BATCH_ROWS + i;
+            row->set_value(0, 1, value);
+            batch->move_row(std::move(row));
+        }
+        *_produced += BATCH_ROWS;
+        ++_batch_idx;
+        *eos = (_batch_idx >= _option.batch_num);
+        return 0;
+    }
+private:
+    BranchOption _option;
+    std::atomic<int64_t>* _produced;
+    int64_t _batch_idx = 0;
+};
+
+static void build_tuples(pb::StoreReq* req) {
+    for (int32_t tuple_id = 0; tuple_id < 2; tuple_id++) {
+        pb::TupleDescriptor* tuple = req->add_tuples();
+        tuple->set_tuple_id(tuple_id);
+        tuple->set_table_id(1);
+        pb::SlotDescriptor* slot = tuple->add_slots();
+        slot->set_slot_id(1);
+        slot->set_slot_type(pb::INT64);
+        slot->set_tuple_id(tuple_id);
+    }
+}
+
+static ExprNode* create_slot_ref() {
+    pb::Expr slot_expr;
+    pb::ExprNode* node = slot_expr.add_nodes();
+    node->set_node_type(pb::SLOT_REF);
+    node->set_col_type(pb::INT64);
+    node->set_num_children(0);
+    node->mutable_derive_node()->set_tuple_id(0);
+    node->mutable_derive_node()->set_slot_id(1);
+    ExprNode* expr = nullptr;
+    ExprNode::create_tree(slot_expr, &expr);
+    return expr;
+}
+
+struct UnionResult {
+    int ret = 0;
+    std::vector<int64_t> values;
+    int64_t produced = 0;
+    MysqlErrCode error_code = ER_ERROR_FIRST;
+    std::string error_msg;
+};
+
+static void run_union(const std::vector<BranchOption>& options, int64_t limit, UnionResult* result) {
+    pb::StoreReq req;
+    req.set_op_type(pb::OP_SELECT);
+    req.set_region_id(1);
+    req.set_region_version(1);
+    build_tuples(&req);
+    pb::Plan plan;
+    TransactionPool pool;
+    NetworkSocket client;
+    std::vector<std::unique_ptr<RuntimeState>> branch_states;
+    RuntimeState state;
+    ASSERT_EQ(0, state.init(req, plan, req.tuples(), &pool, false));
+    state.set_client_conn(&client);
+
+    pb::PlanNode pb_node;
+    pb_node.set_node_type(pb::UNION_NODE);
+    pb_node.set_limit(limit);
+    pb_node.set_num_children(options.size());
+    pb_node.mutable_derive_node()->mutable_union_node()->set_union_tuple_id(1);
+    std::atomic<int64_t> produced(0);
+    std::unique_ptr<UnionNode> union_node(new UnionNode);
+    ASSERT_EQ(0, union_node->init(pb_node));
+    for (auto& option : options) {
+        branch_states.emplace_back(new RuntimeState);
+        ASSERT_EQ(0, branch_states.back()->init(req, plan, req.tuples(), &pool, false));
+        branch_states.back()->set_client_conn(&client);
+        union_node->mutable_select_runtime_states()->push_back(branch_states.back().get());
+        union_node->add_child(new BranchNode(option, &produced));
+        std::vector<ExprNode*> projections {create_slot_ref()};
+        union_node->steal_projections(projections);
+    }
+    result->ret = union_node->open(&state);
+    bool eos = false;
+    while (result->ret == 0 && !eos) {
+        RowBatch batch;
+        result->ret = union_node->get_next(&state, &batch, &eos);
+        for (batch.reset(); !batch.is_traverse_over(); batch.next()) {
+            result->values.push_back(batch.get_row()->get_value(1, 1).get_numberic<int64_t>());
+        }
+    }
+    union_node->close(&state);
+    result->produced = produced.load();
+    result->error_code = state.error_code;
+    result->error_msg = state.error_msg.str();
+}
+
+class UnionNodeTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        FLAGS_union_branch_concurrency = 4;
+        FLAGS_union_max_queue_batches = 2;
+    }
+    virtual void TearDown() {
+        FLAGS_union_branch_concurrency = 4;
+        FLAGS_union_max_queue_batches = 16;
+    }
+};
+
+TEST_F(UnionNodeTest, order_independent) {
+    // 先启动的分支更慢，结果顺序与分支顺序无关，集合与顺序执行一致
+    std::vector<BranchOption> options(3);
+    for (size_t i = 0; i < options.size(); ++i) {
+        options[i].begin = i * 1000;
+        options[i].batch_num = 20;
+        options[i].sleep_us = (options.size() - i) * 1000;
+    }
+    UnionResult concurrent;
+    run_union(options, -1, &concurrent);
+    ASSERT_EQ(0, concurrent.ret);
+    FLAGS_union_branch_concurrency = 1;
+    UnionResult sequential;
+    run_union(options, -1, &sequential);
+    ASSERT_EQ(0, sequential.ret);
+    ASSERT_EQ(600UL, concurrent.values.size());
+    std::sort(concurrent.values.begin(), concurrent.values.end());
+    EXPECT_EQ(sequential.values, concurrent.values);
+}
+
+TEST_F(UnionNodeTest, early_limit) {
+    std::vector<BranchOption> options(3);
+    for (size_t i = 0; i < options.size(); ++i) {
+        options[i].begin = i * 100000;
+        options[i].batch_num = 1000;
+    }
+    UnionResult result;
+    run_union(options, 25, &result);
+    ASSERT_EQ(0, result.ret);
+    EXPECT_EQ(25UL, result.values.size());
+    // 队列有界，达到limit后分支被停止，不会读完全部数据
+    EXPECT_LT(result.produced, 3 * 1000 * BATCH_ROWS / 10);
+}
+
+TEST_F(UnionNodeTest, failed_branch) {
+    std::vector<BranchOption> options(3);
+    for (size_t i = 0; i < options.size(); ++i) {
+        options[i].begin = i * 100000;
+        options[i].batch_num = 100;
+        options[i].sleep_us = 1000;
+    }
+    options[1].fail_at = 3;
+    UnionResult result;
+    run_union(options, -1, &result);
+    EXPECT_EQ(-1, result.ret);
+    EXPECT_EQ(ER_LOCK_WAIT_TIMEOUT, result.error_code);
+    EXPECT_EQ("branch lock wait timeout", result.error_msg);
+
+    FLAGS_union_branch_concurrency = 1;
+    UnionResult sequential;
+    run_union(options, -1, &sequential);
+    EXPECT_EQ(-1, sequential.ret);
+    EXPECT_EQ(ER_LOCK_WAIT_TIMEOUT, sequential.error_code);
+    EXPECT_EQ("branch lock wait timeout", sequential.error_msg);
+}
+}
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,228 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "common.h"
+#include "schema_factory.h"
+#include "rocks_wrapper.h"
+#include "mut_table_key.h"
+#include "table_record.h"
+#include "transaction.h"
+#include "meta_writer.h"
+#include "closure.h"
+#include "region.h"
+
+namespace baikaldb {
+static const int64_t TABLE_ID = 1;
+
+static void init_table() {
+    pb::SchemaInfo info;
+    info.set_namespace_name("test_namespace");
+    info.set_database("test_database");
+    info.set_table_name("test_write_set");
+    info.set_partition_num(1);
+    info.set_namespace_id(1);
+    info.set_database_id(1);
+    info.set_table_id(TABLE_ID);
+    info.set_version(1);
+    pb::FieldInfo* field = info.add_fields();
+    field->set_field_name("id");
+    field->set_field_id(1);
+    field->set_mysql_type(pb::INT64);
+    field = info.add_fields();
+    field->set_field_name("v");
+    field->set_field_id(2);
+    field->set_mysql_type(pb::INT64);
+    pb::IndexInfo* index = info.add_indexs();
+    index->set_index_type(pb::I_PRIMARY);
+    index->set_index_name("pk_index");
+    index->set_index_id(TABLE_ID);
+    index->add_field_ids(1);
+    SchemaFactory::get_instance()->init();
+    SchemaFactory::get_instance()->update_table(info);
+}
+
+static SmartRecord make_row(int64_t id, int64_t v) {
+    SmartRecord record = SchemaFactory::get_instance()->new_record(TABLE_ID);
+    record->set_int64(record->get_field_by_tag(1), id);
+    record->set_int64(record->get_field_by_tag(2), v);
+    return record;
+}
+
+static int64_t count_rows(int64_t region_id) {
+    auto rocksdb = RocksWrapper::get_instance();
+    rocksdb::ReadOptions read_options;
+    read_options.prefix_same_as_start = true;
+    std::unique_ptr<rocksdb::Iterator> iter(rocksdb->new_iterator(read_options, rocksdb->get_data_handle()));
+    MutTableKey prefix;
+    prefix.append_i64(region_id).append_i64(TABLE_ID);
+    int64_t count = 0;
+    for (iter->Seek(prefix.data()); iter->Valid() && iter->key().starts_with(prefix.data()); iter->Next()) {
+        ++count;
+    }
+    return count;
+}
+
+TEST(test_write_set, replay_on_follower) {
+    const int64_t region_id = 201;
+    SmartIndex pk_ptr = SchemaFactory::get_instance()->get_index_info_ptr(TABLE_ID);
+    // leader执行一次，事务内记录kv写集
+    SmartTransaction leader_txn(new Transaction(0, nullptr));
+    ASSERT_EQ(0, leader_txn->begin(Transaction::TxnOptions()));
+    leader_txn->set_separate(true);
+    for (int64_t id = 0; id < 10; ++id) {
+        ASSERT_EQ(0, leader_txn->put_primary(region_id, *pk_ptr, make_row(id, id * 10)));
+    }
+    ASSERT_EQ(0, leader_txn->remove(region_id, *pk_ptr, make_row(3, 0)));
+    pb::StoreReq write_set;
+    write_set.CopyFrom(*leader_txn->get_raftreq());
+    ASSERT_EQ(11, write_set.kv_ops_size());
+    EXPECT_EQ(pb::OP_DELETE_KV, write_set.kv_ops(10).op_type());
+    EXPECT_TRUE(write_set.kv_ops(10).is_primary_key());
+    leader_txn->rollback();
+    EXPECT_EQ(0, count_rows(region_id));
+
+    // follower只按写集put/delete，不执行plan
+    SmartTransaction follower_txn(new Transaction(0, nullptr));
+    ASSERT_EQ(0, follower_txn->begin(Transaction::TxnOptions()));
+    for (auto& kv_op : write_set.kv_ops()) {
+        if (kv_op.op_type() == pb::OP_PUT_KV) {
+            ASSERT_EQ(0, follower_txn->put_kv(kv_op.key(), kv_op.value(), kv_op.ttl_timestamp_us()));
+        } else {
+            ASSERT_EQ(0, follower_txn->delete_kv(kv_op.key()));
+        }
+    }
+    ASSERT_TRUE(follower_txn->commit().ok());
+    EXPECT_EQ(9, count_rows(region_id));
+
+    // 写入的值与leader编码一致
+    MutTableKey key;
+    key.append_i64(region_id).append_i64(TABLE_ID);
+    SmartRecord row = make_row(5, 50);
+    ASSERT_EQ(0, key.append_index(*pk_ptr, row.get(), -1, true));
+    auto rocksdb = RocksWrapper::get_instance();
+    std::string value;
+    ASSERT_TRUE(rocksdb->get(rocksdb::ReadOptions(), rocksdb->get_data_handle(), key.data(), &value).ok());
+    SmartRecord decoded = SchemaFactory::get_instance()->new_record(TABLE_ID);
+    ASSERT_EQ(0, decoded->decode(value));
+    EXPECT_EQ(50, decoded->get_value(decoded->get_field_by_tag(2)).get_numberic<int64_t>());
+}
+
+TEST(test_write_set, version_conflict) {
+    pb::StoreReq request;
+    request.set_op_type(pb::OP_KV_BATCH);
+    request.set_region_id(1);
+    request.set_region_version(5);
+    // 计算存储分离表不带校验标记，保持原有行为
+    EXPECT_FALSE(Region::is_write_set_stale(request, 6));
+
+    request.set_check_write_set_version(true);
+    EXPECT_FALSE(Region::is_write_set_stale(request, 5));
+    // 执行后发生分裂，各副本统一放弃
+    EXPECT_TRUE(Region::is_write_set_stale(request, 6));
+    // 分裂中的新region version为0，按分裂流程处理
+    EXPECT_FALSE(Region::is_write_set_stale(request, 0));
+}
+// leader产生的事务外写集
+static std::shared_ptr<pb::StoreReq> make_write_set(int64_t region_id, const std::vector<int64_t>& ids) {
+    SmartIndex pk_ptr = SchemaFactory::get_instance()->get_index_info_ptr(TABLE_ID);
+    SmartTransaction txn(new Transaction(0, nullptr));
+    txn->begin(Transaction::TxnOptions());
+    txn->set_separate(true);
+    for (int64_t id : ids) {
+        txn->put_primary(region_id, *pk_ptr, make_row(id, id));
+    }
+    auto request = std::make_shared<pb::StoreReq>(*txn->get_raftreq());
+    txn->rollback();
+    request->set_op_type(pb::OP_KV_BATCH);
+    request->set_region_id(region_id);
+    request->set_region_version(1);
+    request->set_num_increase_rows(ids.size());
+    request->set_check_write_set_version(true);
+    return request;
+}
+
+TEST(test_write_set, group_apply) {
+    const int64_t region_id = 202;
+    pb::RegionInfo region_info;
+    region_info.set_region_id(region_id);
+    region_info.set_table_id(TABLE_ID);
+    region_info.set_version(1);
+    // 只走follower的apply路径，region未init，不做shutdown
+    Region* region = new Region(RocksWrapper::get_instance(), SchemaFactory::get_instance(),
+            "127.0.0.1:8110", "region_202", braft::PeerId(), region_info, region_id);
+
+    std::vector<Region::ApplyEntry> group;
+    for (int64_t i = 0; i < 3; ++i) {
+        auto request = make_write_set(region_id, {i * 10, i * 10 + 1, i * 10 + 2});
+        ASSERT_TRUE(region->can_group_apply(*request, nullptr));
+        group.emplace_back(Region::ApplyEntry{1, i + 1, request});
+    }
+    region->apply_kv_out_txn_group(group);
+    EXPECT_TRUE(group.empty());
+    EXPECT_EQ(9, count_rows(region_id));
+    EXPECT_EQ(3, region->get_log_index());
+    EXPECT_EQ(9, region->get_num_table_lines());
+    // 一次提交写入最后一条日志的index
+    int64_t applied_index = 0;
+    int64_t data_index = 0;
+    MetaWriter::get_instance()->read_applied_index(region_id, &applied_index, &data_index);
+    EXPECT_EQ(3, applied_index);
+    EXPECT_EQ(3, data_index);
+    EXPECT_EQ(9, MetaWriter::get_instance()->read_num_table_lines(region_id));
+
+    // 已apply的日志在组内被跳过，不影响同组的其他日志
+    group.emplace_back(Region::ApplyEntry{1, 3, make_write_set(region_id, {100})});
+    group.emplace_back(Region::ApplyEntry{1, 4, make_write_set(region_id, {200})});
+    region->apply_kv_out_txn_group(group);
+    EXPECT_EQ(10, count_rows(region_id));
+    EXPECT_EQ(4, region->get_log_index());
+    EXPECT_EQ(10, region->get_num_table_lines());
+
+    // 单条日志按原路径apply
+    group.emplace_back(Region::ApplyEntry{1, 5, make_write_set(region_id, {300, 301})});
+    region->apply_kv_out_txn_group(group);
+    EXPECT_EQ(12, count_rows(region_id));
+    EXPECT_EQ(5, region->get_log_index());
+
+    // 版本不一致、事务内、leader上带closure的日志不合并，各自单独apply
+    auto stale = make_write_set(region_id, {400});
+    stale->set_region_version(2);
+    EXPECT_FALSE(region->can_group_apply(*stale, nullptr));
+    auto in_txn = make_write_set(region_id, {500});
+    in_txn->add_txn_infos()->set_txn_id(1);
+    EXPECT_FALSE(region->can_group_apply(*in_txn, nullptr));
+    auto leader = make_write_set(region_id, {600});
+    DMLClosure done;
+    EXPECT_FALSE(region->can_group_apply(*leader, &done));
+}
+} // namespace baikaldb
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    google::ParseCommandLineFlags(&argc, &argv, true);
+    if (baikaldb::RocksWrapper::get_instance()->init("rocks_write_set") != 0) {
+        std::cout << "rocksdb init fail" << std::endl;
+        return -1;
+    }
+    auto rocksdb = baikaldb::RocksWrapper::get_instance();
+    baikaldb::MetaWriter::get_instance()->init(rocksdb, rocksdb->get_meta_info_handle());
+    baikaldb::init_table();
+    return RUN_ALL_TESTS();
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */